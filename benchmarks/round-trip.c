@@ -0,0 +1,293 @@
+/* SPDX-License-Identifier: MIT */
+/* -------------------------------------------------------------------------- */
+
+// This benchmark measures the round-trip latency of requests served through
+// KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM, by using kbdus directly (without
+// libbdus) to serve small O_DIRECT reads issued one at a time by another thread
+// with a driver that does no work, and prints the results as a JSON object.
+
+// Usage: round-trip [<num_requests>]
+
+/* -------------------------------------------------------------------------- */
+
+#define _GNU_SOURCE
+
+#include <kbdus.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+
+enum
+{
+    DEVICE_SIZE  = 1 << 20,
+    REQUEST_SIZE = 512,
+    NUM_WARMUP   = 1000,
+};
+
+struct bench_state
+{
+    int control_fd;
+    uint64_t dev_id;
+    pthread_t thread;
+    bool success;
+
+    size_t num_requests;
+    uint64_t *latencies_ns;
+    uint64_t total_ns;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t *sorted, size_t count, double p)
+{
+    size_t i = (size_t)(p / 100.0 * (double)count);
+    return sorted[i < count ? i : count - 1];
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool run_requests(struct bench_state *state, int fd, char *buf)
+{
+    for (size_t i = 0; i < NUM_WARMUP + state->num_requests; ++i)
+    {
+        const off_t offset =
+            (off_t)(i % (DEVICE_SIZE / REQUEST_SIZE)) * REQUEST_SIZE;
+
+        const uint64_t start = now_ns();
+
+        if (pread(fd, buf, REQUEST_SIZE, offset) != REQUEST_SIZE)
+            return false;
+
+        if (i >= NUM_WARMUP)
+        {
+            const uint64_t latency = now_ns() - start;
+
+            state->latencies_ns[i - NUM_WARMUP] = latency;
+            state->total_ns += latency;
+        }
+    }
+
+    return true;
+}
+
+static void *run_workload(void *arg)
+{
+    struct bench_state *const state = arg;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/dev/bdus-%" PRIu64, state->dev_id);
+
+    const int fd = open(path, O_RDONLY | O_DIRECT);
+
+    if (fd >= 0)
+    {
+        void *buf;
+
+        if (posix_memalign(&buf, 4096, REQUEST_SIZE) == 0)
+        {
+            state->success = run_requests(state, fd, buf);
+            free(buf);
+        }
+
+        close(fd);
+    }
+
+    // make the driver loop receive a "terminate" item
+
+    ioctl(state->control_fd, KBDUS_IOCTL_TERMINATE);
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Serves requests until a "terminate" item is received.
+static bool serve(
+    struct bench_state *state, union kbdus_reply_or_item *rai,
+    size_t payload_size, size_t page_size)
+{
+    void *payload;
+
+    if (posix_memalign(&payload, page_size, payload_size) != 0)
+        return false;
+
+    rai->common.handle_index = 0;
+
+    while (true)
+    {
+        rai->common.user_ptr_or_buffer_index = (uint64_t)(uintptr_t)payload;
+        rai->common.use_preallocated_buffer  = 0;
+
+        if (ioctl(
+                state->control_fd, KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM, 0)
+            != 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        switch ((enum kbdus_item_type)rai->item.type)
+        {
+        case KBDUS_ITEM_TYPE_DEVICE_AVAILABLE:
+            rai->common.handle_index = 0;
+
+            if (pthread_create(&state->thread, NULL, run_workload, state) != 0)
+                goto out;
+
+            break;
+
+        case KBDUS_ITEM_TYPE_TERMINATE:
+        case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
+            free(payload);
+            return true;
+
+        default:
+            // leave the payload buffer as is, as its contents don't matter
+
+            if (rai->item.type == KBDUS_ITEM_TYPE_READ)
+                rai->reply.error = 0;
+            else
+                rai->reply.error = EOPNOTSUPP;
+
+            rai->reply.use_splice = 0;
+
+            break;
+        }
+    }
+
+out:
+    free(payload);
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    static struct bench_state state;
+
+    // parse arguments
+
+    state.num_requests = 100000;
+
+    if (argc > 2
+        || (argc == 2 && sscanf(argv[1], "%zu", &state.num_requests) != 1)
+        || state.num_requests == 0)
+    {
+        fprintf(stderr, "Usage: %s [<num_requests>]\n", argv[0]);
+        return 2;
+    }
+
+    state.latencies_ns =
+        calloc(state.num_requests, sizeof(*state.latencies_ns));
+
+    if (!state.latencies_ns)
+        return 1;
+
+    // create device
+
+    state.control_fd = open("/dev/bdus-control", O_RDWR | O_CLOEXEC);
+
+    if (state.control_fd < 0)
+    {
+        perror("Error: Failed to open /dev/bdus-control");
+        return 1;
+    }
+
+    struct kbdus_device_and_fd_config config = {
+        .device =
+            {
+                .size                 = DEVICE_SIZE,
+                .logical_block_size   = REQUEST_SIZE,
+                .max_outstanding_reqs = 1,
+                .supports_read        = true,
+            },
+    };
+
+    if (ioctl(state.control_fd, KBDUS_IOCTL_CREATE_DEVICE, &config) != 0)
+    {
+        perror("Error: KBDUS_IOCTL_CREATE_DEVICE failed");
+        return 1;
+    }
+
+    state.dev_id = config.device.id;
+
+    // map the only reply-or-item into memory and serve requests
+
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    union kbdus_reply_or_item *const rai = mmap(
+        NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        state.control_fd, 0);
+
+    if (rai == MAP_FAILED)
+    {
+        perror("Error: mmap() failed");
+        return 1;
+    }
+
+    const bool served = serve(
+        &state, rai, (size_t)config.device.max_read_write_size, page_size);
+
+    if (served)
+        pthread_join(state.thread, NULL);
+
+    munmap(rai, page_size);
+    close(state.control_fd);
+
+    if (!served || !state.success)
+    {
+        fprintf(stderr, "Error: Failed to serve requests\n");
+        return 1;
+    }
+
+    // print results
+
+    qsort(
+        state.latencies_ns, state.num_requests, sizeof(*state.latencies_ns),
+        compare_u64);
+
+    const size_t n = state.num_requests;
+
+    printf(
+        "{\"benchmark\": \"round-trip\", \"requests\": %zu, \"iops\": %.1f,"
+        " \"lat_mean_ns\": %" PRIu64 ", \"lat_p50_ns\": %" PRIu64
+        ", \"lat_p99_ns\": %" PRIu64 ", \"lat_p99.9_ns\": %" PRIu64 "}\n",
+        n, (double)n * 1e9 / (double)state.total_ns, state.total_ns / n,
+        percentile(state.latencies_ns, n, 50.0),
+        percentile(state.latencies_ns, n, 99.0),
+        percentile(state.latencies_ns, n, 99.9));
+
+    free(state.latencies_ns);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,216 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# Runs fio jobs against devices served by the drivers in the /examples
+# directory and by the transport benchmark driver, as well as the round-trip
+# microbenchmark, and prints the results to stdout as a single JSON document.
+#
+# Requires BDUS to be installed, and fio and jq to be available. The following
+# environment variables can be set to configure the benchmarks:
+#
+#   BENCH_RUNTIME    Seconds for which each fio job runs (default: 10).
+#   BENCH_MAX_JOBS   Maximum number of concurrent fio jobs (default: nproc).
+#   BENCH_REQUESTS   Requests issued by the round-trip benchmark (default:
+#                    100000).
+
+# ---------------------------------------------------------------------------- #
+
+set -o errexit -o pipefail -o nounset
+
+script_dir="$( readlink -e "$0" | xargs dirname )"
+repo_root="$( readlink -e "${script_dir}/.." )"
+
+runtime="${BENCH_RUNTIME:-10}"
+max_jobs="${BENCH_MAX_JOBS:-$( nproc )}"
+num_requests="${BENCH_REQUESTS:-100000}"
+
+# check usage
+
+if (( $# != 0 )); then
+    >&2 echo "Usage: run.bash"
+    exit 2
+fi
+
+# check permissions and dependencies
+
+(( EUID == 0 )) || { >&2 echo "Must be run as root."; exit 1; }
+
+for cmd in bdus fio jq; do
+    command -v "${cmd}" > /dev/null ||
+        { >&2 echo "Command '${cmd}' not found."; exit 1; }
+done
+
+# make sure kbdus is loaded
+
+modprobe kbdus
+
+# compile drivers
+
+temp_dir="$( mktemp -d )"
+trap '{ rm -fr "${temp_dir}"; }' EXIT
+
+for driver in ram zero; do
+    "${CC:-cc}" -std=c99 -O2 \
+        "${repo_root}/examples/${driver}.c" -lbdus -o "${temp_dir}/${driver}"
+done
+
+"${CC:-cc}" -std=c99 -O2 \
+    "${script_dir}/transport.c" -lbdus -o "${temp_dir}/transport"
+
+"${CC:-cc}" -std=c99 -O2 -pthread -I"${repo_root}/kbdus/include" \
+    "${script_dir}/round-trip.c" -o "${temp_dir}/round-trip"
+
+# ---------------------------------------------------------------------------- #
+
+# Usage: run_fio <driver> <device> <rw> <bs> <iodepth> <numjobs>
+#
+# Prints the job's results as a JSON object.
+function run_fio()
+{
+    fio \
+        --output-format=json --name="$3" --filename="$2" \
+        --rw="$3" --bs="$4" --iodepth="$5" --numjobs="$6" \
+        --ioengine=libaio --direct=1 --group_reporting \
+        --time_based --runtime="${runtime}" --ramp_time=1 |
+    jq --compact-output \
+        --arg driver "$1" --arg rw "$3" --arg bs "$4" \
+        --argjson iodepth "$5" --argjson numjobs "$6" \
+        '.jobs[0]
+        | (if .read.io_bytes > 0 then .read else .write end) as $op
+        | {
+            benchmark: "fio",
+            driver: $driver,
+            rw: $rw,
+            bs: $bs,
+            iodepth: $iodepth,
+            numjobs: $numjobs,
+            iops: $op.iops,
+            bw_bytes: $op.bw_bytes,
+            lat_mean_ns: $op.clat_ns.mean,
+            lat_p50_ns: $op.clat_ns.percentile["50.000000"],
+            lat_p99_ns: $op.clat_ns.percentile["99.000000"],
+            "lat_p99.9_ns": $op.clat_ns.percentile["99.900000"]
+        }'
+}
+
+# Usage: run_driver_benchmarks <driver> <writable>
+#
+# Prints the results of each job as a JSON object.
+function run_driver_benchmarks()
+{
+    local device jobs qd rw rws
+
+    device="$( "${temp_dir}/$1" )"
+
+    (( $2 )) && rws=( read write ) || rws=( read )
+
+    # 4 KiB random requests at increasing queue depths
+
+    for rw in "${rws[@]}"; do
+        for qd in 1 2 4 8 16 32 64 128; do
+            run_fio "$1" "${device}" "rand${rw}" 4k "${qd}" 1
+        done
+    done
+
+    # 1 MiB sequential requests
+
+    for rw in "${rws[@]}"; do
+        run_fio "$1" "${device}" "${rw}" 1m 16 1
+    done
+
+    # 4 KiB random reads from an increasing number of threads
+
+    for (( jobs = 1; jobs < max_jobs; jobs *= 2 )); do
+        run_fio "$1" "${device}" randread 4k 1 "${jobs}"
+    done
+
+    run_fio "$1" "${device}" randread 4k 1 "${max_jobs}"
+
+    bdus destroy --quiet "${device}"
+}
+
+# Usage: sum_voluntary_ctxt_switches <pid>
+#
+# Prints the number of times that the threads of the given process slept, i.e.,
+# that they had to be woken up.
+function sum_voluntary_ctxt_switches()
+{
+    cat /proc/"$1"/task/*/status |
+        awk '$1 == "voluntary_ctxt_switches:" { n += $2 } END { print n }'
+}
+
+# Usage: sum_completed_requests <device>
+#
+# Prints the number of read and write requests that the device completed.
+function sum_completed_requests()
+{
+    awk '{ print $1 + $5 }' "/sys/block/$( basename "$1" )/stat"
+}
+
+# Usage: run_transport_benchmarks <transport>
+#
+# Prints the results of each job as a JSON object, including how many times the
+# driver's threads were woken up per request and how many io_uring worker
+# threads the driver had at the end of the job.
+function run_transport_benchmarks()
+{
+    local device pid qd wakeups requests result io_wq_workers
+
+    device="$( "${temp_dir}/transport" "$1" )"
+    pid="$( pgrep --full --newest "${temp_dir}/transport $1" )"
+
+    for qd in 1 32; do
+
+        wakeups="$( sum_voluntary_ctxt_switches "${pid}" )"
+        requests="$( sum_completed_requests "${device}" )"
+
+        result="$( run_fio transport "${device}" randread 4k "${qd}" 1 )"
+
+        wakeups=$(( $( sum_voluntary_ctxt_switches "${pid}" ) - wakeups ))
+        requests=$(( $( sum_completed_requests "${device}" ) - requests ))
+
+        io_wq_workers="$(
+            { grep --files-with-matches '^iou-wrk' \
+                /proc/"${pid}"/task/*/comm || true; } | wc -l
+            )"
+
+        jq --compact-output \
+            --arg transport "$1" \
+            --argjson wakeups "${wakeups}" \
+            --argjson requests "${requests}" \
+            --argjson io_wq_workers "${io_wq_workers}" \
+            '.benchmark = "transport"
+            | .transport = $transport
+            | .wakeups_per_request = $wakeups / $requests
+            | .io_wq_workers = $io_wq_workers' \
+            <<< "${result}"
+
+    done
+
+    bdus destroy --quiet "${device}"
+}
+
+# ---------------------------------------------------------------------------- #
+
+# run benchmarks
+
+{
+    run_driver_benchmarks ram 1
+    run_driver_benchmarks zero 0
+    run_transport_benchmarks ioctl
+    run_transport_benchmarks io_uring
+    run_transport_benchmarks io_uring_polling
+    "${temp_dir}/round-trip" "${num_requests}"
+} > "${temp_dir}/results"
+
+# print results
+
+jq --slurp \
+    --arg version "$( bdus version --kbdus )" \
+    --arg kernel "$( uname -r )" \
+    --arg date "$( date --utc +%Y-%m-%dT%H:%M:%SZ )" \
+    '{ kbdus_version: $version, kernel: $kernel, date: $date, results: . }' \
+    "${temp_dir}/results"
+
+# ---------------------------------------------------------------------------- #
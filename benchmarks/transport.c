@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: MIT */
+/* -------------------------------------------------------------------------- */
+
+// The driver for a zero-filled 1 GiB device that does no work, whose worker
+// threads communicate with kbdus through the given transport, for comparing
+// the overhead of transports. Prints the device's path, like any other driver.
+
+// Usage: transport ioctl|io_uring|io_uring_polling
+
+/* -------------------------------------------------------------------------- */
+
+#include <bdus.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+static int device_read(
+    char *buffer, uint64_t offset, uint32_t size, struct bdus_ctx *ctx)
+{
+    memset(buffer, 0, (size_t)size);
+    return 0;
+}
+
+static int device_write(
+    const char *buffer, uint64_t offset, uint32_t size, struct bdus_ctx *ctx)
+{
+    return 0;
+}
+
+static int device_on_device_available(struct bdus_ctx *ctx)
+{
+    // fail if io_uring was requested but is not available
+
+    const bool *const requested = ctx->private_data;
+
+    return *requested && !ctx->attrs->use_io_uring ? 1 : 0;
+}
+
+static const struct bdus_ops device_ops = {
+    .read                = device_read,
+    .write               = device_write,
+    .on_device_available = device_on_device_available,
+};
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    struct bdus_attrs attrs = {
+        .size                     = 1 << 30, // 1 GiB
+        .logical_block_size       = 512,
+        .max_concurrent_callbacks = 4, // io_uring_polling keeps each busy
+    };
+
+    if (argc == 2 && strcmp(argv[1], "io_uring") == 0)
+    {
+        attrs.use_io_uring = true;
+    }
+    else if (argc == 2 && strcmp(argv[1], "io_uring_polling") == 0)
+    {
+        attrs.use_io_uring     = true;
+        attrs.io_uring_polling = true;
+    }
+    else if (argc != 2 || strcmp(argv[1], "ioctl") != 0)
+    {
+        fprintf(stderr, "Usage: %s ioctl|io_uring|io_uring_polling\n", argv[0]);
+        return 2;
+    }
+
+    bool use_io_uring = attrs.use_io_uring;
+
+    const bool success = bdus_run(&device_ops, &attrs, &use_io_uring);
+
+    if (!success)
+        fprintf(stderr, "Error: %s\n", bdus_get_error_message());
+
+    return success ? 0 : 1;
+}
+
+/* -------------------------------------------------------------------------- */
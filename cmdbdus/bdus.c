@@ -4,16 +4,19 @@
 #define _POSIX_C_SOURCE 199309L
 
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <bdus.h>
 
@@ -36,9 +39,15 @@ static const char *const help =
     "\n"
     "SUBCOMMANDS\n"
     "   destroy   Destroy a device.\n"
+    "   stats     Print statistics about a device.\n"
+    "   top       Continuously print statistics about all devices.\n"
+    "   trace     Print the requests recorded in a device's trace.\n"
     "   version   Print version information.\n";
 
 static int subcommand_destroy(char **args, int num_args);
+static int subcommand_stats(char **args, int num_args);
+static int subcommand_top(char **args, int num_args);
+static int subcommand_trace(char **args, int num_args);
 static int subcommand_version(char **args, int num_args);
 
 int main(int argc, char **argv)
@@ -52,6 +61,18 @@ int main(int argc, char **argv)
     {
         return subcommand_destroy(argv + 2, argc - 2);
     }
+    else if (argc >= 2 && strcmp(argv[1], "stats") == 0)
+    {
+        return subcommand_stats(argv + 2, argc - 2);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "top") == 0)
+    {
+        return subcommand_top(argv + 2, argc - 2);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "trace") == 0)
+    {
+        return subcommand_trace(argv + 2, argc - 2);
+    }
     else if (argc >= 2 && strcmp(argv[1], "version") == 0)
     {
         return subcommand_version(argv + 2, argc - 2);
@@ -296,6 +317,789 @@ static int subcommand_destroy(char **args, int num_args)
     return 0;
 }
 
+/* -------------------------------------------------------------------------- */
+/* statistics */
+
+#define DEFAULT_STATS_INTERVAL_S 1.0
+
+// The activity of a device, or of a request type thereof, over the interval
+// between two statistics samples.
+struct stats_delta
+{
+    double seconds;
+
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t timeouts;
+    uint64_t service_ns;
+
+    uint64_t service_hist[BDUS_STATS_HIST_BUCKETS];
+};
+
+static bool parse_interval(double *out_value, const char *str)
+{
+    if (str[0] == '\0' || isspace(str[0]))
+        return false;
+
+    char *str_end;
+    const double value = strtod(str, &str_end);
+
+    if (str_end[0] != '\0' || !(value > 0.0 && value <= 86400.0))
+        return false;
+
+    *out_value = value;
+    return true;
+}
+
+static void sleep_for(double seconds)
+{
+    struct timespec remaining = {
+        .tv_sec  = (time_t)seconds,
+        .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9),
+    };
+
+    while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR)
+        continue;
+}
+
+static void stats_delta_add(
+    struct stats_delta *delta, const struct bdus_request_stats *before,
+    const struct bdus_request_stats *after)
+{
+    delta->requests += after->requests - before->requests;
+    delta->bytes += after->bytes - before->bytes;
+    delta->errors += after->errors - before->errors;
+    delta->timeouts += after->timeouts - before->timeouts;
+    delta->service_ns += after->service_ns - before->service_ns;
+
+    for (size_t i = 0; i < BDUS_STATS_HIST_BUCKETS; ++i)
+    {
+        delta->service_hist[i] +=
+            after->service_hist[i] - before->service_hist[i];
+    }
+}
+
+static void stats_delta_init_total(
+    struct stats_delta *delta, const struct bdus_dev_stats *before,
+    const struct bdus_dev_stats *after)
+{
+    *delta = (struct stats_delta) {
+        .seconds =
+            (double)(after->timestamp_ns - before->timestamp_ns) / 1e9,
+    };
+
+    for (size_t i = 0; i < BDUS_STATS_NUM_REQ_TYPES; ++i)
+        stats_delta_add(delta, &before->types[i], &after->types[i]);
+}
+
+// The average number of requests that the driver was serving at once, which for
+// drivers that don't use bdus_defer() is the number of busy worker threads.
+static double stats_delta_busy(const struct stats_delta *delta)
+{
+    return (double)delta->service_ns / 1e9 / delta->seconds;
+}
+
+// Returns an upper bound (in microseconds) on the given percentile of the time
+// that requests spent being served by the driver, or a negative value if no
+// requests were served.
+static double stats_delta_percentile_us(
+    const struct stats_delta *delta, double percentile)
+{
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < BDUS_STATS_HIST_BUCKETS; ++i)
+        total += delta->service_hist[i];
+
+    if (total == 0)
+        return -1.0;
+
+    uint64_t cumulative = 0;
+    size_t bucket       = 0;
+
+    for (; bucket < BDUS_STATS_HIST_BUCKETS - 1; ++bucket)
+    {
+        cumulative += delta->service_hist[bucket];
+
+        if ((double)cumulative >= percentile / 100.0 * (double)total)
+            break;
+    }
+
+    // bucket `i` ends at 2^(10+i) ns, except for the last one, which starts at
+    // 2^(9+i) ns and has no end
+
+    const unsigned int exponent = bucket < BDUS_STATS_HIST_BUCKETS - 1
+        ? 10u + (unsigned int)bucket
+        : 9u + (unsigned int)bucket;
+
+    return (double)((uint64_t)1 << exponent) / 1e3;
+}
+
+static void format_us(char buf[16], double us)
+{
+    if (us < 0.0)
+        snprintf(buf, 16, "-");
+    else
+        snprintf(buf, 16, "%.0f", us);
+}
+
+static const char *const stats_header =
+    "%10s %10s %6s %9s %9s %9s %8s %8s";
+
+static void print_stats_delta(const struct stats_delta *delta)
+{
+    char p50[16], p99[16], p999[16];
+
+    format_us(p50, stats_delta_percentile_us(delta, 50.0));
+    format_us(p99, stats_delta_percentile_us(delta, 99.0));
+    format_us(p999, stats_delta_percentile_us(delta, 99.9));
+
+    printf(
+        "%10.1f %10.2f %6.2f %9s %9s %9s %8" PRIu64 " %8" PRIu64,
+        (double)delta->requests / delta->seconds,
+        (double)delta->bytes / 1e6 / delta->seconds, stats_delta_busy(delta),
+        p50, p99, p999, delta->errors, delta->timeouts);
+}
+
+static void print_json_us(const char *name, double us)
+{
+    if (us < 0.0)
+        printf(", \"%s\": null", name);
+    else
+        printf(", \"%s\": %.0f", name, us);
+}
+
+static void print_stats_delta_json(const struct stats_delta *delta)
+{
+    printf(
+        "\"requests\": %" PRIu64 ", \"iops\": %.1f, \"bytes_per_s\": %.0f"
+        ", \"busy\": %.3f",
+        delta->requests, (double)delta->requests / delta->seconds,
+        (double)delta->bytes / delta->seconds, stats_delta_busy(delta));
+
+    print_json_us("p50_us", stats_delta_percentile_us(delta, 50.0));
+    print_json_us("p99_us", stats_delta_percentile_us(delta, 99.0));
+    print_json_us("p999_us", stats_delta_percentile_us(delta, 99.9));
+
+    printf(
+        ", \"errors\": %" PRIu64 ", \"timeouts\": %" PRIu64, delta->errors,
+        delta->timeouts);
+}
+
+/* -------------------------------------------------------------------------- */
+/* subcommand "stats" */
+
+static const char *const usage_stats =
+    "Usage: bdus stats [<options...>] <dev_path_or_id>\n"
+    "Try `bdus stats --help` for more information.\n";
+
+static const char *const help_stats =
+    "USAGE\n"
+    "   bdus stats [<options...>] <dev_path_or_id>\n"
+    "\n"
+    "DESCRIPTION\n"
+    "   Print statistics about a device's requests over an interval, for each\n"
+    "   request type the device has received and in total.\n"
+    "\n"
+    "   BUSY is the average number of requests being served by the driver at\n"
+    "   once, i.e., the number of busy worker threads for drivers that don't\n"
+    "   use bdus_defer(). P50_US, P99_US, and P999_US are upper bounds on\n"
+    "   percentiles of the time requests spent being served by the driver.\n"
+    "   AWAITING is the number of requests waiting to be received by the\n"
+    "   driver, and IN_FLIGHT the number of requests received by it but not\n"
+    "   yet completed, at the end of the interval.\n"
+    "\n"
+    "ARGUMENTS\n"
+    "   <dev_path_or_id>   Path to, or identifier of, the device.\n"
+    "\n"
+    "OPTIONS\n"
+    "   --interval <seconds>   Length of the interval (default: 1).\n"
+    "   --json                 Print statistics as a JSON object instead.\n";
+
+static int subcommand_stats(char **args, int num_args)
+{
+    // parse arguments
+
+    if (num_args == 1 && strcmp(args[0], "--help") == 0)
+    {
+        fputs(help_stats, stdout);
+        return 0;
+    }
+
+    const char *dev_path_or_id = NULL;
+
+    bool json       = false;
+    double interval = DEFAULT_STATS_INTERVAL_S;
+
+    for (int i = 0; i < num_args; ++i)
+    {
+        if (strcmp(args[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(args[i], "--interval") == 0 && i + 1 < num_args)
+        {
+            if (!parse_interval(&interval, args[++i]))
+            {
+                fputs(usage_stats, stderr);
+                return 2;
+            }
+        }
+        else if (!dev_path_or_id)
+        {
+            dev_path_or_id = args[i];
+        }
+        else
+        {
+            fputs(usage_stats, stderr);
+            return 2;
+        }
+    }
+
+    if (!dev_path_or_id)
+    {
+        fputs(usage_stats, stderr);
+        return 2;
+    }
+
+    // get device id and statistics at the start and end of the interval
+
+    uint64_t dev_id;
+
+    static struct bdus_dev_stats before, after;
+
+    bool success = (parse_dev_id(&dev_id, dev_path_or_id)
+                    || bdus_get_dev_id_from_path(&dev_id, dev_path_or_id))
+        && bdus_get_dev_stats(dev_id, &before);
+
+    if (success)
+    {
+        sleep_for(interval);
+        success = bdus_get_dev_stats(dev_id, &after);
+    }
+
+    if (!success)
+    {
+        fprintf(stderr, "Error: %s\n", bdus_get_error_message());
+        return 1;
+    }
+
+    // print statistics
+
+    struct stats_delta total;
+    stats_delta_init_total(&total, &before, &after);
+
+    if (json)
+    {
+        printf(
+            "{\"id\": %" PRIu64 ", \"interval_s\": %.3f"
+            ", \"awaiting_get\": %" PRIu32 ", \"in_flight\": %" PRIu32 ", ",
+            dev_id, total.seconds, after.num_awaiting_get, after.num_in_flight);
+
+        print_stats_delta_json(&total);
+
+        fputs(", \"types\": {", stdout);
+
+        for (size_t i = 0; i < BDUS_STATS_NUM_REQ_TYPES; ++i)
+        {
+            struct stats_delta delta = { .seconds = total.seconds };
+            stats_delta_add(&delta, &before.types[i], &after.types[i]);
+
+            printf("%s\"%s\": {", i == 0 ? "" : ", ", after.types[i].type);
+            print_stats_delta_json(&delta);
+            putchar('}');
+        }
+
+        puts("}}");
+    }
+    else
+    {
+        printf(
+            "AWAITING %" PRIu32 "   IN_FLIGHT %" PRIu32
+            "   INTERVAL %.3f s\n\n",
+            after.num_awaiting_get, after.num_in_flight, total.seconds);
+
+        printf("%-21s ", "TYPE");
+        printf(
+            stats_header, "IOPS", "MB/S", "BUSY", "P50_US", "P99_US", "P999_US",
+            "ERRORS", "TIMEOUTS");
+        putchar('\n');
+
+        // only print types of which the device has ever received requests
+
+        for (size_t i = 0; i < BDUS_STATS_NUM_REQ_TYPES; ++i)
+        {
+            if (after.types[i].requests == 0 && after.types[i].merges == 0)
+                continue;
+
+            struct stats_delta delta = { .seconds = total.seconds };
+            stats_delta_add(&delta, &before.types[i], &after.types[i]);
+
+            printf("%-21s ", after.types[i].type);
+            print_stats_delta(&delta);
+            putchar('\n');
+        }
+
+        printf("%-21s ", "total");
+        print_stats_delta(&total);
+        putchar('\n');
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* subcommand "top" */
+
+static const char *const usage_top =
+    "Usage: bdus top [<options...>]\n"
+    "Try `bdus top --help` for more information.\n";
+
+static const char *const help_top =
+    "USAGE\n"
+    "   bdus top [<options...>]\n"
+    "\n"
+    "DESCRIPTION\n"
+    "   Repeatedly print statistics about all existing devices, one per line,\n"
+    "   over successive intervals. Devices that are busiest (see `bdus stats\n"
+    "   --help`) are printed first.\n"
+    "\n"
+    "OPTIONS\n"
+    "   --interval <seconds>   Length of each interval (default: 1).\n"
+    "   --iterations <n>       Stop after <n> intervals (default: never).\n"
+    "   --json                 Print the statistics of each interval as a\n"
+    "                          single-line JSON object instead.\n";
+
+struct top_dev
+{
+    uint64_t id;
+    uint32_t num_awaiting_get;
+    uint32_t num_in_flight;
+    struct stats_delta total;
+};
+
+static int compare_dev_ids(const void *a, const void *b)
+{
+    const uint64_t id_a = *(const uint64_t *)a;
+    const uint64_t id_b = *(const uint64_t *)b;
+
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+static int compare_top_devs(const void *a, const void *b)
+{
+    const struct top_dev *const dev_a = a;
+    const struct top_dev *const dev_b = b;
+
+    const double busy_a = stats_delta_busy(&dev_a->total);
+    const double busy_b = stats_delta_busy(&dev_b->total);
+
+    if (busy_a != busy_b)
+        return busy_a < busy_b ? 1 : -1;
+
+    if (dev_a->num_awaiting_get != dev_b->num_awaiting_get)
+        return dev_a->num_awaiting_get < dev_b->num_awaiting_get ? 1 : -1;
+
+    return compare_dev_ids(&dev_a->id, &dev_b->id);
+}
+
+// Sets `*out_ids` to a sorted array, which must be freed using free(), with the
+// identifiers of all existing devices. Returns false on failure.
+static bool list_dev_ids(uint64_t **out_ids, size_t *out_num_ids)
+{
+    DIR *const dir = opendir("/sys/block");
+
+    if (!dir)
+        return false;
+
+    uint64_t *ids   = NULL;
+    size_t num_ids  = 0;
+    size_t capacity = 0;
+
+    const struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        uint64_t id;
+
+        if (strncmp(entry->d_name, "bdus-", 5) != 0
+            || !parse_dev_id(&id, entry->d_name + 5))
+        {
+            continue;
+        }
+
+        if (num_ids == capacity)
+        {
+            capacity = capacity == 0 ? 16 : 2 * capacity;
+
+            uint64_t *const new_ids = realloc(ids, capacity * sizeof(*ids));
+
+            if (!new_ids)
+            {
+                free(ids);
+                closedir(dir);
+                errno = ENOMEM;
+                return false;
+            }
+
+            ids = new_ids;
+        }
+
+        ids[num_ids++] = id;
+    }
+
+    closedir(dir);
+
+    qsort(ids, num_ids, sizeof(*ids), compare_dev_ids);
+
+    *out_ids     = ids;
+    *out_num_ids = num_ids;
+
+    return true;
+}
+
+// Gets the statistics of the given devices over an interval, skipping devices
+// that no longer exist. Returns the number of devices whose statistics were
+// stored in `out_devs`, or -1 on failure.
+static ptrdiff_t sample_top_devs(
+    const uint64_t *ids, size_t num_ids, double interval,
+    struct bdus_dev_stats *before, struct top_dev *out_devs)
+{
+    bool *const exists = calloc(num_ids == 0 ? 1 : num_ids, sizeof(*exists));
+
+    if (!exists)
+    {
+        fputs("Error: Failed to allocate memory\n", stderr);
+        return -1;
+    }
+
+    ptrdiff_t num_devs = 0;
+
+    for (size_t i = 0; i < num_ids && num_devs >= 0; ++i)
+    {
+        if (bdus_get_dev_stats(ids[i], &before[i]))
+            exists[i] = true;
+        else if (errno != ENODEV && errno != EINVAL)
+            num_devs = -1;
+    }
+
+    if (num_devs >= 0)
+        sleep_for(interval);
+
+    for (size_t i = 0; i < num_ids && num_devs >= 0; ++i)
+    {
+        struct bdus_dev_stats after;
+
+        if (!exists[i])
+            continue;
+
+        if (!bdus_get_dev_stats(ids[i], &after))
+        {
+            if (errno != ENODEV && errno != EINVAL)
+                num_devs = -1;
+
+            continue;
+        }
+
+        struct top_dev *const dev = &out_devs[num_devs++];
+
+        dev->id               = ids[i];
+        dev->num_awaiting_get = after.num_awaiting_get;
+        dev->num_in_flight    = after.num_in_flight;
+
+        stats_delta_init_total(&dev->total, &before[i], &after);
+    }
+
+    if (num_devs < 0)
+        fprintf(stderr, "Error: %s\n", bdus_get_error_message());
+
+    free(exists);
+
+    return num_devs;
+}
+
+static void print_top_devs(
+    const struct top_dev *devs, size_t num_devs, double interval, bool clear)
+{
+    if (clear)
+        fputs("\033[H\033[2J", stdout);
+
+    printf("%zu devices, interval %.3f s\n\n", num_devs, interval);
+
+    printf("%-20s %8s %9s ", "DEVICE", "AWAITING", "IN_FLIGHT");
+    printf(
+        stats_header, "IOPS", "MB/S", "BUSY", "P50_US", "P99_US", "P999_US",
+        "ERRORS", "TIMEOUTS");
+    putchar('\n');
+
+    for (size_t i = 0; i < num_devs; ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "bdus-%" PRIu64, devs[i].id);
+
+        printf(
+            "%-20s %8" PRIu32 " %9" PRIu32 " ", name, devs[i].num_awaiting_get,
+            devs[i].num_in_flight);
+
+        print_stats_delta(&devs[i].total);
+        putchar('\n');
+    }
+}
+
+static void print_top_devs_json(const struct top_dev *devs, size_t num_devs)
+{
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+        abort();
+
+    printf(
+        "{\"timestamp_ns\": %" PRIu64 ", \"devices\": [",
+        (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec);
+
+    for (size_t i = 0; i < num_devs; ++i)
+    {
+        printf(
+            "%s{\"id\": %" PRIu64 ", \"interval_s\": %.3f"
+            ", \"awaiting_get\": %" PRIu32 ", \"in_flight\": %" PRIu32 ", ",
+            i == 0 ? "" : ", ", devs[i].id, devs[i].total.seconds,
+            devs[i].num_awaiting_get, devs[i].num_in_flight);
+
+        print_stats_delta_json(&devs[i].total);
+        putchar('}');
+    }
+
+    puts("]}");
+}
+
+static int subcommand_top(char **args, int num_args)
+{
+    // parse arguments
+
+    if (num_args == 1 && strcmp(args[0], "--help") == 0)
+    {
+        fputs(help_top, stdout);
+        return 0;
+    }
+
+    bool json           = false;
+    double interval     = DEFAULT_STATS_INTERVAL_S;
+    uint64_t iterations = 0;
+
+    for (int i = 0; i < num_args; ++i)
+    {
+        if (strcmp(args[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(args[i], "--interval") == 0 && i + 1 < num_args)
+        {
+            if (!parse_interval(&interval, args[++i]))
+            {
+                fputs(usage_top, stderr);
+                return 2;
+            }
+        }
+        else if (strcmp(args[i], "--iterations") == 0 && i + 1 < num_args)
+        {
+            if (!parse_dev_id(&iterations, args[++i]) || iterations == 0)
+            {
+                fputs(usage_top, stderr);
+                return 2;
+            }
+        }
+        else
+        {
+            fputs(usage_top, stderr);
+            return 2;
+        }
+    }
+
+    const bool clear = !json && isatty(STDOUT_FILENO);
+
+    // print statistics over successive intervals
+
+    for (uint64_t iteration = 0; iterations == 0 || iteration < iterations;
+         ++iteration)
+    {
+        uint64_t *ids;
+        size_t num_ids;
+
+        if (!list_dev_ids(&ids, &num_ids))
+        {
+            fprintf(
+                stderr, "Error: Failed to list devices: %s\n", strerror(errno));
+            return 1;
+        }
+
+        struct bdus_dev_stats *const before =
+            malloc((num_ids == 0 ? 1 : num_ids) * sizeof(*before));
+
+        struct top_dev *const devs =
+            malloc((num_ids == 0 ? 1 : num_ids) * sizeof(*devs));
+
+        ptrdiff_t num_devs = -1;
+
+        if (before && devs)
+            num_devs = sample_top_devs(ids, num_ids, interval, before, devs);
+        else
+            fputs("Error: Failed to allocate memory\n", stderr);
+
+        if (num_devs >= 0)
+        {
+            qsort(devs, (size_t)num_devs, sizeof(*devs), compare_top_devs);
+
+            if (json)
+                print_top_devs_json(devs, (size_t)num_devs);
+            else
+                print_top_devs(devs, (size_t)num_devs, interval, clear);
+
+            fflush(stdout);
+        }
+
+        free(devs);
+        free(before);
+        free(ids);
+
+        if (num_devs < 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* subcommand "trace" */
+
+static const char *const usage_trace =
+    "Usage: bdus trace [<options...>] <dev_path_or_id>\n"
+    "Try `bdus trace --help` for more information.\n";
+
+static const char *const help_trace =
+    "USAGE\n"
+    "   bdus trace [<options...>] <dev_path_or_id>\n"
+    "\n"
+    "DESCRIPTION\n"
+    "   Print the requests most recently served by a device's driver, which\n"
+    "   must be running with a positive 'trace_size' attribute, or have been\n"
+    "   killed while doing so.\n"
+    "\n"
+    "   Requests are printed one per line, ordered by the time at which the\n"
+    "   callback serving each was invoked, relative to the first printed\n"
+    "   request.\n"
+    "\n"
+    "ARGUMENTS\n"
+    "   <dev_path_or_id>   Path to, or identifier of, the device.\n"
+    "\n"
+    "OPTIONS\n"
+    "   --json   Print requests as a JSON array instead, with absolute times\n"
+    "            as given by CLOCK_MONOTONIC.\n";
+
+static void print_trace(const struct bdus_trace_entry *entries, size_t count)
+{
+    printf(
+        "%12s %6s %-21s %20s %10s %12s %6s\n", "TIME_US", "THREAD", "TYPE",
+        "OFFSET", "SIZE", "DURATION_US", "ERROR");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct bdus_trace_entry *const e = &entries[i];
+
+        printf(
+            "%12.3f %6" PRIu32 " %-21s %20" PRIu64 " %10" PRIu32
+            " %12.3f %6" PRId32 "\n",
+            (double)(e->start_ns - entries[0].start_ns) / 1e3, e->thread_index,
+            e->type, e->offset, e->size, (double)e->duration_ns / 1e3,
+            e->error);
+    }
+}
+
+static void
+    print_trace_json(const struct bdus_trace_entry *entries, size_t count)
+{
+    putchar('[');
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct bdus_trace_entry *const e = &entries[i];
+
+        printf(
+            "%s\n  {\"start_ns\": %" PRIu64 ", \"thread\": %" PRIu32
+            ", \"type\": \"%s\", \"offset\": %" PRIu64 ", \"size\": %" PRIu32
+            ", \"duration_ns\": %" PRIu64 ", \"error\": %" PRId32 "}",
+            i == 0 ? "" : ",", e->start_ns, e->thread_index, e->type,
+            e->offset, e->size, e->duration_ns, e->error);
+    }
+
+    puts(count == 0 ? "]" : "\n]");
+}
+
+static int subcommand_trace(char **args, int num_args)
+{
+    // parse arguments
+
+    if (num_args == 1 && strcmp(args[0], "--help") == 0)
+    {
+        fputs(help_trace, stdout);
+        return 0;
+    }
+
+    const char *dev_path_or_id = NULL;
+
+    bool json = false;
+
+    for (int i = 0; i < num_args; ++i)
+    {
+        if (strcmp(args[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (!dev_path_or_id)
+        {
+            dev_path_or_id = args[i];
+        }
+        else
+        {
+            fputs(usage_trace, stderr);
+            return 2;
+        }
+    }
+
+    if (!dev_path_or_id)
+    {
+        fputs(usage_trace, stderr);
+        return 2;
+    }
+
+    // get device id and trace
+
+    uint64_t dev_id;
+
+    struct bdus_trace_entry *entries;
+    size_t count;
+
+    const bool success = (parse_dev_id(&dev_id, dev_path_or_id)
+                          || bdus_get_dev_id_from_path(&dev_id, dev_path_or_id))
+        && bdus_get_dev_trace(dev_id, &entries, &count);
+
+    if (!success)
+    {
+        fprintf(stderr, "Error: %s\n", bdus_get_error_message());
+        return 1;
+    }
+
+    // print trace
+
+    if (json)
+        print_trace_json(entries, count);
+    else
+        print_trace(entries, count);
+
+    free(entries);
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* subcommand "version" */
 
@@ -32,7 +32,7 @@ _bdus_completion()
         if [[ "${COMP_WORDS[1]}" = -* ]]; then
             candidates=--help
         else
-            candidates="destroy version"
+            candidates="destroy stats top trace version"
         fi
 
     elif [[ "${COMP_WORDS[1]}" = destroy ]]; then
@@ -53,6 +53,51 @@ _bdus_completion()
 
         fi
 
+    elif [[ "${COMP_WORDS[1]}" = stats ]]; then
+
+        if [[ "${COMP_WORDS[COMP_CWORD - 1]}" = --interval ]]; then
+
+            :
+
+        elif [[ "${COMP_WORDS[COMP_CWORD]}" = -* ]]; then
+
+            (( ${#COMP_WORDS[@]} != 3 )) || candidates+=" --help"
+
+            _bdus_has_word --interval || candidates+=" --interval"
+            _bdus_has_word --json     || candidates+=" --json"
+
+        elif ! _bdus_has_subcmd_args; then
+
+            candidates="$( find /dev -maxdepth 1 -type b -name "bdus-?*" | sort -V )"
+
+        fi
+
+    elif [[ "${COMP_WORDS[1]}" = top ]]; then
+
+        if [[ "${COMP_WORDS[COMP_CWORD]}" = -* ]]; then
+
+            (( ${#COMP_WORDS[@]} != 3 )) || candidates+=" --help"
+
+            _bdus_has_word --interval   || candidates+=" --interval"
+            _bdus_has_word --iterations || candidates+=" --iterations"
+            _bdus_has_word --json       || candidates+=" --json"
+
+        fi
+
+    elif [[ "${COMP_WORDS[1]}" = trace ]]; then
+
+        if [[ "${COMP_WORDS[COMP_CWORD]}" = -* ]]; then
+
+            (( ${#COMP_WORDS[@]} != 3 )) || candidates+=" --help"
+
+            _bdus_has_word --json || candidates+=" --json"
+
+        elif ! _bdus_has_subcmd_args; then
+
+            candidates="$( find /dev -maxdepth 1 -type b -name "bdus-?*" | sort -V )"
+
+        fi
+
     elif [[ "${COMP_WORDS[1]}" = version ]]; then
 
         if [[ "${COMP_WORDS[COMP_CWORD]}" = -* ]]; then
@@ -62,6 +62,102 @@ complete \
     -l quiet \
     -d 'Print only error messages'
 
+# ---------------------------------------------------------------------------- #
+# subcommand "stats"
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (count (__bdus_args)) = 1 ]' \
+    -a 'stats' \
+    -d 'Print statistics about a device'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = stats ]
+        and [ (__bdus_args -1) != --interval ]
+        and not string match -r "^[^-].*\$" -- (__bdus_args -2) > /dev/null' \
+    -a '( find /dev -maxdepth 1 -type b -name "bdus-?*" | sort -V )'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = stats ]
+        and not contains -- --interval (__bdus_args)' \
+    -l interval \
+    -r \
+    -d 'Length of the interval in seconds'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = stats ]
+        and not contains -- --json (__bdus_args)' \
+    -l json \
+    -d 'Print statistics as a JSON object'
+
+# ---------------------------------------------------------------------------- #
+# subcommand "top"
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (count (__bdus_args)) = 1 ]' \
+    -a 'top' \
+    -d 'Continuously print statistics about all devices'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = top ]
+        and not contains -- --interval (__bdus_args)' \
+    -l interval \
+    -r \
+    -d 'Length of each interval in seconds'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = top ]
+        and not contains -- --iterations (__bdus_args)' \
+    -l iterations \
+    -r \
+    -d 'Stop after the given number of intervals'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = top ]
+        and not contains -- --json (__bdus_args)' \
+    -l json \
+    -d 'Print statistics as JSON objects'
+
+# ---------------------------------------------------------------------------- #
+# subcommand "trace"
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (count (__bdus_args)) = 1 ]' \
+    -a 'trace' \
+    -d "Print the requests recorded in a device's trace"
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = trace ]
+        and not string match -r "^[^-].*\$" -- (__bdus_args -2) > /dev/null' \
+    -a '( find /dev -maxdepth 1 -type b -name "bdus-?*" | sort -V )'
+
+complete \
+    -c bdus \
+    -n 'not contains -- --help (__bdus_args)
+        and [ (__bdus_args 2) = trace ]
+        and not contains -- --json (__bdus_args)' \
+    -l json \
+    -d 'Print requests as a JSON array'
+
 # ---------------------------------------------------------------------------- #
 # subcommand "version"
 
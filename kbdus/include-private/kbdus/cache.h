@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef KBDUS_HEADER_CACHE_H_
+#define KBDUS_HEADER_CACHE_H_
+
+/* -------------------------------------------------------------------------- */
+
+#include <linux/blkdev.h>
+#include <linux/seq_file.h>
+#include <linux/types.h>
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A size-bounded, least-recently-used cache of the contents of a device, with
+ * page granularity, populated by *read* requests served by the driver.
+ *
+ * All memory used by the cache is allocated when it is created.
+ *
+ * The cache is split into shards by region of the device, each with its own
+ * lock and least-recently-used list, and data is copied between requests and
+ * the cache without holding any lock. *Read* requests targeting more than 32
+ * pages are neither served from nor inserted into the cache.
+ *
+ * To keep the cache coherent, every request that may modify the device's
+ * contents must invalidate the cached pages it targets both when it is
+ * submitted and when it completes, and the data of a *read* request may only
+ * be inserted into the cache if no pages near the ones it targets were
+ * invalidated since the request was submitted (see `kbdus_cache_get_gen()`).
+ */
+struct kbdus_cache;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates a cache holding up to `num_pages` pages, which must be positive.
+ *
+ * Returns an `ERR_PTR()` on failure.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Might sleep.
+ */
+struct kbdus_cache *kbdus_cache_create(u32 num_pages);
+
+/**
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Might sleep.
+ */
+void kbdus_cache_destroy(struct kbdus_cache *cache);
+
+/**
+ * Returns a value that changes whenever pages targeted by the given *read*
+ * request are invalidated, to be given to `kbdus_cache_insert_read()`.
+ *
+ * The value may also change when other nearby pages are invalidated, but not
+ * when pages far from those targeted by the request are.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same cache with
+ * `kbdus_cache_destroy()`.
+ *
+ * CONTEXT: Any.
+ *
+ * SLEEPING: Never sleeps.
+ */
+u64 kbdus_cache_get_gen(struct kbdus_cache *cache, struct request *req);
+
+/**
+ * If the given *read* request targets at most 32 pages, all of which are
+ * cached, copies their data into the request and returns true. Otherwise,
+ * returns false.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same cache with
+ * `kbdus_cache_destroy()`.
+ *
+ * CONTEXT: Any.
+ *
+ * SLEEPING: Never sleeps.
+ */
+bool kbdus_cache_serve_read(struct kbdus_cache *cache, struct request *req);
+
+/**
+ * Inserts into the cache the data of the given *read* request, which was
+ * successfully served by the driver, unless pages it targets may have been
+ * invalidated since `gen` was obtained from `kbdus_cache_get_gen()` before the
+ * request was submitted.
+ *
+ * Only pages that the request targets in their entirety are inserted, evicting
+ * the least recently used pages of their shards if necessary, and nothing is
+ * inserted if the request targets more than 32 pages.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same cache with
+ * `kbdus_cache_destroy()`.
+ *
+ * CONTEXT: Any.
+ *
+ * SLEEPING: Never sleeps.
+ */
+void kbdus_cache_insert_read(
+    struct kbdus_cache *cache, struct request *req, u64 gen);
+
+/**
+ * Removes from the cache all pages that overlap the region of the device with
+ * the given offset and size (in bytes).
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same cache with
+ * `kbdus_cache_destroy()`.
+ *
+ * CONTEXT: Any.
+ *
+ * SLEEPING: Never sleeps.
+ */
+void kbdus_cache_invalidate(struct kbdus_cache *cache, u64 offset, u64 size);
+
+/**
+ * Prints the cache's hit, miss, insertion, eviction, and invalidation counters
+ * to the given seq_file.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same cache with
+ * `kbdus_cache_destroy()`.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
+ */
+void kbdus_cache_show_stats(struct kbdus_cache *cache, struct seq_file *s);
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* KBDUS_HEADER_CACHE_H_ */
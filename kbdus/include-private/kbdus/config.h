@@ -6,6 +6,7 @@
 /* -------------------------------------------------------------------------- */
 
 #include <linux/sizes.h>
+#include <linux/time.h>
 
 /* -------------------------------------------------------------------------- */
 
@@ -16,12 +17,29 @@
 // (u32) The default value for `kbdus_config.max_read_write_size`.
 #define KBDUS_DEFAULT_MAX_READ_WRITE_SIZE ((u32)SZ_256K)
 
-// (u32) The maximum value for `kbdus_config.max_read_write_size`.
-#define KBDUS_HARD_MAX_READ_WRITE_SIZE ((u32)SZ_1M)
+// (u32) The maximum value for `kbdus_config.max_read_write_size`. Requests of
+// this size need not be transferred at once (see `kbdus_fd_config.chunk_size`).
+#define KBDUS_HARD_MAX_READ_WRITE_SIZE ((u32)SZ_16M)
 
 // (u32) The maximum value for `kbdus_config.max_outstanding_reqs`.
 #define KBDUS_HARD_MAX_OUTSTANDING_REQS 256u
 
+// (u32) The maximum value for `kbdus_fd_config.busy_poll_us`.
+#define KBDUS_HARD_MAX_BUSY_POLL_US 10000u
+
+// (u16) The maximum value for `kbdus_device_config.max_discard_ranges`.
+#define KBDUS_HARD_MAX_DISCARD_RANGES ((u16)256)
+
+// (u32) The maximum number of extents into which
+// `kbdus_device_config.zero_extent_size` may divide a device, which bounds the
+// size of the bitmap tracking known-zero extents to 16 MiB.
+#define KBDUS_HARD_MAX_ZERO_EXTENTS (1u << 27)
+
+// (u64) For dispatch policies other than `KBDUS_DISPATCH_POLICY_FIFO`, the
+// time (in nanoseconds) that a request may await get before it is received
+// ahead of all requests that have been waiting for less time.
+#define KBDUS_DISPATCH_MAX_WAIT_NS (500ull * NSEC_PER_MSEC)
+
 /* -------------------------------------------------------------------------- */
 
 #endif /* KBDUS_HEADER_CONFIG_H_ */
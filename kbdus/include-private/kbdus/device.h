@@ -135,6 +135,71 @@ dev_t kbdus_device_get_dev(const struct kbdus_device *device);
 struct kbdus_inverter *
     kbdus_device_get_inverter(const struct kbdus_device *device);
 
+/**
+ * \brief Marks a region of the given device as known or not known to contain
+ *        only zeros.
+ *
+ * See `KBDUS_IOCTL_SET_ZERO_RANGE`, whose error semantics this function
+ * follows, returning a negative errno value on failure.
+ *
+ * THREAD-SAFETY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same device with
+ * `kbdus_device_destroy()`.
+ *
+ * SLEEPING: This function never sleeps.
+ */
+int kbdus_device_set_zero_range(
+    struct kbdus_device *device, u64 offset, u64 size, bool zero);
+
+/**
+ * \brief Removes the data of a region of the given device from its read cache,
+ *        if it has one.
+ *
+ * See `KBDUS_IOCTL_INVALIDATE_READ_CACHE`, whose error semantics this function
+ * follows, returning a negative errno value on failure.
+ *
+ * THREAD-SAFETY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same device with
+ * `kbdus_device_destroy()`.
+ *
+ * SLEEPING: This function never sleeps.
+ */
+int kbdus_device_invalidate_read_cache(
+    struct kbdus_device *device, u64 offset, u64 size);
+
+/**
+ * \brief Adds the given device's request statistics to `stats`, which must be
+ *        zero-filled, and sets its `timestamp_ns` field.
+ *
+ * See `KBDUS_IOCTL_GET_DEVICE_STATS`. The `id` field is left untouched.
+ *
+ * THREAD-SAFETY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same device with
+ * `kbdus_device_destroy()`.
+ *
+ * SLEEPING: This function never sleeps.
+ */
+void kbdus_device_get_stats(
+    struct kbdus_device *device, struct kbdus_device_stats *stats);
+
+/**
+ * \brief Returns the NUMA node of the CPUs that submit requests to the given
+ *        device's hardware queue with index `queue_index`, or `NUMA_NO_NODE` if
+ *        unknown.
+ *
+ * THREAD-SAFETY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same device with
+ * `kbdus_device_destroy()`.
+ *
+ * SLEEPING: This function never sleeps.
+ */
+int kbdus_device_get_queue_node(
+    const struct kbdus_device *device, u32 queue_index);
+
 /**
  * \brief Request the termination of the given device.
  *
@@ -8,7 +8,11 @@
 #include <kbdus.h>
 
 #include <linux/blkdev.h>
+#include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/llist.h>
+#include <linux/poll.h>
+#include <linux/seq_file.h>
 #include <linux/types.h>
 
 /* -------------------------------------------------------------------------- */
@@ -30,6 +34,28 @@ struct kbdus_inverter_pdu
 
     int error;
     int error_ioctl;
+
+    // links completed requests of poll queues until they are polled for
+    struct llist_node poll_node;
+
+    // for *read* requests of devices with a read cache, the cache's
+    // `kbdus_cache_get_gen()` when the request was submitted
+    u64 cache_gen;
+
+    // for driver-private requests that are *zone report* requests, the maximum
+    // number of zones to be reported (positive), otherwise 0
+    u32 zone_report_max_zones;
+
+    // for *zone report* requests, the number of zones reported by the driver
+    u32 zone_report_num_zones;
+
+    // for *zone report* requests, the offset of the first zone to be reported
+    // and the buffer into which the reported zones are copied
+    u64 zone_report_offset;
+    struct kbdus_zone *zone_report_zones;
+
+    // for *zone append* requests, the sector at which the data was written
+    sector_t zone_append_sector;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -131,8 +157,11 @@ void kbdus_inverter_submit_device_available_notification(
  * The request is later completed by putting a negated errno value in an `int`
  * in the first 4 bytes of the queue request's PDU.
  *
- * Takes a request in the "free" state, initializes it to represent the given
- * request, and puts it in "awaiting get" state. Returns the request handle.
+ * Takes the request wrapper associated with the request's tag in the hardware
+ * queue with index `hctx_index` (which must be in the "free" state),
+ * initializes it to represent the given request, and puts it in "awaiting get"
+ * state in the queue with index `queue_index`. Both indices must be less than
+ * the device configuration's `num_queues`. Returns the request handle.
  *
  * Returns 0 (the null handle, meaning no request) if the request is failed by
  * this function because the inverter has been terminated.
@@ -149,7 +178,8 @@ void kbdus_inverter_submit_device_available_notification(
  * SLEEPING: Never sleeps.
  */
 int kbdus_inverter_submit_request(
-    struct kbdus_inverter *inverter, struct request *req);
+    struct kbdus_inverter *inverter, struct request *req, u32 hctx_index,
+    u32 queue_index);
 
 /**
  * Fails the given request due to time out.
@@ -187,12 +217,113 @@ struct kbdus_inverter_item
 };
 
 /**
- * Blocks until a request is available to be processed, and returns a pointer to
- * that request.
+ * Blocks until a request is available to be processed in the queue with index
+ * `queue_index`, and returns a pointer to that request.
  *
  * Takes a request in the "awaiting get" state and puts it in the "being gotten"
  * state.
  *
+ * Notifications are delivered to every queue, with the exception of "device
+ * available" and "flush and terminate" notifications, which are only delivered
+ * to the queue with index 0.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same inverter with
+ * `kbdus_inverter_destroy()`.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Might sleep, unless `timeout` is 0.
+ *
+ * Blocks for at most `timeout` jiffies, or indefinitely if `timeout` is
+ * MAX_SCHEDULE_TIMEOUT. Unless `timeout` is 0, first busy-waits for up to
+ * `busy_poll_us` microseconds before sleeping, stopping early if the current
+ * task should be rescheduled or has a pending signal.
+ *
+ * Returns ERR_PTR(-ERESTARTSYS) if interrupted, and ERR_PTR(-ETIMEDOUT) if
+ * `timeout` jiffies elapse without a request or notification becoming
+ * available. If `timeout` is 0, returns ERR_PTR(-EAGAIN) instead of blocking if
+ * neither a request nor a notification is available.
+ */
+const struct kbdus_inverter_item *kbdus_inverter_begin_item_get(
+    struct kbdus_inverter *inverter, u32 queue_index, long timeout,
+    u32 busy_poll_us);
+
+/**
+ * Like `kbdus_inverter_begin_item_get()`, but returns NULL instead of blocking
+ * if no request is awaiting get in the queue with index `queue_index`.
+ *
+ * Never returns notifications, leaving them to be gotten by a subsequent call
+ * to `kbdus_inverter_begin_item_get()`.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same inverter with
+ * `kbdus_inverter_destroy()`.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
+ */
+const struct kbdus_inverter_item *kbdus_inverter_try_begin_item_get(
+    struct kbdus_inverter *inverter, u32 queue_index);
+
+/**
+ * Returns the number of requests awaiting get in the queue with index
+ * `queue_index`.
+ *
+ * The value may be outdated by the time it is returned, and is only meant to
+ * be used as a hint of how busy the queue is.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same inverter with
+ * `kbdus_inverter_destroy()`.
+ *
+ * CONTEXT: Don't care.
+ *
+ * SLEEPING: Never sleeps.
+ */
+u32 kbdus_inverter_num_awaiting_get(
+    struct kbdus_inverter *inverter, u32 queue_index);
+
+/**
+ * Adds the wait queues of all queues to the given poll table, and returns true
+ * if a request or notification is available in any queue (in which case
+ * `kbdus_inverter_begin_item_get()` would not block for that queue, except if
+ * the request is canceled in the meantime).
+ *
+ * Pollers are woken up whenever a request or notification becomes available.
+ *
+ * CONCURRENCY: This function may be invoked concurrently with itself and with
+ * any other function exposed by this component, with the exception that this
+ * function may *not* be invoked concurrently on the same inverter with
+ * `kbdus_inverter_destroy()`.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
+ */
+bool kbdus_inverter_poll(
+    struct kbdus_inverter *inverter, struct file *filp, poll_table *wait);
+
+/**
+ * Prints the inverter's request statistics to `s`, in a line-based textual
+ * format.
+ *
+ * For each request type, the number of completed requests, transferred bytes,
+ * failed requests, timed out requests, merged requests, requests whose data was
+ * mapped into the driver's memory, and requests whose data was spliced to or
+ * from a file are printed, followed by log2 histograms of the time requests
+ * spent awaiting get, awaiting completion, and being transferred to or from the
+ * driver. The number of times that busy-waiting in
+ * `kbdus_inverter_begin_item_get()` did and did not find a request or
+ * notification is printed last.
+ *
+ * Counters are not read atomically with respect to each other, so the printed
+ * values may be slightly inconsistent if requests are being processed.
+ *
  * CONCURRENCY: This function may be invoked concurrently with itself and with
  * any other function exposed by this component, with the exception that this
  * function may *not* be invoked concurrently on the same inverter with
@@ -201,11 +332,25 @@ struct kbdus_inverter_item
  * CONTEXT: Must be called from process context.
  *
  * SLEEPING: Might sleep.
+ */
+void kbdus_inverter_show_stats(
+    struct kbdus_inverter *inverter, struct seq_file *s);
+
+/**
+ * Adds the inverter's request statistics to `stats`, which must be zero-filled,
+ * and sets its `timestamp_ns` field. The `id` field is left untouched.
+ *
+ * Counters are not read atomically with respect to each other, so the values
+ * may be slightly inconsistent if requests are being processed.
  *
- * Returns ERR_PTR(-ERESTARTSYS) if interrupted.
+ * CONCURRENCY: Same as for `kbdus_inverter_show_stats()`.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
  */
-const struct kbdus_inverter_item *
-    kbdus_inverter_begin_item_get(struct kbdus_inverter *inverter);
+void kbdus_inverter_get_stats(
+    struct kbdus_inverter *inverter, struct kbdus_device_stats *stats);
 
 /**
  * CONTEXT: Must be called from process context.
@@ -252,6 +397,33 @@ void kbdus_inverter_commit_item_completion(
     struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item,
     int negated_errno);
 
+/** How the data of a request was transferred to or from the driver. */
+enum kbdus_inverter_transfer
+{
+    /** The request's pages were mapped into the driver's memory. */
+    KBDUS_INVERTER_TRANSFER_MAPPED,
+
+    /**
+     * The request's data was transferred by kbdus between the request and a
+     * file given by the driver.
+     */
+    KBDUS_INVERTER_TRANSFER_SPLICED,
+};
+
+/**
+ * Records in the inverter's statistics that the data of the given request was
+ * transferred to or from the driver as described by `transfer`.
+ *
+ * The request must be in the "being completed" state.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
+ */
+void kbdus_inverter_count_item_transfer(
+    struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item,
+    enum kbdus_inverter_transfer transfer);
+
 /**
  * Takes a request in the "being completed" state and puts it in the "awaiting
  * completion" state.
@@ -263,6 +435,34 @@ void kbdus_inverter_commit_item_completion(
 void kbdus_inverter_abort_item_completion(
     struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item);
 
+/**
+ * Like `kbdus_inverter_begin_item_completion()`, but for transferring part of
+ * the request's data while the driver is still serving it, after which
+ * `kbdus_inverter_end_item_transfer()` must be called.
+ *
+ * Unlike with `kbdus_inverter_begin_item_completion()`, the time the driver
+ * has so far spent serving the request is not recorded.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
+ */
+const struct kbdus_inverter_item *kbdus_inverter_begin_item_transfer(
+    struct kbdus_inverter *inverter, u16 item_handle_index,
+    u64 item_handle_seqnum);
+
+/**
+ * Takes a request in the "being completed" state, as put in it by
+ * `kbdus_inverter_begin_item_transfer()`, and puts it back in the "awaiting
+ * completion" state.
+ *
+ * CONTEXT: Must be called from process context.
+ *
+ * SLEEPING: Never sleeps.
+ */
+void kbdus_inverter_end_item_transfer(
+    struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item);
+
 /* -------------------------------------------------------------------------- */
 
 #endif /* KBDUS_HEADER_INVERTER_H_ */
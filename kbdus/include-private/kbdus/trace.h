@@ -0,0 +1,220 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+// Tracepoints for the state transitions of requests in the inverter.
+//
+// These are defined in inverter.c and can be enabled through tracefs (e.g.,
+// /sys/kernel/tracing/events/kbdus) or attached to with tools such as perf or
+// bpftrace. When disabled, each costs a single predicted branch.
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM kbdus
+
+#if !defined(KBDUS_HEADER_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define KBDUS_HEADER_TRACE_H_
+
+/* -------------------------------------------------------------------------- */
+
+#include <kbdus.h>
+
+#include <linux/blkdev.h>
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define KBDUS_TRACE_SHOW_ITEM_TYPE_(type)                                      \
+    __print_symbolic(                                                          \
+        type, { KBDUS_ITEM_TYPE_READ, "read" },                                \
+        { KBDUS_ITEM_TYPE_WRITE, "write" },                                    \
+        { KBDUS_ITEM_TYPE_WRITE_SAME, "write_same" },                          \
+        { KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP, "write_zeros_no_unmap" },      \
+        { KBDUS_ITEM_TYPE_WRITE_ZEROS_MAY_UNMAP, "write_zeros_may_unmap" },    \
+        { KBDUS_ITEM_TYPE_FUA_WRITE, "fua_write" },                            \
+        { KBDUS_ITEM_TYPE_FLUSH, "flush" },                                    \
+        { KBDUS_ITEM_TYPE_DISCARD, "discard" },                                \
+        { KBDUS_ITEM_TYPE_SECURE_ERASE, "secure_erase" },                      \
+        { KBDUS_ITEM_TYPE_IOCTL, "ioctl" },                                    \
+        { KBDUS_ITEM_TYPE_ZONE_REPORT, "zone_report" },                        \
+        { KBDUS_ITEM_TYPE_ZONE_RESET, "zone_reset" },                          \
+        { KBDUS_ITEM_TYPE_ZONE_OPEN, "zone_open" },                            \
+        { KBDUS_ITEM_TYPE_ZONE_CLOSE, "zone_close" },                          \
+        { KBDUS_ITEM_TYPE_ZONE_FINISH, "zone_finish" },                        \
+        { KBDUS_ITEM_TYPE_ZONE_APPEND, "zone_append" })
+
+DECLARE_EVENT_CLASS(
+    kbdus_req_class,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req),
+
+    TP_STRUCT__entry(
+        __field(u64, dev_id)
+        __field(u64, handle_seqnum)
+        __field(u64, offset)
+        __field(u32, size)
+        __field(u16, handle_index)
+        __field(u16, type)
+    ),
+
+    TP_fast_assign(
+        __entry->dev_id        = dev_id;
+        __entry->handle_seqnum = handle_seqnum;
+        __entry->offset        = 512ull * (u64)blk_rq_pos(req);
+        __entry->size          = blk_rq_bytes(req);
+        __entry->handle_index  = handle_index;
+        __entry->type          = type;),
+
+    TP_printk(
+        "dev=%llu handle=%u:%llu type=%s offset=%llu size=%u",
+        (unsigned long long)__entry->dev_id,
+        (unsigned int)__entry->handle_index,
+        (unsigned long long)__entry->handle_seqnum,
+        KBDUS_TRACE_SHOW_ITEM_TYPE_(__entry->type),
+        (unsigned long long)__entry->offset, (unsigned int)__entry->size));
+
+// A request was submitted to the device, or was put back to be gotten again
+// (`requeued`), e.g., because the driver failed to receive it.
+TRACE_EVENT(
+    kbdus_req_submit,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req, bool requeued),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req, requeued),
+
+    TP_STRUCT__entry(
+        __field(u64, dev_id)
+        __field(u64, handle_seqnum)
+        __field(u64, offset)
+        __field(u32, size)
+        __field(u16, handle_index)
+        __field(u16, type)
+        __field(bool, requeued)
+    ),
+
+    TP_fast_assign(
+        __entry->dev_id        = dev_id;
+        __entry->handle_seqnum = handle_seqnum;
+        __entry->offset        = 512ull * (u64)blk_rq_pos(req);
+        __entry->size          = blk_rq_bytes(req);
+        __entry->handle_index  = handle_index;
+        __entry->type          = type;
+        __entry->requeued      = requeued;),
+
+    TP_printk(
+        "dev=%llu handle=%u:%llu type=%s offset=%llu size=%u requeued=%d",
+        (unsigned long long)__entry->dev_id,
+        (unsigned int)__entry->handle_index,
+        (unsigned long long)__entry->handle_seqnum,
+        KBDUS_TRACE_SHOW_ITEM_TYPE_(__entry->type),
+        (unsigned long long)__entry->offset, (unsigned int)__entry->size,
+        (int)__entry->requeued));
+
+// A *flush* request was merged into another that the driver has not yet
+// started receiving, and is to be completed along with it.
+DEFINE_EVENT(
+    kbdus_req_class, kbdus_req_merge,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req));
+
+// The driver started receiving a request.
+DEFINE_EVENT(
+    kbdus_req_class, kbdus_req_get,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req));
+
+// The driver received a request and is serving it, or failed to send its
+// reply and is to send it again.
+DEFINE_EVENT(
+    kbdus_req_class, kbdus_req_serve,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req));
+
+// A request timed out while awaiting to be received or completed by the
+// driver. It is then completed with error -ETIMEDOUT.
+DEFINE_EVENT(
+    kbdus_req_class, kbdus_req_timeout,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req));
+
+// A request was canceled because the device was terminated. It is then
+// completed with error -EIO.
+DEFINE_EVENT(
+    kbdus_req_class, kbdus_req_cancel,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req));
+
+// A request was completed, successfully if `error` is 0.
+TRACE_EVENT(
+    kbdus_req_complete,
+
+    TP_PROTO(
+        u64 dev_id, u16 handle_index, u64 handle_seqnum, u16 type,
+        const struct request *req, int error),
+
+    TP_ARGS(dev_id, handle_index, handle_seqnum, type, req, error),
+
+    TP_STRUCT__entry(
+        __field(u64, dev_id)
+        __field(u64, handle_seqnum)
+        __field(u64, offset)
+        __field(u32, size)
+        __field(u16, handle_index)
+        __field(u16, type)
+        __field(int, error)
+    ),
+
+    TP_fast_assign(
+        __entry->dev_id        = dev_id;
+        __entry->handle_seqnum = handle_seqnum;
+        __entry->offset        = 512ull * (u64)blk_rq_pos(req);
+        __entry->size          = blk_rq_bytes(req);
+        __entry->handle_index  = handle_index;
+        __entry->type          = type;
+        __entry->error         = error;),
+
+    TP_printk(
+        "dev=%llu handle=%u:%llu type=%s offset=%llu size=%u error=%d",
+        (unsigned long long)__entry->dev_id,
+        (unsigned int)__entry->handle_index,
+        (unsigned long long)__entry->handle_seqnum,
+        KBDUS_TRACE_SHOW_ITEM_TYPE_(__entry->type),
+        (unsigned long long)__entry->offset, (unsigned int)__entry->size,
+        __entry->error));
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* KBDUS_HEADER_TRACE_H_ */
+
+// this must be outside of the include guard
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH kbdus
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace
+
+#include <trace/define_trace.h>
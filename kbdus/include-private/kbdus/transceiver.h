@@ -6,10 +6,14 @@
 /* -------------------------------------------------------------------------- */
 
 #include <kbdus.h>
+#include <kbdus/device.h>
 #include <kbdus/inverter.h>
 
+#include <linux/fs.h>
 #include <linux/init.h>
 #include <linux/mm_types.h>
+#include <linux/poll.h>
+#include <linux/types.h>
 
 /* -------------------------------------------------------------------------- */
 
@@ -23,10 +27,10 @@ struct kbdus_transceiver;
 int kbdus_transceiver_validate_and_adjust_config(
     struct kbdus_device_and_fd_config *config);
 
-// The transceiver must not outlive the inverter.
+// The transceiver must not outlive the device.
 struct kbdus_transceiver *kbdus_transceiver_create(
     const struct kbdus_device_and_fd_config *config,
-    struct kbdus_inverter *inverter);
+    struct kbdus_device *device);
 
 void kbdus_transceiver_destroy(struct kbdus_transceiver *transceiver);
 
@@ -34,6 +38,18 @@ int kbdus_transceiver_handle_control_ioctl(
     struct kbdus_transceiver *transceiver, unsigned int command,
     unsigned long argument);
 
+ssize_t kbdus_transceiver_handle_control_read(
+    struct kbdus_transceiver *transceiver, char __user *buffer, size_t size,
+    loff_t offset, bool nonblock);
+
+ssize_t kbdus_transceiver_handle_control_write(
+    struct kbdus_transceiver *transceiver, const char __user *buffer,
+    size_t size);
+
+// Returns true if reading would not block.
+bool kbdus_transceiver_handle_control_poll(
+    struct kbdus_transceiver *transceiver, struct file *filp, poll_table *wait);
+
 int kbdus_transceiver_handle_control_mmap(
     struct kbdus_transceiver *transceiver, struct vm_area_struct *vma);
 
@@ -52,6 +52,14 @@
 #define kbdus_access_ok(type, addr, size) access_ok((type), (addr), (size))
 #endif
 
+// Zoned devices are only supported on Linux 5.10 and later, where the block
+// layer provides zone append requests and validates reported zones itself.
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)                             \
+    && IS_ENABLED(CONFIG_BLK_DEV_ZONED)
+#define KBDUS_SUPPORTS_ZONED_DEVICES 1
+#endif
+
 /**
  * This has linear complexity and is only intended to be used in assertions off
  * the critical path.
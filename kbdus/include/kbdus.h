@@ -11,7 +11,7 @@
  * The three components of the version of the `kbdus.h` header file that was
  * included.
  */
-#define KBDUS_HEADER_VERSION_PATCH 2
+#define KBDUS_HEADER_VERSION_PATCH 3
 
 /* -------------------------------------------------------------------------- */
 
@@ -48,6 +48,34 @@ struct kbdus_version
     /** \endcond */
 };
 
+/**
+ * \brief Policies for choosing which request awaiting to be received through a
+ *        hardware queue is received next.
+ *
+ * See `struct kbdus_device_config.dispatch_policy`.
+ */
+enum kbdus_dispatch_policy
+{
+    /** \brief Requests are received in the order they were submitted. */
+    KBDUS_DISPATCH_POLICY_FIFO,
+
+    /**
+     * \brief *Read* requests are received before requests of other types.
+     */
+    KBDUS_DISPATCH_POLICY_READS_FIRST,
+
+    /**
+     * \brief Requests are received in order of their I/O priority (see
+     *        `struct kbdus_item.ioprio`).
+     *
+     * Requests of class `IOPRIO_CLASS_RT` are received first, then those of
+     * class `IOPRIO_CLASS_BE` or with no priority, and then those of class
+     * `IOPRIO_CLASS_IDLE`. Requests of the same class are received in order of
+     * their priority level.
+     */
+    KBDUS_DISPATCH_POLICY_PRIORITY,
+};
+
 /**
  * \brief Configuration for a device.
  *
@@ -326,8 +354,21 @@ struct kbdus_device_config
      */
     uint8_t recoverable;
 
+    /**
+     * \brief How to choose which request awaiting to be received through a
+     *        hardware queue is received next.
+     *
+     * Must be a value of `enum kbdus_dispatch_policy`. Under any policy other
+     * than `KBDUS_DISPATCH_POLICY_FIFO`, requests that have been waiting to be
+     * received for a long time (currently 500 milliseconds) are received before
+     * all others, oldest first, so that no request is starved.
+     *
+     * Directionality: IN on create.
+     */
+    uint8_t dispatch_policy;
+
     /** \cond PRIVATE */
-    uint8_t reserved_1_[3];
+    uint8_t reserved_1_[2];
     /** \endcond */
 
     /**
@@ -344,8 +385,237 @@ struct kbdus_device_config
      */
     uint32_t minor;
 
+    /**
+     * \brief The number of hardware queues of the device.
+     *
+     * Each hardware queue is serviced separately: items for requests submitted
+     * through hardware queue `q` are only received with ioctl commands whose
+     * rai index `i` satisfies `i % num_queues == q` (or, for ioctl command
+     * `KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS`, whose batch's
+     * `queue_index` is `q`). Replies may be sent through any rai. Requests
+     * submitted before the device first becomes available to clients are all
+     * serviced by the first hardware queue.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If this value is 0, it is set to 1;
+     * - Otherwise, this value is either left unchanged or decreased to an
+     *   unspecified positive value no greater than the *adjusted* value of
+     *   `max_outstanding_reqs` (but never increased).
+     *
+     * The *adjusted* value of `max_outstanding_reqs` is always a multiple of
+     * the *adjusted* value of this field.
+     */
+    uint32_t num_queues;
+
+    /**
+     * \brief How many of the device's hardware queues are dedicated to polled
+     *        I/O.
+     *
+     * The last `num_poll_queues` of the device's `num_queues` hardware queues
+     * serve only polled requests, such as those submitted with `RWF_HIPRI` or
+     * through an io_uring instance set up with `IORING_SETUP_IOPOLL`, and the
+     * remaining hardware queues serve all other requests. Items for polled
+     * requests are received and replied to like any others, but the requests
+     * are then completed by the clients that submitted them, which busy-poll
+     * for completions instead of sleeping until woken up.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If the running kernel does not support polled I/O, this value is set
+     *   to 0;
+     * - Otherwise, this value is either left unchanged or decreased to a value
+     *   less than the *adjusted* value of `num_queues` (but never increased).
+     */
+    uint32_t num_poll_queues;
+
+    /**
+     * \brief The maximum number of ranges of a single *discard* request.
+     *
+     * If this is greater than 1, discards of several non-contiguous regions may
+     * be merged into a single request, whose item then lists its ranges in the
+     * request payload (see `KBDUS_ITEM_TYPE_DISCARD`). This greatly reduces the
+     * number of items needed to serve workloads that issue many small discards,
+     * such as `fstrim` on fragmented file systems.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If `supports_discard` is false, this value is set to 0;
+     * - Otherwise, if this value is 0 or the running kernel does not support
+     *   multi-range discard requests, it is set to 1;
+     * - Otherwise, this value is either left unchanged or decreased to an
+     *   unspecified positive value (but never increased).
+     */
+    uint16_t max_discard_ranges;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_2_[2];
+    /** \endcond */
+
+    /**
+     * \brief The granularity (in bytes) with which kbdus tracks which regions
+     *        of the device are known to contain only zeros, or 0 to not track
+     *        them.
+     *
+     * If not 0, must be a power of two greater than or equal to
+     * `logical_block_size`, and `size` must be at most 2^58. The device is
+     * then divided into extents of this size (the last one possibly being
+     * smaller), and the driver may mark extents as known to contain only zeros
+     * using `KBDUS_IOCTL_SET_ZERO_RANGE`. *Read* requests that only target
+     * such extents are completed by kbdus itself, without ever reaching the
+     * driver.
+     * Every extent targeted by a request that may modify data (*write*, *write
+     * same*, *write zeros*, *FUA write*, *discard*, or *secure erase*) stops
+     * being known to contain only zeros as soon as that request is submitted,
+     * and again when it is completed.
+     *
+     * Initially, no extent is known to contain only zeros. Extents remain known
+     * to contain only zeros when the driver detaches from a recoverable device.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If `supports_read` is false or `zoned` is true, this value is set to
+     *   0;
+     * - Otherwise, this value is either left unchanged or increased to a power
+     *   of two so that the number of extents is at most 2^27.
+     */
+    uint32_t zero_extent_size;
+
+    /**
+     * \brief The maximum amount of memory (in bytes) to be used by kbdus to
+     *        cache the device's contents, or 0 to not cache them.
+     *
+     * If not 0, kbdus keeps a least-recently-used cache of data returned by
+     * *read* requests, with page granularity, and serves *read* requests whose
+     * data is entirely cached without ever reaching the driver. This is useful
+     * for read-mostly devices whose data is expensive to obtain and that are
+     * used with `O_DIRECT` or by several clients that do not share a page
+     * cache. Only *read* requests targeting at most 32 pages (*e.g.*, 128 KiB
+     * with 4 KiB pages) are cached. All of the cache's memory is allocated
+     * when the device is created.
+     *
+     * Cached data is invalidated when requests that may modify it (*write*,
+     * *write same*, *write zeros*, *FUA write*, *discard*, or *secure erase*)
+     * are submitted and when they complete. Drivers whose data may change in
+     * other ways (*e.g.*, as a side effect of *ioctl* requests, or by other
+     * means altogether) must invalidate it with
+     * `KBDUS_IOCTL_INVALIDATE_READ_CACHE`. Cached data is kept when the driver
+     * detaches from a recoverable device.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If `supports_read` is false or `zoned` is true, this value is set to
+     *   0;
+     * - Otherwise, this value is rounded down to a multiple of the page size.
+     */
+    uint32_t read_cache_size;
+
+    /**
+     * \brief Whether the device is a host-managed zoned block device.
+     *
+     * If this is true, the device is divided into zones of `zone_size` bytes
+     * (the last one possibly being smaller), whose types, conditions, and write
+     * pointers the driver reports in reply to *zone report* requests.
+     * Conventional zones can be written like any other region of a device.
+     * Sequential write required zones can only be written at their write
+     * pointer, by *write* and *FUA write* requests that start at it or by *zone
+     * append* requests, and are managed with *zone reset*, *zone open*, *zone
+     * close*, and *zone finish* requests. The driver must serve requests of all
+     * of these types, as well as *read* and *write* requests.
+     *
+     * *Write* and *FUA write* requests are submitted to the driver one at a
+     * time for each sequential zone, which is why the device's I/O scheduler
+     * defaults to (and must remain) `mq-deadline`. Any number of *zone append*
+     * requests to the same zone may however be outstanding at once, and the
+     * driver is free to place their data in any order, reporting where it was
+     * written in `kbdus_reply.arg64`.
+     *
+     * Directionality: IN on create.
+     *
+     * Restrictions: Must be false if the running kernel does not support zoned
+     * block devices (*i.e.*, if it is earlier than Linux 5.10 or was built
+     * without `CONFIG_BLK_DEV_ZONED`). If true, `supports_read` and
+     * `supports_write` must also be true.
+     */
+    uint8_t zoned;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_3_[7];
+    /** \endcond */
+
+    /**
+     * \brief The size of the device's zones, in bytes.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * Restrictions: If `zoned` is true, must be a power of two greater than or
+     * equal to both `logical_block_size` and `physical_block_size`, and no
+     * greater than 2^40.
+     *
+     * How this value is modified:
+     *
+     * - If `zoned` is false, this value is set to 0;
+     * - Otherwise, this value is left unchanged.
+     */
+    uint64_t zone_size;
+
+    /**
+     * \brief The maximum number of sequential zones that may be open
+     *        (explicitly or implicitly) at once, or 0 for no limit.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If `zoned` is false, this value is set to 0;
+     * - Otherwise, this value is left unchanged.
+     */
+    uint32_t max_open_zones;
+
+    /**
+     * \brief The maximum number of sequential zones that may be open or closed
+     *        at once, or 0 for no limit.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If `zoned` is false, this value is set to 0;
+     * - Otherwise, this value is left unchanged.
+     */
+    uint32_t max_active_zones;
+
+    /**
+     * \brief The maximum value for the 32-bit argument of *zone append*
+     *        requests.
+     *
+     * Directionality: IN/OUT on create.
+     *
+     * How this value is modified:
+     *
+     * - If `zoned` is false, this value is set to 0;
+     * - Otherwise, if this value is 0, it is set to the *adjusted* value of
+     *   `max_read_write_size`;
+     * - Otherwise, this value is either left unchanged or decreased to a
+     *   positive value no greater than the *adjusted* value of
+     *   `max_read_write_size` (but never increased);
+     * - In both cases, this value is then decreased to `zone_size` if greater
+     *   than it, and rounded down to a multiple of `logical_block_size`.
+     */
+    uint32_t max_zone_append_size;
+
     /** \cond PRIVATE */
-    uint8_t reserved_2_[60];
+    uint8_t reserved_4_[12];
     /** \endcond */
 };
 
@@ -363,6 +633,14 @@ struct kbdus_fd_config
     /**
      * \brief How many user-mappable request payload buffers to allocate.
      *
+     * If the device has more than one hardware queue and the system has more
+     * than one NUMA node, the preallocated buffer with index `i` is allocated
+     * on the NUMA node of the CPUs that submit requests to hardware queue
+     * `i % num_queues`, and rais are allocated on that of the first hardware
+     * queue. Otherwise, all are allocated close to the CPU on which the
+     * `KBDUS_IOCTL_CREATE_DEVICE` or `KBDUS_IOCTL_ATTACH_TO_DEVICE` ioctl
+     * command is issued.
+     *
      * Directionality: IN/OUT.
      *
      * How this value is modified: If it is greater than the *adjusted* value of
@@ -370,11 +648,246 @@ struct kbdus_fd_config
      */
     uint32_t num_preallocated_buffers;
 
+    /**
+     * \brief Whether to map request payloads into the process' memory instead
+     *        of copying them into preallocated buffers, when possible.
+     *
+     * If this is true, each preallocated buffer is paired with a *payload
+     * window* of the same size, which can be mapped by applying `mmap()` to
+     * the file description at offset `KBDUS_PAYLOAD_WINDOWS_MMAP_OFFSET` plus
+     * the buffer's index times its size. When an item for a *read*, *write*,
+     * or *FUA write* request is received into the preallocated buffer and the
+     * request's data consists only of whole pages (so that no memory other
+     * than the request's own data is exposed), those pages are instead
+     * mapped into the buffer's payload window, and the item's
+     * `payload_is_mapped` field is set. The driver must then access the
+     * request's data through the window, not the buffer, and the pages remain
+     * mapped until the respective reply is sent using the same buffer.
+     *
+     * The pages of requests other than *read* requests hold the client's data
+     * and are only inserted into mappings created without `PROT_WRITE`, which
+     * can then not be made writable, so the driver should map each window
+     * twice: once read-write, for *read* requests, and once read-only, for all
+     * other requests.
+     *
+     * Payload windows must not be mapped with `MAP_POPULATE`. Accessing a
+     * window while it holds no request's pages, or accessing a writable
+     * mapping of a window while it holds the pages of a request other than a
+     * *read* request, raises `SIGBUS`. Each file description's windows are
+     * mapped independently of those of other file descriptions.
+     *
+     * Directionality: IN/OUT.
+     *
+     * How this value is modified: If this is not supported by the running
+     * kernel, it is set to 0.
+     */
+    uint8_t zero_copy;
+
+    /**
+     * \brief Whether to also map request payloads whose data pages are not
+     *        suitably aligned to be laid out contiguously, describing their
+     *        layout with segments.
+     *
+     * Only has an effect if `zero_copy` is true. If this is also true, the
+     * data pages of *read*, *write*, and *FUA write* requests whose data is
+     * split across several memory regions are mapped page by page into the
+     * payload window, and an array of `struct kbdus_segment` values specifying
+     * the regions of the window that hold the request's data, in order, is
+     * stored at the start of the preallocated buffer. The item's
+     * `num_segments` field is then set to the number of segments. Payloads
+     * that can be laid out contiguously are described by a single segment.
+     *
+     * Only data pages that the request covers entirely are mapped themselves.
+     * Data that covers only part of a page is instead copied into a later part
+     * of the preallocated buffer (or, for *read* requests, copied from there
+     * when replying), whose pages are mapped into the window in its place with
+     * all other bytes zeroed, and the request is copied as usual if it doesn't
+     * fit there.
+     *
+     * Directionality: IN/OUT.
+     *
+     * How this value is modified: If `zero_copy` is false after being
+     * adjusted, this is set to 0.
+     */
+    uint8_t scatter_gather;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_1_[2];
+    /** \endcond */
+
+    /**
+     * \brief For how long, in microseconds, to busy-wait for a request before
+     *        sleeping when receiving items.
+     *
+     * If positive, a thread that would block waiting for an item for a queue
+     * with no available requests or notifications instead first busy-waits for
+     * up to this long, returning the first item that becomes available in the
+     * meantime. This avoids having to wake up the thread when requests arrive
+     * in quick succession, at the cost of CPU time. Busy-waiting also stops
+     * early if the thread should yield the CPU to another task or a signal is
+     * pending.
+     *
+     * Directionality: IN/OUT.
+     *
+     * How this value is modified: This value is either left unchanged or
+     * decreased to an unspecified value (but never increased).
+     */
+    uint32_t busy_poll_us;
+
+    /**
+     * \brief The maximum amount of data of a *read*, *write*, or *FUA write*
+     *        request to transfer at once, or 0 to always transfer all of it.
+     *
+     * If positive, the data of *read*, *write*, and *FUA write* requests
+     * larger than this is not transferred when items are received nor when
+     * replies are sent. Such items instead have their `payload_is_chunked`
+     * field set, and the driver transfers the request's data in chunks of at
+     * most this many bytes, each through the item's payload buffer, using
+     * `KBDUS_IOCTL_TRANSFER_CHUNK`. Preallocated buffers then need only hold a
+     * single chunk, so large requests need not be split nor require large
+     * buffers.
+     *
+     * Directionality: IN/OUT.
+     *
+     * How this value is modified: If positive, it is rounded up to a multiple
+     * of the system's page size, and then set to 0 if it is not less than the
+     * device's `max_read_write_size`.
+     */
+    uint32_t chunk_size;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_2_[112];
+    /** \endcond */
+};
+
+/**
+ * \brief The `mmap()` offset of the first payload window of a file
+ *        description.
+ *
+ * See `struct kbdus_fd_config.zero_copy`.
+ */
+#define KBDUS_PAYLOAD_WINDOWS_MMAP_OFFSET ((uint64_t)1 << 40)
+
+/**
+ * \brief A region of a payload window that holds part of a request's data.
+ *
+ * See `struct kbdus_fd_config.scatter_gather`.
+ */
+struct kbdus_segment
+{
+    /** \brief The offset of the region into the payload window, in bytes. */
+    uint32_t offset;
+
+    /** \brief The size of the region, in bytes. */
+    uint32_t size;
+};
+
+/**
+ * \brief A region of a device targeted by a multi-range *discard* request.
+ *
+ * See `struct kbdus_device_config.max_discard_ranges`.
+ */
+struct kbdus_range
+{
+    /** \brief The offset of the region into the device, in bytes. */
+    uint64_t offset;
+
+    /** \brief The size of the region, in bytes. */
+    uint32_t size;
+
+    /** \cond PRIVATE */
+    uint8_t padding_[4];
+    /** \endcond */
+};
+
+/** \brief Zone types. See `struct kbdus_zone`. */
+enum kbdus_zone_type
+{
+    /** \brief The zone may be written at any offset. */
+    KBDUS_ZONE_TYPE_CONVENTIONAL = 0x1,
+
+    /** \brief The zone may only be written sequentially. */
+    KBDUS_ZONE_TYPE_SEQUENTIAL_WRITE_REQUIRED = 0x2,
+};
+
+/** \brief Zone conditions. See `struct kbdus_zone`. */
+enum kbdus_zone_condition
+{
+    /** \brief The zone has no write pointer (it is conventional). */
+    KBDUS_ZONE_CONDITION_NOT_WRITE_POINTER = 0x0,
+
+    /** \brief The zone is empty. */
+    KBDUS_ZONE_CONDITION_EMPTY = 0x1,
+
+    /** \brief The zone was opened by being written. */
+    KBDUS_ZONE_CONDITION_IMPLICIT_OPEN = 0x2,
+
+    /** \brief The zone was opened by a *zone open* request. */
+    KBDUS_ZONE_CONDITION_EXPLICIT_OPEN = 0x3,
+
+    /** \brief The zone was partially written and then closed. */
+    KBDUS_ZONE_CONDITION_CLOSED = 0x4,
+
+    /** \brief The zone may only be read. */
+    KBDUS_ZONE_CONDITION_READ_ONLY = 0xd,
+
+    /** \brief The zone is full. */
+    KBDUS_ZONE_CONDITION_FULL = 0xe,
+
+    /** \brief The zone may be neither read nor written. */
+    KBDUS_ZONE_CONDITION_OFFLINE = 0xf,
+};
+
+/**
+ * \brief A zone of a zoned device, as reported in reply to a *zone report*
+ *        request.
+ *
+ * See `struct kbdus_device_config.zoned`.
+ */
+struct kbdus_zone
+{
+    /** \brief The offset of the zone into the device, in bytes. */
+    uint64_t offset;
+
+    /**
+     * \brief The size of the zone, in bytes.
+     *
+     * Must be `kbdus_device_config.zone_size`, except for the last zone, which
+     * may be smaller.
+     */
+    uint64_t size;
+
+    /**
+     * \brief How many bytes of the zone can be written, which must be no
+     *        greater than `size`.
+     */
+    uint64_t capacity;
+
+    /**
+     * \brief The offset into the device, in bytes, of the zone's write
+     *        pointer.
+     *
+     * Ignored for conventional zones.
+     */
+    uint64_t write_pointer;
+
+    /** \brief The zone's type, as an `enum kbdus_zone_type` value. */
+    uint8_t type;
+
+    /** \brief The zone's condition, as an `enum kbdus_zone_condition` value. */
+    uint8_t condition;
+
     /** \cond PRIVATE */
-    uint8_t reserved_[124];
+    uint8_t padding_[6];
     /** \endcond */
 };
 
+/**
+ * \brief The maximum number of zones reported in reply to a single *zone
+ *        report* request.
+ */
+#define KBDUS_MAX_ZONES_PER_REPORT 64
+
 /** \brief Configuration for both a device and a file description. */
 struct kbdus_device_and_fd_config
 {
@@ -489,7 +1002,12 @@ enum kbdus_item_type
      *
      * - 64-bit argument: discard offset;
      * - 32-bit argument: number of bytes to be discarded;
-     * - Request payload: (none);
+     * - Request payload: if `kbdus_item.num_ranges` is positive, that many
+     *   `struct kbdus_range` entries describing the regions to be discarded
+     *   (in which case the arguments give the offset of the first region and
+     *   the total size of all regions), otherwise (none);
+     * - Request payload size: `kbdus_item.num_ranges * sizeof(struct
+     *   kbdus_range)`;
      * - Reply payload: (none).
      */
     KBDUS_ITEM_TYPE_DISCARD,
@@ -519,6 +1037,79 @@ enum kbdus_item_type
      *   direction has the _IOC_WRITE bit set.
      */
     KBDUS_ITEM_TYPE_IOCTL,
+
+    /**
+     * \brief *Zone report* request.
+     *
+     * - 64-bit argument: offset of the first zone to be reported, which may be
+     *   anywhere in that zone;
+     * - 32-bit argument: maximum number of zones to be reported, no greater
+     *   than `KBDUS_MAX_ZONES_PER_REPORT`;
+     * - Request payload: (none);
+     * - Reply payload: `kbdus_reply.arg64` consecutive `struct kbdus_zone`
+     *   entries, starting with the zone containing the 64-bit argument, if the
+     *   operation was successful;
+     * - Reply payload size: `kbdus_reply.arg64 * sizeof(struct kbdus_zone)`,
+     *   where `kbdus_reply.arg64` must be no greater than the 32-bit argument,
+     *   and may only be less than it if the last zone of the device is
+     *   reported.
+     */
+    KBDUS_ITEM_TYPE_ZONE_REPORT,
+
+    /**
+     * \brief *Zone reset* request.
+     *
+     * - 64-bit argument: offset of the zone to be reset;
+     * - 32-bit argument: (unused);
+     * - Request payload: (none);
+     * - Reply payload: (none).
+     */
+    KBDUS_ITEM_TYPE_ZONE_RESET,
+
+    /**
+     * \brief *Zone open* request.
+     *
+     * - 64-bit argument: offset of the zone to be explicitly opened;
+     * - 32-bit argument: (unused);
+     * - Request payload: (none);
+     * - Reply payload: (none).
+     */
+    KBDUS_ITEM_TYPE_ZONE_OPEN,
+
+    /**
+     * \brief *Zone close* request.
+     *
+     * - 64-bit argument: offset of the zone to be closed;
+     * - 32-bit argument: (unused);
+     * - Request payload: (none);
+     * - Reply payload: (none).
+     */
+    KBDUS_ITEM_TYPE_ZONE_CLOSE,
+
+    /**
+     * \brief *Zone finish* request.
+     *
+     * - 64-bit argument: offset of the zone to be transitioned to the full
+     *   condition;
+     * - 32-bit argument: (unused);
+     * - Request payload: (none);
+     * - Reply payload: (none).
+     */
+    KBDUS_ITEM_TYPE_ZONE_FINISH,
+
+    /**
+     * \brief *Zone append* request.
+     *
+     * - 64-bit argument: offset of the zone to be appended to;
+     * - 32-bit argument: number of bytes to be written;
+     * - Request payload: the data to be written at the zone's write pointer;
+     * - Request payload size: the 32-bit argument;
+     * - Reply payload: (none).
+     *
+     * If the operation was successful, `kbdus_reply.arg64` must be the offset
+     * at which the data was written, which must lie entirely within the zone.
+     */
+    KBDUS_ITEM_TYPE_ZONE_APPEND,
 };
 
 /** \brief An item. */
@@ -552,18 +1143,95 @@ struct kbdus_item
     /** \brief The 64-bit argument for this item (if applicable). */
     uint64_t arg64;
 
-    /** \cond PRIVATE */
-    uint8_t padding_[32];
-    /** \endcond */
-};
-
-/** \brief A reply to a request. */
-struct kbdus_reply
-{
     /**
-     * \brief Pointer to process memory or index of preallocated buffer.
+     * \brief Whether the request's data was mapped into the payload window of
+     *        the preallocated buffer instead of being copied into the buffer.
      *
-     * The meaning of this field depends on use_preallocated_buffer.
+     * See `struct kbdus_fd_config.zero_copy`.
+     */
+    uint8_t payload_is_mapped;
+
+    /**
+     * \brief Whether the request's data was not transferred and must instead
+     *        be transferred in chunks.
+     *
+     * If this is set, the payload buffer holds none of the data of the
+     * *read*, *write*, or *FUA write* request, and the reply to it does not
+     * transfer any data either. See `struct kbdus_fd_config.chunk_size` and
+     * `KBDUS_IOCTL_TRANSFER_CHUNK`.
+     */
+    uint8_t payload_is_chunked;
+
+    /**
+     * \brief The number of segments describing the layout of the request's
+     *        data in the payload window, or 0 if it is laid out contiguously
+     *        from the start of the window.
+     *
+     * Only positive if `payload_is_mapped` is set. See `struct
+     * kbdus_fd_config.scatter_gather`.
+     */
+    uint16_t num_segments;
+
+    /**
+     * \brief The number of ranges of a *discard* request, or 0 if it targets
+     *        a single contiguous region.
+     *
+     * Only positive if the request targets two or more non-contiguous regions,
+     * which requires `struct kbdus_device_config.max_discard_ranges` to be
+     * greater than 1. See `KBDUS_ITEM_TYPE_DISCARD`.
+     */
+    uint16_t num_ranges;
+
+    /**
+     * \brief The I/O priority of the request, encoded as for `ioprio_set()`.
+     *
+     * The priority class and level can be extracted with macros
+     * `IOPRIO_PRIO_CLASS()` and `IOPRIO_PRIO_DATA()` from `<linux/ioprio.h>`. A
+     * class of `IOPRIO_CLASS_NONE` means that the request has no priority of
+     * its own.
+     */
+    uint16_t ioprio;
+
+    /**
+     * \brief Flags describing how the request was issued, as a combination
+     *        of `enum kbdus_item_op_flag` values.
+     */
+    uint8_t op_flags;
+
+    /** \cond PRIVATE */
+    uint8_t padding2_[23];
+    /** \endcond */
+};
+
+/** \brief Flags describing how a request was issued. */
+enum kbdus_item_op_flag
+{
+    /**
+     * \brief The request is synchronous, *i.e.*, its issuer is waiting for it
+     *        to complete.
+     *
+     * All *read* requests are synchronous.
+     */
+    KBDUS_ITEM_OP_FLAG_SYNC = 1u << 0,
+
+    /** \brief The request pertains to file system metadata. */
+    KBDUS_ITEM_OP_FLAG_META = 1u << 1,
+
+    /**
+     * \brief The request is background I/O, such as writeback of dirty pages.
+     *
+     * Never set on Linux 4.9 and earlier.
+     */
+    KBDUS_ITEM_OP_FLAG_BACKGROUND = 1u << 2,
+};
+
+/** \brief A reply to a request. */
+struct kbdus_reply
+{
+    /**
+     * \brief Pointer to process memory or index of preallocated buffer.
+     *
+     * The meaning of this field depends on use_preallocated_buffer.
      */
     uint64_t user_ptr_or_buffer_index;
 
@@ -600,8 +1268,54 @@ struct kbdus_reply
      */
     int32_t error;
 
+    /**
+     * \brief The offset into file `splice_fd` at which the request's data
+     *        should be transferred, if `use_splice` is true.
+     */
+    uint64_t splice_offset;
+
+    /**
+     * \brief The file descriptor (in the process sending the reply) of the
+     *        file to or from which the request's data should be transferred,
+     *        if `use_splice` is true.
+     */
+    int32_t splice_fd;
+
+    /**
+     * \brief Whether the request's data should be transferred directly
+     *        between the request and a file instead of through the reply's
+     *        payload buffer.
+     *
+     * May only be true for replies to *read*, *write*, and *FUA write*
+     * requests, and is ignored if `error` is not 0. If it is true, the payload
+     * buffer is ignored and kbdus itself transfers the request's data: for
+     * *read* requests, the data is read from file `splice_fd` at offset
+     * `splice_offset`; for *write* and *FUA write* requests, the data is
+     * written to that file at that offset (and, for *FUA write* requests, then
+     * synced to stable storage).
+     *
+     * If the transfer fails or is short, the request fails with the
+     * corresponding error (or `EIO` for short transfers), but the reply is
+     * still considered successfully sent.
+     */
+    uint8_t use_splice;
+
     /** \cond PRIVATE */
-    uint8_t padding2_[40];
+    uint8_t padding2_[3];
+    /** \endcond */
+
+    /**
+     * \brief The 64-bit result for this reply (if applicable).
+     *
+     * Only used for replies to *zone report* requests, for which it is the
+     * number of zones reported, and *zone append* requests, for which it is the
+     * offset at which the data was written (see `KBDUS_ITEM_TYPE_ZONE_REPORT`
+     * and `KBDUS_ITEM_TYPE_ZONE_APPEND`). Ignored if `error` is not 0.
+     */
+    uint64_t arg64;
+
+    /** \cond PRIVATE */
+    uint8_t padding3_[16];
     /** \endcond */
 };
 
@@ -646,9 +1360,278 @@ union kbdus_reply_or_item
     struct kbdus_reply_or_item_common common;
 };
 
+/**
+ * \brief A batch of consecutive `union kbdus_reply_or_item` structures.
+ *
+ * This is the argument of ioctl command
+ * `KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS`.
+ */
+struct kbdus_batch
+{
+    /** \brief The index of the first `union kbdus_reply_or_item`. */
+    uint64_t first_index;
+
+    /**
+     * \brief The number of `union kbdus_reply_or_item` in the batch.
+     *
+     * Must be positive.
+     */
+    uint32_t size;
+
+    /**
+     * \brief The index of the hardware queue from which to receive items.
+     *
+     * Must be less than the device's `num_queues`.
+     */
+    uint32_t queue_index;
+
+    /**
+     * \brief The maximum number of milliseconds to wait for the first item, or
+     *        0 to wait indefinitely.
+     */
+    uint32_t timeout_ms;
+
+    /**
+     * \brief Set on success to the number of requests that were still
+     *        awaiting to be received from the hardware queue after the batch's
+     *        items were received.
+     *
+     * This is only a hint of how busy the queue is, as it may be outdated by
+     * the time the ioctl returns. Its value on input is ignored.
+     */
+    uint32_t num_awaiting;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_[8];
+    /** \endcond */
+};
+
+/**
+ * \brief A chunk of the data of a request whose item has `payload_is_chunked`
+ *        set.
+ *
+ * This is the argument of ioctl command `KBDUS_IOCTL_TRANSFER_CHUNK`.
+ */
+struct kbdus_chunk
+{
+    /**
+     * \brief Pointer to process memory or index of preallocated buffer.
+     *
+     * The meaning of this field depends on use_preallocated_buffer.
+     */
+    uint64_t user_ptr_or_buffer_index;
+
+    /**
+     * \brief The *seqnum* portion of the handle that identifies the item to
+     *        which this chunk pertains.
+     */
+    uint64_t handle_seqnum;
+
+    /**
+     * \brief The *index* portion of the handle that identifies the item to
+     *        which this chunk pertains.
+     */
+    uint16_t handle_index;
+
+    /**
+     * \brief Whether the chunk's data should be transferred to or from a
+     *        preallocated buffer or a region of process memory.
+     */
+    uint8_t use_preallocated_buffer;
+
+    /** \cond PRIVATE */
+    uint8_t padding_[1];
+    /** \endcond */
+
+    /**
+     * \brief The offset of the chunk into the request's data, in bytes.
+     *
+     * Must be a multiple of the file description's `chunk_size` and less than
+     * the size of the request's data.
+     */
+    uint32_t offset;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_[8];
+    /** \endcond */
+};
+
 /** \brief The "type" of all kbdus-specific `ioctl` commands. */
 #define KBDUS_IOCTL_TYPE 0xbd
 
+/**
+ * \brief A region of a device whose cached data is to be invalidated.
+ *
+ * See `KBDUS_IOCTL_INVALIDATE_READ_CACHE`.
+ */
+struct kbdus_cache_range
+{
+    /** \brief The offset (in bytes) into the device of the region. */
+    uint64_t offset;
+
+    /** \brief The size (in bytes) of the region. */
+    uint64_t size;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_[48];
+    /** \endcond */
+};
+
+/**
+ * \brief A region of a device whose contents are known or not known to be
+ *        all zeros.
+ *
+ * See `KBDUS_IOCTL_SET_ZERO_RANGE`.
+ */
+struct kbdus_zero_range
+{
+    /**
+     * \brief The offset (in bytes) into the device of the region.
+     *
+     * Must be a multiple of the device's logical block size.
+     */
+    uint64_t offset;
+
+    /**
+     * \brief The size (in bytes) of the region.
+     *
+     * Must be a multiple of the device's logical block size.
+     */
+    uint64_t size;
+
+    /**
+     * \brief Whether the region is known to contain only zeros.
+     *
+     * If nonzero, every extent (see `kbdus_device_config.zero_extent_size`)
+     * that lies entirely within the region becomes known to contain only
+     * zeros. Otherwise, every extent that overlaps the region stops being
+     * known to contain only zeros.
+     */
+    uint8_t zero;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_[47];
+    /** \endcond */
+};
+
+/**
+ * \brief The number of buckets in each latency histogram of `struct
+ *        kbdus_request_stats`.
+ *
+ * Bucket 0 counts latencies under 2^10 nanoseconds, bucket `i` counts latencies
+ * in [2^(9+i), 2^(10+i)) nanoseconds, and the last bucket counts all latencies
+ * of at least 2^32 nanoseconds.
+ */
+#define KBDUS_STATS_HIST_BUCKETS 24
+
+/**
+ * \brief The number of request types with separate statistics in `struct
+ *        kbdus_device_stats`, namely those from `KBDUS_ITEM_TYPE_READ` to
+ *        `KBDUS_ITEM_TYPE_IOCTL`.
+ */
+#define KBDUS_STATS_NUM_REQ_TYPES 10
+
+/**
+ * \brief Statistics about the requests of a given type that a device has
+ *        received.
+ *
+ * All values are cumulative since the device was created.
+ */
+struct kbdus_request_stats
+{
+    /** \brief The number of completed requests. */
+    uint64_t requests;
+
+    /** \brief The total size (in bytes) of completed requests. */
+    uint64_t bytes;
+
+    /** \brief The number of requests that failed, excluding timeouts. */
+    uint64_t errors;
+
+    /** \brief The number of requests that timed out. */
+    uint64_t timeouts;
+
+    /** \brief The number of requests merged into other requests. */
+    uint64_t merges;
+
+    /**
+     * \brief The total time (in nanoseconds) that requests spent being served
+     *        by the driver.
+     */
+    uint64_t service_ns;
+
+    /**
+     * \brief Histogram of the time requests spent waiting to be received by the
+     *        driver.
+     */
+    uint64_t queue_wait_hist[KBDUS_STATS_HIST_BUCKETS];
+
+    /**
+     * \brief Histogram of the time requests spent being served by the driver,
+     *        from being received until the driver starts replying to them.
+     */
+    uint64_t service_hist[KBDUS_STATS_HIST_BUCKETS];
+
+    /**
+     * \brief Histogram of the time spent copying requests' data to and from
+     *        the driver.
+     */
+    uint64_t copy_hist[KBDUS_STATS_HIST_BUCKETS];
+};
+
+/**
+ * \brief Statistics about a device.
+ *
+ * This is the argument of ioctl command `KBDUS_IOCTL_GET_DEVICE_STATS`.
+ *
+ * Counters are not read atomically with respect to each other, so values may be
+ * slightly inconsistent if requests are being processed.
+ */
+struct kbdus_device_stats
+{
+    /**
+     * \brief The identifier of the device.
+     *
+     * Directionality: IN.
+     */
+    uint64_t id;
+
+    /**
+     * \brief The time (in nanoseconds, as given by `clock_gettime()` with
+     *        `CLOCK_MONOTONIC`) at which the statistics were taken.
+     *
+     * Directionality: OUT.
+     */
+    uint64_t timestamp_ns;
+
+    /**
+     * \brief The number of requests waiting to be received by the driver.
+     *
+     * Directionality: OUT.
+     */
+    uint32_t num_awaiting_get;
+
+    /**
+     * \brief The number of requests received by the driver but not yet
+     *        completed.
+     *
+     * Directionality: OUT.
+     */
+    uint32_t num_in_flight;
+
+    /** \cond PRIVATE */
+    uint8_t reserved_[40];
+    /** \endcond */
+
+    /**
+     * \brief Statistics for each request type, indexed by the type minus
+     *        `KBDUS_ITEM_TYPE_READ`.
+     *
+     * Directionality: OUT.
+     */
+    struct kbdus_request_stats types[KBDUS_STATS_NUM_REQ_TYPES];
+};
+
 /**
  * \brief Writes kbdus' version into the argument.
  *
@@ -908,7 +1891,8 @@ union kbdus_reply_or_item
  * \brief Blocks until an item is ready to be consumed.
  *
  * The argument is the index of the `union kbdus_reply_or_item` to which to
- * write the item.
+ * write the item. Only items from the device's hardware queue with index
+ * `argument % num_queues` are received.
  *
  * If this ioctl fails with errno = EINTR, the struct kbdus_reply_or_item is
  * left unmodified. If this ioctl fails with any other errno, the struct
@@ -945,6 +1929,232 @@ union kbdus_reply_or_item
  */
 #define KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM _IO(KBDUS_IOCTL_TYPE, 12)
 
+/**
+ * \brief Sends the replies in a batch and then blocks until at least one item
+ *        is ready to be consumed, receiving as many items as are available up
+ *        to the batch's size.
+ *
+ * The argument is a pointer to a `struct kbdus_batch`.
+ *
+ * Replies are sent as if by `KBDUS_IOCTL_SEND_REPLY` on every `union
+ * kbdus_reply_or_item` in the batch, in order. Items are then written to
+ * consecutive `union kbdus_reply_or_item` starting at the first one in the
+ * batch. Only the first item may block, and notification items are always
+ * received alone, as the only item in the batch. The `handle_index` field of
+ * every `union kbdus_reply_or_item` in the batch that did not receive an item
+ * is set to 0.
+ *
+ * As with `KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM`, this may only fail with
+ * `EINTR` after the replies were successfully sent, and retrying is safe since
+ * attempts to complete an already completed request are ignored.
+ *
+ * If the batch's `timeout_ms` field is positive and no item becomes available
+ * within that many milliseconds, this ioctl fails with errno = ETIMEDOUT after
+ * the replies were successfully sent, and the `handle_index` field of every
+ * `union kbdus_reply_or_item` in the batch is set to 0.
+ *
+ * If this ioctl fails with errno = EINTR, the batch's `union
+ * kbdus_reply_or_item` structures are left unmodified. If this ioctl fails
+ * with any other errno, they are left in an unspecified state.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EFAULT` if memory copy from user space fails.
+ * - Fails with `errno = EINVAL` if the batch is empty or extends beyond the
+ *   last `union kbdus_reply_or_item`, if `queue_index` is invalid, or if the
+ *   reserved space is not zero-filled.
+ * - Fails with `errno = EINTR` if interrupted.
+ * - Fails with `errno = ETIMEDOUT` if the batch's `timeout_ms` field is
+ *   positive and no item became available within that time.
+ * - Returns the (positive) number of received items on success.
+ */
+#define KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS                             \
+    _IOW(KBDUS_IOCTL_TYPE, 13, struct kbdus_batch)
+
+/**
+ * \brief Marks a region of the device to which the file description is
+ *        attached as known or not known to contain only zeros.
+ *
+ * The argument is a pointer to a `struct kbdus_zero_range`. See
+ * `kbdus_device_config.zero_extent_size`.
+ *
+ * Extents targeted by requests that may modify data stop being known to
+ * contain only zeros both when those requests are submitted and when they are
+ * completed, so requests that are still in progress when a region is marked
+ * (including those that the driver has not yet received) can't leave it
+ * wrongly marked. However, the driver must itself ensure that no such request
+ * targeting the region was completed since the region last contained only
+ * zeros, as kbdus can't tell, *e.g.*, by only marking regions before the device
+ * becomes available.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EFAULT` if memory copy from user space fails.
+ * - Fails with `errno = EINVAL` if the file description is not attached to a
+ *   device or if the reserved space is not zero-filled.
+ * - Fails with `errno = EOPNOTSUPP` if the device's `zero_extent_size` is 0.
+ * - Fails with `errno = ERANGE` if the region is not aligned to the device's
+ *   logical block size or extends beyond the end of the device.
+ * - Returns 0 on success.
+ */
+#define KBDUS_IOCTL_SET_ZERO_RANGE                                             \
+    _IOW(KBDUS_IOCTL_TYPE, 14, struct kbdus_zero_range)
+
+/**
+ * \brief Removes the data of a region of the device to which the file
+ *        description is attached from its read cache.
+ *
+ * The argument is a pointer to a `struct kbdus_cache_range`. See
+ * `kbdus_device_config.read_cache_size`.
+ *
+ * Every cached page that overlaps the region is removed from the cache, and
+ * *read* requests in progress are prevented from inserting possibly stale data
+ * into it. This succeeds and has no effect if the device has no read cache.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EFAULT` if memory copy from user space fails.
+ * - Fails with `errno = EINVAL` if the file description is not attached to a
+ *   device or if the reserved space is not zero-filled.
+ * - Fails with `errno = ERANGE` if the region extends beyond the end of the
+ *   device.
+ * - Returns 0 on success.
+ */
+#define KBDUS_IOCTL_INVALIDATE_READ_CACHE                                      \
+    _IOW(KBDUS_IOCTL_TYPE, 15, struct kbdus_cache_range)
+
+/**
+ * \brief Suspends the device to which the file description is attached, so
+ *        that serving it can be handed off to another process.
+ *
+ * The device keeps accepting requests, but these are not sent to the file
+ * description, which instead only receives "terminate" items until
+ * `KBDUS_IOCTL_RESUME` is issued on it. Unlike with `KBDUS_IOCTL_TERMINATE`,
+ * no "flush+terminate" item is sent, and requests that were already received
+ * can and should still be replied to.
+ *
+ * The file description remains attached to the device, and can be passed to
+ * another process (*e.g.*, over a UNIX domain socket), which can then map the
+ * memory already allocated for it and resume serving the device. If the file
+ * description is instead closed, the device is left as if it had been closed
+ * while not suspended.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EINVAL` if the file description is not attached to a
+ *   device, or if it was already suspended or terminated.
+ * - Fails with `errno = EBUSY` if the device is not yet available to clients.
+ * - Fails with `errno = EINPROGRESS` if another file description is trying to
+ *   attach to the device.
+ * - Fails with `errno = ENODEV` if the device was terminated.
+ * - Fails with `errno = EINTR` if interrupted.
+ * - Returns 0 on success.
+ */
+#define KBDUS_IOCTL_SUSPEND _IO(KBDUS_IOCTL_TYPE, 16)
+
+/**
+ * \brief Resumes a device suspended using `KBDUS_IOCTL_SUSPEND` on the same
+ *        file description.
+ *
+ * Requests that were received through the file description but not replied to
+ * are received again, and a "device available" notification is sent to it, as
+ * when attaching to a device.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EINVAL` if the file description is not attached to a
+ *   device or is not suspended.
+ * - Fails with `errno = EINPROGRESS` if another file description is trying to
+ *   attach to the device, in which case the device remains suspended.
+ * - Fails with `errno = ENODEV` if the device was terminated.
+ * - Fails with `errno = EINTR` if interrupted.
+ * - Returns 0 on success.
+ */
+#define KBDUS_IOCTL_RESUME _IO(KBDUS_IOCTL_TYPE, 17)
+
+/**
+ * \brief Transfers a chunk of the data of a request whose item has
+ *        `payload_is_chunked` set.
+ *
+ * The argument is a pointer to a `struct kbdus_chunk`. The chunk covers the
+ * `chunk_size` bytes of the request's data starting at the chunk's offset, or
+ * fewer if it is the last chunk. For *write* and *FUA write* requests, that
+ * data is copied into the chunk's payload buffer. For *read* requests, it is
+ * copied from the chunk's payload buffer into the request.
+ *
+ * The driver may transfer chunks in any order and more than once. All chunks
+ * of a *read* request must have been transferred before a successful reply to
+ * it is sent.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EFAULT` if memory copy from or to user space fails.
+ * - Fails with `errno = EINVAL` if the handle is invalid, if the item's
+ *   `payload_is_chunked` field was not set, if the offset is invalid, if the
+ *   preallocated buffer index is invalid, or if the reserved space is not
+ *   zero-filled.
+ * - Fails with `errno = ENOENT` if the request was already completed (*e.g.*,
+ *   because it timed out or the device was terminated).
+ * - Returns the (positive) size of the chunk on success.
+ */
+#define KBDUS_IOCTL_TRANSFER_CHUNK                                             \
+    _IOW(KBDUS_IOCTL_TYPE, 18, struct kbdus_chunk)
+
+/**
+ * \brief Retrieves statistics about a device.
+ *
+ * The id of the device whose statistics to retrieve must be specified in the
+ * `id` field of the argument, and the reserved space must be zero-filled. The
+ * remaining fields are then overwritten with the device's statistics.
+ *
+ * Errors and return values:
+ *
+ * - Fails with `errno = EFAULT` if memory copy from/to user space fails.
+ * - Fails with `errno = EINVAL` if no device with the given id ever existed or
+ *   if the reserved space is not zero-filled.
+ * - Fails with `errno = ENODEV` if the device with the given id no longer
+ *   exists.
+ * - Fails with `errno = EINTR` if interrupted.
+ * - Returns 0 on success.
+ */
+#define KBDUS_IOCTL_GET_DEVICE_STATS                                           \
+    _IOWR(KBDUS_IOCTL_TYPE, 19, struct kbdus_device_stats)
+
+/*
+ * Items can also be received and replies sent by reading from and writing to a
+ * control file description that is attached to a device, which allows using
+ * interfaces such as io_uring instead of ioctl commands:
+ *
+ * - Reading receives items into an array of `struct kbdus_item`, whose size
+ *   must be a positive multiple of 64, much like
+ *   `KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS` does for a batch. The
+ *   `user_ptr_or_buffer_index` and `use_preallocated_buffer` fields are read
+ *   from each array element before an item is written to it. The file offset
+ *   is the index of the hardware queue from which to receive items, and it is
+ *   never modified. Returns the number of bytes of the array that were filled
+ *   with items.
+ *
+ * - Writing sends the replies in an array of `struct kbdus_reply`, whose size
+ *   must be a positive multiple of 64, as if by `KBDUS_IOCTL_SEND_REPLY`.
+ *   Returns the number of bytes of the array whose replies were sent.
+ *
+ * The array need not be in memory mapped from the control file description,
+ * but it must be a single contiguous buffer: vectored reads and writes with
+ * more than one segment fail with `errno = EINVAL`.
+ *
+ * If the control file description is in non-blocking mode (`O_NONBLOCK`), or
+ * if the read is submitted with `RWF_NOWAIT` (e.g., by `preadv2()` or as the
+ * `rw_flags` of an io_uring read), reading fails with `errno = EAGAIN` instead
+ * of blocking when no item is available. (Writing never waits for requests.)
+ * The control file description can also be monitored with `poll()`,
+ * `select()`, or epoll, being reported as readable when an item (possibly a
+ * notification) is available from any hardware queue. This allows a single
+ * thread to receive items and send replies without ever blocking in kbdus, and
+ * thus to keep several requests in progress at once. (Readiness may
+ * occasionally be reported spuriously, in which case reading fails with
+ * `errno = EAGAIN`.)
+ */
+
 /* -------------------------------------------------------------------------- */
 
 #ifdef __cplusplus
@@ -0,0 +1,709 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* -------------------------------------------------------------------------- */
+
+#include <kbdus/cache.h>
+
+#include <linux/atomic.h>
+#include <linux/blk-mq.h>
+#include <linux/blkdev.h>
+#include <linux/cache.h>
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/gfp.h>
+#include <linux/hash.h>
+#include <linux/highmem.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#include <linux/vmalloc.h>
+
+/* -------------------------------------------------------------------------- */
+
+// Invalidations are tracked per group of 2^KBDUS_CACHE_GROUP_SHIFT_ consecutive
+// device pages, with group `i` using generation `i % KBDUS_CACHE_NUM_GENS_`, so
+// that an invalidation only prevents the insertion of *read* requests targeting
+// groups that share a generation with it. Groups sharing a generation are thus
+// far apart (64 MiB with 4 KiB pages).
+//
+// Pages are also split among up to KBDUS_CACHE_MAX_SHARDS_ shards by group,
+// with group `i` belonging to shard `i % num_shards`, each with its own lock,
+// least-recently-used list, and hash table, so that requests targeting
+// different regions of the device seldom contend for the same lock.
+//
+// *Read* requests targeting more than KBDUS_CACHE_MAX_REQ_PAGES_ pages are
+// neither served from nor inserted into the cache.
+enum
+{
+    KBDUS_CACHE_GROUP_SHIFT_   = 4,
+    KBDUS_CACHE_NUM_GENS_      = 1 << 10,
+    KBDUS_CACHE_MAX_SHARDS_    = 1 << 6,
+    KBDUS_CACHE_MAX_REQ_PAGES_ = 32,
+};
+
+struct kbdus_cache_entry_
+{
+    // links entries with the same hash, if the entry holds a page
+    struct hlist_node hash_node;
+
+    // links entries in their shard's `lru` list if the entry holds a page, and
+    // in its `free` list otherwise, except while a page is being inserted into
+    // the entry, during which the entry is in no list
+    struct list_head list;
+
+    // the index of the device page whose data the entry holds
+    u64 index;
+
+    // *read* requests being served from the cache hold a reference to this
+    // page while copying data from it, so its data is only modified when the
+    // entry holds the only reference
+    struct page *page;
+};
+
+struct kbdus_cache_shard_
+{
+    // protects the fields below and the entries in the shard
+    spinlock_t lock;
+
+    // entries holding pages, most recently used first
+    struct list_head lru;
+
+    // entries not holding pages
+    struct list_head free;
+
+    struct hlist_head *buckets;
+
+    atomic64_t hits;
+    atomic64_t misses;
+    atomic64_t insertions;
+    atomic64_t evictions;
+    atomic64_t invalidations;
+} ____cacheline_aligned_in_smp;
+
+struct kbdus_cache
+{
+    struct kbdus_cache_shard_ shards[KBDUS_CACHE_MAX_SHARDS_];
+    u32 num_shards;
+
+    // the generation of each group of pages, incremented whenever a page in a
+    // group using it is invalidated, *before* the page is removed from its
+    // shard
+    atomic64_t gens[KBDUS_CACHE_NUM_GENS_];
+
+    // the buckets of all shards, each having 2^hash_bits of them
+    struct hlist_head *buckets;
+    unsigned int hash_bits;
+
+    struct kbdus_cache_entry_ *entries;
+    u32 num_entries;
+};
+
+/* -------------------------------------------------------------------------- */
+
+static struct kbdus_cache_shard_ *
+    kbdus_cache_shard_(struct kbdus_cache *cache, u64 index)
+{
+    u64 group;
+
+    group = index >> KBDUS_CACHE_GROUP_SHIFT_;
+
+    return &cache->shards[group & (u64)(cache->num_shards - 1)];
+}
+
+// Locks the shard of the page with the given index, unless it is `locked`,
+// which is otherwise unlocked if not NULL, and returns it.
+static struct kbdus_cache_shard_ *kbdus_cache_lock_shard_(
+    struct kbdus_cache *cache, struct kbdus_cache_shard_ *locked, u64 index,
+    unsigned long *flags)
+{
+    struct kbdus_cache_shard_ *shard;
+
+    shard = kbdus_cache_shard_(cache, index);
+
+    if (shard != locked)
+    {
+        if (locked)
+            spin_unlock_irqrestore(&locked->lock, *flags);
+
+        spin_lock_irqsave(&shard->lock, *flags);
+    }
+
+    return shard;
+}
+
+// Must be called with the lock of the shard of the page with the given index
+// held.
+static struct kbdus_cache_entry_ *kbdus_cache_lookup_(
+    struct kbdus_cache *cache, struct kbdus_cache_shard_ *shard, u64 index)
+{
+    struct kbdus_cache_entry_ *entry;
+
+    hlist_for_each_entry(
+        entry, &shard->buckets[hash_64(index, cache->hash_bits)], hash_node)
+    {
+        if (entry->index == index)
+            return entry;
+    }
+
+    return NULL;
+}
+
+// Returns the sum of the generations of the groups of the pages with indices
+// `first` to `last`, which changes whenever any of those pages, or any page
+// whose group shares a generation with theirs, is invalidated.
+static u64 kbdus_cache_sum_gens_(struct kbdus_cache *cache, u64 first, u64 last)
+{
+    u64 group;
+    u64 sum;
+    u32 i;
+
+    first >>= KBDUS_CACHE_GROUP_SHIFT_;
+    last >>= KBDUS_CACHE_GROUP_SHIFT_;
+
+    sum = 0;
+
+    if (last - first < (u64)KBDUS_CACHE_NUM_GENS_)
+    {
+        for (group = first; group <= last; ++group)
+        {
+            sum += (u64)atomic64_read(
+                &cache->gens[group % KBDUS_CACHE_NUM_GENS_]);
+        }
+    }
+    else
+    {
+        for (i = 0; i < KBDUS_CACHE_NUM_GENS_; ++i)
+            sum += (u64)atomic64_read(&cache->gens[i]);
+    }
+
+    return sum;
+}
+
+// Increments the generations of the groups of the pages with indices `first`
+// to `last`.
+static void
+    kbdus_cache_increment_gens_(struct kbdus_cache *cache, u64 first, u64 last)
+{
+    u64 group;
+    u32 i;
+
+    first >>= KBDUS_CACHE_GROUP_SHIFT_;
+    last >>= KBDUS_CACHE_GROUP_SHIFT_;
+
+    if (last - first < (u64)KBDUS_CACHE_NUM_GENS_)
+    {
+        for (group = first; group <= last; ++group)
+            atomic64_inc(&cache->gens[group % KBDUS_CACHE_NUM_GENS_]);
+    }
+    else
+    {
+        for (i = 0; i < KBDUS_CACHE_NUM_GENS_; ++i)
+            atomic64_inc(&cache->gens[i]);
+    }
+}
+
+// Returns the indices of the first and last pages targeted by the given
+// request.
+static void kbdus_cache_req_pages_(struct request *req, u64 *first, u64 *last)
+{
+    *first = (512ull * (u64)blk_rq_pos(req)) >> PAGE_SHIFT;
+    *last  = (512ull * (u64)blk_rq_pos(req) + (u64)blk_rq_bytes(req) - 1)
+        >> PAGE_SHIFT;
+}
+
+// Must be called with the lock of the entry's shard held.
+static void kbdus_cache_remove_(
+    struct kbdus_cache_shard_ *shard, struct kbdus_cache_entry_ *entry)
+{
+    hlist_del(&entry->hash_node);
+    list_move(&entry->list, &shard->free);
+    atomic64_inc(&shard->invalidations);
+}
+
+// Takes a free or the least recently used entry of the given shard, evicting
+// its page in the latter case, and removes it from all lists. Returns NULL if
+// there is no such entry.
+//
+// Must be called with the shard's lock held.
+static struct kbdus_cache_entry_ *
+    kbdus_cache_take_entry_(struct kbdus_cache_shard_ *shard)
+{
+    struct kbdus_cache_entry_ *entry;
+
+    if (!list_empty(&shard->free))
+    {
+        entry = list_first_entry(&shard->free, struct kbdus_cache_entry_, list);
+    }
+    else if (!list_empty(&shard->lru))
+    {
+        entry = list_last_entry(&shard->lru, struct kbdus_cache_entry_, list);
+
+        hlist_del(&entry->hash_node);
+        atomic64_inc(&shard->evictions);
+    }
+    else
+    {
+        // all entries are having pages inserted into them
+        return NULL;
+    }
+
+    list_del(&entry->list);
+
+    return entry;
+}
+
+// Copies data between the given request and the given pages, the i-th of
+// which holds the data of the device page with index `first + i`, where `first`
+// is the index of the first page targeted by the request. Pages that are NULL
+// are skipped.
+//
+// If `to_req` is true, data is copied from the pages to the request.
+// Otherwise, it is copied from the request to the pages, and pages that the
+// request does not target in their entirety must be NULL.
+static void
+    kbdus_cache_copy_(struct request *req, struct page **pages, bool to_req)
+{
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    struct page *page;
+    u64 first;
+    u64 pos;
+    u32 done;
+    u32 page_offset;
+    u32 len;
+    char *bvec_mapped_page;
+    char *cache_data;
+
+    pos   = 512ull * (u64)blk_rq_pos(req);
+    first = pos >> PAGE_SHIFT;
+
+    rq_for_each_segment(bvec, req, req_iter)
+    {
+        for (done = 0; done < bvec.bv_len; done += len, pos += len)
+        {
+            page        = pages[(pos >> PAGE_SHIFT) - first];
+            page_offset = (u32)(pos & ~PAGE_MASK);
+            len = min_t(u32, bvec.bv_len - done, (u32)PAGE_SIZE - page_offset);
+
+            if (!page)
+                continue;
+
+            bvec_mapped_page = kmap_atomic(bvec.bv_page);
+            cache_data       = page_address(page);
+
+            if (to_req)
+            {
+                memcpy(
+                    bvec_mapped_page + bvec.bv_offset + done,
+                    cache_data + page_offset, len);
+            }
+            else
+            {
+                memcpy(
+                    cache_data + page_offset,
+                    bvec_mapped_page + bvec.bv_offset + done, len);
+            }
+
+            kunmap_atomic(bvec_mapped_page);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct kbdus_cache *kbdus_cache_create(u32 num_pages)
+{
+    struct kbdus_cache *cache;
+    struct kbdus_cache_shard_ *shard;
+    u32 i;
+
+    cache = vzalloc(sizeof(*cache));
+
+    if (!cache)
+        goto error;
+
+    // use as many shards as possible while giving each at least one entry
+
+    cache->num_shards = min_t(
+        u32, (u32)rounddown_pow_of_two(num_pages), KBDUS_CACHE_MAX_SHARDS_);
+
+    // allocate hash tables with about one bucket per entry
+
+    cache->hash_bits = max(
+        ilog2(roundup_pow_of_two(
+            DIV_ROUND_UP(num_pages, cache->num_shards))),
+        1);
+
+    cache->buckets = vzalloc(
+        sizeof(*cache->buckets)
+        * ((size_t)cache->num_shards << cache->hash_bits));
+
+    if (!cache->buckets)
+        goto error_free_cache;
+
+    for (i = 0; i < cache->num_shards; ++i)
+    {
+        shard = &cache->shards[i];
+
+        spin_lock_init(&shard->lock);
+
+        INIT_LIST_HEAD(&shard->lru);
+        INIT_LIST_HEAD(&shard->free);
+
+        shard->buckets = cache->buckets + ((size_t)i << cache->hash_bits);
+    }
+
+    // allocate entries and their pages, spreading them evenly among shards
+
+    cache->entries = vzalloc(sizeof(*cache->entries) * (size_t)num_pages);
+
+    if (!cache->entries)
+        goto error_free_buckets;
+
+    for (i = 0; i < num_pages; ++i)
+    {
+        cache->entries[i].page = alloc_page(GFP_KERNEL);
+
+        if (!cache->entries[i].page)
+            goto error_free_entries;
+
+        list_add_tail(
+            &cache->entries[i].list,
+            &cache->shards[i % cache->num_shards].free);
+
+        cache->num_entries = i + 1;
+    }
+
+    return cache;
+
+error_free_entries:
+    for (i = 0; i < cache->num_entries; ++i)
+        __free_page(cache->entries[i].page);
+    vfree(cache->entries);
+error_free_buckets:
+    vfree(cache->buckets);
+error_free_cache:
+    vfree(cache);
+error:
+    return ERR_PTR(-ENOMEM);
+}
+
+void kbdus_cache_destroy(struct kbdus_cache *cache)
+{
+    u32 i;
+
+    for (i = 0; i < cache->num_entries; ++i)
+        __free_page(cache->entries[i].page);
+
+    vfree(cache->entries);
+    vfree(cache->buckets);
+    vfree(cache);
+}
+
+u64 kbdus_cache_get_gen(struct kbdus_cache *cache, struct request *req)
+{
+    u64 first;
+    u64 last;
+
+    kbdus_cache_req_pages_(req, &first, &last);
+
+    return kbdus_cache_sum_gens_(cache, first, last);
+}
+
+bool kbdus_cache_serve_read(struct kbdus_cache *cache, struct request *req)
+{
+    struct page *pages[KBDUS_CACHE_MAX_REQ_PAGES_];
+    struct kbdus_cache_shard_ *shard;
+    struct kbdus_cache_entry_ *entry;
+    unsigned long flags;
+    u64 first;
+    u64 last;
+    u64 index;
+    u64 gen;
+    u32 num_pages;
+    u32 i;
+    bool hit;
+
+    kbdus_cache_req_pages_(req, &first, &last);
+
+    if (last - first >= (u64)KBDUS_CACHE_MAX_REQ_PAGES_)
+    {
+        atomic64_inc(&kbdus_cache_shard_(cache, first)->misses);
+        return false;
+    }
+
+    gen = kbdus_cache_sum_gens_(cache, first, last);
+
+    // get a reference to the page of every entry, marking entries as most
+    // recently used
+
+    shard     = NULL;
+    num_pages = 0;
+
+    for (index = first; index <= last; ++index)
+    {
+        shard = kbdus_cache_lock_shard_(cache, shard, index, &flags);
+        entry = kbdus_cache_lookup_(cache, shard, index);
+
+        if (!entry)
+            break;
+
+        get_page(entry->page);
+        pages[num_pages++] = entry->page;
+
+        list_move(&entry->list, &shard->lru);
+    }
+
+    spin_unlock_irqrestore(&shard->lock, flags);
+
+    hit = index > last;
+
+    // copy data into request, but treat the request as a miss if pages it
+    // targets were invalidated in the meantime, as the invalidating request's
+    // data may have been written by the driver before the copy was done
+
+    if (hit)
+    {
+        kbdus_cache_copy_(req, pages, true);
+
+        smp_rmb();
+
+        hit = kbdus_cache_sum_gens_(cache, first, last) == gen;
+    }
+
+    for (i = 0; i < num_pages; ++i)
+        put_page(pages[i]);
+
+    shard = kbdus_cache_shard_(cache, first);
+    atomic64_inc(hit ? &shard->hits : &shard->misses);
+
+    return hit;
+}
+
+void kbdus_cache_insert_read(
+    struct kbdus_cache *cache, struct request *req, u64 gen)
+{
+    struct kbdus_cache_entry_ *entries[KBDUS_CACHE_MAX_REQ_PAGES_];
+    struct page *pages[KBDUS_CACHE_MAX_REQ_PAGES_];
+    struct kbdus_cache_shard_ *shard;
+    struct kbdus_cache_entry_ *entry;
+    unsigned long flags;
+    u64 start;
+    u64 end;
+    u64 first;
+    u64 last;
+    u64 index;
+    u32 i;
+    bool covered;
+    bool any;
+
+    kbdus_cache_req_pages_(req, &first, &last);
+
+    // the data may be stale if the request raced with some invalidation of the
+    // pages it targets
+
+    if (last - first >= (u64)KBDUS_CACHE_MAX_REQ_PAGES_
+        || kbdus_cache_sum_gens_(cache, first, last) != gen)
+    {
+        return;
+    }
+
+    start = 512ull * (u64)blk_rq_pos(req);
+    end   = start + (u64)blk_rq_bytes(req);
+
+    // take an entry for every page that the request targets in its entirety
+    // and that is not cached, removing it from all lists so that its page can
+    // be filled in without holding any lock
+
+    shard = NULL;
+    any   = false;
+
+    for (index = first, i = 0; index <= last; ++index, ++i)
+    {
+        entries[i] = NULL;
+        pages[i]   = NULL;
+
+        covered = (index << PAGE_SHIFT) >= start
+            && ((index + 1) << PAGE_SHIFT) <= end;
+
+        if (!covered)
+            continue;
+
+        shard = kbdus_cache_lock_shard_(cache, shard, index, &flags);
+        entry = kbdus_cache_lookup_(cache, shard, index);
+
+        if (entry)
+        {
+            // already cached, and necessarily with the same data
+            list_move(&entry->list, &shard->lru);
+            continue;
+        }
+
+        entry = kbdus_cache_take_entry_(shard);
+
+        if (!entry)
+            continue;
+
+        entry->index = index;
+        entries[i]   = entry;
+
+        // skip the page if it is still being copied to some *read* request,
+        // as its data can't be modified yet (no more references to it can be
+        // taken, since the entry is no longer in the hash table)
+
+        if (page_ref_count(entry->page) == 1)
+        {
+            pages[i] = entry->page;
+            any      = true;
+        }
+    }
+
+    if (shard)
+        spin_unlock_irqrestore(&shard->lock, flags);
+
+    // copy data from request
+
+    if (any)
+        kbdus_cache_copy_(req, pages, false);
+
+    // make pages available, unless they were invalidated in the meantime or
+    // were concurrently inserted by another request, in which case their
+    // entries are freed
+
+    shard = NULL;
+
+    for (index = first, i = 0; index <= last; ++index, ++i)
+    {
+        entry = entries[i];
+
+        if (!entry)
+            continue;
+
+        shard = kbdus_cache_lock_shard_(cache, shard, index, &flags);
+
+        if (pages[i] && kbdus_cache_sum_gens_(cache, first, last) == gen
+            && !kbdus_cache_lookup_(cache, shard, index))
+        {
+            hlist_add_head(
+                &entry->hash_node,
+                &shard->buckets[hash_64(index, cache->hash_bits)]);
+
+            list_add(&entry->list, &shard->lru);
+            atomic64_inc(&shard->insertions);
+        }
+        else
+        {
+            list_add(&entry->list, &shard->free);
+        }
+    }
+
+    if (shard)
+        spin_unlock_irqrestore(&shard->lock, flags);
+}
+
+void kbdus_cache_invalidate(struct kbdus_cache *cache, u64 offset, u64 size)
+{
+    struct kbdus_cache_shard_ *shard;
+    struct kbdus_cache_entry_ *entry;
+    struct kbdus_cache_entry_ *next;
+    unsigned long flags;
+    u64 first;
+    u64 last;
+    u64 index;
+    u32 i;
+
+    if (size == 0)
+        return;
+
+    first = offset >> PAGE_SHIFT;
+    last  = (offset + size - 1) >> PAGE_SHIFT;
+
+    // Increment the generations before removing pages, so that requests
+    // inserting pages into a shard either see the new generation while holding
+    // the shard's lock or do so before the pages are removed.
+
+    kbdus_cache_increment_gens_(cache, first, last);
+
+    if (last - first < (u64)cache->num_entries)
+    {
+        // look up every page in the region
+
+        shard = NULL;
+
+        for (index = first; index <= last; ++index)
+        {
+            shard = kbdus_cache_lock_shard_(cache, shard, index, &flags);
+            entry = kbdus_cache_lookup_(cache, shard, index);
+
+            if (entry)
+                kbdus_cache_remove_(shard, entry);
+        }
+
+        spin_unlock_irqrestore(&shard->lock, flags);
+    }
+    else
+    {
+        // the region has more pages than the cache, so go through the cache
+
+        for (i = 0; i < cache->num_shards; ++i)
+        {
+            shard = &cache->shards[i];
+
+            spin_lock_irqsave(&shard->lock, flags);
+
+            list_for_each_entry_safe(entry, next, &shard->lru, list)
+            {
+                if (entry->index >= first && entry->index <= last)
+                    kbdus_cache_remove_(shard, entry);
+            }
+
+            spin_unlock_irqrestore(&shard->lock, flags);
+        }
+    }
+}
+
+void kbdus_cache_show_stats(struct kbdus_cache *cache, struct seq_file *s)
+{
+    struct kbdus_cache_shard_ *shard;
+    u64 hits;
+    u64 misses;
+    u64 insertions;
+    u64 evictions;
+    u64 invalidations;
+    u32 i;
+
+    hits          = 0;
+    misses        = 0;
+    insertions    = 0;
+    evictions     = 0;
+    invalidations = 0;
+
+    for (i = 0; i < cache->num_shards; ++i)
+    {
+        shard = &cache->shards[i];
+
+        hits += (u64)atomic64_read(&shard->hits);
+        misses += (u64)atomic64_read(&shard->misses);
+        insertions += (u64)atomic64_read(&shard->insertions);
+        evictions += (u64)atomic64_read(&shard->evictions);
+        invalidations += (u64)atomic64_read(&shard->invalidations);
+    }
+
+    seq_printf(s, "read_cache hits %llu\n", (unsigned long long)hits);
+    seq_printf(s, "read_cache misses %llu\n", (unsigned long long)misses);
+
+    seq_printf(
+        s, "read_cache insertions %llu\n", (unsigned long long)insertions);
+
+    seq_printf(s, "read_cache evictions %llu\n", (unsigned long long)evictions);
+
+    seq_printf(
+        s, "read_cache invalidations %llu\n",
+        (unsigned long long)invalidations);
+}
+
+/* -------------------------------------------------------------------------- */
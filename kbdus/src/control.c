@@ -27,6 +27,7 @@
 #include <linux/mutex.h>
 #include <linux/namei.h>
 #include <linux/path.h>
+#include <linux/poll.h>
 #include <linux/printk.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -97,6 +98,10 @@ enum
     // Whether the fd was "marked as successful" using
     // KBDUS_IOCTL_MARK_AS_SUCCESSFUL ioctl.
     KBDUS_CONTROL_FD_FLAG_SUCCESSFUL_,
+
+    // Whether the fd suspended its device using KBDUS_IOCTL_SUSPEND ioctl and
+    // did not yet resume it.
+    KBDUS_CONTROL_FD_FLAG_SUSPENDED_,
 };
 
 /* -------------------------------------------------------------------------- */
@@ -120,6 +125,10 @@ struct kbdus_control_fd_
 
     struct kbdus_control_device_wrapper_ *device_wrapper;
     struct kbdus_transceiver *transceiver;
+
+    // the mappings of this fd's payload windows, which are kept apart from
+    // those of other fds so that unmapping a window doesn't affect them
+    struct address_space mapping;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -285,10 +294,26 @@ static int kbdus_control_open_(struct inode *inode, struct file *filp)
 
     clear_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags);
     clear_bit(KBDUS_CONTROL_FD_FLAG_SUCCESSFUL_, &fd->flags);
+    clear_bit(KBDUS_CONTROL_FD_FLAG_SUSPENDED_, &fd->flags);
+
+    address_space_init_once(&fd->mapping);
+
+    fd->mapping.host  = inode;
+    fd->mapping.a_ops = inode->i_mapping->a_ops;
 
-    // store fd in filp's private data
+    // store fd in filp's private data, and make mappings of this fd use its
+    // own address space
 
     filp->private_data = fd;
+    filp->f_mapping    = &fd->mapping;
+
+    // let reads and writes be submitted with IOCB_NOWAIT, so that io_uring
+    // attempts them inline instead of always handing them off to its worker
+    // threads (newer kernels use FOP_NOWAIT instead)
+
+#ifdef FMODE_NOWAIT
+    filp->f_mode |= FMODE_NOWAIT;
+#endif
 
     // success
 
@@ -469,8 +494,7 @@ static int __kbdus_control_ioctl_create_device_(
 
     // create transceiver
 
-    transceiver = kbdus_transceiver_create(
-        config, kbdus_device_get_inverter(device_wrapper->device));
+    transceiver = kbdus_transceiver_create(config, device_wrapper->device);
 
     if (IS_ERR(transceiver))
     {
@@ -582,11 +606,12 @@ static int __kbdus_control_ioctl_attach_to_device_(
 
     if (device_wrapper->fd)
     {
-        // deactivate device (unless already terminated, in which case we use
-        // the completion simply to wait until the device is destroyed)
+        // deactivate device (unless already deactivated by the attached fd
+        // terminating or suspending it, or already terminated, in which case
+        // we use the completion simply to wait until the device is destroyed)
 
         if (kbdus_device_get_state(device_wrapper->device)
-            != KBDUS_DEVICE_STATE_TERMINATED)
+            == KBDUS_DEVICE_STATE_ACTIVE)
         {
             kbdus_device_deactivate(device_wrapper->device, true);
         }
@@ -636,8 +661,7 @@ static int __kbdus_control_ioctl_attach_to_device_(
 
     // create transceiver
 
-    transceiver = kbdus_transceiver_create(
-        config, kbdus_device_get_inverter(device_wrapper->device));
+    transceiver = kbdus_transceiver_create(config, device_wrapper->device);
 
     if (IS_ERR(transceiver))
     {
@@ -749,6 +773,8 @@ static int kbdus_control_ioctl_terminate_(struct kbdus_control_fd_ *fd)
 
     device = fd->device_wrapper->device;
 
+    clear_bit(KBDUS_CONTROL_FD_FLAG_SUSPENDED_, &fd->flags);
+
     switch (kbdus_device_get_state(device))
     {
     case KBDUS_DEVICE_STATE_UNAVAILABLE:
@@ -787,6 +813,94 @@ static int kbdus_control_ioctl_mark_as_successful_(struct kbdus_control_fd_ *fd)
     return 0;
 }
 
+static int kbdus_control_ioctl_suspend_(struct kbdus_control_fd_ *fd)
+{
+    struct kbdus_device *device;
+    int ret;
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&kbdus_control_mutex_) != 0)
+        return -ERESTARTSYS;
+
+    device = fd->device_wrapper->device;
+
+    if (fd->device_wrapper->on_detach)
+    {
+        ret = -EINPROGRESS;
+        goto out_unlock;
+    }
+
+    switch (kbdus_device_get_state(device))
+    {
+    case KBDUS_DEVICE_STATE_UNAVAILABLE:
+        ret = -EBUSY;
+        break;
+
+    case KBDUS_DEVICE_STATE_ACTIVE:
+        kbdus_device_deactivate(device, false);
+        set_bit(KBDUS_CONTROL_FD_FLAG_SUSPENDED_, &fd->flags);
+        ret = 0;
+        break;
+
+    case KBDUS_DEVICE_STATE_INACTIVE:
+        ret = -EINVAL;
+        break;
+
+    case KBDUS_DEVICE_STATE_TERMINATED:
+        ret = -ENODEV;
+        break;
+
+    default:
+        WARN_ON(true);
+        ret = -EINVAL;
+        break;
+    }
+
+out_unlock:
+    mutex_unlock(&kbdus_control_mutex_);
+    return ret;
+}
+
+static int kbdus_control_ioctl_resume_(struct kbdus_control_fd_ *fd)
+{
+    struct kbdus_device *device;
+    int ret;
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&kbdus_control_mutex_) != 0)
+        return -ERESTARTSYS;
+
+    device = fd->device_wrapper->device;
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_SUSPENDED_, &fd->flags))
+    {
+        ret = -EINVAL;
+    }
+    else if (fd->device_wrapper->on_detach)
+    {
+        ret = -EINPROGRESS;
+    }
+    else if (kbdus_device_get_state(device) == KBDUS_DEVICE_STATE_TERMINATED)
+    {
+        ret = -ENODEV;
+    }
+    else
+    {
+        WARN_ON(kbdus_device_get_state(device) != KBDUS_DEVICE_STATE_INACTIVE);
+
+        clear_bit(KBDUS_CONTROL_FD_FLAG_SUSPENDED_, &fd->flags);
+        kbdus_device_activate(device);
+        ret = 0;
+    }
+
+    mutex_unlock(&kbdus_control_mutex_);
+    return ret;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
 
 static int kbdus_control_stat_impl_(
@@ -1044,6 +1158,143 @@ out:
     return ret;
 }
 
+static int kbdus_control_ioctl_set_zero_range_(
+    struct kbdus_control_fd_ *fd,
+    const struct kbdus_zero_range __user *zero_range_usrptr)
+{
+    struct kbdus_zero_range zero_range;
+
+    // ensure that fd is attached to a device (which then can't be destroyed
+    // while fd is in use)
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return -EINVAL;
+
+    // copy region from user space
+
+    if (copy_from_user(&zero_range, zero_range_usrptr, sizeof(zero_range))
+        != 0)
+    {
+        return -EFAULT;
+    }
+
+    // ensure that reserved space is zeroed out
+
+    if (!kbdus_array_is_zero_filled(zero_range.reserved_))
+        return -EINVAL;
+
+    // update device's zero map
+
+    return kbdus_device_set_zero_range(
+        fd->device_wrapper->device, zero_range.offset, zero_range.size,
+        zero_range.zero != 0);
+}
+
+static int kbdus_control_ioctl_invalidate_read_cache_(
+    struct kbdus_control_fd_ *fd,
+    const struct kbdus_cache_range __user *cache_range_usrptr)
+{
+    struct kbdus_cache_range cache_range;
+
+    // ensure that fd is attached to a device (which then can't be destroyed
+    // while fd is in use)
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return -EINVAL;
+
+    // copy region from user space
+
+    if (copy_from_user(&cache_range, cache_range_usrptr, sizeof(cache_range))
+        != 0)
+    {
+        return -EFAULT;
+    }
+
+    // ensure that reserved space is zeroed out
+
+    if (!kbdus_array_is_zero_filled(cache_range.reserved_))
+        return -EINVAL;
+
+    // invalidate device's read cache
+
+    return kbdus_device_invalidate_read_cache(
+        fd->device_wrapper->device, cache_range.offset, cache_range.size);
+}
+
+static int kbdus_control_ioctl_get_device_stats_(
+    struct kbdus_device_stats __user *stats_usrptr)
+{
+    struct kbdus_device_stats *stats;
+    struct kbdus_control_device_wrapper_ *device_wrapper;
+    int ret;
+
+    // check capabilities
+
+    if (!capable(CAP_SYS_ADMIN))
+        return -EPERM;
+
+    // allocate statistics (too large for the stack)
+
+    stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+
+    if (!stats)
+        return -ENOMEM;
+
+    // copy device id and reserved space from user space
+
+    if (get_user(stats->id, &stats_usrptr->id) != 0
+        || copy_from_user(
+               stats->reserved_, stats_usrptr->reserved_,
+               sizeof(stats->reserved_))
+            != 0)
+    {
+        ret = -EFAULT;
+        goto out_free;
+    }
+
+    // ensure that reserved space is zeroed out
+
+    if (!kbdus_array_is_zero_filled(stats->reserved_))
+    {
+        ret = -EINVAL;
+        goto out_free;
+    }
+
+    // lock global mutex (so that device isn't destroyed while we are reading
+    // its statistics)
+
+    if (mutex_lock_interruptible(&kbdus_control_mutex_) != 0)
+    {
+        ret = -ERESTARTSYS;
+        goto out_free;
+    }
+
+    // get device wrapper
+
+    device_wrapper = kbdus_control_get_device_wrapper_by_id_(stats->id);
+
+    if (IS_ERR(device_wrapper))
+    {
+        mutex_unlock(&kbdus_control_mutex_);
+        ret = PTR_ERR(device_wrapper);
+        goto out_free;
+    }
+
+    // get device statistics
+
+    kbdus_device_get_stats(device_wrapper->device, stats);
+
+    mutex_unlock(&kbdus_control_mutex_);
+
+    // copy statistics to user space
+
+    ret = copy_to_user(stats_usrptr, stats, sizeof(*stats)) != 0 ? -EFAULT : 0;
+
+out_free:
+    kfree(stats);
+    return ret;
+}
+
 static int
     kbdus_control_ioctl_trigger_device_destruction_(const u64 __user *id_usrptr)
 {
@@ -1181,6 +1432,12 @@ static long kbdus_control_ioctl_(
     case KBDUS_IOCTL_MARK_AS_SUCCESSFUL:
         return kbdus_control_ioctl_mark_as_successful_(fd);
 
+    case KBDUS_IOCTL_SUSPEND:
+        return kbdus_control_ioctl_suspend_(fd);
+
+    case KBDUS_IOCTL_RESUME:
+        return kbdus_control_ioctl_resume_(fd);
+
     case KBDUS_IOCTL_DEVICE_PATH_TO_ID:
         return kbdus_control_ioctl_device_path_to_id_(fd, arg_usrptr);
 
@@ -1190,6 +1447,15 @@ static long kbdus_control_ioctl_(
     case KBDUS_IOCTL_FLUSH_DEVICE:
         return kbdus_control_ioctl_flush_device_(arg_usrptr);
 
+    case KBDUS_IOCTL_SET_ZERO_RANGE:
+        return kbdus_control_ioctl_set_zero_range_(fd, arg_usrptr);
+
+    case KBDUS_IOCTL_INVALIDATE_READ_CACHE:
+        return kbdus_control_ioctl_invalidate_read_cache_(fd, arg_usrptr);
+
+    case KBDUS_IOCTL_GET_DEVICE_STATS:
+        return kbdus_control_ioctl_get_device_stats_(arg_usrptr);
+
     case KBDUS_IOCTL_TRIGGER_DEVICE_DESTRUCTION:
         return kbdus_control_ioctl_trigger_device_destruction_(arg_usrptr);
 
@@ -1201,6 +1467,127 @@ static long kbdus_control_ioctl_(
     }
 }
 
+// Returns the user-space address at which the data of the given iterator
+// starts, or NULL if it does not consist of a single user-space segment, as is
+// the case for read(), write(), and io_uring's non-vectored operations.
+static void __user *kbdus_control_iter_usrptr_(const struct iov_iter *iter)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 0, 0)
+    if (iter_is_ubuf(iter))
+        return iter->ubuf + iter->iov_offset;
+#endif
+
+    if (!iter_is_iovec(iter) || iter->nr_segs != 1)
+        return NULL;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+    return iter_iov(iter)->iov_base + iter->iov_offset;
+#else
+    return iter->iov->iov_base + iter->iov_offset;
+#endif
+}
+
+// Reads are non-blocking if the file description has O_NONBLOCK set or the
+// read was submitted with IOCB_NOWAIT (e.g., by io_uring, which only hands the
+// read off to one of its worker threads if this fails with -EAGAIN and the
+// read was not itself submitted with RWF_NOWAIT).
+static ssize_t kbdus_control_read_iter_(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct kbdus_control_fd_ *fd;
+    char __user *buffer;
+    bool nonblock;
+    ssize_t ret;
+
+    fd = iocb->ki_filp->private_data;
+
+    // ensure that fd is attached to a device
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return -EINVAL;
+
+    // get user-space buffer
+
+    buffer = kbdus_control_iter_usrptr_(to);
+
+    if (!buffer)
+        return -EINVAL;
+
+    // delegate read to transceiver (the offset is not advanced)
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+    nonblock = (iocb->ki_flags & IOCB_NOWAIT) != 0;
+#else
+    nonblock = false;
+#endif
+
+    nonblock = nonblock || (iocb->ki_filp->f_flags & O_NONBLOCK) != 0;
+
+    ret = kbdus_transceiver_handle_control_read(
+        fd->transceiver, buffer, iov_iter_count(to), iocb->ki_pos, nonblock);
+
+    if (ret > 0)
+        iov_iter_advance(to, (size_t)ret);
+
+    return ret;
+}
+
+// Writes never wait for requests or for the driver, so IOCB_NOWAIT needs no
+// special handling.
+static ssize_t
+    kbdus_control_write_iter_(struct kiocb *iocb, struct iov_iter *from)
+{
+    struct kbdus_control_fd_ *fd;
+    const char __user *buffer;
+    ssize_t ret;
+
+    fd = iocb->ki_filp->private_data;
+
+    // ensure that fd is attached to a device
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return -EINVAL;
+
+    // get user-space buffer
+
+    buffer = kbdus_control_iter_usrptr_(from);
+
+    if (!buffer)
+        return -EINVAL;
+
+    // delegate write to transceiver
+
+    ret = kbdus_transceiver_handle_control_write(
+        fd->transceiver, buffer, iov_iter_count(from));
+
+    if (ret > 0)
+        iov_iter_advance(from, (size_t)ret);
+
+    return ret;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 16, 0)
+static __poll_t kbdus_control_poll_(struct file *filp, poll_table *wait)
+#else
+static unsigned int kbdus_control_poll_(struct file *filp, poll_table *wait)
+#endif
+{
+    struct kbdus_control_fd_ *fd;
+
+    fd = filp->private_data;
+
+    // ensure that fd is attached to a device
+
+    if (!test_bit(KBDUS_CONTROL_FD_FLAG_ATTACHED_, &fd->flags))
+        return POLLERR;
+
+    // delegate poll to transceiver
+
+    if (!kbdus_transceiver_handle_control_poll(fd->transceiver, filp, wait))
+        return 0;
+
+    return POLLIN | POLLRDNORM;
+}
+
 static int kbdus_control_mmap_(struct file *filp, struct vm_area_struct *vma)
 {
     struct kbdus_control_fd_ *fd;
@@ -1221,9 +1608,15 @@ static const struct file_operations kbdus_control_ops_ = {
     .owner          = THIS_MODULE,
     .open           = kbdus_control_open_,
     .release        = kbdus_control_release_,
+    .read_iter      = kbdus_control_read_iter_,
+    .write_iter     = kbdus_control_write_iter_,
+    .poll           = kbdus_control_poll_,
     .unlocked_ioctl = kbdus_control_ioctl_,
     .compat_ioctl   = kbdus_control_ioctl_,
     .mmap           = kbdus_control_mmap_,
+#ifdef FOP_NOWAIT
+    .fop_flags      = FOP_NOWAIT,
+#endif
 };
 
 /* -------------------------------------------------------------------------- */
@@ -1236,6 +1629,9 @@ int __init kbdus_control_init(void)
     BUILD_BUG_ON(sizeof(struct kbdus_device_config) != 128);
     BUILD_BUG_ON(sizeof(struct kbdus_fd_config) != 128);
     BUILD_BUG_ON(sizeof(struct kbdus_device_and_fd_config) != 256);
+    BUILD_BUG_ON(sizeof(struct kbdus_request_stats) != 624);
+    BUILD_BUG_ON(sizeof(struct kbdus_device_stats) != 6304);
+    BUILD_BUG_ON(sizeof(struct kbdus_zone) != 40);
 
     // ensure that there are enough minor numbers for all devices
 
@@ -2,30 +2,41 @@
 /* -------------------------------------------------------------------------- */
 
 #include <kbdus.h>
+#include <kbdus/cache.h>
 #include <kbdus/config.h>
 #include <kbdus/device.h>
 #include <kbdus/inverter.h>
 #include <kbdus/utilities.h>
 
 #include <linux/atomic.h>
+#include <linux/bitmap.h>
 #include <linux/blk-mq.h>
 #include <linux/blkdev.h>
 #include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/crash_dump.h>
+#include <linux/debugfs.h>
 #include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/export.h>
 #include <linux/genhd.h>
+#include <linux/highmem.h>
 #include <linux/init.h>
 #include <linux/ioctl.h>
 #include <linux/kernel.h>
 #include <linux/kernfs.h>
 #include <linux/kthread.h>
+#include <linux/llist.h>
+#include <linux/log2.h>
+#include <linux/numa.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/sizes.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/types.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
 #include <linux/sched/task.h>
@@ -49,9 +60,32 @@ struct kbdus_device
 
     struct blk_mq_tag_set tag_set;
 
+    // completed requests of each hardware queue, if it is a poll queue
+    struct llist_head *polled_reqs;
+
+    // the number of requests ended by polling poll queues
+    atomic64_t num_polled_reqs;
+
     struct gendisk *disk;
     struct task_struct *add_disk_task;
     struct completion add_disk_task_started;
+
+    // the device's debugfs directory, or NULL or an error pointer if absent
+    struct dentry *debugfs_dir;
+
+    // bit `i` is set if the extent with index `i` is known to contain only
+    // zeros, or NULL if `config.zero_extent_size` is 0; bits are only set or
+    // cleared with `zero_map_lock` held, but may be tested without it
+    unsigned long *zero_map;
+    unsigned long num_zero_extents;
+    unsigned int zero_extent_shift;
+    spinlock_t zero_map_lock;
+
+    // the number of *read* requests served from the zero map
+    atomic64_t num_zero_map_hits;
+
+    // the device's read cache, or NULL if `config.read_cache_size` is 0
+    struct kbdus_cache *read_cache;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -59,6 +93,9 @@ struct kbdus_device
 // The major number for BDUS block devices.
 static int kbdus_device_major_;
 
+// The "kbdus" debugfs directory, or NULL or an error pointer if absent.
+static struct dentry *kbdus_device_debugfs_root_;
+
 /* -------------------------------------------------------------------------- */
 
 static bool kbdus_device_is_read_only_(const struct kbdus_device_config *config)
@@ -99,7 +136,9 @@ static bool
     // ensure that reserved space is zeroed out
 
     valid = kbdus_array_is_zero_filled(config->reserved_1_)
-        && kbdus_array_is_zero_filled(config->reserved_2_);
+        && kbdus_array_is_zero_filled(config->reserved_2_)
+        && kbdus_array_is_zero_filled(config->reserved_3_)
+        && kbdus_array_is_zero_filled(config->reserved_4_);
 
     // operations -- supports_fua_write implies supports_flush
 
@@ -155,6 +194,40 @@ static bool
 
     valid = valid && (config->max_outstanding_reqs > 0);
 
+    // attributes -- zero_extent_size (extents can't grow past 2^31 bytes, so
+    // larger devices would need more than KBDUS_HARD_MAX_ZERO_EXTENTS of them)
+
+    valid = valid
+        && (config->zero_extent_size == 0
+            || (kbdus_is_power_of_two(config->zero_extent_size)
+                && config->zero_extent_size >= config->logical_block_size
+                && DIV_ROUND_UP_ULL(config->size, 1ull << 31)
+                    <= (u64)KBDUS_HARD_MAX_ZERO_EXTENTS));
+
+    // attributes -- zoned, zone_size (the zone size in sectors must fit in an
+    // unsigned int)
+
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    valid = valid
+        && (!config->zoned
+            || (config->supports_read && config->supports_write
+                && kbdus_is_power_of_two(config->zone_size)
+                && config->zone_size
+                    >= (u64)max(
+                        config->physical_block_size,
+                        config->logical_block_size)
+                && config->zone_size <= (1ull << 40)));
+#else
+    valid = valid && !config->zoned;
+#endif
+
+    // attributes -- dispatch_policy
+
+    valid = valid
+        && (config->dispatch_policy == KBDUS_DISPATCH_POLICY_FIFO
+            || config->dispatch_policy == KBDUS_DISPATCH_POLICY_READS_FIRST
+            || config->dispatch_policy == KBDUS_DISPATCH_POLICY_PRIORITY);
+
     // return result
 
     return valid;
@@ -233,6 +306,42 @@ static void kbdus_device_adjust_config_(struct kbdus_device_config *config)
             config->logical_block_size);
     }
 
+    // max_discard_ranges (requests with several discard ranges were introduced
+    // in Linux 4.11)
+
+    if (!config->supports_discard)
+    {
+        config->max_discard_ranges = 0;
+    }
+    else
+    {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+        config->max_discard_ranges = clamp(
+            config->max_discard_ranges, (u16)1, KBDUS_HARD_MAX_DISCARD_RANGES);
+#else
+        config->max_discard_ranges = 1;
+#endif
+    }
+
+    // zone_size, max_open_zones, max_active_zones, max_zone_append_size
+
+    if (!config->zoned)
+    {
+        config->zone_size            = 0;
+        config->max_open_zones       = 0;
+        config->max_active_zones     = 0;
+        config->max_zone_append_size = 0;
+    }
+    else
+    {
+        config->max_zone_append_size = round_down(
+            (u32)min(
+                (u64)min_not_zero(
+                    config->max_zone_append_size, config->max_read_write_size),
+                config->zone_size),
+            config->logical_block_size);
+    }
+
     // max_outstanding_reqs
 
     if (!config->supports_read && !config->supports_write
@@ -248,6 +357,57 @@ static void kbdus_device_adjust_config_(struct kbdus_device_config *config)
         config->max_outstanding_reqs =
             min(config->max_outstanding_reqs, KBDUS_HARD_MAX_OUTSTANDING_REQS);
     }
+
+    // num_queues
+
+    config->num_queues = clamp(
+        config->num_queues, 1u,
+        min(config->max_outstanding_reqs, (u32)nr_cpu_ids));
+
+    config->max_outstanding_reqs =
+        rounddown(config->max_outstanding_reqs, config->num_queues);
+
+    // num_poll_queues (at least one hardware queue must serve non-polled
+    // requests, and poll queues can't be set up in kdump kernels, as custom
+    // queue mappings are then ignored)
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+    if (is_kdump_kernel())
+        config->num_poll_queues = 0;
+    else
+        config->num_poll_queues =
+            min(config->num_poll_queues, config->num_queues - 1);
+#else
+    config->num_poll_queues = 0;
+#endif
+
+    // zero_extent_size (zone append requests don't target the region they end
+    // up writing, so zoned devices can't keep track of zeros)
+
+    if (!config->supports_read || config->zoned)
+    {
+        config->zero_extent_size = 0;
+    }
+    else if (config->zero_extent_size != 0)
+    {
+        // validation ensures that this stops with at most
+        // KBDUS_HARD_MAX_ZERO_EXTENTS extents
+
+        while (config->zero_extent_size < (1u << 31)
+               && DIV_ROUND_UP_ULL(config->size, config->zero_extent_size)
+                   > (u64)KBDUS_HARD_MAX_ZERO_EXTENTS)
+        {
+            config->zero_extent_size <<= 1;
+        }
+    }
+
+    // read_cache_size (zoned devices can't invalidate data written by zone
+    // append requests either)
+
+    if (!config->supports_read || config->zoned)
+        config->read_cache_size = 0;
+    else
+        config->read_cache_size = rounddown(config->read_cache_size, PAGE_SIZE);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -330,6 +490,14 @@ static void kbdus_device_config_request_queue_limits_(
         queue,
         (unsigned int)(max(config->max_read_write_size, (u32)PAGE_SIZE) / 512u));
 
+    // let requests reach that size even if their pages are not contiguous
+
+    blk_queue_max_segments(
+        queue,
+        (unsigned short)clamp(
+            config->max_read_write_size >> PAGE_SHIFT, (u32)BLK_MAX_SEGMENTS,
+            (u32)USHRT_MAX));
+
     // write same requests
 
     if (config->supports_write_same)
@@ -358,8 +526,50 @@ static void kbdus_device_config_request_queue_limits_(
         queue->limits.discard_granularity =
             (unsigned int)config->logical_block_size;
     }
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+    if (config->supports_discard)
+    {
+        blk_queue_max_discard_segments(
+            queue, (unsigned short)config->max_discard_ranges);
+    }
+#endif
+}
+
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+
+// Makes the given disk a host-managed zoned block device. Its zones must still
+// be revalidated, which requires the driver to be serving requests.
+static void kbdus_device_config_zones_(
+    struct gendisk *disk, const struct kbdus_device_config *config)
+{
+    struct request_queue *queue;
+
+    queue = disk->queue;
+
+    blk_queue_chunk_sectors(queue, (unsigned int)(config->zone_size / 512u));
+
+    blk_queue_max_zone_append_sectors(
+        queue, (unsigned int)(config->max_zone_append_size / 512u));
+
+    // writes to sequential zones must be submitted in order, one at a time,
+    // which mq-deadline ensures
+
+    blk_queue_required_elevator_features(queue, ELEVATOR_F_ZBD_SEQ_WRITE);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 0, 0)
+    disk_set_zoned(disk, BLK_ZONED_HM);
+    disk_set_max_open_zones(disk, (unsigned int)config->max_open_zones);
+    disk_set_max_active_zones(disk, (unsigned int)config->max_active_zones);
+#else
+    blk_queue_set_zoned(disk, BLK_ZONED_HM);
+    blk_queue_max_open_zones(queue, (unsigned int)config->max_open_zones);
+    blk_queue_max_active_zones(queue, (unsigned int)config->max_active_zones);
+#endif
 }
 
+#endif
+
 static void kbdus_set_scheduler_none_(struct request_queue *q)
 {
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
@@ -393,6 +603,17 @@ static int kbdus_device_add_disk_(void *argument)
 
     complete(&device->add_disk_task_started);
 
+    // validate zones, which submits *zone report* requests
+
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    if (device->config.zoned
+        && blk_revalidate_disk_zones(device->disk, NULL) != 0)
+    {
+        kbdus_device_terminate(device);
+        return 0; // return value is ignored
+    }
+#endif
+
     // add disk
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
@@ -405,9 +626,10 @@ static int kbdus_device_add_disk_(void *argument)
     add_disk(device->disk);
 #endif
 
-    // switch scheduler to "none"
+    // switch scheduler to "none" (zoned devices must keep mq-deadline)
 
-    kbdus_set_scheduler_none_(device->disk->queue);
+    if (!device->config.zoned)
+        kbdus_set_scheduler_none_(device->disk->queue);
 
     // submit "device available" notification
 
@@ -424,6 +646,150 @@ static int kbdus_device_add_disk_(void *argument)
 
 /* -------------------------------------------------------------------------- */
 
+// Returns the index of the inverter queue to which requests submitted through
+// the given hardware queue should be submitted.
+static u32 kbdus_device_hctx_to_queue_index_(
+    const struct kbdus_device *device, const struct blk_mq_hw_ctx *hctx)
+{
+    // requests submitted before the device first becomes available (e.g., due
+    // to partition scanning) go to the first queue, as user space may only be
+    // servicing that queue until then
+
+    if (atomic_read(&device->state) == KBDUS_DEVICE_STATE_UNAVAILABLE)
+        return 0;
+
+    return (u32)hctx->queue_num;
+}
+
+// Whether the given request reads or writes device data, as opposed to being a
+// *flush* or *ioctl* request.
+static bool kbdus_device_req_has_data_(struct request *req)
+{
+    if (blk_rq_bytes(req) == 0)
+        return false;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+    return !blk_rq_is_passthrough(req);
+#else
+    return req->cmd_type == REQ_TYPE_FS;
+#endif
+}
+
+// Makes the extents targeted by the given request no longer be known to contain
+// only zeros, avoiding taking the lock if none of them is.
+static void kbdus_device_zero_map_clear_(
+    struct kbdus_device *device, struct request *req)
+{
+    unsigned long first;
+    unsigned long last;
+    unsigned long flags;
+
+    first = (unsigned long)(
+        (512ull * (u64)blk_rq_pos(req)) >> device->zero_extent_shift);
+
+    last = (unsigned long)(
+        (512ull * (u64)blk_rq_pos(req) + (u64)blk_rq_bytes(req) - 1)
+        >> device->zero_extent_shift);
+
+    if (find_next_bit(device->zero_map, last + 1, first) <= last)
+    {
+        spin_lock_irqsave(&device->zero_map_lock, flags);
+        bitmap_clear(
+            device->zero_map, (unsigned int)first,
+            (unsigned int)(last - first + 1));
+        spin_unlock_irqrestore(&device->zero_map_lock, flags);
+    }
+}
+
+// If all extents targeted by the given *read* request are known to contain only
+// zeros, zero-fills the request and returns true.
+static bool kbdus_device_zero_map_serve_read_(
+    struct kbdus_device *device, struct request *req)
+{
+    unsigned long first;
+    unsigned long last;
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+
+    first = (unsigned long)(
+        (512ull * (u64)blk_rq_pos(req)) >> device->zero_extent_shift);
+
+    last = (unsigned long)(
+        (512ull * (u64)blk_rq_pos(req) + (u64)blk_rq_bytes(req) - 1)
+        >> device->zero_extent_shift);
+
+    if (find_next_zero_bit(device->zero_map, last + 1, first) <= last)
+        return false;
+
+    rq_for_each_segment(bvec, req, req_iter)
+    {
+        zero_user(bvec.bv_page, bvec.bv_offset, bvec.bv_len);
+    }
+
+    atomic64_inc(&device->num_zero_map_hits);
+
+    return true;
+}
+
+// Updates the device's zero map and read cache according to the given request
+// which is being submitted, and serves it directly if it is a *read* request
+// that can be served from them. Returns true if the request was served and
+// should thus not be submitted to the inverter.
+static bool kbdus_device_handle_req_locally_(
+    struct kbdus_device *device, struct request *req)
+{
+    struct kbdus_inverter_pdu *pdu;
+
+    if ((!device->zero_map && !device->read_cache)
+        || !kbdus_device_req_has_data_(req))
+    {
+        return false;
+    }
+
+    if (rq_data_dir(req) == WRITE)
+    {
+        // the request may modify data
+
+        if (device->zero_map)
+            kbdus_device_zero_map_clear_(device, req);
+
+        if (device->read_cache)
+        {
+            kbdus_cache_invalidate(
+                device->read_cache, 512ull * (u64)blk_rq_pos(req),
+                (u64)blk_rq_bytes(req));
+        }
+
+        return false;
+    }
+
+    if ((!device->zero_map || !kbdus_device_zero_map_serve_read_(device, req))
+        && (!device->read_cache
+            || !kbdus_cache_serve_read(device->read_cache, req)))
+    {
+        // the request must be served by the driver, and its data may only be
+        // cached if none of its pages is invalidated in the meantime
+
+        if (device->read_cache)
+        {
+            pdu            = blk_mq_rq_to_pdu(req);
+            pdu->cache_gen = kbdus_cache_get_gen(device->read_cache, req);
+        }
+
+        return false;
+    }
+
+    blk_mq_start_request(req);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+    blk_mq_end_request(req, BLK_STS_OK);
+#else
+    blk_mq_end_request(req, 0);
+#endif
+
+    return true;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
 
 static blk_status_t kbdus_device_mq_ops_queue_rq_(
@@ -433,8 +799,12 @@ static blk_status_t kbdus_device_mq_ops_queue_rq_(
 
     device = hctx->queue->queuedata;
 
-    return errno_to_blk_status(
-        kbdus_inverter_submit_request(device->inverter, bd->rq));
+    if (kbdus_device_handle_req_locally_(device, bd->rq))
+        return BLK_STS_OK;
+
+    return errno_to_blk_status(kbdus_inverter_submit_request(
+        device->inverter, bd->rq, (u32)hctx->queue_num,
+        kbdus_device_hctx_to_queue_index_(device, hctx)));
 }
 
 #else
@@ -446,7 +816,13 @@ static int kbdus_device_mq_ops_queue_rq_(
 
     device = hctx->queue->queuedata;
 
-    if (kbdus_inverter_submit_request(device->inverter, bd->rq) == 0)
+    if (kbdus_device_handle_req_locally_(device, bd->rq))
+        return BLK_MQ_RQ_QUEUE_OK;
+
+    if (kbdus_inverter_submit_request(
+            device->inverter, bd->rq, (u32)hctx->queue_num,
+            kbdus_device_hctx_to_queue_index_(device, hctx))
+        == 0)
         return BLK_MQ_RQ_QUEUE_OK;
     else
         return BLK_MQ_RQ_QUEUE_ERROR;
@@ -464,11 +840,45 @@ static enum blk_eh_timer_return
     return kbdus_inverter_timeout_request(device->inverter, req);
 }
 
-static void kbdus_device_mq_ops_complete_(struct request *req)
+static void kbdus_device_end_request_(struct request *req)
 {
+    struct kbdus_device *device;
     struct kbdus_inverter_pdu *pdu;
 
-    pdu = blk_mq_rq_to_pdu(req);
+    device = req->q->queuedata;
+    pdu    = blk_mq_rq_to_pdu(req);
+
+    // keep zero map and read cache coherent, updating them for requests that
+    // may have modified data again now that they are complete, as the driver
+    // may have marked extents as zeroed while they were still in progress and
+    // reads that raced with them may have cached stale data
+
+    if (kbdus_device_req_has_data_(req))
+    {
+        if (rq_data_dir(req) == WRITE)
+        {
+            if (device->zero_map)
+                kbdus_device_zero_map_clear_(device, req);
+
+            if (device->read_cache)
+            {
+                kbdus_cache_invalidate(
+                    device->read_cache, 512ull * (u64)blk_rq_pos(req),
+                    (u64)blk_rq_bytes(req));
+            }
+        }
+        else if (device->read_cache && pdu->error == 0)
+        {
+            kbdus_cache_insert_read(device->read_cache, req, pdu->cache_gen);
+        }
+    }
+
+    // report where the data of *zone append* requests was written
+
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    if (req_op(req) == REQ_OP_ZONE_APPEND && pdu->error == 0)
+        req->__sector = pdu->zone_append_sector;
+#endif
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
     blk_mq_end_request(req, errno_to_blk_status(pdu->error));
@@ -477,11 +887,123 @@ static void kbdus_device_mq_ops_complete_(struct request *req)
 #endif
 }
 
+static void kbdus_device_mq_ops_complete_(struct request *req)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+
+    struct kbdus_inverter_pdu *pdu;
+
+    // requests of poll queues are ended by kbdus_device_mq_ops_poll_(), in the
+    // context of the client that is polling for them
+
+    if (req->mq_hctx->type == HCTX_TYPE_POLL)
+    {
+        pdu = blk_mq_rq_to_pdu(req);
+        llist_add(&pdu->poll_node, req->mq_hctx->driver_data);
+        return;
+    }
+
+#endif
+
+    kbdus_device_end_request_(req);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+
+static int kbdus_device_mq_ops_init_hctx_(
+    struct blk_mq_hw_ctx *hctx, void *driver_data, unsigned int hctx_idx)
+{
+    struct kbdus_device *device;
+
+    device = driver_data;
+
+    hctx->driver_data = &device->polled_reqs[hctx_idx];
+
+    return 0;
+}
+
+static int kbdus_device_mq_ops_map_queues_(struct blk_mq_tag_set *tag_set)
+{
+    struct kbdus_device *device;
+    struct blk_mq_queue_map *map;
+    unsigned int num_poll_queues;
+
+    device          = tag_set->driver_data;
+    num_poll_queues = device->config.num_poll_queues;
+
+    // the first hardware queues serve non-polled requests
+
+    map = &tag_set->map[HCTX_TYPE_DEFAULT];
+
+    map->nr_queues    = tag_set->nr_hw_queues - num_poll_queues;
+    map->queue_offset = 0;
+
+    blk_mq_map_queues(map);
+
+    if (tag_set->nr_maps <= HCTX_TYPE_POLL)
+        return 0;
+
+    // read requests use the same hardware queues as other non-polled requests
+
+    tag_set->map[HCTX_TYPE_READ].nr_queues = 0;
+
+    // the last hardware queues serve polled requests
+
+    map = &tag_set->map[HCTX_TYPE_POLL];
+
+    map->nr_queues    = num_poll_queues;
+    map->queue_offset = tag_set->nr_hw_queues - num_poll_queues;
+
+    blk_mq_map_queues(map);
+
+    return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)
+static int kbdus_device_mq_ops_poll_(
+    struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
+#else
+static int kbdus_device_mq_ops_poll_(struct blk_mq_hw_ctx *hctx)
+#endif
+{
+    struct kbdus_device *device;
+    struct llist_node *nodes;
+    struct kbdus_inverter_pdu *pdu;
+    struct kbdus_inverter_pdu *next_pdu;
+    int num_completed;
+
+    // take all completed requests, ending them in the order they completed
+
+    nodes = llist_reverse_order(llist_del_all(hctx->driver_data));
+
+    num_completed = 0;
+
+    llist_for_each_entry_safe(pdu, next_pdu, nodes, poll_node)
+    {
+        kbdus_device_end_request_(blk_mq_rq_from_pdu(pdu));
+        ++num_completed;
+    }
+
+    if (num_completed > 0)
+    {
+        device = hctx->queue->queuedata;
+        atomic64_add(num_completed, &device->num_polled_reqs);
+    }
+
+    return num_completed;
+}
+
+#endif
+
 static const struct blk_mq_ops kbdus_device_queue_ops_ = {
     .queue_rq = kbdus_device_mq_ops_queue_rq_,
     .timeout  = kbdus_device_mq_ops_timeout_,
     .complete = kbdus_device_mq_ops_complete_,
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 9, 0)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+    .init_hctx  = kbdus_device_mq_ops_init_hctx_,
+    .map_queues = kbdus_device_mq_ops_map_queues_,
+    .poll       = kbdus_device_mq_ops_poll_,
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 9, 0)
     .map_queues = NULL,
 #else
     .map_queue = blk_mq_map_queue,
@@ -572,8 +1094,9 @@ static int kbdus_device_ioctl_submit_and_await_(
 
     pdu = blk_mq_rq_to_pdu(req);
 
-    pdu->ioctl_command  = command;
-    pdu->ioctl_argument = arg_buffer;
+    pdu->ioctl_command         = command;
+    pdu->ioctl_argument        = arg_buffer;
+    pdu->zone_report_max_zones = 0;
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
     blk_execute_rq(disk, req, 0);
@@ -637,17 +1160,220 @@ static int kbdus_device_ioctl_(
         bdev->bd_disk, command, (void __user *)argument);
 }
 
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+
+// Submits a *zone report* request for at most `max_zones` zones starting with
+// the one containing `offset` and awaits its completion. Returns the number of
+// zones that the driver reported into `zones`, or a negated errno value.
+static int kbdus_device_zone_report_submit_and_await_(
+    struct gendisk *disk, u64 offset, struct kbdus_zone *zones, u32 max_zones)
+{
+    struct request *req;
+    struct kbdus_inverter_pdu *pdu;
+    int ret;
+
+    // get request
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)
+    req = blk_mq_alloc_request(disk->queue, REQ_OP_DRV_IN, 0);
+#else
+    req = blk_get_request(disk->queue, REQ_OP_DRV_IN, 0);
+#endif
+
+    if (IS_ERR(req))
+        return PTR_ERR(req);
+
+    // submit and await request
+
+    pdu = blk_mq_rq_to_pdu(req);
+
+    pdu->zone_report_max_zones = max_zones;
+    pdu->zone_report_num_zones = 0;
+    pdu->zone_report_offset    = offset;
+    pdu->zone_report_zones     = zones;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
+    blk_execute_rq(disk, req, 0);
+#else
+    blk_execute_rq(disk->queue, disk, req, 0);
+#endif
+
+    ret = pdu->error == 0 ? (int)pdu->zone_report_num_zones : pdu->error;
+
+    // put request
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)
+    blk_mq_free_request(req);
+#else
+    blk_put_request(req);
+#endif
+
+    return ret;
+}
+
+// Converts a zone reported by the driver, which must be the zone at `offset` of
+// the given size. Returns false if the reported zone is invalid.
+static bool kbdus_device_convert_zone_(
+    const struct kbdus_zone *zone, u64 offset, u64 size,
+    struct blk_zone *blk_zone)
+{
+    BUILD_BUG_ON(KBDUS_ZONE_TYPE_CONVENTIONAL != BLK_ZONE_TYPE_CONVENTIONAL);
+    BUILD_BUG_ON(
+        KBDUS_ZONE_TYPE_SEQUENTIAL_WRITE_REQUIRED
+        != BLK_ZONE_TYPE_SEQWRITE_REQ);
+
+    BUILD_BUG_ON(
+        KBDUS_ZONE_CONDITION_NOT_WRITE_POINTER != BLK_ZONE_COND_NOT_WP);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_EMPTY != BLK_ZONE_COND_EMPTY);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_IMPLICIT_OPEN != BLK_ZONE_COND_IMP_OPEN);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_EXPLICIT_OPEN != BLK_ZONE_COND_EXP_OPEN);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_CLOSED != BLK_ZONE_COND_CLOSED);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_READ_ONLY != BLK_ZONE_COND_READONLY);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_FULL != BLK_ZONE_COND_FULL);
+    BUILD_BUG_ON(KBDUS_ZONE_CONDITION_OFFLINE != BLK_ZONE_COND_OFFLINE);
+
+    if (zone->offset != offset || zone->size != size
+        || zone->capacity > size || zone->capacity % 512 != 0)
+    {
+        return false;
+    }
+
+    switch (zone->type)
+    {
+    case KBDUS_ZONE_TYPE_CONVENTIONAL:
+
+        if (zone->condition != KBDUS_ZONE_CONDITION_NOT_WRITE_POINTER)
+            return false;
+
+        break;
+
+    case KBDUS_ZONE_TYPE_SEQUENTIAL_WRITE_REQUIRED:
+
+        switch (zone->condition)
+        {
+        case KBDUS_ZONE_CONDITION_EMPTY:
+        case KBDUS_ZONE_CONDITION_IMPLICIT_OPEN:
+        case KBDUS_ZONE_CONDITION_EXPLICIT_OPEN:
+        case KBDUS_ZONE_CONDITION_CLOSED:
+        case KBDUS_ZONE_CONDITION_READ_ONLY:
+        case KBDUS_ZONE_CONDITION_FULL:
+        case KBDUS_ZONE_CONDITION_OFFLINE:
+            break;
+
+        default:
+            return false;
+        }
+
+        if (zone->write_pointer < offset
+            || zone->write_pointer - offset > size
+            || zone->write_pointer % 512 != 0)
+        {
+            return false;
+        }
+
+        break;
+
+    default:
+        return false;
+    }
+
+    memset(blk_zone, 0, sizeof(*blk_zone));
+
+    blk_zone->start    = (sector_t)(offset / 512);
+    blk_zone->len      = (sector_t)(size / 512);
+    blk_zone->capacity = (sector_t)(zone->capacity / 512);
+    blk_zone->type     = zone->type;
+    blk_zone->cond     = zone->condition;
+
+    if (zone->type == KBDUS_ZONE_TYPE_CONVENTIONAL)
+        blk_zone->wp = blk_zone->start + blk_zone->len;
+    else
+        blk_zone->wp = (sector_t)(zone->write_pointer / 512);
+
+    return true;
+}
+
+static int kbdus_device_report_zones_(
+    struct gendisk *disk, sector_t sector, unsigned int nr_zones,
+    report_zones_cb cb, void *data)
+{
+    const struct kbdus_device *device;
+    struct kbdus_zone *zones;
+    struct blk_zone blk_zone;
+    unsigned int num_reported;
+    u64 offset;
+    u64 size;
+    int num_zones;
+    int i;
+    int ret;
+
+    device = disk->queue->queuedata;
+
+    zones = kmalloc_array(
+        KBDUS_MAX_ZONES_PER_REPORT, sizeof(*zones), GFP_KERNEL);
+
+    if (!zones)
+        return -ENOMEM;
+
+    // start at the zone containing `sector`, as zones always have the
+    // configured size (except for the last one)
+
+    offset       = (512ull * (u64)sector) & ~(device->config.zone_size - 1);
+    num_reported = 0;
+    ret          = 0;
+
+    while (ret == 0 && num_reported < nr_zones && offset < device->config.size)
+    {
+        num_zones = kbdus_device_zone_report_submit_and_await_(
+            disk, offset, zones,
+            min(nr_zones - num_reported, (u32)KBDUS_MAX_ZONES_PER_REPORT));
+
+        if (num_zones <= 0)
+        {
+            ret = num_zones;
+            break;
+        }
+
+        for (i = 0; ret == 0 && i < num_zones; ++i)
+        {
+            size = min(device->config.zone_size, device->config.size - offset);
+
+            if (offset >= device->config.size
+                || !kbdus_device_convert_zone_(
+                    &zones[i], offset, size, &blk_zone))
+            {
+                ret = -EIO;
+            }
+            else
+            {
+                ret = cb(&blk_zone, num_reported++, data);
+                offset += size;
+            }
+        }
+    }
+
+    kfree(zones);
+
+    return ret != 0 ? ret : (int)num_reported;
+}
+
+#endif
+
 // File operations for devices.
 static const struct block_device_operations kbdus_device_ops_ = {
     .owner        = THIS_MODULE,
     .ioctl        = kbdus_device_ioctl_,
     .compat_ioctl = kbdus_device_ioctl_,
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    .report_zones = kbdus_device_report_zones_,
+#endif
 };
 
 /* -------------------------------------------------------------------------- */
 
 static struct gendisk *kbdus_device_create_disk_(
-    struct blk_mq_tag_set *tag_set, const struct kbdus_device_config *config)
+    struct blk_mq_tag_set *tag_set, const struct kbdus_device_config *config,
+    void *driver_data)
 {
     unsigned int tag_set_flags;
     int ret;
@@ -662,16 +1388,19 @@ static struct gendisk *kbdus_device_create_disk_(
         tag_set_flags |= BLK_MQ_F_SHOULD_MERGE;
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
-    tag_set_flags |= BLK_MQ_F_NO_SCHED_BY_DEFAULT;
+    if (!config->zoned)
+        tag_set_flags |= BLK_MQ_F_NO_SCHED_BY_DEFAULT;
 #endif
 
     memset(tag_set, 0, sizeof(*tag_set));
 
-    tag_set->nr_hw_queues = 1;
-    tag_set->queue_depth  = (unsigned int)config->max_outstanding_reqs;
+    tag_set->nr_hw_queues = (unsigned int)config->num_queues;
+    tag_set->queue_depth =
+        (unsigned int)(config->max_outstanding_reqs / config->num_queues);
     tag_set->numa_node    = NUMA_NO_NODE;
     tag_set->cmd_size     = (unsigned int)sizeof(struct kbdus_inverter_pdu);
     tag_set->flags        = tag_set_flags;
+    tag_set->driver_data  = driver_data;
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
     tag_set->ops = &kbdus_device_queue_ops_;
@@ -680,7 +1409,7 @@ static struct gendisk *kbdus_device_create_disk_(
 #endif
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
-    tag_set->nr_maps = 1;
+    tag_set->nr_maps = config->num_poll_queues > 0 ? HCTX_TYPE_POLL + 1 : 1;
 #endif
 
     // allocate tag set
@@ -755,6 +1484,11 @@ static struct gendisk *kbdus_device_create_disk_(
     kbdus_device_config_request_queue_flags_(disk->queue, config);
     kbdus_device_config_request_queue_limits_(disk->queue, config);
 
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    if (config->zoned)
+        kbdus_device_config_zones_(disk, config);
+#endif
+
     // return disk
 
     return disk;
@@ -762,6 +1496,68 @@ static struct gendisk *kbdus_device_create_disk_(
 
 /* -------------------------------------------------------------------------- */
 
+static int kbdus_device_debugfs_stats_show_(struct seq_file *s, void *unused)
+{
+    struct kbdus_device *device;
+
+    device = s->private;
+
+    kbdus_inverter_show_stats(device->inverter, s);
+
+    if (device->config.num_poll_queues > 0)
+    {
+        seq_printf(
+            s, "poll_queues requests %llu\n",
+            (unsigned long long)atomic64_read(&device->num_polled_reqs));
+    }
+
+    if (device->zero_map)
+    {
+        seq_printf(
+            s, "zero_extents hits %llu\n",
+            (unsigned long long)atomic64_read(&device->num_zero_map_hits));
+    }
+
+    if (device->read_cache)
+        kbdus_cache_show_stats(device->read_cache, s);
+
+    return 0;
+}
+
+static int
+    kbdus_device_debugfs_stats_open_(struct inode *inode, struct file *filp)
+{
+    return single_open(
+        filp, kbdus_device_debugfs_stats_show_, inode->i_private);
+}
+
+static const struct file_operations kbdus_device_debugfs_stats_fops_ = {
+    .owner   = THIS_MODULE,
+    .open    = kbdus_device_debugfs_stats_open_,
+    .read    = seq_read,
+    .llseek  = seq_lseek,
+    .release = single_release,
+};
+
+// Statistics are a debugging aid, so failing to expose them is not an error.
+static void kbdus_device_debugfs_create_(struct kbdus_device *device)
+{
+    if (IS_ERR_OR_NULL(kbdus_device_debugfs_root_))
+        return;
+
+    device->debugfs_dir = debugfs_create_dir(
+        device->disk->disk_name, kbdus_device_debugfs_root_);
+
+    if (IS_ERR_OR_NULL(device->debugfs_dir))
+        return;
+
+    debugfs_create_file(
+        "stats", 0400, device->debugfs_dir, device,
+        &kbdus_device_debugfs_stats_fops_);
+}
+
+/* -------------------------------------------------------------------------- */
+
 int __init kbdus_device_init(void)
 {
     // register block device
@@ -771,6 +1567,10 @@ int __init kbdus_device_init(void)
     if (kbdus_device_major_ < 0)
         return kbdus_device_major_;
 
+    // create debugfs directory (failure is not fatal)
+
+    kbdus_device_debugfs_root_ = debugfs_create_dir("kbdus", NULL);
+
     // success
 
     return 0;
@@ -778,6 +1578,9 @@ int __init kbdus_device_init(void)
 
 void kbdus_device_exit(void)
 {
+    if (!IS_ERR_OR_NULL(kbdus_device_debugfs_root_))
+        debugfs_remove_recursive(kbdus_device_debugfs_root_);
+
     unregister_blkdev(kbdus_device_major_, "bdus");
 }
 
@@ -802,6 +1605,7 @@ struct kbdus_device *
     kbdus_device_create(const struct kbdus_device_config *config)
 {
     struct kbdus_device *device;
+    u32 i;
     int ret_error;
 
     // allocate and initialize device structure a bit
@@ -818,6 +1622,42 @@ struct kbdus_device *
 
     atomic_set(&device->state, KBDUS_DEVICE_STATE_UNAVAILABLE);
 
+    // allocate zero map (no extent is initially known to contain only zeros)
+
+    if (config->zero_extent_size != 0)
+    {
+        device->zero_extent_shift = ilog2(config->zero_extent_size);
+
+        device->num_zero_extents = (unsigned long)DIV_ROUND_UP_ULL(
+            config->size, config->zero_extent_size);
+
+        device->zero_map = vzalloc(
+            BITS_TO_LONGS(device->num_zero_extents) * sizeof(unsigned long));
+
+        if (!device->zero_map)
+        {
+            ret_error = -ENOMEM;
+            goto error_free_device;
+        }
+
+        spin_lock_init(&device->zero_map_lock);
+        atomic64_set(&device->num_zero_map_hits, 0);
+    }
+
+    // create read cache
+
+    if (config->read_cache_size != 0)
+    {
+        device->read_cache =
+            kbdus_cache_create(config->read_cache_size / (u32)PAGE_SIZE);
+
+        if (IS_ERR(device->read_cache))
+        {
+            ret_error = PTR_ERR(device->read_cache);
+            goto error_free_zero_map;
+        }
+    }
+
     // create inverter
 
     device->inverter = kbdus_inverter_create(config);
@@ -825,9 +1665,25 @@ struct kbdus_device *
     if (IS_ERR(device->inverter))
     {
         ret_error = PTR_ERR(device->inverter);
-        goto error_free_device;
+        goto error_destroy_read_cache;
     }
 
+    // allocate lists of completed requests of poll queues
+
+    device->polled_reqs = kcalloc(
+        config->num_queues, sizeof(*device->polled_reqs), GFP_KERNEL);
+
+    if (!device->polled_reqs)
+    {
+        ret_error = -ENOMEM;
+        goto error_destroy_inverter;
+    }
+
+    for (i = 0; i < config->num_queues; ++i)
+        init_llist_head(&device->polled_reqs[i]);
+
+    atomic64_set(&device->num_polled_reqs, 0);
+
     // create task for adding the disk
 
     device->add_disk_task = kthread_create(
@@ -836,14 +1692,15 @@ struct kbdus_device *
     if (IS_ERR(device->add_disk_task))
     {
         ret_error = PTR_ERR(device->add_disk_task);
-        goto error_destroy_inverter;
+        goto error_free_polled_reqs;
     }
 
     init_completion(&device->add_disk_task_started);
 
     // create disk
 
-    device->disk = kbdus_device_create_disk_(&device->tag_set, config);
+    device->disk =
+        kbdus_device_create_disk_(&device->tag_set, config, device);
 
     if (IS_ERR(device->disk))
     {
@@ -853,6 +1710,10 @@ struct kbdus_device *
 
     device->disk->queue->queuedata = device;
 
+    // expose statistics in debugfs
+
+    kbdus_device_debugfs_create_(device);
+
     // "get" `add_disk_task` so that it is still around when
     // `kbdus_device_destroy()` and thus `kthread_stop()` is called, even if the
     // task already ended
@@ -878,9 +1739,16 @@ struct kbdus_device *
 
 error_stop_add_disk_task:
     kthread_stop(device->add_disk_task);
+error_free_polled_reqs:
+    kfree(device->polled_reqs);
 error_destroy_inverter:
     kbdus_inverter_terminate(device->inverter);
     kbdus_inverter_destroy(device->inverter);
+error_destroy_read_cache:
+    if (device->read_cache)
+        kbdus_cache_destroy(device->read_cache);
+error_free_zero_map:
+    vfree(device->zero_map);
 error_free_device:
     kfree(device);
 error:
@@ -893,6 +1761,11 @@ void kbdus_device_destroy(struct kbdus_device *device)
 
     kbdus_inverter_terminate(device->inverter);
 
+    // remove debugfs files (so that statistics are no longer read)
+
+    if (!IS_ERR_OR_NULL(device->debugfs_dir))
+        debugfs_remove_recursive(device->debugfs_dir);
+
     // wait for add_disk_task to end
 
     kthread_stop(device->add_disk_task);
@@ -913,6 +1786,17 @@ void kbdus_device_destroy(struct kbdus_device *device)
 
     blk_mq_free_tag_set(&device->tag_set);
 
+    // free lists of completed requests of poll queues
+
+    kfree(device->polled_reqs);
+
+    // free zero map and destroy read cache
+
+    vfree(device->zero_map);
+
+    if (device->read_cache)
+        kbdus_cache_destroy(device->read_cache);
+
     // free device
 
     kfree(device);
@@ -946,6 +1830,114 @@ struct kbdus_inverter *
     return device->inverter;
 }
 
+int kbdus_device_set_zero_range(
+    struct kbdus_device *device, u64 offset, u64 size, bool zero)
+{
+    u64 end;
+    unsigned long first;
+    unsigned long last_plus_one;
+    unsigned long flags;
+
+    if (!device->zero_map)
+        return -EOPNOTSUPP;
+
+    if (!IS_ALIGNED(offset, (u64)device->config.logical_block_size)
+        || !IS_ALIGNED(size, (u64)device->config.logical_block_size)
+        || offset > device->config.size || size > device->config.size - offset)
+    {
+        return -ERANGE;
+    }
+
+    end = offset + size;
+
+    if (zero)
+    {
+        // only extents entirely within the region, including the last extent
+        // if the region extends to the end of the device
+
+        first = (unsigned long)DIV_ROUND_UP_ULL(
+            offset, device->config.zero_extent_size);
+
+        if (end == device->config.size)
+            last_plus_one = device->num_zero_extents;
+        else
+            last_plus_one = (unsigned long)(end >> device->zero_extent_shift);
+    }
+    else
+    {
+        // all extents that overlap the region
+
+        first = (unsigned long)(offset >> device->zero_extent_shift);
+
+        last_plus_one = (unsigned long)DIV_ROUND_UP_ULL(
+            end, device->config.zero_extent_size);
+    }
+
+    if (first >= last_plus_one)
+        return 0;
+
+    spin_lock_irqsave(&device->zero_map_lock, flags);
+
+    if (zero)
+    {
+        bitmap_set(
+            device->zero_map, (unsigned int)first,
+            (unsigned int)(last_plus_one - first));
+    }
+    else
+    {
+        bitmap_clear(
+            device->zero_map, (unsigned int)first,
+            (unsigned int)(last_plus_one - first));
+    }
+
+    spin_unlock_irqrestore(&device->zero_map_lock, flags);
+
+    // the read cache may hold data from before the region became zeroed
+
+    if (!zero && device->read_cache)
+        kbdus_cache_invalidate(device->read_cache, offset, size);
+
+    return 0;
+}
+
+int kbdus_device_invalidate_read_cache(
+    struct kbdus_device *device, u64 offset, u64 size)
+{
+    if (offset > device->config.size || size > device->config.size - offset)
+        return -ERANGE;
+
+    if (device->read_cache)
+        kbdus_cache_invalidate(device->read_cache, offset, size);
+
+    return 0;
+}
+
+void kbdus_device_get_stats(
+    struct kbdus_device *device, struct kbdus_device_stats *stats)
+{
+    kbdus_inverter_get_stats(device->inverter, stats);
+}
+
+int kbdus_device_get_queue_node(
+    const struct kbdus_device *device, u32 queue_index)
+{
+    struct blk_mq_hw_ctx *hctx;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 18, 0)
+    unsigned long i;
+#else
+    unsigned int i;
+#endif
+
+    queue_for_each_hw_ctx(device->disk->queue, hctx, i)
+    {
+        if (i == (unsigned long)queue_index)
+            return hctx->numa_node;
+    }
+
+    return NUMA_NO_NODE;
+}
+
 void kbdus_device_terminate(struct kbdus_device *device)
 {
     atomic_set(&device->state, KBDUS_DEVICE_STATE_TERMINATED);
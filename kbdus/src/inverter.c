@@ -1,22 +1,28 @@
 /* SPDX-License-Identifier: GPL-2.0-only */
 /* -------------------------------------------------------------------------- */
 
+#include <kbdus/config.h>
 #include <kbdus/inverter.h>
 #include <kbdus/utilities.h>
 
 #include <linux/blk-mq.h>
 #include <linux/blkdev.h>
+#include <linux/cache.h>
 #include <linux/completion.h>
 #include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/export.h>
 #include <linux/genhd.h>
 #include <linux/init.h>
+#include <linux/ioprio.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
 #include <linux/log2.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/timekeeping.h>
@@ -36,27 +42,37 @@
 #include <linux/bug.h>
 #endif
 
+#define CREATE_TRACE_POINTS
+#include <kbdus/trace.h>
+
 /* -------------------------------------------------------------------------- */
 
+// Flags applying to a single queue. These are protected by the queue's lock.
 enum
 {
-    KBDUS_INVERTER_FLAG_DEACTIVATED_             = 1u << 0,
-    KBDUS_INVERTER_FLAG_DEACTIVATED_NOT_FLUSHED_ = 1u << 1,
-    KBDUS_INVERTER_FLAG_TERMINATED_              = 1u << 2,
-    KBDUS_INVERTER_FLAG_SEND_DEVICE_AVAILABLE_   = 1u << 3,
+    KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_             = 1u << 0,
+    KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_NOT_FLUSHED_ = 1u << 1,
+    KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_              = 1u << 2,
+    KBDUS_INVERTER_QUEUE_FLAG_SEND_DEVICE_AVAILABLE_   = 1u << 3,
+};
 
-    KBDUS_INVERTER_FLAG_SUPPORTS_READ_  = 1u << 4,
-    KBDUS_INVERTER_FLAG_SUPPORTS_WRITE_ = 1u << 5,
-    KBDUS_INVERTER_FLAG_SUPPORTS_FLUSH_ = 1u << 6,
-    KBDUS_INVERTER_FLAG_SUPPORTS_IOCTL_ = 1u << 7,
+// Flags applying to the whole inverter. These are never modified after the
+// inverter is created.
+enum
+{
+    KBDUS_INVERTER_FLAG_SUPPORTS_READ_  = 1u << 0,
+    KBDUS_INVERTER_FLAG_SUPPORTS_WRITE_ = 1u << 1,
+    KBDUS_INVERTER_FLAG_SUPPORTS_FLUSH_ = 1u << 2,
+    KBDUS_INVERTER_FLAG_SUPPORTS_IOCTL_ = 1u << 3,
 
 #if KBDUS_DEBUG
 
-    KBDUS_INVERTER_FLAG_SUPPORTS_WRITE_SAME_   = 1u << 8,
-    KBDUS_INVERTER_FLAG_SUPPORTS_WRITE_ZEROS_  = 1u << 9,
-    KBDUS_INVERTER_FLAG_SUPPORTS_FUA_WRITE_    = 1u << 10,
-    KBDUS_INVERTER_FLAG_SUPPORTS_DISCARD_      = 1u << 11,
-    KBDUS_INVERTER_FLAG_SUPPORTS_SECURE_ERASE_ = 1u << 12,
+    KBDUS_INVERTER_FLAG_SUPPORTS_WRITE_SAME_   = 1u << 4,
+    KBDUS_INVERTER_FLAG_SUPPORTS_WRITE_ZEROS_  = 1u << 5,
+    KBDUS_INVERTER_FLAG_SUPPORTS_FUA_WRITE_    = 1u << 6,
+    KBDUS_INVERTER_FLAG_SUPPORTS_DISCARD_      = 1u << 7,
+    KBDUS_INVERTER_FLAG_SUPPORTS_SECURE_ERASE_ = 1u << 8,
+    KBDUS_INVERTER_FLAG_ZONED_                 = 1u << 9,
 
 #endif
 };
@@ -85,6 +101,10 @@ enum
     // `kbdus_inverter_commit_item_completion()` or
     // `kbdus_inverter_abort_item_completion()` have not
     KBDUS_REQ_STATE_BEING_COMPLETED_,
+
+    // request wrapper is holding a *flush* request that was merged into
+    // another one, and is to be completed along with it
+    KBDUS_REQ_STATE_MERGED_,
 };
 
 static const struct kbdus_inverter_item kbdus_inverter_req_dev_available_ = {
@@ -107,6 +127,14 @@ static const struct kbdus_inverter_item kbdus_inverter_req_flush_terminate_ = {
 
 /* -------------------------------------------------------------------------- */
 
+// Request wrappers are indexed by hardware queue and blk-mq tag, so the wrapper
+// for a request is always free when the request is submitted and no free list
+// is needed.
+//
+// A non-free wrapper belongs to the queue given by `queue_index` (for merged
+// *flush* requests, that of the request they were merged into), and its state
+// is protected by that queue's lock. While free, a wrapper may only be touched
+// by `kbdus_inverter_submit_request()`.
 struct kbdus_inverter_req_wrapper_
 {
     // - 32-bit archs: bytes 0-7
@@ -121,29 +149,156 @@ struct kbdus_inverter_req_wrapper_
     // - 64-bit archs: bytes 40-43
     u32 state;
 
+    // - 32-bit archs: bytes 28-31
+    // - 64-bit archs: bytes 44-47
+    u32 queue_index;
+
+    // when the request entered its current state, or when it started being
+    // gotten or completed, for statistics
+    //
+    // - 32-bit archs: bytes 32-39
+    // - 64-bit archs: bytes 48-55
+    u64 timestamp_ns;
+
+    // the time spent so far copying the request's data to and from user space
+    //
+    // - 32-bit archs: bytes 40-43
+    // - 64-bit archs: bytes 56-59
+    u32 copy_ns;
+
+    // the handle index of the next *flush* request merged into this one (or,
+    // if this one was itself merged, into the same request as this one), or 0
+    // if there is none
+    //
+    // - 32-bit archs: bytes 44-45
+    // - 64-bit archs: bytes 60-61
+    u16 next_merged_index;
+
     // pad to 64 bytes
 #if BITS_PER_LONG == 32
-    u8 padding_[36];
+    u8 padding_[18];
 #else
-    u8 padding_[20];
+    u8 padding_[2];
 #endif
 };
 
-struct kbdus_inverter
+/* -------------------------------------------------------------------------- */
+
+// The number of buckets in each latency histogram. Bucket 0 counts latencies
+// under 2^10 ns, bucket `i` counts latencies in [2^(9+i), 2^(10+i)) ns, and
+// the last bucket counts all latencies of at least 2^32 ns.
+#define KBDUS_INVERTER_HIST_BUCKETS_ 24
+
+// Requests of type `KBDUS_ITEM_TYPE_READ` through `KBDUS_ITEM_TYPE_ZONE_APPEND`
+// have separate statistics, but only those up to `KBDUS_ITEM_TYPE_IOCTL` are
+// exposed through `KBDUS_IOCTL_GET_DEVICE_STATS`.
+#define KBDUS_INVERTER_NUM_REQ_TYPES_                                          \
+    (KBDUS_ITEM_TYPE_ZONE_APPEND - KBDUS_ITEM_TYPE_READ + 1)
+
+struct kbdus_inverter_req_type_stats_
+{
+    u64 requests;
+    u64 bytes;
+    u64 errors;
+    u64 timeouts;
+    u64 merges;
+
+    // requests whose data was mapped into the driver's memory instead of being
+    // copied (updated without holding a queue lock, see
+    // `kbdus_inverter_count_item_transfer()`)
+    u64 mapped;
+
+    // requests whose data was transferred by kbdus between the request and a
+    // file given by the driver (updated like `mapped`)
+    u64 spliced;
+
+    // total time spent being served by the driver
+    u64 service_ns;
+
+    // time spent awaiting get, being served by the driver (from being gotten
+    // until starting to be completed), and copying data to and from user space
+    u64 queue_wait_hist[KBDUS_INVERTER_HIST_BUCKETS_];
+    u64 service_hist[KBDUS_INVERTER_HIST_BUCKETS_];
+    u64 copy_hist[KBDUS_INVERTER_HIST_BUCKETS_];
+};
+
+// Statistics are kept per CPU and, unless otherwise noted, only updated with a
+// queue's lock held (and thus with interrupts disabled), so updates need no
+// atomic operations. The others are updated with this_cpu_inc().
+struct kbdus_inverter_stats_
+{
+    struct kbdus_inverter_req_type_stats_ types[KBDUS_INVERTER_NUM_REQ_TYPES_];
+
+    // times that busy-waiting for a request or notification ended because one
+    // became available, and because it didn't in time (updated without
+    // holding a queue lock)
+    u64 busy_poll_hits;
+    u64 busy_poll_misses;
+};
+
+struct kbdus_inverter_queue_
 {
+    spinlock_t lock;
     u32 flags;
-    u32 num_reqs;
 
     struct completion item_is_awaiting_get;
 
-    spinlock_t reqs_lock;
-    struct list_head reqs_free;
+    // woken up whenever `item_is_awaiting_get` is completed, for the benefit
+    // of poll(), select(), and epoll
+    wait_queue_head_t item_is_awaiting_get_poll;
+
     struct list_head reqs_awaiting_get;
+    struct list_head reqs_awaiting_completion;
+
+    // a *flush* request awaiting get, into which subsequently submitted
+    // *flush* requests are merged, or NULL if there is none
+    struct kbdus_inverter_req_wrapper_ *flush_awaiting_get;
+
+    // the *flush* request most recently gotten by the driver, if it has not yet
+    // been completed or requeued, or NULL, and the value of `writes_completed`
+    // when it was gotten (while no other request that may write data completes,
+    // subsequently submitted *flush* requests are merged into it too)
+    struct kbdus_inverter_req_wrapper_ *flush_in_flight;
+    u64 flush_in_flight_writes;
+
+    // the same as the inverter's `writes_completed`
+    atomic64_t *writes_completed;
+
+    // the same as the inverter's `reqs_all`
+    struct kbdus_inverter_req_wrapper_ *reqs_all;
+
+    // the number of requests in `reqs_awaiting_get`, which may be read without
+    // holding `lock`
+    u32 num_awaiting_get;
+
+    // the same as the inverter's `stats`
+    struct kbdus_inverter_stats_ __percpu *stats;
+
+    // the id of the device, for tracing
+    u64 dev_id;
+
+    // the device's `enum kbdus_dispatch_policy`
+    u8 dispatch_policy;
+} ____cacheline_aligned_in_smp;
+
+struct kbdus_inverter
+{
+    u32 flags;
+    u32 num_reqs;
+    u32 num_queues;
+    u32 queue_depth;
+
+    struct kbdus_inverter_queue_ *queues;
+
+    struct kbdus_inverter_stats_ __percpu *stats;
+
+    // the number of completed requests that may have written data, on all
+    // queues
+    atomic64_t writes_completed;
 
     void *reqs_all_unaligned;
     struct kbdus_inverter_req_wrapper_ *reqs_all;
 };
-
 /* -------------------------------------------------------------------------- */
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 18, 0)
@@ -155,7 +310,7 @@ struct kbdus_inverter
 /* -------------------------------------------------------------------------- */
 
 static enum kbdus_item_type
-    kbdus_inverter_req_to_item_type_(const struct request *req)
+    kbdus_inverter_req_to_item_type_(struct request *req)
 {
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 8, 0)
 
@@ -202,9 +357,34 @@ static enum kbdus_item_type
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
     case REQ_OP_DRV_IN:
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+        if (((struct kbdus_inverter_pdu *)blk_mq_rq_to_pdu(req))
+                ->zone_report_max_zones
+            > 0)
+        {
+            return KBDUS_ITEM_TYPE_ZONE_REPORT;
+        }
+#endif
         return KBDUS_ITEM_TYPE_IOCTL;
 #endif
 
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    case REQ_OP_ZONE_RESET:
+        return KBDUS_ITEM_TYPE_ZONE_RESET;
+
+    case REQ_OP_ZONE_OPEN:
+        return KBDUS_ITEM_TYPE_ZONE_OPEN;
+
+    case REQ_OP_ZONE_CLOSE:
+        return KBDUS_ITEM_TYPE_ZONE_CLOSE;
+
+    case REQ_OP_ZONE_FINISH:
+        return KBDUS_ITEM_TYPE_ZONE_FINISH;
+
+    case REQ_OP_ZONE_APPEND:
+        return KBDUS_ITEM_TYPE_ZONE_APPEND;
+#endif
+
     default:
         WARN_ON(true);
         return -1;
@@ -290,6 +470,15 @@ static bool kbdus_inverter_req_is_supported_(
             !(inverter->flags & KBDUS_INVERTER_FLAG_SUPPORTS_SECURE_ERASE_));
         return inverter->flags & KBDUS_INVERTER_FLAG_SUPPORTS_SECURE_ERASE_;
 
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+    case KBDUS_ITEM_TYPE_ZONE_RESET:
+    case KBDUS_ITEM_TYPE_ZONE_OPEN:
+    case KBDUS_ITEM_TYPE_ZONE_CLOSE:
+    case KBDUS_ITEM_TYPE_ZONE_FINISH:
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
+        WARN_ON(!(inverter->flags & KBDUS_INVERTER_FLAG_ZONED_));
+        return inverter->flags & KBDUS_INVERTER_FLAG_ZONED_;
+
         // and there aren't any more request types
 
     default:
@@ -305,6 +494,7 @@ static bool kbdus_inverter_req_is_supported_(
     }
 }
 
+
 static struct kbdus_inverter_req_wrapper_ *
     kbdus_inverter_handle_index_to_wrapper_(
         struct kbdus_inverter *inverter, u16 index)
@@ -317,11 +507,93 @@ static struct kbdus_inverter_req_wrapper_ *
     return &inverter->reqs_all[index];
 }
 
+// Locks and returns the queue to which the given wrapper belongs. The wrapper
+// must not be free, or the returned queue may be stale.
+static struct kbdus_inverter_queue_ *kbdus_inverter_lock_wrapper_queue_(
+    struct kbdus_inverter *inverter,
+    const struct kbdus_inverter_req_wrapper_ *wrapper, unsigned long *flags)
+{
+    struct kbdus_inverter_queue_ *queue;
+    u32 queue_index;
+
+    while (true)
+    {
+        queue_index = READ_ONCE(wrapper->queue_index);
+        queue       = &inverter->queues[queue_index];
+
+        spin_lock_irqsave(&queue->lock, *flags);
+
+        // the wrapper may have been freed and resubmitted to another queue in
+        // the meantime
+
+        if (likely(wrapper->queue_index == queue_index))
+            return queue;
+
+        spin_unlock_irqrestore(&queue->lock, *flags);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Must be called with `queue->lock` held.
+static struct kbdus_inverter_req_type_stats_ *kbdus_inverter_type_stats_(
+    struct kbdus_inverter_queue_ *queue,
+    const struct kbdus_inverter_req_wrapper_ *wrapper)
+{
+    return &this_cpu_ptr(queue->stats)
+                ->types[wrapper->item.type - KBDUS_ITEM_TYPE_READ];
+}
+
+static void kbdus_inverter_hist_add_(u64 *hist, u64 ns)
+{
+    u32 bucket;
+
+    if (ns < (1ull << 10))
+        bucket = 0;
+    else
+        bucket = min((u32)ilog2(ns) - 9, (u32)KBDUS_INVERTER_HIST_BUCKETS_ - 1);
+
+    ++hist[bucket];
+}
+
+// Whether a request of the given type may write data that a subsequent *flush*
+// request must persist.
+static bool kbdus_inverter_type_may_write_(u32 type)
+{
+    return type != KBDUS_ITEM_TYPE_READ && type != KBDUS_ITEM_TYPE_FLUSH
+        && type != KBDUS_ITEM_TYPE_ZONE_REPORT;
+}
+
+// Adds the time elapsed since the wrapper's timestamp to its copy time, and
+// resets the timestamp to `now_ns`.
+static void kbdus_inverter_wrapper_add_copy_time_(
+    struct kbdus_inverter_req_wrapper_ *wrapper, u64 now_ns)
+{
+    u64 copy_ns;
+
+    copy_ns = (u64)wrapper->copy_ns + (now_ns - wrapper->timestamp_ns);
+
+    wrapper->copy_ns      = (u32)min(copy_ns, (u64)U32_MAX);
+    wrapper->timestamp_ns = now_ns;
+}
+
 /* -------------------------------------------------------------------------- */
 
-// Must be called with `inverter->reqs_lock` held.
+// Must be called with `queue->lock` held, after completing
+// `queue->item_is_awaiting_get`.
+static void
+    kbdus_inverter_wake_up_pollers_(struct kbdus_inverter_queue_ *queue)
+{
+    // pollers are added to the wait queue before they take `queue->lock` to
+    // check for items, so they can't be missed here
+
+    if (waitqueue_active(&queue->item_is_awaiting_get_poll))
+        wake_up_interruptible(&queue->item_is_awaiting_get_poll);
+}
+
+// Must be called with `queue->lock` held.
 static void kbdus_inverter_wrapper_to_awaiting_get_(
-    struct kbdus_inverter *inverter,
+    struct kbdus_inverter_queue_ *queue,
     struct kbdus_inverter_req_wrapper_ *wrapper)
 {
 #if KBDUS_DEBUG
@@ -331,39 +603,156 @@ static void kbdus_inverter_wrapper_to_awaiting_get_(
         && wrapper->state != KBDUS_REQ_STATE_BEING_GOTTEN_);
 #endif
 
-    // put wrapper into "awaiting get" list
+    trace_kbdus_req_submit(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, wrapper->item.req,
+        wrapper->state != KBDUS_REQ_STATE_FREE_);
+
+    // a requeued flush request no longer persists the writes completed before
+    // it was gotten, as the driver may not have served it
+
+    if (queue->flush_in_flight == wrapper)
+        queue->flush_in_flight = NULL;
+
+    // put wrapper into "awaiting get" list (at the front if it was already
+    // gotten before, so that it is retried first)
+
+    switch (wrapper->state)
+    {
+    case KBDUS_REQ_STATE_FREE_:
+        list_add_tail(&wrapper->list, &queue->reqs_awaiting_get);
+        break;
+
+    case KBDUS_REQ_STATE_AWAITING_COMPLETION_:
+        list_move(&wrapper->list, &queue->reqs_awaiting_get);
+        break;
+
+    default:
+        list_add(&wrapper->list, &queue->reqs_awaiting_get);
+        break;
+    }
+
+    WRITE_ONCE(queue->num_awaiting_get, queue->num_awaiting_get + 1);
+
+    // start measuring the time spent awaiting get
 
     if (wrapper->state == KBDUS_REQ_STATE_FREE_)
-        list_move_tail(&wrapper->list, &inverter->reqs_awaiting_get);
-    else
-        list_add(&wrapper->list, &inverter->reqs_awaiting_get);
+        wrapper->copy_ns = 0;
+
+    wrapper->timestamp_ns = ktime_get_ns();
 
     // set wrapper state
 
     wrapper->state = KBDUS_REQ_STATE_AWAITING_GET_;
 
+    // let subsequent flush requests be merged into this one
+
+    if (wrapper->item.type == KBDUS_ITEM_TYPE_FLUSH
+        && !queue->flush_awaiting_get)
+    {
+        queue->flush_awaiting_get = wrapper;
+    }
+
     // notify single waiter that item is awaiting get
 
-    complete(&inverter->item_is_awaiting_get);
+    complete(&queue->item_is_awaiting_get);
+    kbdus_inverter_wake_up_pollers_(queue);
+}
+
+// Must be called with `queue->lock` held.
+//
+// Merges a *flush* request into another one that is awaiting get, or that the
+// driver has gotten if no request that may write data was completed since. The
+// latter either only starts being served after the former was submitted, or
+// already persists every write that the former must persist, so completing it
+// also satisfies the former.
+static void kbdus_inverter_wrapper_to_merged_(
+    struct kbdus_inverter_queue_ *queue,
+    struct kbdus_inverter_req_wrapper_ *wrapper,
+    struct kbdus_inverter_req_wrapper_ *target)
+{
+#if KBDUS_DEBUG
+    WARN_ON(wrapper->state != KBDUS_REQ_STATE_FREE_);
+    WARN_ON(
+        target->state != KBDUS_REQ_STATE_AWAITING_GET_
+        && target->state != KBDUS_REQ_STATE_BEING_GOTTEN_
+        && target->state != KBDUS_REQ_STATE_AWAITING_COMPLETION_
+        && target->state != KBDUS_REQ_STATE_BEING_COMPLETED_);
+    WARN_ON(wrapper->item.type != KBDUS_ITEM_TYPE_FLUSH);
+    WARN_ON(target->item.type != KBDUS_ITEM_TYPE_FLUSH);
+#endif
+
+    trace_kbdus_req_submit(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, wrapper->item.req, false);
+
+    trace_kbdus_req_merge(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, wrapper->item.req);
+
+    // add wrapper to the target's list of merged requests
+
+    wrapper->next_merged_index = target->next_merged_index;
+    target->next_merged_index  = wrapper->item.handle_index;
+
+    kbdus_inverter_type_stats_(queue, wrapper)->merges += 1;
+
+    // set wrapper state
+
+    wrapper->copy_ns      = 0;
+    wrapper->timestamp_ns = ktime_get_ns();
+
+    wrapper->state = KBDUS_REQ_STATE_MERGED_;
 }
 
-// Must be called with `inverter->reqs_lock` held.
+// Must be called with `queue->lock` held.
 static void kbdus_inverter_wrapper_to_being_gotten_(
-    struct kbdus_inverter *inverter,
+    struct kbdus_inverter_queue_ *queue,
     struct kbdus_inverter_req_wrapper_ *wrapper)
 {
+    u64 now_ns;
+
 #if KBDUS_DEBUG
     WARN_ON(wrapper->state != KBDUS_REQ_STATE_AWAITING_GET_);
 #endif
 
+    trace_kbdus_req_get(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, wrapper->item.req);
+
     list_del(&wrapper->list);
+    WRITE_ONCE(queue->num_awaiting_get, queue->num_awaiting_get - 1);
+
+    // the driver may start serving the request at any moment, after which
+    // flush requests can't be merged into it
+
+    if (queue->flush_awaiting_get == wrapper)
+        queue->flush_awaiting_get = NULL;
+
+    // ...but they can still be merged into it until a request that may write
+    // data completes, as the driver only starts serving it from now on
+
+    if (wrapper->item.type == KBDUS_ITEM_TYPE_FLUSH)
+    {
+        queue->flush_in_flight        = wrapper;
+        queue->flush_in_flight_writes = (u64)atomic64_read(
+            queue->writes_completed);
+    }
+
+    now_ns = ktime_get_ns();
+
+    kbdus_inverter_hist_add_(
+        kbdus_inverter_type_stats_(queue, wrapper)->queue_wait_hist,
+        now_ns - wrapper->timestamp_ns);
+
+    wrapper->timestamp_ns = now_ns;
 
     wrapper->state = KBDUS_REQ_STATE_BEING_GOTTEN_;
 }
 
-// Must be called with `inverter->reqs_lock` held.
+// Must be called with `queue->lock` held.
 static void kbdus_inverter_wrapper_to_awaiting_completion_(
-    struct kbdus_inverter *inverter,
+    struct kbdus_inverter_queue_ *queue,
     struct kbdus_inverter_req_wrapper_ *wrapper)
 {
 #if KBDUS_DEBUG
@@ -372,75 +761,177 @@ static void kbdus_inverter_wrapper_to_awaiting_completion_(
         && wrapper->state != KBDUS_REQ_STATE_BEING_COMPLETED_);
 #endif
 
+    trace_kbdus_req_serve(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, wrapper->item.req);
+
+    list_add_tail(&wrapper->list, &queue->reqs_awaiting_completion);
+
+    // the request's data was just copied (or failed to be), and the driver
+    // starts (or resumes) serving it
+
+    kbdus_inverter_wrapper_add_copy_time_(wrapper, ktime_get_ns());
+
     wrapper->state = KBDUS_REQ_STATE_AWAITING_COMPLETION_;
 }
 
-// Must be called with `inverter->reqs_lock` held.
+// Must be called with `queue->lock` held.
 static void kbdus_inverter_wrapper_to_being_completed_(
-    struct kbdus_inverter *inverter,
+    struct kbdus_inverter_queue_ *queue,
     struct kbdus_inverter_req_wrapper_ *wrapper)
 {
+    struct kbdus_inverter_req_type_stats_ *stats;
+    u64 now_ns;
+    u64 service_ns;
+
 #if KBDUS_DEBUG
     WARN_ON(wrapper->state != KBDUS_REQ_STATE_AWAITING_COMPLETION_);
 #endif
 
+    list_del(&wrapper->list);
+
+    now_ns     = ktime_get_ns();
+    service_ns = now_ns - wrapper->timestamp_ns;
+
+    stats = kbdus_inverter_type_stats_(queue, wrapper);
+
+    stats->service_ns += service_ns;
+    kbdus_inverter_hist_add_(stats->service_hist, service_ns);
+
+    wrapper->timestamp_ns = now_ns;
+
     wrapper->state = KBDUS_REQ_STATE_BEING_COMPLETED_;
 }
 
-// Must be called with `inverter->reqs_lock` held.
+// Must be called with `queue->lock` held.
 static void kbdus_inverter_wrapper_to_free_(
-    struct kbdus_inverter *inverter,
+    struct kbdus_inverter_queue_ *queue,
     struct kbdus_inverter_req_wrapper_ *wrapper, int neg_errno,
     int neg_errno_ioctl)
 {
+    struct request *req;
     struct kbdus_inverter_pdu *pdu;
+    struct kbdus_inverter_req_type_stats_ *stats;
+    u16 merged_index;
+    struct kbdus_inverter_req_wrapper_ *merged;
 
 #if KBDUS_DEBUG
     WARN_ON(
         wrapper->state != KBDUS_REQ_STATE_AWAITING_GET_
         && wrapper->state != KBDUS_REQ_STATE_BEING_GOTTEN_
         && wrapper->state != KBDUS_REQ_STATE_AWAITING_COMPLETION_
-        && wrapper->state != KBDUS_REQ_STATE_BEING_COMPLETED_);
+        && wrapper->state != KBDUS_REQ_STATE_BEING_COMPLETED_
+        && wrapper->state != KBDUS_REQ_STATE_MERGED_);
 #endif
 
+    req = wrapper->item.req;
+
+    // stop merging flush requests into this one, and detach those that were
+    // (before completing the request, after which the wrapper may be reused)
+
+    if (queue->flush_awaiting_get == wrapper)
+        queue->flush_awaiting_get = NULL;
+
+    if (queue->flush_in_flight == wrapper)
+        queue->flush_in_flight = NULL;
+
+    merged_index               = wrapper->next_merged_index;
+    wrapper->next_merged_index = 0;
+
+    // remove wrapper from list, if in one
+
+    if (wrapper->state == KBDUS_REQ_STATE_AWAITING_GET_)
+    {
+        list_del(&wrapper->list);
+        WRITE_ONCE(queue->num_awaiting_get, queue->num_awaiting_get - 1);
+    }
+    else if (wrapper->state == KBDUS_REQ_STATE_AWAITING_COMPLETION_)
+    {
+        list_del(&wrapper->list);
+    }
+
+    // update statistics (copy time is only known for requests whose reply
+    // was received)
+
+    stats = kbdus_inverter_type_stats_(queue, wrapper);
+
+    stats->requests += 1;
+    stats->bytes += blk_rq_bytes(req);
+
+    if (neg_errno == -ETIMEDOUT)
+        stats->timeouts += 1;
+    else if (neg_errno != 0)
+        stats->errors += 1;
+
+    if (wrapper->state == KBDUS_REQ_STATE_BEING_COMPLETED_)
+    {
+        kbdus_inverter_wrapper_add_copy_time_(wrapper, ktime_get_ns());
+        kbdus_inverter_hist_add_(stats->copy_hist, wrapper->copy_ns);
+    }
+
+    trace_kbdus_req_complete(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, req, neg_errno);
+
+    // increment wrapper seqnum and set wrapper state (before completing the
+    // request, as its tag and thus the wrapper may be reused as soon as it is
+    // completed)
+
+    wrapper->item.handle_seqnum += 1;
+    wrapper->state = KBDUS_REQ_STATE_FREE_;
+
+    // flush requests submitted from now on can't be merged into ones that the
+    // driver got before this request completed (the barrier orders this with
+    // the completion, after which such flush requests may be submitted)
+
+    if (kbdus_inverter_type_may_write_(wrapper->item.type))
+    {
+        atomic64_inc(queue->writes_completed);
+        smp_mb__after_atomic();
+    }
+
     // complete request
 
-    pdu = blk_mq_rq_to_pdu(wrapper->item.req);
+    pdu = blk_mq_rq_to_pdu(req);
 
     pdu->error       = neg_errno;
     pdu->error_ioctl = neg_errno_ioctl;
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 12, 0)
-    blk_mq_complete_request(wrapper->item.req);
+    blk_mq_complete_request(req);
 #elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
-    blk_mq_complete_request(wrapper->item.req, neg_errno);
+    blk_mq_complete_request(req, neg_errno);
 #else
-    wrapper->item.req->errors = neg_errno;
-    blk_mq_complete_request(wrapper->item.req);
+    req->errors = neg_errno;
+    blk_mq_complete_request(req);
 #endif
 
-    // increment wrapper seqnum
-
-    wrapper->item.handle_seqnum += 1;
-
-    // put wrapper into "awaiting get" list
+    // complete the flush requests that were merged into this one in the same
+    // way (they are detached from each other first, so this doesn't recurse
+    // any further)
 
-    if (wrapper->state == KBDUS_REQ_STATE_AWAITING_GET_)
-        list_move(&wrapper->list, &inverter->reqs_free);
-    else
-        list_add(&wrapper->list, &inverter->reqs_free);
+    while (merged_index != 0)
+    {
+        merged       = &queue->reqs_all[merged_index - 1];
+        merged_index = merged->next_merged_index;
 
-    // set wrapper state
+        merged->next_merged_index = 0;
 
-    wrapper->state = KBDUS_REQ_STATE_FREE_;
+        kbdus_inverter_wrapper_to_free_(
+            queue, merged, neg_errno, neg_errno_ioctl);
+    }
 }
 
-// Must be called with `inverter->reqs_lock` held.
+// Must be called with `queue->lock` held.
 static void kbdus_inverter_wrapper_cancel_due_to_termination_(
-    struct kbdus_inverter *inverter,
+    struct kbdus_inverter_queue_ *queue,
     struct kbdus_inverter_req_wrapper_ *wrapper)
 {
-    kbdus_inverter_wrapper_to_free_(inverter, wrapper, -EIO, -ENODEV);
+    trace_kbdus_req_cancel(
+        queue->dev_id, wrapper->item.handle_index, wrapper->item.handle_seqnum,
+        wrapper->item.type, wrapper->item.req);
+
+    kbdus_inverter_wrapper_to_free_(queue, wrapper, -EIO, -ENODEV);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -462,6 +953,7 @@ struct kbdus_inverter *
     kbdus_inverter_create(const struct kbdus_device_config *device_config)
 {
     struct kbdus_inverter *inverter;
+    struct kbdus_inverter_queue_ *queue;
     u32 i;
 
     // allocate inverter
@@ -471,6 +963,17 @@ struct kbdus_inverter *
     if (!inverter)
         return ERR_PTR(-ENOMEM);
 
+    // allocate queues
+
+    inverter->queues = kcalloc(
+        device_config->num_queues, sizeof(*inverter->queues), GFP_KERNEL);
+
+    if (!inverter->queues)
+    {
+        kfree(inverter);
+        return ERR_PTR(-ENOMEM);
+    }
+
     // allocate request wrappers
 
     inverter->reqs_all_unaligned =
@@ -478,12 +981,25 @@ struct kbdus_inverter *
 
     if (!inverter->reqs_all_unaligned)
     {
+        kfree(inverter->queues);
         kfree(inverter);
         return ERR_PTR(-ENOMEM);
     }
 
     inverter->reqs_all = PTR_ALIGN(inverter->reqs_all_unaligned, 64);
 
+    // allocate statistics (zero-filled)
+
+    inverter->stats = alloc_percpu(struct kbdus_inverter_stats_);
+
+    if (!inverter->stats)
+    {
+        kfree(inverter->reqs_all_unaligned);
+        kfree(inverter->queues);
+        kfree(inverter);
+        return ERR_PTR(-ENOMEM);
+    }
+
     // initialize inverter structure
 
     inverter->flags = 0;
@@ -517,23 +1033,46 @@ struct kbdus_inverter *
     if (device_config->supports_secure_erase)
         inverter->flags |= KBDUS_INVERTER_FLAG_SUPPORTS_SECURE_ERASE_;
 
+    if (device_config->zoned)
+        inverter->flags |= KBDUS_INVERTER_FLAG_ZONED_;
+
 #endif
 
-    inverter->num_reqs = device_config->max_outstanding_reqs;
+    atomic64_set(&inverter->writes_completed, 0);
+
+    inverter->num_reqs    = device_config->max_outstanding_reqs;
+    inverter->num_queues  = device_config->num_queues;
+    inverter->queue_depth = inverter->num_reqs / inverter->num_queues;
+
+    for (i = 0; i < inverter->num_queues; ++i)
+    {
+        queue = &inverter->queues[i];
+
+        spin_lock_init(&queue->lock);
+        queue->flags = 0;
 
-    INIT_LIST_HEAD(&inverter->reqs_free);
-    INIT_LIST_HEAD(&inverter->reqs_awaiting_get);
+        init_completion(&queue->item_is_awaiting_get);
+        init_waitqueue_head(&queue->item_is_awaiting_get_poll);
 
-    spin_lock_init(&inverter->reqs_lock);
-    init_completion(&inverter->item_is_awaiting_get);
+        INIT_LIST_HEAD(&queue->reqs_awaiting_get);
+        INIT_LIST_HEAD(&queue->reqs_awaiting_completion);
 
-    for (i = 0; i < device_config->max_outstanding_reqs; ++i)
+        queue->num_awaiting_get   = 0;
+        queue->flush_awaiting_get = NULL;
+        queue->flush_in_flight    = NULL;
+        queue->writes_completed   = &inverter->writes_completed;
+        queue->reqs_all           = inverter->reqs_all;
+        queue->stats              = inverter->stats;
+        queue->dev_id             = device_config->id;
+        queue->dispatch_policy    = device_config->dispatch_policy;
+    }
+
+    for (i = 0; i < inverter->num_reqs; ++i)
     {
         inverter->reqs_all[i].state              = KBDUS_REQ_STATE_FREE_;
+        inverter->reqs_all[i].queue_index        = 0;
         inverter->reqs_all[i].item.handle_index  = (u16)(i + 1);
         inverter->reqs_all[i].item.handle_seqnum = 0;
-
-        list_add_tail(&inverter->reqs_all[i].list, &inverter->reqs_free);
     }
 
     // success
@@ -543,225 +1082,366 @@ struct kbdus_inverter *
 
 void kbdus_inverter_destroy(struct kbdus_inverter *inverter)
 {
+    struct kbdus_inverter_queue_ *queue;
     u32 i;
 
     // perform some sanity checks
 
-    WARN_ON(!(inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_));
+    for (i = 0; i < inverter->num_queues; ++i)
+    {
+        queue = &inverter->queues[i];
+
+        WARN_ON(!(queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_));
 
-    WARN_ON(kbdus_list_length(&inverter->reqs_free) != inverter->num_reqs);
-    WARN_ON(!list_empty(&inverter->reqs_awaiting_get));
+        WARN_ON(!list_empty(&queue->reqs_awaiting_get));
+        WARN_ON(!list_empty(&queue->reqs_awaiting_completion));
+
+        WARN_ON(spin_is_locked(&queue->lock));
+    }
 
     for (i = 0; i < inverter->num_reqs; ++i)
         WARN_ON(inverter->reqs_all[i].state != KBDUS_REQ_STATE_FREE_);
 
-    WARN_ON(spin_is_locked(&inverter->reqs_lock));
-
     // free inverter structure
 
+    free_percpu(inverter->stats);
     kfree(inverter->reqs_all_unaligned);
+    kfree(inverter->queues);
     kfree(inverter);
 }
 
 void kbdus_inverter_terminate(struct kbdus_inverter *inverter)
 {
     u32 i;
+    struct kbdus_inverter_queue_ *queue;
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_req_wrapper_ *next;
 
-    spin_lock_irq(&inverter->reqs_lock);
-
-    if (!(inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_))
+    for (i = 0; i < inverter->num_queues; ++i)
     {
-        inverter->flags |= KBDUS_INVERTER_FLAG_TERMINATED_;
+        queue = &inverter->queues[i];
 
-        // fail requests awaiting get or awaiting completion
+        spin_lock_irq(&queue->lock);
 
-        for (i = 0; i < inverter->num_reqs; ++i)
+        if (!(queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_))
         {
-            wrapper = &inverter->reqs_all[i];
+            queue->flags |= KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_;
+
+            // fail requests awaiting get or awaiting completion
+
+            list_for_each_entry_safe(
+                wrapper, next, &queue->reqs_awaiting_get, list)
+            {
+                kbdus_inverter_wrapper_cancel_due_to_termination_(
+                    queue, wrapper);
+            }
 
-            if (wrapper->state == KBDUS_REQ_STATE_AWAITING_GET_
-                || wrapper->state == KBDUS_REQ_STATE_AWAITING_COMPLETION_)
+            list_for_each_entry_safe(
+                wrapper, next, &queue->reqs_awaiting_completion, list)
             {
                 kbdus_inverter_wrapper_cancel_due_to_termination_(
-                    inverter, wrapper);
+                    queue, wrapper);
             }
+
+            // notify waiters of infinite termination requests
+            complete_all(&queue->item_is_awaiting_get);
+            kbdus_inverter_wake_up_pollers_(queue);
         }
 
-        // notify waiters of infinite termination requests
-        complete_all(&inverter->item_is_awaiting_get);
+        spin_unlock_irq(&queue->lock);
     }
-
-    spin_unlock_irq(&inverter->reqs_lock);
 }
 
 void kbdus_inverter_deactivate(struct kbdus_inverter *inverter, bool flush)
 {
-    spin_lock_irq(&inverter->reqs_lock);
-
-    WARN_ON(inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_);
+    u32 i;
+    struct kbdus_inverter_queue_ *queue;
 
-    if (!(inverter->flags & KBDUS_INVERTER_FLAG_DEACTIVATED_))
+    for (i = 0; i < inverter->num_queues; ++i)
     {
-        inverter->flags |= KBDUS_INVERTER_FLAG_DEACTIVATED_;
+        queue = &inverter->queues[i];
 
-        if (flush && (inverter->flags & KBDUS_INVERTER_FLAG_SUPPORTS_FLUSH_))
-            inverter->flags |= KBDUS_INVERTER_FLAG_DEACTIVATED_NOT_FLUSHED_;
-    }
+        spin_lock_irq(&queue->lock);
+
+        WARN_ON(queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_);
+
+        if (!(queue->flags & KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_))
+        {
+            queue->flags |= KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_;
 
-    // notify waiters of infinite termination requests
-    complete_all(&inverter->item_is_awaiting_get);
+            // the flush request is only sent through the first queue
 
-    spin_unlock_irq(&inverter->reqs_lock);
+            if (flush && i == 0
+                && (inverter->flags & KBDUS_INVERTER_FLAG_SUPPORTS_FLUSH_))
+            {
+                queue->flags |=
+                    KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_NOT_FLUSHED_;
+            }
+        }
+
+        // notify waiters of infinite termination requests
+        complete_all(&queue->item_is_awaiting_get);
+        kbdus_inverter_wake_up_pollers_(queue);
+
+        spin_unlock_irq(&queue->lock);
+    }
 }
 
 void kbdus_inverter_activate(struct kbdus_inverter *inverter)
 {
     u32 i;
+    struct kbdus_inverter_queue_ *queue;
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_req_wrapper_ *next;
 
-    spin_lock_irq(&inverter->reqs_lock);
-
-    WARN_ON(inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_);
-
-    // test and clear "deactivated" flag
-
-    if (inverter->flags & KBDUS_INVERTER_FLAG_DEACTIVATED_)
+    for (i = 0; i < inverter->num_queues; ++i)
     {
-        inverter->flags &=
-            ~(KBDUS_INVERTER_FLAG_DEACTIVATED_
-              | KBDUS_INVERTER_FLAG_DEACTIVATED_NOT_FLUSHED_);
+        queue = &inverter->queues[i];
 
-        // reinitialize completion
+        spin_lock_irq(&queue->lock);
 
-        reinit_completion(&inverter->item_is_awaiting_get);
+        WARN_ON(queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_);
 
-        // move all requests with state AWAITING_COMPLETION back to AWAITING_GET
+        // test and clear "deactivated" flag
 
-        for (i = 0; i < inverter->num_reqs; ++i)
+        if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_)
         {
-            wrapper = &inverter->reqs_all[i];
+            queue->flags &=
+                ~(KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_
+                  | KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_NOT_FLUSHED_);
+
+            // reinitialize completion
+
+            reinit_completion(&queue->item_is_awaiting_get);
 
-            WARN_ON(
-                wrapper->state != KBDUS_REQ_STATE_FREE_
-                && wrapper->state != KBDUS_REQ_STATE_AWAITING_GET_
-                && wrapper->state != KBDUS_REQ_STATE_AWAITING_COMPLETION_);
+            // notify waiters of requests that were already awaiting get
 
-            switch (wrapper->state)
+            list_for_each_entry(wrapper, &queue->reqs_awaiting_get, list)
             {
-            case KBDUS_REQ_STATE_AWAITING_GET_:
-                complete(&inverter->item_is_awaiting_get);
-                break;
+                complete(&queue->item_is_awaiting_get);
+            }
+
+            // move all requests awaiting completion back to awaiting get
 
-            case KBDUS_REQ_STATE_AWAITING_COMPLETION_:
-                kbdus_inverter_wrapper_to_awaiting_get_(inverter, wrapper);
-                break;
+            list_for_each_entry_safe(
+                wrapper, next, &queue->reqs_awaiting_completion, list)
+            {
+                kbdus_inverter_wrapper_to_awaiting_get_(queue, wrapper);
             }
-        }
 
-        // notify waiters of "device available" request if appropriate
+            // notify waiters of "device available" request if appropriate
 
-        if (inverter->flags & KBDUS_INVERTER_FLAG_SEND_DEVICE_AVAILABLE_)
-            complete(&inverter->item_is_awaiting_get);
-    }
+            if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_SEND_DEVICE_AVAILABLE_)
+                complete(&queue->item_is_awaiting_get);
+
+            kbdus_inverter_wake_up_pollers_(queue);
+        }
 
-    // unlock request lock
+        // unlock queue lock
 
-    spin_unlock_irq(&inverter->reqs_lock);
+        spin_unlock_irq(&queue->lock);
+    }
 }
 
 void kbdus_inverter_submit_device_available_notification(
     struct kbdus_inverter *inverter)
 {
-    spin_lock_irq(&inverter->reqs_lock);
+    struct kbdus_inverter_queue_ *queue;
 
-    if (!(inverter->flags & KBDUS_INVERTER_FLAG_SEND_DEVICE_AVAILABLE_))
+    // the notification is only sent through the first queue
+
+    queue = &inverter->queues[0];
+
+    spin_lock_irq(&queue->lock);
+
+    if (!(queue->flags & KBDUS_INVERTER_QUEUE_FLAG_SEND_DEVICE_AVAILABLE_))
     {
-        inverter->flags |= KBDUS_INVERTER_FLAG_SEND_DEVICE_AVAILABLE_;
-        complete(&inverter->item_is_awaiting_get);
+        queue->flags |= KBDUS_INVERTER_QUEUE_FLAG_SEND_DEVICE_AVAILABLE_;
+        complete(&queue->item_is_awaiting_get);
+        kbdus_inverter_wake_up_pollers_(queue);
     }
 
-    spin_unlock_irq(&inverter->reqs_lock);
+    spin_unlock_irq(&queue->lock);
 }
 
-int kbdus_inverter_submit_request(
-    struct kbdus_inverter *inverter, struct request *req)
+// Must be called with `queue->lock` held.
+//
+// Returns the *flush* request in `queue` into which a *flush* request submitted
+// now may be merged, or NULL if there is none.
+static struct kbdus_inverter_req_wrapper_ *kbdus_inverter_flush_merge_target_(
+    struct kbdus_inverter *inverter, struct kbdus_inverter_queue_ *queue)
+{
+    if (queue->flush_awaiting_get)
+        return queue->flush_awaiting_get;
+
+    if (queue->flush_in_flight
+        && (u64)atomic64_read(&inverter->writes_completed)
+            == queue->flush_in_flight_writes)
+    {
+        return queue->flush_in_flight;
+    }
+
+    return NULL;
+}
+
+// Must be called with `queue->lock` held, and with `wrapper` initialized for a
+// *flush* request submitted to `queue`.
+//
+// Merges the request into another *flush* request and starts it, if there is a
+// suitable one, and returns whether it did so.
+//
+// blk-mq sends at most one *flush* request at a time through each hardware
+// queue, so other queues are also searched. Their locks are only tried, as
+// waiting for them while holding `queue->lock` could deadlock, and a merged
+// request moves to the queue of the request that it was merged into.
+static bool kbdus_inverter_merge_flush_(
+    struct kbdus_inverter *inverter, struct kbdus_inverter_queue_ *queue,
+    struct kbdus_inverter_req_wrapper_ *wrapper)
+{
+    struct kbdus_inverter_pdu *pdu;
+    struct kbdus_inverter_queue_ *target_queue;
+    struct kbdus_inverter_req_wrapper_ *target;
+    u32 i;
+
+    target_queue = queue;
+    target       = kbdus_inverter_flush_merge_target_(inverter, queue);
+
+    for (i = 0; !target && i < inverter->num_queues; ++i)
+    {
+        target_queue = &inverter->queues[i];
+
+        if (target_queue == queue || !spin_trylock(&target_queue->lock))
+            continue;
+
+        if (!(target_queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_))
+            target = kbdus_inverter_flush_merge_target_(inverter, target_queue);
+
+        if (!target)
+            spin_unlock(&target_queue->lock);
+    }
+
+    if (!target)
+        return false;
+
+    // the request must be started before the target's queue lock is released,
+    // after which it may be completed
+
+    WRITE_ONCE(
+        wrapper->queue_index, (u32)(target_queue - inverter->queues));
+
+    kbdus_inverter_wrapper_to_merged_(target_queue, wrapper, target);
+
+    pdu = blk_mq_rq_to_pdu(wrapper->item.req);
+
+    pdu->handle_index  = wrapper->item.handle_index;
+    pdu->handle_seqnum = wrapper->item.handle_seqnum;
+
+    blk_mq_start_request(wrapper->item.req);
+
+    if (target_queue != queue)
+        spin_unlock(&target_queue->lock);
+
+    return true;
+}
+
+int kbdus_inverter_submit_request(
+    struct kbdus_inverter *inverter, struct request *req, u32 hctx_index,
+    u32 queue_index)
 {
     struct kbdus_inverter_pdu *pdu;
     enum kbdus_item_type item_type;
+    struct kbdus_inverter_queue_ *queue;
     unsigned long flags;
     struct kbdus_inverter_req_wrapper_ *wrapper;
 
     pdu       = blk_mq_rq_to_pdu(req);
     item_type = kbdus_inverter_req_to_item_type_(req);
 
-    // lock request lock
+    // get request wrapper from hardware queue index and tag
 
-    spin_lock_irqsave(&inverter->reqs_lock, flags);
+#if KBDUS_DEBUG
+    WARN_ON(req->tag < 0 || (u32)req->tag >= inverter->queue_depth);
+#endif
 
-    // perform some sanity checks
+    wrapper =
+        &inverter->reqs_all[hctx_index * inverter->queue_depth + (u32)req->tag];
 
 #if KBDUS_DEBUG
-    WARN_ON(list_empty(&inverter->reqs_free));
+    WARN_ON(wrapper->state != KBDUS_REQ_STATE_FREE_);
 #endif
 
-    // fail request if inverter was terminated
+    // reject read, write, or ioctl if unsupported
 
-    if (inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_)
+    if (!kbdus_inverter_req_is_supported_(inverter, item_type))
     {
-        spin_unlock_irqrestore(&inverter->reqs_lock, flags);
-
         pdu->handle_index  = 0;
         pdu->handle_seqnum = 0;
 
-        pdu->error       = -EIO;
-        pdu->error_ioctl = -ENODEV;
+        pdu->error       = -EOPNOTSUPP;
+        pdu->error_ioctl = -ENOTTY;
 
-        return -EIO;
+        return -EOPNOTSUPP;
     }
 
-    // reject read, write, or ioctl if unsupported
+    // lock queue lock
 
-    if (!kbdus_inverter_req_is_supported_(inverter, item_type))
+    queue = &inverter->queues[queue_index];
+
+    spin_lock_irqsave(&queue->lock, flags);
+
+    // fail request if inverter was terminated
+
+    if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_)
     {
-        spin_unlock_irqrestore(&inverter->reqs_lock, flags);
+        spin_unlock_irqrestore(&queue->lock, flags);
 
         pdu->handle_index  = 0;
         pdu->handle_seqnum = 0;
 
-        pdu->error       = -EOPNOTSUPP;
-        pdu->error_ioctl = -ENOTTY;
+        pdu->error       = -EIO;
+        pdu->error_ioctl = -ENODEV;
 
-        return -EOPNOTSUPP;
+        return -EIO;
     }
 
-    // get free request wrapper
-
-    wrapper = list_first_entry(
-        &inverter->reqs_free, struct kbdus_inverter_req_wrapper_, list);
-
     // initialize request
 
     wrapper->item.type = item_type;
     wrapper->item.req  = req;
 
-    // set request state and move wrapper to appropriate list
+    // pairs with the READ_ONCE() in kbdus_inverter_lock_wrapper_queue_(), which
+    // reads this without holding this queue's lock
 
-    kbdus_inverter_wrapper_to_awaiting_get_(inverter, wrapper);
+    WRITE_ONCE(wrapper->queue_index, queue_index);
 
-    // start request
+    // merge flush requests into one that the driver has not yet started
+    // receiving or that already persists all writes completed so far, possibly
+    // in another queue
 
-    blk_mq_start_request(req);
+    if (item_type == KBDUS_ITEM_TYPE_FLUSH
+        && kbdus_inverter_merge_flush_(inverter, queue, wrapper))
+    {
+        spin_unlock_irqrestore(&queue->lock, flags);
+        return 0;
+    }
 
-    // unlock request lock
+    // set request state and move wrapper to appropriate list
 
-    spin_unlock_irqrestore(&inverter->reqs_lock, flags);
+    kbdus_inverter_wrapper_to_awaiting_get_(queue, wrapper);
 
     // return request handle
 
     pdu->handle_index  = wrapper->item.handle_index;
     pdu->handle_seqnum = wrapper->item.handle_seqnum;
 
+    // start request
+
+    blk_mq_start_request(req);
+
+    // unlock queue lock
+
+    spin_unlock_irqrestore(&queue->lock, flags);
+
     // success
 
     return 0;
@@ -772,6 +1452,7 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
 {
     struct kbdus_inverter_pdu *pdu;
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
     unsigned long flags;
     int ret;
 
@@ -782,13 +1463,13 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
     wrapper =
         kbdus_inverter_handle_index_to_wrapper_(inverter, pdu->handle_index);
 
-    // lock request lock
+    WARN_ON(!wrapper);
 
-    spin_lock_irqsave(&inverter->reqs_lock, flags);
+    // lock queue lock
 
-    // perform some sanity checks
+    queue = kbdus_inverter_lock_wrapper_queue_(inverter, wrapper, &flags);
 
-    WARN_ON(!wrapper);
+    // perform some sanity checks
 
     WARN_ON(
         wrapper->item.type != KBDUS_ITEM_TYPE_READ
@@ -800,7 +1481,13 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
         && wrapper->item.type != KBDUS_ITEM_TYPE_FLUSH
         && wrapper->item.type != KBDUS_ITEM_TYPE_DISCARD
         && wrapper->item.type != KBDUS_ITEM_TYPE_SECURE_ERASE
-        && wrapper->item.type != KBDUS_ITEM_TYPE_IOCTL);
+        && wrapper->item.type != KBDUS_ITEM_TYPE_IOCTL
+        && wrapper->item.type != KBDUS_ITEM_TYPE_ZONE_REPORT
+        && wrapper->item.type != KBDUS_ITEM_TYPE_ZONE_RESET
+        && wrapper->item.type != KBDUS_ITEM_TYPE_ZONE_OPEN
+        && wrapper->item.type != KBDUS_ITEM_TYPE_ZONE_CLOSE
+        && wrapper->item.type != KBDUS_ITEM_TYPE_ZONE_FINISH
+        && wrapper->item.type != KBDUS_ITEM_TYPE_ZONE_APPEND);
 
     if (wrapper->item.handle_seqnum != pdu->handle_seqnum)
     {
@@ -812,8 +1499,11 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
         {
         case KBDUS_REQ_STATE_BEING_GOTTEN_:
         case KBDUS_REQ_STATE_BEING_COMPLETED_:
+        case KBDUS_REQ_STATE_MERGED_:
 
-            // can't timeout requests in these states, restart timer
+            // can't timeout requests in these states (merged requests time out
+            // along with the request that they were merged into), restart
+            // timer
 
             ret = BLK_EH_RESET_TIMER;
 
@@ -822,8 +1512,12 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
         case KBDUS_REQ_STATE_AWAITING_GET_:
         case KBDUS_REQ_STATE_AWAITING_COMPLETION_:
 
+            trace_kbdus_req_timeout(
+                queue->dev_id, wrapper->item.handle_index,
+                wrapper->item.handle_seqnum, wrapper->item.type, req);
+
             kbdus_inverter_wrapper_to_free_(
-                inverter, wrapper, -ETIMEDOUT, -ETIMEDOUT);
+                queue, wrapper, -ETIMEDOUT, -ETIMEDOUT);
 
             ret = KBDUS_INVERTER_BLK_EH_DONE_;
 
@@ -839,9 +1533,9 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
         }
     }
 
-    // unlock request lock
+    // unlock queue lock
 
-    spin_unlock_irqrestore(&inverter->reqs_lock, flags);
+    spin_unlock_irqrestore(&queue->lock, flags);
 
     // return result
 
@@ -850,84 +1544,501 @@ enum blk_eh_timer_return kbdus_inverter_timeout_request(
 
 /* -------------------------------------------------------------------------- */
 
-const struct kbdus_inverter_item *
-    kbdus_inverter_begin_item_get(struct kbdus_inverter *inverter)
+// The number of priority levels within the *real-time* and *best-effort* I/O
+// priority classes.
+#define KBDUS_INVERTER_IOPRIO_LEVELS_ 8u
+
+// Requests with lower ranks are gotten first under the queue's dispatch policy.
+static u32 kbdus_inverter_dispatch_rank_(
+    const struct kbdus_inverter_queue_ *queue,
+    const struct kbdus_inverter_req_wrapper_ *wrapper)
+{
+    u16 ioprio;
+    u32 class_rank;
+    u32 level;
+
+    switch (queue->dispatch_policy)
+    {
+    case KBDUS_DISPATCH_POLICY_READS_FIRST:
+
+        return wrapper->item.type == KBDUS_ITEM_TYPE_READ ? 0 : 1;
+
+    case KBDUS_DISPATCH_POLICY_PRIORITY:
+
+        ioprio = wrapper->item.req->ioprio;
+
+        switch (IOPRIO_PRIO_CLASS(ioprio))
+        {
+        case IOPRIO_CLASS_RT:
+            class_rank = 0;
+            level      = IOPRIO_PRIO_DATA(ioprio);
+            break;
+
+        case IOPRIO_CLASS_BE:
+            class_rank = 1;
+            level      = IOPRIO_PRIO_DATA(ioprio);
+            break;
+
+        case IOPRIO_CLASS_IDLE:
+            class_rank = 2;
+            level      = 0;
+            break;
+
+        default:
+            class_rank = 1;
+            level      = IOPRIO_NORM;
+            break;
+        }
+
+        return class_rank * KBDUS_INVERTER_IOPRIO_LEVELS_
+            + min_t(u32, level, KBDUS_INVERTER_IOPRIO_LEVELS_ - 1);
+
+    default:
+
+        return 0;
+    }
+}
+
+// Chooses which request awaiting get in the given queue should be gotten next,
+// according to the queue's dispatch policy. The queue must have at least one
+// request awaiting get.
+//
+// Under policies other than `KBDUS_DISPATCH_POLICY_FIFO`, this scans the whole
+// "awaiting get" list, which holds at most `queue_depth` requests. Requests
+// that have awaited get for at least `KBDUS_DISPATCH_MAX_WAIT_NS` are gotten
+// first, oldest first, so that low-ranked requests are never starved. Ties are
+// broken by list order, so that requests requeued for retrying come first.
+//
+// Must be called with `queue->lock` held.
+static struct kbdus_inverter_req_wrapper_ *kbdus_inverter_pick_awaiting_get_(
+    struct kbdus_inverter_queue_ *queue)
 {
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_req_wrapper_ *best;
+    u64 now_ns;
+    u32 rank;
+    u32 best_rank;
+
+    best = list_first_entry(
+        &queue->reqs_awaiting_get, struct kbdus_inverter_req_wrapper_, list);
+
+    if (queue->dispatch_policy == KBDUS_DISPATCH_POLICY_FIFO)
+        return best;
+
+    now_ns    = ktime_get_ns();
+    best_rank = U32_MAX;
+
+    list_for_each_entry(wrapper, &queue->reqs_awaiting_get, list)
+    {
+        // rank 0 is reserved for requests that have waited for too long
+
+        if (now_ns - wrapper->timestamp_ns >= KBDUS_DISPATCH_MAX_WAIT_NS)
+            rank = 0;
+        else
+            rank = 1 + kbdus_inverter_dispatch_rank_(queue, wrapper);
+
+        if (rank < best_rank
+            || (rank == 0 && wrapper->timestamp_ns < best->timestamp_ns))
+        {
+            best      = wrapper;
+            best_rank = rank;
+        }
+    }
+
+    return best;
+}
+
+// Busy-waits for up to `busy_poll_us` microseconds for a request or
+// notification to become available in the given queue, without consuming it.
+// Stops early if the current task should yield the CPU or has a pending signal.
+static void kbdus_inverter_busy_poll_(
+    struct kbdus_inverter_queue_ *queue, u32 busy_poll_us)
+{
+    u64 deadline_ns;
+
+    if (completion_done(&queue->item_is_awaiting_get))
+        return; // nothing to wait for
+
+    deadline_ns = ktime_get_ns() + (u64)busy_poll_us * NSEC_PER_USEC;
+
+    while (!completion_done(&queue->item_is_awaiting_get))
+    {
+        if (need_resched() || signal_pending(current)
+            || ktime_get_ns() >= deadline_ns)
+        {
+            this_cpu_inc(queue->stats->busy_poll_misses);
+            return;
+        }
+
+        cpu_relax();
+    }
+
+    this_cpu_inc(queue->stats->busy_poll_hits);
+}
+
+const struct kbdus_inverter_item *kbdus_inverter_begin_item_get(
+    struct kbdus_inverter *inverter, u32 queue_index, long timeout,
+    u32 busy_poll_us)
+{
+    struct kbdus_inverter_queue_ *queue;
+    struct kbdus_inverter_req_wrapper_ *wrapper;
+    long ret;
+
+    queue = &inverter->queues[queue_index];
+
+    // busy-wait for a bit before sleeping, so that requests that arrive in
+    // quick succession don't each require waking us up
+
+    if (timeout != 0 && busy_poll_us > 0)
+        kbdus_inverter_busy_poll_(queue, busy_poll_us);
 
     while (true)
     {
-        // wait until a request is awaiting get (or until we are interrupted)
+        // wait until a request is awaiting get (or until we are interrupted or
+        // time out)
 
-        if (wait_for_completion_interruptible(&inverter->item_is_awaiting_get)
-            != 0)
+        if (timeout == 0)
         {
-            return ERR_PTR(-ERESTARTSYS);
+            if (!try_wait_for_completion(&queue->item_is_awaiting_get))
+                return ERR_PTR(-EAGAIN);
+        }
+        else
+        {
+            ret = wait_for_completion_interruptible_timeout(
+                &queue->item_is_awaiting_get, timeout);
+
+            if (ret < 0)
+                return ERR_PTR(-ERESTARTSYS);
+
+            if (ret == 0)
+                return ERR_PTR(-ETIMEDOUT);
+
+            // keep waiting for the remaining time if the request is canceled
+            // in the meantime
+
+            if (timeout != MAX_SCHEDULE_TIMEOUT)
+                timeout = ret;
         }
 
-        // lock request lock
+        // lock queue lock
 
-        spin_lock_irq(&inverter->reqs_lock);
+        spin_lock_irq(&queue->lock);
 
-        // check if request is a notification request
+        // check if request is a notification request (flush and "device
+        // available" notifications are only ever flagged on the first queue)
 
-        if (inverter->flags & KBDUS_INVERTER_FLAG_DEACTIVATED_NOT_FLUSHED_)
+        if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_NOT_FLUSHED_)
         {
-            inverter->flags &= ~KBDUS_INVERTER_FLAG_DEACTIVATED_NOT_FLUSHED_;
+            queue->flags &= ~KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_NOT_FLUSHED_;
 
-            spin_unlock_irq(&inverter->reqs_lock);
+            spin_unlock_irq(&queue->lock);
             return &kbdus_inverter_req_flush_terminate_;
         }
 
-        if (inverter->flags
-            & (KBDUS_INVERTER_FLAG_DEACTIVATED_
-               | KBDUS_INVERTER_FLAG_TERMINATED_))
+        if (queue->flags
+            & (KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_
+               | KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_))
         {
-            spin_unlock_irq(&inverter->reqs_lock);
+            spin_unlock_irq(&queue->lock);
             return &kbdus_inverter_req_terminate_;
         }
 
-        if (inverter->flags & KBDUS_INVERTER_FLAG_SEND_DEVICE_AVAILABLE_)
+        if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_SEND_DEVICE_AVAILABLE_)
         {
-            inverter->flags &= ~KBDUS_INVERTER_FLAG_SEND_DEVICE_AVAILABLE_;
+            queue->flags &= ~KBDUS_INVERTER_QUEUE_FLAG_SEND_DEVICE_AVAILABLE_;
 
-            spin_unlock_irq(&inverter->reqs_lock);
+            spin_unlock_irq(&queue->lock);
             return &kbdus_inverter_req_dev_available_;
         }
 
         // ensure request awaiting get exists (might have been canceled in the
         // meantime)
 
-        if (!list_empty(&inverter->reqs_awaiting_get))
+        if (!list_empty(&queue->reqs_awaiting_get))
             break;
 
-        // unlock request lock
+        // unlock queue lock
 
-        spin_unlock_irq(&inverter->reqs_lock);
+        spin_unlock_irq(&queue->lock);
     }
 
     // get request wrapper
 
-    wrapper = list_first_entry(
-        &inverter->reqs_awaiting_get, struct kbdus_inverter_req_wrapper_, list);
+    wrapper = kbdus_inverter_pick_awaiting_get_(queue);
 
     // advance request state
 
-    kbdus_inverter_wrapper_to_being_gotten_(inverter, wrapper);
+    kbdus_inverter_wrapper_to_being_gotten_(queue, wrapper);
 
-    // unlock request lock
+    // unlock queue lock
 
-    spin_unlock_irq(&inverter->reqs_lock);
+    spin_unlock_irq(&queue->lock);
 
     // return request
 
     return &wrapper->item;
 }
 
+const struct kbdus_inverter_item *kbdus_inverter_try_begin_item_get(
+    struct kbdus_inverter *inverter, u32 queue_index)
+{
+    struct kbdus_inverter_queue_ *queue;
+    struct kbdus_inverter_req_wrapper_ *wrapper;
+
+    queue = &inverter->queues[queue_index];
+
+    while (try_wait_for_completion(&queue->item_is_awaiting_get))
+    {
+        // lock queue lock
+
+        spin_lock_irq(&queue->lock);
+
+        // leave notifications to `kbdus_inverter_begin_item_get()`, giving back
+        // the completion that was consumed (every queue flag corresponds to
+        // some pending notification)
+
+        if (queue->flags != 0)
+        {
+            complete(&queue->item_is_awaiting_get);
+
+            spin_unlock_irq(&queue->lock);
+            return NULL;
+        }
+
+        // get request awaiting get if one exists (might have been canceled in
+        // the meantime)
+
+        if (!list_empty(&queue->reqs_awaiting_get))
+        {
+            wrapper = kbdus_inverter_pick_awaiting_get_(queue);
+
+            kbdus_inverter_wrapper_to_being_gotten_(queue, wrapper);
+
+            spin_unlock_irq(&queue->lock);
+            return &wrapper->item;
+        }
+
+        // unlock queue lock
+
+        spin_unlock_irq(&queue->lock);
+    }
+
+    return NULL;
+}
+
+u32 kbdus_inverter_num_awaiting_get(
+    struct kbdus_inverter *inverter, u32 queue_index)
+{
+    return READ_ONCE(inverter->queues[queue_index].num_awaiting_get);
+}
+
+// Sums the counter at `offset` within `struct kbdus_inverter_stats_` over all
+// CPUs.
+static u64
+    kbdus_inverter_sum_(struct kbdus_inverter *inverter, size_t offset)
+{
+    const char *cpu_stats;
+    u64 sum;
+    int cpu;
+
+    sum = 0;
+
+    for_each_possible_cpu(cpu)
+    {
+        cpu_stats = (const char *)per_cpu_ptr(inverter->stats, cpu);
+        sum += READ_ONCE(*(const u64 *)(cpu_stats + offset));
+    }
+
+    return sum;
+}
+
+static u64 kbdus_inverter_sum_stat_(
+    struct kbdus_inverter *inverter, size_t type_index, size_t offset)
+{
+    return kbdus_inverter_sum_(
+        inverter,
+        offsetof(struct kbdus_inverter_stats_, types)
+            + type_index * sizeof(struct kbdus_inverter_req_type_stats_)
+            + offset);
+}
+
+static void kbdus_inverter_show_hist_(
+    struct kbdus_inverter *inverter, struct seq_file *s, const char *type_name,
+    size_t type_index, const char *hist_name, size_t hist_offset)
+{
+    size_t i;
+
+    seq_printf(s, "%s %s", type_name, hist_name);
+
+    for (i = 0; i < KBDUS_INVERTER_HIST_BUCKETS_; ++i)
+    {
+        seq_printf(
+            s, " %llu",
+            (unsigned long long)kbdus_inverter_sum_stat_(
+                inverter, type_index, hist_offset + i * sizeof(u64)));
+    }
+
+    seq_putc(s, '\n');
+}
+
+void kbdus_inverter_show_stats(
+    struct kbdus_inverter *inverter, struct seq_file *s)
+{
+    static const char *const type_names[KBDUS_INVERTER_NUM_REQ_TYPES_] = {
+        "read",
+        "write",
+        "write_same",
+        "write_zeros_no_unmap",
+        "write_zeros_may_unmap",
+        "fua_write",
+        "flush",
+        "discard",
+        "secure_erase",
+        "ioctl",
+        "zone_report",
+        "zone_reset",
+        "zone_open",
+        "zone_close",
+        "zone_finish",
+        "zone_append",
+    };
+
+    const char *name;
+    size_t i;
+
+    for (i = 0; i < KBDUS_INVERTER_NUM_REQ_TYPES_; ++i)
+    {
+        name = type_names[i];
+
+#define KBDUS_INVERTER_SHOW_COUNTER_(field)                                    \
+    seq_printf(                                                                \
+        s, "%s %s %llu\n", name, #field,                                       \
+        (unsigned long long)kbdus_inverter_sum_stat_(                          \
+            inverter, i,                                                       \
+            offsetof(struct kbdus_inverter_req_type_stats_, field)))
+
+#define KBDUS_INVERTER_SHOW_HIST_(field)                                       \
+    kbdus_inverter_show_hist_(                                                 \
+        inverter, s, name, i, #field,                                          \
+        offsetof(struct kbdus_inverter_req_type_stats_, field))
+
+        KBDUS_INVERTER_SHOW_COUNTER_(requests);
+        KBDUS_INVERTER_SHOW_COUNTER_(bytes);
+        KBDUS_INVERTER_SHOW_COUNTER_(errors);
+        KBDUS_INVERTER_SHOW_COUNTER_(timeouts);
+        KBDUS_INVERTER_SHOW_COUNTER_(merges);
+        KBDUS_INVERTER_SHOW_COUNTER_(mapped);
+        KBDUS_INVERTER_SHOW_COUNTER_(spliced);
+
+        KBDUS_INVERTER_SHOW_HIST_(queue_wait_hist);
+        KBDUS_INVERTER_SHOW_HIST_(service_hist);
+        KBDUS_INVERTER_SHOW_HIST_(copy_hist);
+
+#undef KBDUS_INVERTER_SHOW_HIST_
+#undef KBDUS_INVERTER_SHOW_COUNTER_
+    }
+
+    seq_printf(
+        s, "busy_poll hits %llu\n",
+        (unsigned long long)kbdus_inverter_sum_(
+            inverter, offsetof(struct kbdus_inverter_stats_, busy_poll_hits)));
+
+    seq_printf(
+        s, "busy_poll misses %llu\n",
+        (unsigned long long)kbdus_inverter_sum_(
+            inverter,
+            offsetof(struct kbdus_inverter_stats_, busy_poll_misses)));
+}
+
+void kbdus_inverter_get_stats(
+    struct kbdus_inverter *inverter, struct kbdus_device_stats *stats)
+{
+    const struct kbdus_inverter_req_type_stats_ *cpu_stats;
+    struct kbdus_request_stats *type_stats;
+    u32 state;
+    size_t i;
+    size_t j;
+    int cpu;
+
+    BUILD_BUG_ON(KBDUS_STATS_HIST_BUCKETS != KBDUS_INVERTER_HIST_BUCKETS_);
+    BUILD_BUG_ON(KBDUS_STATS_NUM_REQ_TYPES > KBDUS_INVERTER_NUM_REQ_TYPES_);
+
+    stats->timestamp_ns = ktime_get_ns();
+
+    // count requests awaiting get and requests being served by the driver
+
+    for (i = 0; i < inverter->num_queues; ++i)
+        stats->num_awaiting_get += kbdus_inverter_num_awaiting_get(inverter, i);
+
+    for (i = 0; i < inverter->num_reqs; ++i)
+    {
+        state = READ_ONCE(inverter->reqs_all[i].state);
+
+        if (state == KBDUS_REQ_STATE_BEING_GOTTEN_
+            || state == KBDUS_REQ_STATE_AWAITING_COMPLETION_
+            || state == KBDUS_REQ_STATE_BEING_COMPLETED_)
+        {
+            stats->num_in_flight += 1;
+        }
+    }
+
+    // sum per-CPU statistics
+
+    for_each_possible_cpu(cpu)
+    {
+        for (i = 0; i < KBDUS_STATS_NUM_REQ_TYPES; ++i)
+        {
+            cpu_stats  = &per_cpu_ptr(inverter->stats, cpu)->types[i];
+            type_stats = &stats->types[i];
+
+            type_stats->requests += READ_ONCE(cpu_stats->requests);
+            type_stats->bytes += READ_ONCE(cpu_stats->bytes);
+            type_stats->errors += READ_ONCE(cpu_stats->errors);
+            type_stats->timeouts += READ_ONCE(cpu_stats->timeouts);
+            type_stats->merges += READ_ONCE(cpu_stats->merges);
+            type_stats->service_ns += READ_ONCE(cpu_stats->service_ns);
+
+            for (j = 0; j < KBDUS_INVERTER_HIST_BUCKETS_; ++j)
+            {
+                type_stats->queue_wait_hist[j] +=
+                    READ_ONCE(cpu_stats->queue_wait_hist[j]);
+                type_stats->service_hist[j] +=
+                    READ_ONCE(cpu_stats->service_hist[j]);
+                type_stats->copy_hist[j] += READ_ONCE(cpu_stats->copy_hist[j]);
+            }
+        }
+    }
+}
+
+bool kbdus_inverter_poll(
+    struct kbdus_inverter *inverter, struct file *filp, poll_table *wait)
+{
+    struct kbdus_inverter_queue_ *queue;
+    bool awaiting_get;
+    u32 i;
+
+    awaiting_get = false;
+
+    for (i = 0; i < inverter->num_queues; ++i)
+    {
+        queue = &inverter->queues[i];
+
+        poll_wait(filp, &queue->item_is_awaiting_get_poll, wait);
+
+        spin_lock_irq(&queue->lock);
+        awaiting_get = awaiting_get
+            || completion_done(&queue->item_is_awaiting_get);
+        spin_unlock_irq(&queue->lock);
+    }
+
+    return awaiting_get;
+}
+
 void kbdus_inverter_commit_item_get(
     struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item)
 {
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
 
     switch (item->type)
     {
@@ -939,13 +2050,14 @@ void kbdus_inverter_commit_item_get(
 
     default:
 
-        // get request wrapper
+        // get request wrapper and its queue
 
         wrapper = container_of(item, struct kbdus_inverter_req_wrapper_, item);
+        queue   = &inverter->queues[wrapper->queue_index];
 
-        // lock request lock
+        // lock queue lock
 
-        spin_lock_irq(&inverter->reqs_lock);
+        spin_lock_irq(&queue->lock);
 
         // perform some sanity checks
 
@@ -955,19 +2067,14 @@ void kbdus_inverter_commit_item_get(
 
         // advance request state
 
-        if (inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_)
-        {
-            kbdus_inverter_wrapper_cancel_due_to_termination_(
-                inverter, wrapper);
-        }
+        if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_)
+            kbdus_inverter_wrapper_cancel_due_to_termination_(queue, wrapper);
         else
-        {
-            kbdus_inverter_wrapper_to_awaiting_completion_(inverter, wrapper);
-        }
+            kbdus_inverter_wrapper_to_awaiting_completion_(queue, wrapper);
 
-        // unlock request lock
+        // unlock queue lock
 
-        spin_unlock_irq(&inverter->reqs_lock);
+        spin_unlock_irq(&queue->lock);
 
         break;
     }
@@ -977,6 +2084,7 @@ void kbdus_inverter_abort_item_get(
     struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item)
 {
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
 
     switch (item->type)
     {
@@ -993,18 +2101,27 @@ void kbdus_inverter_abort_item_get(
         break;
 
     case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
-        inverter->flags |= KBDUS_INVERTER_FLAG_DEACTIVATED_NOT_FLUSHED_;
+
+        // resubmit "flush and terminate" request (always on the first queue)
+
+        queue = &inverter->queues[0];
+
+        spin_lock_irq(&queue->lock);
+        queue->flags |= KBDUS_INVERTER_QUEUE_FLAG_DEACTIVATED_NOT_FLUSHED_;
+        spin_unlock_irq(&queue->lock);
+
         break;
 
     default:
 
-        // get request wrapper
+        // get request wrapper and its queue
 
         wrapper = container_of(item, struct kbdus_inverter_req_wrapper_, item);
+        queue   = &inverter->queues[wrapper->queue_index];
 
-        // lock request lock
+        // lock queue lock
 
-        spin_lock_irq(&inverter->reqs_lock);
+        spin_lock_irq(&queue->lock);
 
         // perform some sanity checks
 
@@ -1014,29 +2131,28 @@ void kbdus_inverter_abort_item_get(
 
         // advance request state
 
-        if (inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_)
-        {
-            kbdus_inverter_wrapper_cancel_due_to_termination_(
-                inverter, wrapper);
-        }
+        if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_)
+            kbdus_inverter_wrapper_cancel_due_to_termination_(queue, wrapper);
         else
-        {
-            kbdus_inverter_wrapper_to_awaiting_get_(inverter, wrapper);
-        }
+            kbdus_inverter_wrapper_to_awaiting_get_(queue, wrapper);
 
-        // unlock request lock
+        // unlock queue lock
 
-        spin_unlock_irq(&inverter->reqs_lock);
+        spin_unlock_irq(&queue->lock);
 
         break;
     }
 }
 
-const struct kbdus_inverter_item *kbdus_inverter_begin_item_completion(
+// If `transfer` is true, the request is only being transferred (see
+// kbdus_inverter_begin_item_transfer()), so its service time is not recorded.
+static const struct kbdus_inverter_item *kbdus_inverter_begin_item_completion_(
     struct kbdus_inverter *inverter, u16 request_handle_index,
-    u64 request_handle_seqnum)
+    u64 request_handle_seqnum, bool transfer)
 {
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
+    unsigned long flags;
 
     // get wrapper and ensure that handle index is valid
 
@@ -1046,15 +2162,15 @@ const struct kbdus_inverter_item *kbdus_inverter_begin_item_completion(
     if (!wrapper)
         return ERR_PTR(-EINVAL);
 
-    // lock request lock
+    // lock queue lock
 
-    spin_lock_irq(&inverter->reqs_lock);
+    queue = kbdus_inverter_lock_wrapper_queue_(inverter, wrapper, &flags);
 
     // ensure that handle seqnum matches
 
     if (wrapper->item.handle_seqnum != request_handle_seqnum)
     {
-        spin_unlock_irq(&inverter->reqs_lock);
+        spin_unlock_irqrestore(&queue->lock, flags);
         return NULL;
     }
 
@@ -1062,37 +2178,63 @@ const struct kbdus_inverter_item *kbdus_inverter_begin_item_completion(
 
     if (wrapper->state != KBDUS_REQ_STATE_AWAITING_COMPLETION_)
     {
-        spin_unlock_irq(&inverter->reqs_lock);
+        spin_unlock_irqrestore(&queue->lock, flags);
         return ERR_PTR(-EINVAL);
     }
 
     // advance request state
 
-    kbdus_inverter_wrapper_to_being_completed_(inverter, wrapper);
+    if (transfer)
+    {
+        list_del(&wrapper->list);
+        wrapper->state = KBDUS_REQ_STATE_BEING_COMPLETED_;
+    }
+    else
+    {
+        kbdus_inverter_wrapper_to_being_completed_(queue, wrapper);
+    }
 
-    // unlock request lock
+    // unlock queue lock
 
-    spin_unlock_irq(&inverter->reqs_lock);
+    spin_unlock_irqrestore(&queue->lock, flags);
 
     // return request
 
     return &wrapper->item;
 }
 
+const struct kbdus_inverter_item *kbdus_inverter_begin_item_completion(
+    struct kbdus_inverter *inverter, u16 request_handle_index,
+    u64 request_handle_seqnum)
+{
+    return kbdus_inverter_begin_item_completion_(
+        inverter, request_handle_index, request_handle_seqnum, false);
+}
+
+const struct kbdus_inverter_item *kbdus_inverter_begin_item_transfer(
+    struct kbdus_inverter *inverter, u16 request_handle_index,
+    u64 request_handle_seqnum)
+{
+    return kbdus_inverter_begin_item_completion_(
+        inverter, request_handle_index, request_handle_seqnum, true);
+}
+
 void kbdus_inverter_commit_item_completion(
     struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item,
     int neg_errno)
 {
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
     int neg_errno_ioctl;
 
-    // get request wrapper
+    // get request wrapper and its queue
 
     wrapper = container_of(item, struct kbdus_inverter_req_wrapper_, item);
+    queue   = &inverter->queues[wrapper->queue_index];
 
-    // lock request lock
+    // lock queue lock
 
-    spin_lock_irq(&inverter->reqs_lock);
+    spin_lock_irq(&queue->lock);
 
     // perform some sanity checks
 
@@ -1106,9 +2248,9 @@ void kbdus_inverter_commit_item_completion(
 
     // advance item state
 
-    if (inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_)
+    if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_)
     {
-        kbdus_inverter_wrapper_cancel_due_to_termination_(inverter, wrapper);
+        kbdus_inverter_wrapper_cancel_due_to_termination_(queue, wrapper);
     }
     else
     {
@@ -1129,26 +2271,48 @@ void kbdus_inverter_commit_item_completion(
         }
 
         kbdus_inverter_wrapper_to_free_(
-            inverter, wrapper, neg_errno, neg_errno_ioctl);
+            queue, wrapper, neg_errno, neg_errno_ioctl);
     }
 
-    // unlock request lock
+    // unlock queue lock
 
-    spin_unlock_irq(&inverter->reqs_lock);
+    spin_unlock_irq(&queue->lock);
+}
+
+void kbdus_inverter_count_item_transfer(
+    struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item,
+    enum kbdus_inverter_transfer transfer)
+{
+    struct kbdus_inverter_req_type_stats_ __percpu *stats;
+
+    stats = &inverter->stats->types[item->type - KBDUS_ITEM_TYPE_READ];
+
+    switch (transfer)
+    {
+    case KBDUS_INVERTER_TRANSFER_MAPPED:
+        this_cpu_inc(stats->mapped);
+        break;
+
+    case KBDUS_INVERTER_TRANSFER_SPLICED:
+        this_cpu_inc(stats->spliced);
+        break;
+    }
 }
 
 void kbdus_inverter_abort_item_completion(
     struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item)
 {
     struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
 
-    // get request wrapper
+    // get request wrapper and its queue
 
     wrapper = container_of(item, struct kbdus_inverter_req_wrapper_, item);
+    queue   = &inverter->queues[wrapper->queue_index];
 
-    // lock request lock
+    // lock queue lock
 
-    spin_lock_irq(&inverter->reqs_lock);
+    spin_lock_irq(&queue->lock);
 
     // perform some sanity checks
 
@@ -1162,14 +2326,53 @@ void kbdus_inverter_abort_item_completion(
 
     // advance request state
 
-    if (inverter->flags & KBDUS_INVERTER_FLAG_TERMINATED_)
-        kbdus_inverter_wrapper_cancel_due_to_termination_(inverter, wrapper);
+    if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_)
+        kbdus_inverter_wrapper_cancel_due_to_termination_(queue, wrapper);
     else
-        kbdus_inverter_wrapper_to_awaiting_completion_(inverter, wrapper);
+        kbdus_inverter_wrapper_to_awaiting_completion_(queue, wrapper);
+
+    // unlock queue lock
+
+    spin_unlock_irq(&queue->lock);
+}
+
+void kbdus_inverter_end_item_transfer(
+    struct kbdus_inverter *inverter, const struct kbdus_inverter_item *item)
+{
+    struct kbdus_inverter_req_wrapper_ *wrapper;
+    struct kbdus_inverter_queue_ *queue;
+
+    // get request wrapper and its queue
+
+    wrapper = container_of(item, struct kbdus_inverter_req_wrapper_, item);
+    queue   = &inverter->queues[wrapper->queue_index];
+
+    // lock queue lock
+
+    spin_lock_irq(&queue->lock);
+
+    // perform some sanity checks
+
+#if KBDUS_DEBUG
+    WARN_ON(wrapper->state != KBDUS_REQ_STATE_BEING_COMPLETED_);
+#endif
+
+    // advance request state (without recording anything, as the driver is
+    // still serving the request)
+
+    if (queue->flags & KBDUS_INVERTER_QUEUE_FLAG_TERMINATED_)
+    {
+        kbdus_inverter_wrapper_cancel_due_to_termination_(queue, wrapper);
+    }
+    else
+    {
+        list_add_tail(&wrapper->list, &queue->reqs_awaiting_completion);
+        wrapper->state = KBDUS_REQ_STATE_AWAITING_COMPLETION_;
+    }
 
-    // unlock request lock
+    // unlock queue lock
 
-    spin_unlock_irq(&inverter->reqs_lock);
+    spin_unlock_irq(&queue->lock);
 }
 
 /* -------------------------------------------------------------------------- */
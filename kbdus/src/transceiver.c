@@ -3,6 +3,7 @@
 
 #include <kbdus.h>
 #include <kbdus/config.h>
+#include <kbdus/device.h>
 #include <kbdus/inverter.h>
 #include <kbdus/transceiver.h>
 #include <kbdus/utilities.h>
@@ -11,13 +12,21 @@
 #include <linux/blkdev.h>
 #include <linux/err.h>
 #include <linux/errno.h>
+#include <linux/file.h>
+#include <linux/fs.h>
 #include <linux/init.h>
 #include <linux/ioctl.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/nodemask.h>
+#include <linux/numa.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
 #include <linux/stddef.h>
 #include <linux/string.h>
 #include <linux/types.h>
+#include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
@@ -28,11 +37,19 @@
 
 /* -------------------------------------------------------------------------- */
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 18, 0)
+#define KBDUS_TRANSCEIVER_SUPPORTS_ZERO_COPY_ 1
+#endif
+
+/* -------------------------------------------------------------------------- */
+
 int __init kbdus_transceiver_init(void)
 {
     BUILD_BUG_ON(sizeof(struct kbdus_item) != 64);
     BUILD_BUG_ON(sizeof(struct kbdus_reply) != 64);
     BUILD_BUG_ON(sizeof(union kbdus_reply_or_item) != 64);
+    BUILD_BUG_ON(sizeof(struct kbdus_batch) != 32);
+    BUILD_BUG_ON(sizeof(struct kbdus_chunk) != 32);
 
     return 0;
 }
@@ -43,26 +60,79 @@ void kbdus_transceiver_exit(void)
 
 /* -------------------------------------------------------------------------- */
 
+// The payload window of a preallocated buffer (see `struct
+// kbdus_fd_config.zero_copy`).
+struct kbdus_transceiver_window_
+{
+    // protects the fields below against page faults and misbehaving clients
+    struct mutex lock;
+
+    // the handle of the request whose pages are mapped, if num_pages > 0
+    u64 handle_seqnum;
+    u16 handle_index;
+
+    // whether the mapped pages may be written by the driver, i.e., whether the
+    // request is a *read* request (the pages of other requests hold the
+    // client's data, and are only inserted into mappings that can never be
+    // made writable)
+    bool writable;
+
+    // the mapped pages, each of which holds a reference
+    u32 num_pages;
+    struct page **pages;
+};
+
 struct kbdus_transceiver
 {
     struct kbdus_inverter *inverter;
 
+    u32 num_queues;
+    u32 busy_poll_us;
+    u16 max_discard_ranges;
+
+    // 0 if the device is not zoned
+    u64 zone_size;
+
+    // 0 if request data is always transferred at once
+    u32 chunk_size;
+
     u32 num_rais;
     u32 num_preallocated_buffers;
     size_t preallocated_buffer_size;
 
     void *shared_memory;
     void *preallocated_buffers_start;
+
+    // NULL if `shared_memory` was allocated with vmalloc_user(), otherwise the
+    // pages it is made of, each allocated on the NUMA node of the hardware
+    // queue that it is used with
+    struct page **shared_pages;
+    size_t shared_num_pages;
+
+    // NULL if zero-copy is disabled
+    struct kbdus_transceiver_window_ *windows;
+    bool scatter_gather;
+    struct page **window_pages;
+
+    // set when payload windows are first mapped, and only shared by mappings of
+    // the same file description (see kbdus_control_open_())
+    struct address_space *window_mapping;
 };
 
 /* -------------------------------------------------------------------------- */
 
+// Returns the size of the largest payload that a buffer may have to hold,
+// which for *read*, *write*, and *FUA write* requests is at most `chunk_size`
+// if it is positive.
 static size_t kbdus_transceiver_get_max_request_size_(
-    const struct kbdus_device_config *device_config)
+    const struct kbdus_device_config *device_config, u32 chunk_size)
 {
     size_t size;
 
-    size = (size_t)device_config->max_read_write_size;
+    if (chunk_size > 0)
+        size = (size_t)min(device_config->max_read_write_size, chunk_size);
+    else
+        size = (size_t)device_config->max_read_write_size;
 
     if (device_config->supports_write_same)
         size = max(size, (size_t)device_config->logical_block_size);
@@ -70,9 +140,87 @@ static size_t kbdus_transceiver_get_max_request_size_(
     if (device_config->supports_ioctl)
         size = max(size, (size_t)1 << 14);
 
+    if (device_config->max_discard_ranges > 1)
+    {
+        size = max(
+            size, (size_t)device_config->max_discard_ranges
+                      * sizeof(struct kbdus_range));
+    }
+
+    if (device_config->zoned)
+    {
+        size = max(size, (size_t)device_config->max_zone_append_size);
+        size = max(
+            size,
+            (size_t)KBDUS_MAX_ZONES_PER_REPORT * sizeof(struct kbdus_zone));
+    }
+
     return size;
 }
 
+// Gets the next region targeted by a *discard* request, merging the regions of
+// contiguous bios, and advances `*bio` past them. Returns false if there are no
+// more regions, i.e., if `*bio` is NULL.
+static bool kbdus_transceiver_next_discard_range_(
+    struct bio **bio, struct kbdus_range *range)
+{
+    if (!*bio)
+        return false;
+
+    memset(range, 0, sizeof(*range));
+    range->offset = 512ull * (u64)(*bio)->bi_iter.bi_sector;
+
+    do
+    {
+        range->size += (*bio)->bi_iter.bi_size;
+        *bio = (*bio)->bi_next;
+    } while (*bio
+             && 512ull * (u64)(*bio)->bi_iter.bi_sector
+                 == range->offset + range->size);
+
+    return true;
+}
+
+// Returns the `enum kbdus_item_op_flag` flags describing how `req` was issued.
+static u8 kbdus_transceiver_req_op_flags_(struct request *req)
+{
+    u8 flags;
+
+    flags = 0;
+
+    if (rq_is_sync(req))
+        flags |= KBDUS_ITEM_OP_FLAG_SYNC;
+
+    if (req->cmd_flags & REQ_META)
+        flags |= KBDUS_ITEM_OP_FLAG_META;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
+    if (req->cmd_flags & REQ_BACKGROUND)
+        flags |= KBDUS_ITEM_OP_FLAG_BACKGROUND;
+#endif
+
+    return flags;
+}
+
+// Whether the data of the given request is transferred in chunks (see `struct
+// kbdus_fd_config.chunk_size`).
+static bool kbdus_transceiver_req_is_chunked_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_inverter_item *inverter_item)
+{
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        return transceiver->chunk_size > 0
+            && blk_rq_bytes(inverter_item->req) > transceiver->chunk_size;
+
+    default:
+        return false;
+    }
+}
+
 // Returns NULL if invalid rai_index.
 static union kbdus_reply_or_item *kbdus_transceiver_get_rai_(
     const struct kbdus_transceiver *transceiver, u64 rai_index)
@@ -96,406 +244,1693 @@ static void *kbdus_transceiver_get_preallocated_buffer_(
 
 /* -------------------------------------------------------------------------- */
 
-static int kbdus_transceiver_copy_req_to_item_and_user_buffer_(
-    const struct kbdus_transceiver *transceiver,
-    const struct kbdus_inverter_item *inverter_item, struct kbdus_item *item)
+// Returns NULL if zero-copy is disabled or invalid preallocated_buffer_index.
+static struct kbdus_transceiver_window_ *kbdus_transceiver_get_window_(
+    const struct kbdus_transceiver *transceiver, u64 preallocated_buffer_index)
 {
-    void __user *payload_buffer_usrptr;
-    struct bio_vec bvec;
-    struct req_iterator req_iter;
-    void *bvec_mapped_page;
-    int ret;
-    struct kbdus_inverter_pdu *pdu;
-
-    payload_buffer_usrptr = (void __user *)item->user_ptr_or_buffer_index;
-
-    switch (inverter_item->type)
+    if (!transceiver->windows
+        || preallocated_buffer_index
+            >= (u64)transceiver->num_preallocated_buffers)
     {
-    case KBDUS_ITEM_TYPE_WRITE:
-    case KBDUS_ITEM_TYPE_WRITE_SAME:
-    case KBDUS_ITEM_TYPE_FUA_WRITE:
-
-        if (!kbdus_access_ok(
-                KBDUS_VERIFY_WRITE, payload_buffer_usrptr,
-                (size_t)blk_rq_bytes(inverter_item->req)))
-        {
-            return -EFAULT;
-        }
-
-        rq_for_each_segment(bvec, inverter_item->req, req_iter)
-        {
-            bvec_mapped_page = kmap(bvec.bv_page);
+        return NULL;
+    }
 
-            ret = __copy_to_user(
-                payload_buffer_usrptr, bvec_mapped_page + bvec.bv_offset,
-                bvec.bv_len);
+    return &transceiver->windows[preallocated_buffer_index];
+}
 
-            kunmap(bvec_mapped_page);
+// Must be called with the window's lock held.
+static void kbdus_transceiver_clear_window_(
+    const struct kbdus_transceiver *transceiver,
+    struct kbdus_transceiver_window_ *window, u64 preallocated_buffer_index)
+{
+    struct address_space *mapping;
+    u32 i;
 
-            if (ret != 0)
-                return -EFAULT;
+    if (window->num_pages == 0)
+        return;
 
-            payload_buffer_usrptr += bvec.bv_len;
-        }
+    // remove the pages from the page tables of every mapping of the window,
+    // which all belong to this transceiver's file description
 
-        /* fallthrough */
+    mapping = READ_ONCE(transceiver->window_mapping);
 
-    case KBDUS_ITEM_TYPE_READ:
-    case KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP:
-    case KBDUS_ITEM_TYPE_WRITE_ZEROS_MAY_UNMAP:
-    case KBDUS_ITEM_TYPE_DISCARD:
-    case KBDUS_ITEM_TYPE_SECURE_ERASE:
+    if (mapping)
+    {
+        unmap_mapping_range(
+            mapping,
+            (loff_t)(KBDUS_PAYLOAD_WINDOWS_MMAP_OFFSET
+                     + transceiver->preallocated_buffer_size
+                         * preallocated_buffer_index),
+            (loff_t)transceiver->preallocated_buffer_size, 1);
+    }
 
-        item->arg64 = 512ull * (u64)blk_rq_pos(inverter_item->req);
-        item->arg32 = (u32)blk_rq_bytes(inverter_item->req);
+    // drop page references
 
-        break;
+    for (i = 0; i < window->num_pages; ++i)
+        put_page(window->pages[i]);
 
-    case KBDUS_ITEM_TYPE_IOCTL:
+    window->num_pages = 0;
+}
 
-        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+// The state of laying out a request's data in a payload window as segments
+// (see kbdus_transceiver_add_bvec_to_window_()).
+struct kbdus_transceiver_layout_
+{
+    u32 num_pages;
+    u32 num_segments;
+    struct kbdus_segment segment;
+
+    // how much of the bounce area is used, how much of it is mapped into the
+    // window, and whether the window's last page is in the bounce area
+    size_t bounce_size;
+    size_t bounce_mapped_size;
+    bool bouncing;
+};
 
-        item->arg32 = (u32)pdu->ioctl_command;
+// Returns the offset into each preallocated buffer of its *bounce area*, which
+// holds copies of the parts of pages of requests mapped as segments, and
+// follows the room for the largest array of segments.
+static size_t kbdus_transceiver_get_bounce_area_offset_(
+    const struct kbdus_transceiver *transceiver)
+{
+    return PAGE_ALIGN(
+        (transceiver->preallocated_buffer_size >> PAGE_SHIFT)
+        * sizeof(struct kbdus_segment));
+}
 
-        if (_IOC_DIR(pdu->ioctl_command) & _IOC_READ)
-        {
-            if (copy_to_user(
-                    payload_buffer_usrptr, pdu->ioctl_argument,
-                    (size_t)_IOC_SIZE(pdu->ioctl_command))
-                != 0)
-            {
-                return -EFAULT;
-            }
-        }
+// Zeroes the rest of the bounce area page holding the last run of parts of
+// pages, if any, so that it exposes nothing other than the request's data.
+static void kbdus_transceiver_end_bounce_(
+    const struct kbdus_transceiver *transceiver, void *buffer,
+    struct kbdus_transceiver_layout_ *layout)
+{
+    if (!layout->bouncing)
+        return;
 
-        break;
-    }
+    memset(
+        buffer + kbdus_transceiver_get_bounce_area_offset_(transceiver)
+            + layout->bounce_size,
+        0, PAGE_ALIGN(layout->bounce_size) - layout->bounce_size);
 
-    return 0;
+    layout->bouncing = false;
 }
 
-static int kbdus_transceiver_copy_req_to_item_and_preallocated_buffer_(
+// Lays out `bvec` in the payload window after the data laid out so far,
+// either extending segment `layout->segment` or storing it into `segments` and
+// starting a new one. Returns false if the window or the bounce area of buffer
+// `buffer` is too small, or if the bvec's page can't be mapped.
+//
+// Only bvecs that cover whole pages have their pages mapped, so that the
+// driver can't access memory other than the request's data. Other bvecs are
+// copied into the bounce area (only if `copy` is true, otherwise they are
+// copied back when the request is replied to) and the bounce area's pages are
+// mapped instead, each run of such bvecs starting in a new page of both.
+//
+// Each new segment starts in a new page of the window, so there are never more
+// segments than pages, and the array of segments always fits in the
+// preallocated buffer before its bounce area.
+static bool kbdus_transceiver_add_bvec_to_window_(
     const struct kbdus_transceiver *transceiver,
-    const struct kbdus_inverter_item *inverter_item, struct kbdus_item *item)
+    struct kbdus_transceiver_window_ *window, void *buffer, bool copy,
+    struct kbdus_segment *segments, struct kbdus_transceiver_layout_ *layout,
+    const struct bio_vec *bvec)
 {
-    void *payload_buffer;
-    struct bio_vec bvec;
-    struct req_iterator req_iter;
+    size_t max_num_pages;
+    void *bounce_area;
     void *bvec_mapped_page;
-    struct kbdus_inverter_pdu *pdu;
+    u32 segment_end;
+    u32 offset;
 
-    payload_buffer = kbdus_transceiver_get_preallocated_buffer_(
-        transceiver, item->user_ptr_or_buffer_index);
+    if (bvec->bv_offset + bvec->bv_len > PAGE_SIZE)
+        return false;
 
-    if (!payload_buffer)
-        return -EINVAL;
+    max_num_pages = transceiver->preallocated_buffer_size >> PAGE_SHIFT;
+    segment_end   = layout->segment.offset + layout->segment.size;
 
-    switch (inverter_item->type)
+    if (bvec->bv_offset == 0 && bvec->bv_len == PAGE_SIZE)
     {
-    case KBDUS_ITEM_TYPE_WRITE:
-    case KBDUS_ITEM_TYPE_WRITE_SAME:
-    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        // map the bvec's page into a new page of the window
 
-        rq_for_each_segment(bvec, inverter_item->req, req_iter)
+        if (PageAnon(bvec->bv_page) || PageSlab(bvec->bv_page)
+            || (size_t)layout->num_pages == max_num_pages)
         {
-            bvec_mapped_page = kmap(bvec.bv_page);
+            return false;
+        }
 
-            memcpy(
-                payload_buffer, bvec_mapped_page + bvec.bv_offset, bvec.bv_len);
+        kbdus_transceiver_end_bounce_(transceiver, buffer, layout);
 
-            kunmap(bvec_mapped_page);
+        offset = layout->num_pages << PAGE_SHIFT;
+        window->pages[layout->num_pages++] = bvec->bv_page;
+    }
+    else
+    {
+        // place the bvec in the bounce area after the bvecs placed so far if
+        // they precede it, otherwise in a new page
 
-            payload_buffer += bvec.bv_len;
-        }
+        bounce_area =
+            buffer + kbdus_transceiver_get_bounce_area_offset_(transceiver);
 
-        /* fallthrough */
+        if (!layout->bouncing)
+        {
+            layout->bounce_size = PAGE_ALIGN(layout->bounce_size);
+            layout->bouncing    = true;
+        }
 
-    case KBDUS_ITEM_TYPE_READ:
-    case KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP:
-    case KBDUS_ITEM_TYPE_WRITE_ZEROS_MAY_UNMAP:
-    case KBDUS_ITEM_TYPE_DISCARD:
-    case KBDUS_ITEM_TYPE_SECURE_ERASE:
+        if ((size_t)(bounce_area - buffer) + layout->bounce_size + bvec->bv_len
+            > transceiver->preallocated_buffer_size)
+        {
+            return false;
+        }
 
-        item->arg64 = 512ull * (u64)blk_rq_pos(inverter_item->req);
-        item->arg32 = (u32)blk_rq_bytes(inverter_item->req);
+        offset = (layout->num_pages << PAGE_SHIFT)
+            - (u32)(layout->bounce_mapped_size - layout->bounce_size);
 
-        break;
+        // map the bounce area's pages that the bvec reaches into the window
 
-    case KBDUS_ITEM_TYPE_IOCTL:
+        while (layout->bounce_mapped_size < layout->bounce_size + bvec->bv_len)
+        {
+            if ((size_t)layout->num_pages == max_num_pages)
+                return false;
 
-        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+            window->pages[layout->num_pages++] =
+                vmalloc_to_page(bounce_area + layout->bounce_mapped_size);
 
-        item->arg32 = (u32)pdu->ioctl_command;
+            layout->bounce_mapped_size += PAGE_SIZE;
+        }
 
-        if (_IOC_DIR(pdu->ioctl_command) & _IOC_READ)
+        if (copy)
         {
+            bvec_mapped_page = kmap(bvec->bv_page);
+
             memcpy(
-                payload_buffer, pdu->ioctl_argument,
-                (size_t)_IOC_SIZE(pdu->ioctl_command));
+                bounce_area + layout->bounce_size,
+                bvec_mapped_page + bvec->bv_offset, bvec->bv_len);
+
+            kunmap(bvec_mapped_page);
         }
 
-        break;
+        layout->bounce_size += bvec->bv_len;
     }
 
-    return 0;
+    // extend the current segment if bvec is contiguous to it in the window
+
+    if (layout->segment.size > 0 && offset == segment_end)
+    {
+        layout->segment.size += bvec->bv_len;
+    }
+    else
+    {
+        if (layout->segment.size > 0)
+            segments[layout->num_segments++] = layout->segment;
+
+        layout->segment.offset = offset;
+        layout->segment.size   = bvec->bv_len;
+    }
+
+    return true;
 }
 
-static int kbdus_transceiver_copy_reply_data_from_user_buffer_(
-    const struct kbdus_transceiver *transceiver,
+// Unmaps the pages of any request from the payload window of the given
+// preallocated buffer and, if possible, maps the pages of the given request
+// into it instead. Returns true if the latter succeeded.
+//
+// If `segments` is not NULL, data that can't be laid out contiguously is
+// mapped anyway, and the layout of the request's data in the window is stored
+// in `segments`, with their number stored in `*num_segments`. Note that
+// `segments` points to the start of the preallocated buffer, which user space
+// can modify at any time, and so is only ever written to.
+static bool kbdus_transceiver_map_req_into_window_(
+    const struct kbdus_transceiver *transceiver, u64 preallocated_buffer_index,
     const struct kbdus_inverter_item *inverter_item,
-    const void __user *payload_buffer_usrptr)
+    struct kbdus_segment *segments, u16 *num_segments)
 {
+    struct kbdus_transceiver_window_ *window;
     struct bio_vec bvec;
     struct req_iterator req_iter;
-    void *bvec_mapped_page;
-    int ret;
-    struct kbdus_inverter_pdu *pdu;
-
-    switch (inverter_item->type)
-    {
-    case KBDUS_ITEM_TYPE_READ:
+    bool mappable;
+    struct kbdus_transceiver_layout_ layout;
+    u32 i;
 
-        if (!kbdus_access_ok(
-                KBDUS_VERIFY_READ, payload_buffer_usrptr,
-                (size_t)blk_rq_bytes(inverter_item->req)))
-        {
-            return -EFAULT;
-        }
+    window = kbdus_transceiver_get_window_(
+        transceiver, preallocated_buffer_index);
 
-        rq_for_each_segment(bvec, inverter_item->req, req_iter)
-        {
-            bvec_mapped_page = kmap(bvec.bv_page);
+    if (!window)
+        return false;
 
-            ret = __copy_from_user(
-                bvec_mapped_page + bvec.bv_offset, payload_buffer_usrptr,
-                bvec.bv_len);
+    mutex_lock(&window->lock);
 
-            kunmap(bvec_mapped_page);
+    // unmap the pages of a request that was never replied to, if any
 
-            if (ret != 0)
-                return -EFAULT;
+    kbdus_transceiver_clear_window_(
+        transceiver, window, preallocated_buffer_index);
 
-            payload_buffer_usrptr += bvec.bv_len;
-        }
+    // check if request's pages can be laid out contiguously in the window and
+    // inserted into user page tables
 
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        mappable = true;
         break;
 
-    case KBDUS_ITEM_TYPE_IOCTL:
+    default:
+        mappable = false;
+        break;
+    }
 
-        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+    memset(&layout, 0, sizeof(layout));
 
-        if (_IOC_DIR(pdu->ioctl_command) & _IOC_WRITE)
+    if (mappable)
+    {
+        rq_for_each_segment(bvec, inverter_item->req, req_iter)
         {
-            if (copy_from_user(
-                    pdu->ioctl_argument, payload_buffer_usrptr,
-                    (size_t)_IOC_SIZE(pdu->ioctl_command))
-                != 0)
+            if (segments)
             {
-                return -EFAULT;
+                if (!kbdus_transceiver_add_bvec_to_window_(
+                        transceiver, window, segments,
+                        inverter_item->type != KBDUS_ITEM_TYPE_READ, segments,
+                        &layout, &bvec))
+                {
+                    mappable = false;
+                    break;
+                }
+            }
+            else
+            {
+                // only map whole pages, as the driver would otherwise be able
+                // to access the parts of pages that the request doesn't cover
+
+                if (PageAnon(bvec.bv_page) || PageSlab(bvec.bv_page)
+                    || bvec.bv_offset != 0 || bvec.bv_len != PAGE_SIZE
+                    || (size_t)(layout.num_pages + 1) << PAGE_SHIFT
+                        > transceiver->preallocated_buffer_size)
+                {
+                    mappable = false;
+                    break;
+                }
+
+                window->pages[layout.num_pages++] = bvec.bv_page;
             }
         }
+    }
 
-        break;
+    // store the last segment
+
+    if (mappable && segments && layout.segment.size > 0)
+    {
+        kbdus_transceiver_end_bounce_(transceiver, segments, &layout);
+
+        segments[layout.num_segments++] = layout.segment;
+        *num_segments                   = (u16)layout.num_segments;
     }
 
-    return 0;
+    // map pages
+
+    if (mappable && layout.num_pages > 0)
+    {
+        for (i = 0; i < layout.num_pages; ++i)
+            get_page(window->pages[i]);
+
+        window->handle_seqnum = inverter_item->handle_seqnum;
+        window->handle_index  = inverter_item->handle_index;
+        window->writable      = inverter_item->type == KBDUS_ITEM_TYPE_READ;
+        window->num_pages     = layout.num_pages;
+    }
+
+    mutex_unlock(&window->lock);
+
+    return mappable && layout.num_pages > 0;
 }
 
-static int kbdus_transceiver_copy_reply_data_from_preallocated_buffer_(
-    const struct kbdus_transceiver *transceiver,
-    const struct kbdus_inverter_item *inverter_item,
-    u64 preallocated_buffer_index)
+// Copies the parts of pages of the given *read* request that were placed in
+// the bounce area of the given preallocated buffer when mapping the request
+// into its payload window back into the request (see
+// kbdus_transceiver_add_bvec_to_window_()).
+static void kbdus_transceiver_copy_bounced_data_to_req_(
+    const struct kbdus_transceiver *transceiver, u64 preallocated_buffer_index,
+    const struct kbdus_inverter_item *inverter_item)
 {
-    void *payload_buffer;
+    void *bounce_area;
     struct bio_vec bvec;
     struct req_iterator req_iter;
     void *bvec_mapped_page;
-    struct kbdus_inverter_pdu *pdu;
+    size_t bounce_size;
+    bool bouncing;
 
-    payload_buffer = kbdus_transceiver_get_preallocated_buffer_(
-        transceiver, preallocated_buffer_index);
+    bounce_area = kbdus_transceiver_get_preallocated_buffer_(
+                      transceiver, preallocated_buffer_index)
+        + kbdus_transceiver_get_bounce_area_offset_(transceiver);
 
-    if (!payload_buffer)
-        return -EINVAL;
+    bounce_size = 0;
+    bouncing    = false;
 
-    switch (inverter_item->type)
+    rq_for_each_segment(bvec, inverter_item->req, req_iter)
     {
-    case KBDUS_ITEM_TYPE_READ:
+        if (bvec.bv_offset == 0 && bvec.bv_len == PAGE_SIZE)
+        {
+            bouncing = false;
+            continue;
+        }
 
-        rq_for_each_segment(bvec, inverter_item->req, req_iter)
+        if (!bouncing)
+        {
+            bounce_size = PAGE_ALIGN(bounce_size);
+            bouncing    = true;
+        }
+
+        bvec_mapped_page = kmap(bvec.bv_page);
+
+        memcpy(
+            bvec_mapped_page + bvec.bv_offset, bounce_area + bounce_size,
+            bvec.bv_len);
+
+        kunmap(bvec_mapped_page);
+
+        bounce_size += bvec.bv_len;
+    }
+}
+
+// Unmaps the pages of the request with the same handle as the given item from
+// the payload window of the given preallocated buffer, or of any request if
+// `inverter_item` is NULL. Returns true if pages were unmapped.
+static bool kbdus_transceiver_unmap_window_(
+    const struct kbdus_transceiver *transceiver, u64 preallocated_buffer_index,
+    const struct kbdus_inverter_item *inverter_item)
+{
+    struct kbdus_transceiver_window_ *window;
+    bool unmapped;
+
+    window = kbdus_transceiver_get_window_(
+        transceiver, preallocated_buffer_index);
+
+    if (!window)
+        return false;
+
+    mutex_lock(&window->lock);
+
+    unmapped = window->num_pages > 0
+        && (!inverter_item
+            || (window->handle_seqnum == inverter_item->handle_seqnum
+                && window->handle_index == inverter_item->handle_index));
+
+    if (unmapped)
+    {
+        kbdus_transceiver_clear_window_(
+            transceiver, window, preallocated_buffer_index);
+    }
+
+    mutex_unlock(&window->lock);
+
+    return unmapped;
+}
+
+#ifdef KBDUS_TRANSCEIVER_SUPPORTS_ZERO_COPY_
+
+static vm_fault_t kbdus_transceiver_window_fault_(struct vm_fault *vmf)
+{
+    const struct kbdus_transceiver *transceiver;
+    struct kbdus_transceiver_window_ *window;
+    unsigned long window_num_pages;
+    unsigned long page_index;
+    vm_fault_t ret;
+    int err;
+
+    transceiver = vmf->vma->vm_private_data;
+
+    // locate window and page (the vma's range was validated when mapping it)
+
+    window_num_pages = transceiver->preallocated_buffer_size >> PAGE_SHIFT;
+
+    page_index = vmf->pgoff
+        - (unsigned long)(KBDUS_PAYLOAD_WINDOWS_MMAP_OFFSET >> PAGE_SHIFT);
+
+    window = &transceiver->windows[page_index / window_num_pages];
+    page_index %= window_num_pages;
+
+    // insert page, if the window currently holds it and, unless it belongs to
+    // a *read* request, the mapping can never be made writable (see
+    // kbdus_transceiver_handle_control_mmap())
+
+    mutex_lock(&window->lock);
+
+    if (page_index < (unsigned long)window->num_pages
+        && (window->writable || !(vmf->vma->vm_flags & VM_MAYWRITE)))
+    {
+        err = vm_insert_page(
+            vmf->vma, vmf->address, window->pages[page_index]);
+
+        if (err == 0 || err == -EBUSY)
+            ret = VM_FAULT_NOPAGE;
+        else if (err == -ENOMEM)
+            ret = VM_FAULT_OOM;
+        else
+            ret = VM_FAULT_SIGBUS;
+    }
+    else
+    {
+        ret = VM_FAULT_SIGBUS;
+    }
+
+    mutex_unlock(&window->lock);
+
+    return ret;
+}
+
+static const struct vm_operations_struct kbdus_transceiver_window_vm_ops_ = {
+    .fault = kbdus_transceiver_window_fault_,
+};
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+static int kbdus_transceiver_copy_req_to_item_and_user_buffer_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_inverter_item *inverter_item, struct kbdus_item *item)
+{
+    void __user *payload_buffer_usrptr;
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    void *bvec_mapped_page;
+    int ret;
+    struct kbdus_inverter_pdu *pdu;
+    struct bio *bio;
+    struct kbdus_range range;
+    u16 num_ranges;
+
+    payload_buffer_usrptr = (void __user *)item->user_ptr_or_buffer_index;
+
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_WRITE_SAME:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
+
+        if (!kbdus_access_ok(
+                KBDUS_VERIFY_WRITE, payload_buffer_usrptr,
+                (size_t)blk_rq_bytes(inverter_item->req)))
+        {
+            return -EFAULT;
+        }
+
+        rq_for_each_segment(bvec, inverter_item->req, req_iter)
+        {
+            bvec_mapped_page = kmap(bvec.bv_page);
+
+            ret = __copy_to_user(
+                payload_buffer_usrptr, bvec_mapped_page + bvec.bv_offset,
+                bvec.bv_len);
+
+            kunmap(bvec_mapped_page);
+
+            if (ret != 0)
+                return -EFAULT;
+
+            payload_buffer_usrptr += bvec.bv_len;
+        }
+
+        /* fallthrough */
+
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP:
+    case KBDUS_ITEM_TYPE_WRITE_ZEROS_MAY_UNMAP:
+    case KBDUS_ITEM_TYPE_DISCARD:
+    case KBDUS_ITEM_TYPE_SECURE_ERASE:
+    case KBDUS_ITEM_TYPE_ZONE_RESET:
+    case KBDUS_ITEM_TYPE_ZONE_OPEN:
+    case KBDUS_ITEM_TYPE_ZONE_CLOSE:
+    case KBDUS_ITEM_TYPE_ZONE_FINISH:
+
+        item->arg64 = 512ull * (u64)blk_rq_pos(inverter_item->req);
+        item->arg32 = (u32)blk_rq_bytes(inverter_item->req);
+
+        break;
+
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        item->arg64 = pdu->zone_report_offset;
+        item->arg32 = pdu->zone_report_max_zones;
+
+        break;
+
+    case KBDUS_ITEM_TYPE_IOCTL:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        item->arg32 = (u32)pdu->ioctl_command;
+
+        if (_IOC_DIR(pdu->ioctl_command) & _IOC_READ)
+        {
+            if (copy_to_user(
+                    payload_buffer_usrptr, pdu->ioctl_argument,
+                    (size_t)_IOC_SIZE(pdu->ioctl_command))
+                != 0)
+            {
+                return -EFAULT;
+            }
+        }
+
+        break;
+    }
+
+    // list the regions of discard requests that may target several of them
+
+    if (inverter_item->type == KBDUS_ITEM_TYPE_DISCARD
+        && transceiver->max_discard_ranges > 1)
+    {
+        bio        = inverter_item->req->bio;
+        num_ranges = 0;
+
+        while (kbdus_transceiver_next_discard_range_(&bio, &range))
+        {
+            if (WARN_ON(num_ranges == transceiver->max_discard_ranges))
+                return -EIO;
+
+            if (copy_to_user(payload_buffer_usrptr, &range, sizeof(range))
+                != 0)
+            {
+                return -EFAULT;
+            }
+
+            payload_buffer_usrptr += sizeof(range);
+            ++num_ranges;
+        }
+
+        item->num_ranges = num_ranges > 1 ? num_ranges : 0;
+    }
+
+    return 0;
+}
+
+static int kbdus_transceiver_copy_req_to_item_and_preallocated_buffer_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_inverter_item *inverter_item, struct kbdus_item *item)
+{
+    void *payload_buffer;
+    struct kbdus_segment *segments;
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    void *bvec_mapped_page;
+    struct kbdus_inverter_pdu *pdu;
+    struct kbdus_range *ranges;
+    struct bio *bio;
+    u16 num_ranges;
+
+    payload_buffer = kbdus_transceiver_get_preallocated_buffer_(
+        transceiver, item->user_ptr_or_buffer_index);
+
+    if (!payload_buffer)
+        return -EINVAL;
+
+    // only read, write, and FUA write requests are served by vector callbacks,
+    // so only their data may be mapped as several segments
+
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        segments = transceiver->scatter_gather ? payload_buffer : NULL;
+        break;
+
+    default:
+        segments = NULL;
+        break;
+    }
+
+    // map request data into the buffer's payload window instead of copying it,
+    // if possible
+
+    if (kbdus_transceiver_map_req_into_window_(
+            transceiver, item->user_ptr_or_buffer_index, inverter_item,
+            segments, &item->num_segments))
+    {
+        item->payload_is_mapped = 1;
+        item->arg64 = 512ull * (u64)blk_rq_pos(inverter_item->req);
+        item->arg32 = (u32)blk_rq_bytes(inverter_item->req);
+
+        return 0;
+    }
+
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_WRITE_SAME:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
+
+        rq_for_each_segment(bvec, inverter_item->req, req_iter)
         {
             bvec_mapped_page = kmap(bvec.bv_page);
 
             memcpy(
-                bvec_mapped_page + bvec.bv_offset, payload_buffer, bvec.bv_len);
+                payload_buffer, bvec_mapped_page + bvec.bv_offset, bvec.bv_len);
+
+            kunmap(bvec_mapped_page);
+
+            payload_buffer += bvec.bv_len;
+        }
+
+        /* fallthrough */
+
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP:
+    case KBDUS_ITEM_TYPE_WRITE_ZEROS_MAY_UNMAP:
+    case KBDUS_ITEM_TYPE_DISCARD:
+    case KBDUS_ITEM_TYPE_SECURE_ERASE:
+    case KBDUS_ITEM_TYPE_ZONE_RESET:
+    case KBDUS_ITEM_TYPE_ZONE_OPEN:
+    case KBDUS_ITEM_TYPE_ZONE_CLOSE:
+    case KBDUS_ITEM_TYPE_ZONE_FINISH:
+
+        item->arg64 = 512ull * (u64)blk_rq_pos(inverter_item->req);
+        item->arg32 = (u32)blk_rq_bytes(inverter_item->req);
+
+        break;
+
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        item->arg64 = pdu->zone_report_offset;
+        item->arg32 = pdu->zone_report_max_zones;
+
+        break;
+
+    case KBDUS_ITEM_TYPE_IOCTL:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        item->arg32 = (u32)pdu->ioctl_command;
+
+        if (_IOC_DIR(pdu->ioctl_command) & _IOC_READ)
+        {
+            memcpy(
+                payload_buffer, pdu->ioctl_argument,
+                (size_t)_IOC_SIZE(pdu->ioctl_command));
+        }
+
+        break;
+    }
+
+    // list the regions of discard requests that may target several of them
+
+    if (inverter_item->type == KBDUS_ITEM_TYPE_DISCARD
+        && transceiver->max_discard_ranges > 1)
+    {
+        ranges     = payload_buffer;
+        bio        = inverter_item->req->bio;
+        num_ranges = 0;
+
+        while (bio)
+        {
+            if (WARN_ON(num_ranges == transceiver->max_discard_ranges))
+                return -EIO;
+
+            kbdus_transceiver_next_discard_range_(&bio, &ranges[num_ranges++]);
+        }
+
+        item->num_ranges = num_ranges > 1 ? num_ranges : 0;
+    }
+
+    return 0;
+}
+
+static int kbdus_transceiver_copy_reply_data_from_user_buffer_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_inverter_item *inverter_item,
+    const void __user *payload_buffer_usrptr)
+{
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    void *bvec_mapped_page;
+    int ret;
+    struct kbdus_inverter_pdu *pdu;
+
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+
+        if (!kbdus_access_ok(
+                KBDUS_VERIFY_READ, payload_buffer_usrptr,
+                (size_t)blk_rq_bytes(inverter_item->req)))
+        {
+            return -EFAULT;
+        }
+
+        rq_for_each_segment(bvec, inverter_item->req, req_iter)
+        {
+            bvec_mapped_page = kmap(bvec.bv_page);
+
+            ret = __copy_from_user(
+                bvec_mapped_page + bvec.bv_offset, payload_buffer_usrptr,
+                bvec.bv_len);
+
+            kunmap(bvec_mapped_page);
+
+            if (ret != 0)
+                return -EFAULT;
+
+            payload_buffer_usrptr += bvec.bv_len;
+        }
+
+        break;
+
+    case KBDUS_ITEM_TYPE_IOCTL:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        if (_IOC_DIR(pdu->ioctl_command) & _IOC_WRITE)
+        {
+            if (copy_from_user(
+                    pdu->ioctl_argument, payload_buffer_usrptr,
+                    (size_t)_IOC_SIZE(pdu->ioctl_command))
+                != 0)
+            {
+                return -EFAULT;
+            }
+        }
+
+        break;
+
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        if (copy_from_user(
+                pdu->zone_report_zones, payload_buffer_usrptr,
+                (size_t)pdu->zone_report_num_zones * sizeof(struct kbdus_zone))
+            != 0)
+        {
+            return -EFAULT;
+        }
+
+        break;
+    }
+
+    return 0;
+}
+
+static int kbdus_transceiver_copy_reply_data_from_preallocated_buffer_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_inverter_item *inverter_item,
+    u64 preallocated_buffer_index)
+{
+    void *payload_buffer;
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    void *bvec_mapped_page;
+    struct kbdus_inverter_pdu *pdu;
+
+    payload_buffer = kbdus_transceiver_get_preallocated_buffer_(
+        transceiver, preallocated_buffer_index);
+
+    if (!payload_buffer)
+        return -EINVAL;
+
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+
+        rq_for_each_segment(bvec, inverter_item->req, req_iter)
+        {
+            bvec_mapped_page = kmap(bvec.bv_page);
+
+            memcpy(
+                bvec_mapped_page + bvec.bv_offset, payload_buffer, bvec.bv_len);
+
+            kunmap(bvec_mapped_page);
+
+            payload_buffer += bvec.bv_len;
+        }
+
+        break;
+
+    case KBDUS_ITEM_TYPE_IOCTL:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        if (_IOC_DIR(pdu->ioctl_command) & _IOC_WRITE)
+        {
+            memcpy(
+                pdu->ioctl_argument, payload_buffer,
+                (size_t)_IOC_SIZE(pdu->ioctl_command));
+        }
+
+        break;
+
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+
+        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+        memcpy(
+            pdu->zone_report_zones, payload_buffer,
+            (size_t)pdu->zone_report_num_zones * sizeof(struct kbdus_zone));
+
+        break;
+    }
+
+    return 0;
+}
+
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+
+// Validates the 64-bit result of a successful reply to a *zone report* or *zone
+// append* request and records it in the request's pdu. Returns 0 on success, or
+// the negated errno value with which the request should fail.
+static int kbdus_transceiver_handle_zone_reply_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_inverter_item *inverter_item, u64 arg64)
+{
+    struct kbdus_inverter_pdu *pdu;
+    u64 zone_offset;
+
+    pdu = blk_mq_rq_to_pdu(inverter_item->req);
+
+    switch (inverter_item->type)
+    {
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+
+        if (arg64 > (u64)pdu->zone_report_max_zones)
+            return -EIO;
+
+        pdu->zone_report_num_zones = (u32)arg64;
+
+        break;
+
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
+
+        // the data must have been written entirely within the zone
+
+        zone_offset = 512ull * (u64)blk_rq_pos(inverter_item->req);
+
+        if (arg64 % 512 != 0 || arg64 < zone_offset
+            || arg64 - zone_offset > transceiver->zone_size
+                    - (u64)blk_rq_bytes(inverter_item->req))
+        {
+            return -EIO;
+        }
+
+        pdu->zone_append_sector = (sector_t)(arg64 / 512);
+
+        break;
+    }
+
+    return 0;
+}
+
+#endif
+
+static bool kbdus_transceiver_item_type_can_splice_(u16 type)
+{
+    switch (type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Reads or writes up to `count` bytes at `*pos`, advancing the latter by the
+// number of bytes transferred.
+static ssize_t kbdus_transceiver_file_read_or_write_(
+    struct file *file, void *buffer, size_t count, loff_t *pos, bool write)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+    if (write)
+        return kernel_write(file, buffer, count, pos);
+    else
+        return kernel_read(file, buffer, count, pos);
+#else
+    ssize_t ret;
+
+    if (write)
+        ret = kernel_write(file, buffer, count, *pos);
+    else
+        ret = kernel_read(file, *pos, buffer, (unsigned long)count);
+
+    if (ret > 0)
+        *pos += ret;
+
+    return ret;
+#endif
+}
+
+// Transfers the request's data from or to the file given in the reply. Returns
+// 0 on success, or the negated errno value with which to fail the request.
+static int kbdus_transceiver_splice_reply_data_(
+    const struct kbdus_inverter_item *inverter_item,
+    const struct kbdus_reply *reply)
+{
+    struct file *file;
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    void *bvec_mapped_page;
+    bool write;
+    loff_t pos;
+    ssize_t transferred;
+    int ret;
+
+    // get file from the calling process' file descriptor table
+
+    if (reply->splice_fd < 0)
+        return -EBADF;
+
+    file = fget((unsigned int)reply->splice_fd);
+
+    if (!file)
+        return -EBADF;
+
+    // transfer data directly between the request's pages and the file
+
+    write = inverter_item->type != KBDUS_ITEM_TYPE_READ;
+    pos   = (loff_t)reply->splice_offset;
+    ret   = 0;
+
+    rq_for_each_segment(bvec, inverter_item->req, req_iter)
+    {
+        bvec_mapped_page = kmap(bvec.bv_page);
+
+        transferred = kbdus_transceiver_file_read_or_write_(
+            file, bvec_mapped_page + bvec.bv_offset, (size_t)bvec.bv_len, &pos,
+            write);
+
+        kunmap(bvec_mapped_page);
+
+        if (transferred != (ssize_t)bvec.bv_len)
+        {
+            ret = transferred < 0 ? (int)transferred : -EIO;
+            break;
+        }
+    }
+
+    // ensure that the data of FUA writes reaches stable storage
+
+    if (ret == 0 && inverter_item->type == KBDUS_ITEM_TYPE_FUA_WRITE)
+        ret = vfs_fsync_range(file, (loff_t)reply->splice_offset, pos - 1, 1);
+
+    fput(file);
+
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool kbdus_transceiver_item_is_notification_(
+    const struct kbdus_item *item)
+{
+    switch (item->type)
+    {
+    case KBDUS_ITEM_TYPE_DEVICE_AVAILABLE:
+    case KBDUS_ITEM_TYPE_TERMINATE:
+    case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// How `kbdus_transceiver_receive_item_()` gets items.
+enum
+{
+    // block until a request or notification is available, or until the
+    // timeout expires (returning -ETIMEDOUT)
+    KBDUS_TRANSCEIVER_RECEIVE_BLOCK_,
+
+    // same, but return -EAGAIN instead of blocking
+    KBDUS_TRANSCEIVER_RECEIVE_NONBLOCK_,
+
+    // only get a request that is already available, returning -EAGAIN
+    // otherwise, and leave notifications to be received later
+    KBDUS_TRANSCEIVER_RECEIVE_MORE_,
+};
+
+// `mode` is one of the `KBDUS_TRANSCEIVER_RECEIVE_*_` values. `timeout` is
+// the maximum number of jiffies to block for in mode
+// `KBDUS_TRANSCEIVER_RECEIVE_BLOCK_`, or MAX_SCHEDULE_TIMEOUT to block
+// indefinitely, and is otherwise ignored.
+//
+// If `item_usrptr` is not NULL, the item is also copied to it, and the request
+// is only considered received if that copy succeeds.
+static int kbdus_transceiver_receive_item_(
+    const struct kbdus_transceiver *transceiver, u32 queue_index, int mode,
+    long timeout, struct kbdus_item *item,
+    struct kbdus_item __user *item_usrptr)
+{
+    const struct kbdus_inverter_item *inverter_item;
+    int ret;
+
+    // get request to be processed from the given queue
+
+    if (mode != KBDUS_TRANSCEIVER_RECEIVE_MORE_)
+    {
+        inverter_item = kbdus_inverter_begin_item_get(
+            transceiver->inverter, queue_index,
+            mode == KBDUS_TRANSCEIVER_RECEIVE_BLOCK_ ? timeout : 0,
+            transceiver->busy_poll_us);
+
+        if (IS_ERR(inverter_item))
+            return PTR_ERR(inverter_item);
+    }
+    else
+    {
+        inverter_item = kbdus_inverter_try_begin_item_get(
+            transceiver->inverter, queue_index);
+
+        if (!inverter_item)
+            return -EAGAIN;
+    }
+
+    // put item into the rai's item structure
+
+    item->handle_seqnum     = inverter_item->handle_seqnum;
+    item->handle_index      = inverter_item->handle_index;
+    item->type              = inverter_item->type;
+    item->payload_is_mapped  = 0;
+    item->payload_is_chunked = 0;
+    item->num_segments       = 0;
+    item->num_ranges         = 0;
+
+    if (inverter_item->req)
+    {
+        item->ioprio   = (u16)inverter_item->req->ioprio;
+        item->op_flags = kbdus_transceiver_req_op_flags_(inverter_item->req);
+    }
+    else
+    {
+        item->ioprio   = 0;
+        item->op_flags = 0;
+    }
+
+    // put request data into the payload buffer, unless it is to be
+    // transferred in chunks
+
+    if (kbdus_transceiver_req_is_chunked_(transceiver, inverter_item))
+    {
+        item->payload_is_chunked = 1;
+        item->arg64 = 512ull * (u64)blk_rq_pos(inverter_item->req);
+        item->arg32 = (u32)blk_rq_bytes(inverter_item->req);
+
+        ret = 0;
+    }
+    else if (!item->use_preallocated_buffer)
+    {
+        ret = kbdus_transceiver_copy_req_to_item_and_user_buffer_(
+            transceiver, inverter_item, item);
+    }
+    else
+    {
+        ret = kbdus_transceiver_copy_req_to_item_and_preallocated_buffer_(
+            transceiver, inverter_item, item);
+    }
+
+    // copy item to user space if applicable
+
+    if (ret == 0 && item_usrptr
+        && copy_to_user(item_usrptr, item, sizeof(*item)) != 0)
+    {
+        ret = -EFAULT;
+    }
+
+    // commit or abort "request get"
+
+    if (ret == 0)
+    {
+        kbdus_inverter_commit_item_get(transceiver->inverter, inverter_item);
+    }
+    else
+    {
+        if (item->payload_is_mapped)
+        {
+            kbdus_transceiver_unmap_window_(
+                transceiver, item->user_ptr_or_buffer_index, NULL);
+        }
+
+        kbdus_inverter_abort_item_get(transceiver->inverter, inverter_item);
+    }
+
+    // return result
+
+    return ret;
+}
+
+static int kbdus_transceiver_send_reply_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_reply *reply)
+{
+    const struct kbdus_inverter_item *inverter_item;
+    bool payload_is_mapped;
+    bool payload_is_spliced;
+    int error;
+    int ret;
+
+    // check if there is a reply at all
+
+    if (reply->handle_index == 0)
+        return 0;
+
+    // get inverter request
+
+    inverter_item = kbdus_inverter_begin_item_completion(
+        transceiver->inverter, reply->handle_index, reply->handle_seqnum);
+
+    if (!inverter_item)
+        return 0; // request timed out, was canceled, or was already completed
+
+    if (IS_ERR(inverter_item))
+        return PTR_ERR(inverter_item);
+
+    // unmap the request's pages if they were mapped into the payload window
+    // of the reply's preallocated buffer, in which case there is nothing else
+    // to copy
+
+    payload_is_mapped = reply->use_preallocated_buffer
+        && kbdus_transceiver_unmap_window_(
+            transceiver, reply->user_ptr_or_buffer_index, inverter_item);
+
+    // the parts of pages of *read* requests mapped as segments were placed in
+    // the preallocated buffer, from which they must be copied
+
+    if (payload_is_mapped && reply->error == 0 && transceiver->scatter_gather
+        && inverter_item->type == KBDUS_ITEM_TYPE_READ)
+    {
+        kbdus_transceiver_copy_bounced_data_to_req_(
+            transceiver, reply->user_ptr_or_buffer_index, inverter_item);
+    }
+
+    // transfer or copy data if applicable and request succeeded
+
+    error              = (int)(-(reply->error));
+    ret                = 0;
+    payload_is_spliced = false;
+
+#ifdef KBDUS_SUPPORTS_ZONED_DEVICES
+    if (error == 0)
+    {
+        error = kbdus_transceiver_handle_zone_reply_(
+            transceiver, inverter_item, reply->arg64);
+    }
+#endif
+
+    if (error == 0 && reply->use_splice)
+    {
+        if (kbdus_transceiver_item_type_can_splice_(inverter_item->type))
+        {
+            error = kbdus_transceiver_splice_reply_data_(inverter_item, reply);
+            payload_is_spliced = error == 0;
+        }
+        else
+        {
+            ret = -EINVAL;
+        }
+    }
+    else if (
+        error == 0 && !payload_is_mapped
+        && !kbdus_transceiver_req_is_chunked_(transceiver, inverter_item))
+    {
+        if (!reply->use_preallocated_buffer)
+        {
+            ret = kbdus_transceiver_copy_reply_data_from_user_buffer_(
+                transceiver, inverter_item,
+                (const void __user *)reply->user_ptr_or_buffer_index);
+        }
+        else
+        {
+            ret = kbdus_transceiver_copy_reply_data_from_preallocated_buffer_(
+                transceiver, inverter_item, reply->user_ptr_or_buffer_index);
+        }
+    }
+
+    // commit or abort request completion
+
+    if (ret == 0)
+    {
+        if (payload_is_mapped)
+        {
+            kbdus_inverter_count_item_transfer(
+                transceiver->inverter, inverter_item,
+                KBDUS_INVERTER_TRANSFER_MAPPED);
+        }
+        else if (payload_is_spliced)
+        {
+            kbdus_inverter_count_item_transfer(
+                transceiver->inverter, inverter_item,
+                KBDUS_INVERTER_TRANSFER_SPLICED);
+        }
+
+        kbdus_inverter_commit_item_completion(
+            transceiver->inverter, inverter_item, error);
+    }
+    else
+    {
+        kbdus_inverter_abort_item_completion(
+            transceiver->inverter, inverter_item);
+    }
+
+    // return result
+
+    return ret;
+}
+
+static int kbdus_transceiver_send_reply_and_receive_item_(
+    const struct kbdus_transceiver *transceiver, u64 rai_index,
+    union kbdus_reply_or_item *rai)
+{
+    int ret;
+
+    ret = kbdus_transceiver_send_reply_(transceiver, &rai->reply);
+
+    if (ret == 0)
+    {
+        ret = kbdus_transceiver_receive_item_(
+            transceiver, (u32)(rai_index % transceiver->num_queues),
+            KBDUS_TRANSCEIVER_RECEIVE_BLOCK_, MAX_SCHEDULE_TIMEOUT, &rai->item,
+            NULL);
+    }
+
+    return ret;
+}
+
+static int kbdus_transceiver_send_replies_and_receive_items_(
+    const struct kbdus_transceiver *transceiver,
+    struct kbdus_batch __user *batch_usrptr)
+{
+    struct kbdus_batch batch;
+    union kbdus_reply_or_item *rais;
+    long timeout;
+    u32 num_items;
+    u32 num_awaiting;
+    u32 i;
+    int ret;
+
+    // copy and validate batch
+
+    if (copy_from_user(&batch, batch_usrptr, sizeof(batch)) != 0)
+        return -EFAULT;
+
+    if (!kbdus_array_is_zero_filled(batch.reserved_) || batch.size == 0
+        || batch.queue_index >= transceiver->num_queues
+        || batch.first_index >= (u64)transceiver->num_rais
+        || (u64)batch.size > (u64)transceiver->num_rais - batch.first_index)
+    {
+        return -EINVAL;
+    }
+
+    rais = kbdus_transceiver_get_rai_(transceiver, batch.first_index);
+
+    // send replies
+
+    for (i = 0; i < batch.size; ++i)
+    {
+        ret = kbdus_transceiver_send_reply_(transceiver, &rais[i].reply);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    // block until the first item is available or the timeout expires, in
+    // which case the replies that were just sent must not be sent again
+
+    timeout = batch.timeout_ms == 0
+        ? MAX_SCHEDULE_TIMEOUT
+        : (long)msecs_to_jiffies(batch.timeout_ms);
+
+    ret = kbdus_transceiver_receive_item_(
+        transceiver, batch.queue_index, KBDUS_TRANSCEIVER_RECEIVE_BLOCK_,
+        timeout, &rais[0].item, NULL);
+
+    if (ret == -ETIMEDOUT)
+    {
+        for (i = 0; i < batch.size; ++i)
+            rais[i].common.handle_index = 0;
+    }
+
+    if (ret != 0)
+        return ret;
+
+    num_items = 1;
+
+    // receive further requests that are already available, unless the first
+    // item is a notification (a failure to receive a request is not reported
+    // here, as the request is left available and will be received again)
+
+    if (!kbdus_transceiver_item_is_notification_(&rais[0].item))
+    {
+        while (num_items < batch.size
+               && kbdus_transceiver_receive_item_(
+                      transceiver, batch.queue_index,
+                      KBDUS_TRANSCEIVER_RECEIVE_MORE_, 0, &rais[num_items].item,
+                      NULL)
+                   == 0)
+        {
+            ++num_items;
+        }
+    }
+
+    // ensure that the replies that were just sent are not sent again
+
+    for (i = num_items; i < batch.size; ++i)
+        rais[i].common.handle_index = 0;
+
+    // report how many requests remain available, so that user space can
+    // decide whether to have more threads receive items from the queue (a
+    // failure to do so is not reported, as the items were already received)
+
+    num_awaiting = kbdus_inverter_num_awaiting_get(
+        transceiver->inverter, batch.queue_index);
+
+    (void)put_user(num_awaiting, &batch_usrptr->num_awaiting);
+
+    return (int)num_items;
+}
+
+// Copies the `size` bytes of the request's data starting at `offset` to or from
+// `buffer`, or `buffer_usrptr` if `buffer` is NULL.
+static int kbdus_transceiver_copy_chunk_(
+    const struct kbdus_inverter_item *inverter_item, u32 offset, u32 size,
+    void *buffer, void __user *buffer_usrptr, bool to_buffer)
+{
+    struct bio_vec bvec;
+    struct req_iterator req_iter;
+    void *bvec_mapped_page;
+    u32 pos;
+    u32 start;
+    u32 len;
+    int ret;
+
+    if (!buffer
+        && !kbdus_access_ok(
+            to_buffer ? KBDUS_VERIFY_WRITE : KBDUS_VERIFY_READ, buffer_usrptr,
+            (size_t)size))
+    {
+        return -EFAULT;
+    }
+
+    pos = 0;
+    ret = 0;
+
+    rq_for_each_segment(bvec, inverter_item->req, req_iter)
+    {
+        // skip to the part of the segment that overlaps the chunk, if any
+
+        if (ret != 0 || pos + bvec.bv_len <= offset || pos >= offset + size)
+        {
+            pos += bvec.bv_len;
+            continue;
+        }
+
+        start = max(pos, offset) - pos;
+        len   = min(pos + bvec.bv_len, offset + size) - pos - start;
+
+        bvec_mapped_page = kmap(bvec.bv_page) + bvec.bv_offset + start;
+
+        if (buffer && to_buffer)
+        {
+            memcpy(buffer + pos + start - offset, bvec_mapped_page, len);
+        }
+        else if (buffer)
+        {
+            memcpy(bvec_mapped_page, buffer + pos + start - offset, len);
+        }
+        else if (to_buffer)
+        {
+            if (__copy_to_user(
+                    buffer_usrptr + pos + start - offset, bvec_mapped_page,
+                    len)
+                != 0)
+            {
+                ret = -EFAULT;
+            }
+        }
+        else
+        {
+            if (__copy_from_user(
+                    bvec_mapped_page, buffer_usrptr + pos + start - offset,
+                    len)
+                != 0)
+            {
+                ret = -EFAULT;
+            }
+        }
+
+        kunmap(bvec.bv_page);
+
+        pos += bvec.bv_len;
+    }
+
+    return ret;
+}
+
+static int kbdus_transceiver_transfer_chunk_(
+    const struct kbdus_transceiver *transceiver,
+    const struct kbdus_chunk __user *chunk_usrptr)
+{
+    struct kbdus_chunk chunk;
+    const struct kbdus_inverter_item *inverter_item;
+    void *buffer;
+    u32 req_size;
+    u32 size;
+    int ret;
+
+    // copy and validate chunk
+
+    if (copy_from_user(&chunk, chunk_usrptr, sizeof(chunk)) != 0)
+        return -EFAULT;
+
+    if (!kbdus_array_is_zero_filled(chunk.reserved_)
+        || transceiver->chunk_size == 0 || chunk.handle_index == 0
+        || chunk.offset % transceiver->chunk_size != 0)
+    {
+        return -EINVAL;
+    }
+
+    if (chunk.use_preallocated_buffer)
+    {
+        buffer = kbdus_transceiver_get_preallocated_buffer_(
+            transceiver, chunk.user_ptr_or_buffer_index);
+
+        if (!buffer)
+            return -EINVAL;
+    }
+    else
+    {
+        buffer = NULL;
+    }
+
+    // get inverter request, keeping it from being completed while its data is
+    // transferred
+
+    inverter_item = kbdus_inverter_begin_item_transfer(
+        transceiver->inverter, chunk.handle_index, chunk.handle_seqnum);
 
-            kunmap(bvec_mapped_page);
+    if (!inverter_item)
+        return -ENOENT;
 
-            payload_buffer += bvec.bv_len;
-        }
+    if (IS_ERR(inverter_item))
+        return PTR_ERR(inverter_item);
 
-        break;
+    // transfer chunk
 
-    case KBDUS_ITEM_TYPE_IOCTL:
+    req_size = 0;
+    size     = 0;
 
-        pdu = blk_mq_rq_to_pdu(inverter_item->req);
+    if (kbdus_transceiver_req_is_chunked_(transceiver, inverter_item))
+        req_size = (u32)blk_rq_bytes(inverter_item->req);
 
-        if (_IOC_DIR(pdu->ioctl_command) & _IOC_WRITE)
-        {
-            memcpy(
-                pdu->ioctl_argument, payload_buffer,
-                (size_t)_IOC_SIZE(pdu->ioctl_command));
-        }
+    if (chunk.offset < req_size)
+    {
+        size = min(req_size - chunk.offset, transceiver->chunk_size);
 
-        break;
+        ret = kbdus_transceiver_copy_chunk_(
+            inverter_item, chunk.offset, size, buffer,
+            (void __user *)chunk.user_ptr_or_buffer_index,
+            inverter_item->type != KBDUS_ITEM_TYPE_READ);
+    }
+    else
+    {
+        ret = -EINVAL;
     }
 
-    return 0;
+    kbdus_inverter_end_item_transfer(transceiver->inverter, inverter_item);
+
+    return ret == 0 ? (int)size : ret;
 }
 
 /* -------------------------------------------------------------------------- */
 
-static int kbdus_transceiver_receive_item_(
-    const struct kbdus_transceiver *transceiver, struct kbdus_item *item)
+int kbdus_transceiver_validate_and_adjust_config(
+    struct kbdus_device_and_fd_config *config)
 {
-    const struct kbdus_inverter_item *inverter_item;
-    int ret;
+    // ensure that reserved space is zeroed out
+
+    if (!kbdus_array_is_zero_filled(config->fd.reserved_1_)
+        || !kbdus_array_is_zero_filled(config->fd.reserved_2_))
+    {
+        return -EINVAL;
+    }
 
-    // get request to be processed
+    // adjust configuration
 
-    inverter_item = kbdus_inverter_begin_item_get(transceiver->inverter);
+    config->fd.num_preallocated_buffers =
+        min(config->fd.num_preallocated_buffers,
+            config->device.max_outstanding_reqs);
 
-    if (IS_ERR(inverter_item))
-        return PTR_ERR(inverter_item);
+#ifdef KBDUS_TRANSCEIVER_SUPPORTS_ZERO_COPY_
+    config->fd.zero_copy = config->fd.zero_copy ? 1 : 0;
+#else
+    config->fd.zero_copy = 0;
+#endif
 
-    // put item into the rai's item structure
+    config->fd.scatter_gather =
+        config->fd.zero_copy && config->fd.scatter_gather ? 1 : 0;
 
-    item->handle_seqnum = inverter_item->handle_seqnum;
-    item->handle_index  = inverter_item->handle_index;
-    item->type          = inverter_item->type;
+    config->fd.busy_poll_us =
+        min(config->fd.busy_poll_us, KBDUS_HARD_MAX_BUSY_POLL_US);
 
-    // put request data into the payload buffer
+    if (config->fd.chunk_size < config->device.max_read_write_size)
+        config->fd.chunk_size = round_up(config->fd.chunk_size, (u32)PAGE_SIZE);
 
-    if (!item->use_preallocated_buffer)
-    {
-        ret = kbdus_transceiver_copy_req_to_item_and_user_buffer_(
-            transceiver, inverter_item, item);
-    }
-    else
+    if (config->fd.chunk_size >= config->device.max_read_write_size)
+        config->fd.chunk_size = 0;
+
+    return 0;
+}
+
+static void
+    kbdus_transceiver_free_shared_memory_(struct kbdus_transceiver *transceiver)
+{
+    size_t i;
+
+    if (!transceiver->shared_pages)
     {
-        ret = kbdus_transceiver_copy_req_to_item_and_preallocated_buffer_(
-            transceiver, inverter_item, item);
+        vfree(transceiver->shared_memory);
+        return;
     }
 
-    // commit or abort "request get"
-
-    if (ret == 0)
-        kbdus_inverter_commit_item_get(transceiver->inverter, inverter_item);
-    else
-        kbdus_inverter_abort_item_get(transceiver->inverter, inverter_item);
+    vunmap(transceiver->shared_memory);
 
-    // return result
+    for (i = 0; i < transceiver->shared_num_pages; ++i)
+        __free_page(transceiver->shared_pages[i]);
 
-    return ret;
+    vfree(transceiver->shared_pages);
 }
 
-static int kbdus_transceiver_send_reply_(
-    const struct kbdus_transceiver *transceiver,
-    const struct kbdus_reply *reply)
+static struct page *kbdus_transceiver_alloc_zeroed_page_(int node)
 {
-    const struct kbdus_inverter_item *inverter_item;
-    int ret;
-
-    // check if there is a reply at all
+    if (node == NUMA_NO_NODE)
+        return alloc_page(GFP_KERNEL | __GFP_ZERO);
+    else
+        return alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+}
 
-    if (reply->handle_index == 0)
-        return 0;
+// Allocates the shared memory page by page, placing preallocated buffer `i` on
+// the NUMA node of hardware queue `i % num_queues` (whose worker threads are
+// expected to use it) and the rais on the node of the first hardware queue.
+static int kbdus_transceiver_alloc_shared_memory_numa_(
+    struct kbdus_transceiver *transceiver, const struct kbdus_device *device,
+    size_t rais_size)
+{
+    size_t rais_num_pages;
+    size_t buffer_num_pages;
+    size_t i;
+    u32 buffer_index;
+    int node;
 
-    // get inverter request
+    rais_num_pages   = rais_size >> PAGE_SHIFT;
+    buffer_num_pages = transceiver->preallocated_buffer_size >> PAGE_SHIFT;
 
-    inverter_item = kbdus_inverter_begin_item_completion(
-        transceiver->inverter, reply->handle_index, reply->handle_seqnum);
+    transceiver->shared_num_pages = rais_num_pages
+        + (size_t)transceiver->num_preallocated_buffers * buffer_num_pages;
 
-    if (!inverter_item)
-        return 0; // request timed out, was canceled, or was already completed
+    transceiver->shared_pages = vzalloc(
+        transceiver->shared_num_pages * sizeof(*transceiver->shared_pages));
 
-    if (IS_ERR(inverter_item))
-        return PTR_ERR(inverter_item);
+    if (!transceiver->shared_pages)
+        return -ENOMEM;
 
-    // copy data if applicable and request succeeded
+    // allocate pages
 
-    ret = 0;
+    node = kbdus_device_get_queue_node(device, 0);
 
-    if (reply->error == 0)
+    for (i = 0; i < transceiver->shared_num_pages; ++i)
     {
-        if (!reply->use_preallocated_buffer)
-        {
-            ret = kbdus_transceiver_copy_reply_data_from_user_buffer_(
-                transceiver, inverter_item,
-                (const void __user *)reply->user_ptr_or_buffer_index);
-        }
-        else
+        if (i >= rais_num_pages && (i - rais_num_pages) % buffer_num_pages == 0)
         {
-            ret = kbdus_transceiver_copy_reply_data_from_preallocated_buffer_(
-                transceiver, inverter_item, reply->user_ptr_or_buffer_index);
+            buffer_index = (u32)((i - rais_num_pages) / buffer_num_pages);
+
+            node = kbdus_device_get_queue_node(
+                device, buffer_index % transceiver->num_queues);
         }
-    }
 
-    // commit or abort request completion
+        transceiver->shared_pages[i] =
+            kbdus_transceiver_alloc_zeroed_page_(node);
 
-    if (ret == 0)
-    {
-        kbdus_inverter_commit_item_completion(
-            transceiver->inverter, inverter_item, (int)(-(reply->error)));
-    }
-    else
-    {
-        kbdus_inverter_abort_item_completion(
-            transceiver->inverter, inverter_item);
+        if (!transceiver->shared_pages[i])
+            goto error;
     }
 
-    // return result
+    // map pages contiguously into the kernel's address space
 
-    return ret;
-}
+    transceiver->shared_memory = vmap(
+        transceiver->shared_pages, (unsigned int)transceiver->shared_num_pages,
+        VM_MAP, PAGE_KERNEL);
 
-static int kbdus_transceiver_send_reply_and_receive_item_(
-    const struct kbdus_transceiver *transceiver, union kbdus_reply_or_item *rai)
-{
-    int ret;
+    if (!transceiver->shared_memory)
+        goto error;
 
-    ret = kbdus_transceiver_send_reply_(transceiver, &rai->reply);
+    return 0;
 
-    if (ret == 0)
-        ret = kbdus_transceiver_receive_item_(transceiver, &rai->item);
+error:
+    for (; i > 0; --i)
+        __free_page(transceiver->shared_pages[i - 1]);
 
-    return ret;
-}
+    vfree(transceiver->shared_pages);
+    transceiver->shared_pages = NULL;
 
-/* -------------------------------------------------------------------------- */
+    return -ENOMEM;
+}
 
-int kbdus_transceiver_validate_and_adjust_config(
-    struct kbdus_device_and_fd_config *config)
+// If the device has several hardware queues and the system several NUMA nodes,
+// memory is allocated on the node of the hardware queue that it is used with.
+static int kbdus_transceiver_alloc_shared_memory_(
+    struct kbdus_transceiver *transceiver, const struct kbdus_device *device)
 {
-    // ensure that reserved space is zeroed out
+    size_t rais_size;
 
-    if (!kbdus_array_is_zero_filled(config->fd.reserved_))
-        return -EINVAL;
+    rais_size = PAGE_ALIGN(transceiver->num_rais * 64);
 
-    // adjust configuration
+    if (transceiver->num_queues > 1 && num_online_nodes() > 1)
+    {
+        return kbdus_transceiver_alloc_shared_memory_numa_(
+            transceiver, device, rais_size);
+    }
 
-    config->fd.num_preallocated_buffers =
-        min(config->fd.num_preallocated_buffers,
-            config->device.max_outstanding_reqs);
+    transceiver->shared_memory = vmalloc_user(
+        rais_size
+        + transceiver->num_preallocated_buffers
+            * transceiver->preallocated_buffer_size);
 
-    return 0;
+    return transceiver->shared_memory ? 0 : -ENOMEM;
 }
 
 struct kbdus_transceiver *kbdus_transceiver_create(
     const struct kbdus_device_and_fd_config *config,
-    struct kbdus_inverter *inverter)
+    struct kbdus_device *device)
 {
     struct kbdus_transceiver *transceiver;
+    size_t window_num_pages;
+    u32 i;
+    int ret;
 
     // allocate transceiver struct
 
@@ -504,29 +1939,69 @@ struct kbdus_transceiver *kbdus_transceiver_create(
     if (!transceiver)
         return ERR_PTR(-ENOMEM);
 
-    transceiver->inverter = inverter;
+    transceiver->inverter   = kbdus_device_get_inverter(device);
+    transceiver->num_queues = config->device.num_queues;
+
+    transceiver->busy_poll_us = config->fd.busy_poll_us;
+
+    transceiver->max_discard_ranges = config->device.max_discard_ranges;
+    transceiver->zone_size          = config->device.zone_size;
+
+    transceiver->scatter_gather = config->fd.scatter_gather != 0;
+
+    transceiver->chunk_size = config->fd.chunk_size;
 
     transceiver->num_rais                 = config->device.max_outstanding_reqs;
     transceiver->num_preallocated_buffers = config->fd.num_preallocated_buffers;
     transceiver->preallocated_buffer_size =
-        PAGE_ALIGN(kbdus_transceiver_get_max_request_size_(&config->device));
+        PAGE_ALIGN(kbdus_transceiver_get_max_request_size_(
+            &config->device, config->fd.chunk_size));
 
     // allocate shared memory (RAIs + preallocated buffers)
 
-    transceiver->shared_memory = vmalloc_user(
-        PAGE_ALIGN(transceiver->num_rais * 64)
-        + transceiver->num_preallocated_buffers
-            * transceiver->preallocated_buffer_size);
+    ret = kbdus_transceiver_alloc_shared_memory_(transceiver, device);
 
-    if (!transceiver->shared_memory)
+    if (ret != 0)
     {
         kfree(transceiver);
-        return ERR_PTR(-ENOMEM);
+        return ERR_PTR(ret);
     }
 
     transceiver->preallocated_buffers_start =
         transceiver->shared_memory + PAGE_ALIGN(transceiver->num_rais * 64);
 
+    // allocate payload windows if zero-copy is enabled
+
+    if (config->fd.zero_copy && transceiver->num_preallocated_buffers > 0)
+    {
+        window_num_pages = transceiver->preallocated_buffer_size >> PAGE_SHIFT;
+
+        transceiver->windows = kcalloc(
+            transceiver->num_preallocated_buffers,
+            sizeof(*transceiver->windows), GFP_KERNEL);
+
+        transceiver->window_pages = vzalloc(
+            transceiver->num_preallocated_buffers * window_num_pages
+            * sizeof(*transceiver->window_pages));
+
+        if (!transceiver->windows || !transceiver->window_pages)
+        {
+            vfree(transceiver->window_pages);
+            kfree(transceiver->windows);
+            kbdus_transceiver_free_shared_memory_(transceiver);
+            kfree(transceiver);
+            return ERR_PTR(-ENOMEM);
+        }
+
+        for (i = 0; i < transceiver->num_preallocated_buffers; ++i)
+        {
+            mutex_init(&transceiver->windows[i].lock);
+
+            transceiver->windows[i].pages =
+                transceiver->window_pages + window_num_pages * i;
+        }
+    }
+
     // success
 
     return transceiver;
@@ -534,7 +2009,22 @@ struct kbdus_transceiver *kbdus_transceiver_create(
 
 void kbdus_transceiver_destroy(struct kbdus_transceiver *transceiver)
 {
-    vfree(transceiver->shared_memory);
+    u32 i;
+
+    // drop references to pages still in payload windows
+
+    if (transceiver->windows)
+    {
+        for (i = 0; i < transceiver->num_preallocated_buffers; ++i)
+        {
+            kbdus_transceiver_unmap_window_(transceiver, (u64)i, NULL);
+            mutex_destroy(&transceiver->windows[i].lock);
+        }
+    }
+
+    vfree(transceiver->window_pages);
+    kfree(transceiver->windows);
+    kbdus_transceiver_free_shared_memory_(transceiver);
     kfree(transceiver);
 }
 
@@ -548,6 +2038,14 @@ int kbdus_transceiver_handle_control_ioctl(
 
     switch (command)
     {
+    case KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS:
+        return kbdus_transceiver_send_replies_and_receive_items_(
+            transceiver, (struct kbdus_batch __user *)argument);
+
+    case KBDUS_IOCTL_TRANSFER_CHUNK:
+        return kbdus_transceiver_transfer_chunk_(
+            transceiver, (const struct kbdus_chunk __user *)argument);
+
     case KBDUS_IOCTL_RECEIVE_ITEM:
     case KBDUS_IOCTL_SEND_REPLY:
     case KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM:
@@ -569,23 +2067,216 @@ int kbdus_transceiver_handle_control_ioctl(
     switch (command)
     {
     case KBDUS_IOCTL_RECEIVE_ITEM:
-        return kbdus_transceiver_receive_item_(transceiver, &rai->item);
+        return kbdus_transceiver_receive_item_(
+            transceiver, (u32)((u64)argument % transceiver->num_queues),
+            KBDUS_TRANSCEIVER_RECEIVE_BLOCK_, MAX_SCHEDULE_TIMEOUT, &rai->item,
+            NULL);
 
     case KBDUS_IOCTL_SEND_REPLY:
         return kbdus_transceiver_send_reply_(transceiver, &rai->reply);
 
     case KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM:
-        return kbdus_transceiver_send_reply_and_receive_item_(transceiver, rai);
+        return kbdus_transceiver_send_reply_and_receive_item_(
+            transceiver, (u64)argument, rai);
 
     default:
         return -ENOTTY;
     }
 }
 
+ssize_t kbdus_transceiver_handle_control_read(
+    struct kbdus_transceiver *transceiver, char __user *buffer, size_t size,
+    loff_t offset, bool nonblock)
+{
+    struct kbdus_item __user *items_usrptr;
+    struct kbdus_item item;
+    size_t num_items;
+    int mode;
+    int ret;
+
+    items_usrptr = (struct kbdus_item __user *)buffer;
+
+    // validate arguments (the offset is the index of the queue to receive from)
+
+    if (size == 0 || size % sizeof(item) != 0 || offset < 0
+        || offset >= (loff_t)transceiver->num_queues)
+    {
+        return -EINVAL;
+    }
+
+    // block until the first item is available (unless in non-blocking mode),
+    // then receive further requests that are already available
+
+    ret = 0;
+
+    for (num_items = 0; num_items < size / sizeof(item); ++num_items)
+    {
+        if (copy_from_user(&item, &items_usrptr[num_items], sizeof(item)) != 0)
+        {
+            ret = -EFAULT;
+            break;
+        }
+
+        if (num_items > 0)
+            mode = KBDUS_TRANSCEIVER_RECEIVE_MORE_;
+        else if (nonblock)
+            mode = KBDUS_TRANSCEIVER_RECEIVE_NONBLOCK_;
+        else
+            mode = KBDUS_TRANSCEIVER_RECEIVE_BLOCK_;
+
+        ret = kbdus_transceiver_receive_item_(
+            transceiver, (u32)offset, mode, MAX_SCHEDULE_TIMEOUT, &item,
+            &items_usrptr[num_items]);
+
+        if (ret != 0)
+            break;
+
+        if (kbdus_transceiver_item_is_notification_(&item))
+        {
+            ++num_items;
+            break;
+        }
+    }
+
+    // only report failures to receive the first item, as otherwise the
+    // request is left available and will be received again
+
+    if (num_items == 0)
+        return ret;
+
+    return (ssize_t)(num_items * sizeof(item));
+}
+
+ssize_t kbdus_transceiver_handle_control_write(
+    struct kbdus_transceiver *transceiver, const char __user *buffer,
+    size_t size)
+{
+    const struct kbdus_reply __user *replies_usrptr;
+    struct kbdus_reply reply;
+    size_t i;
+    int ret;
+
+    replies_usrptr = (const struct kbdus_reply __user *)buffer;
+
+    // validate arguments
+
+    if (size == 0 || size % sizeof(reply) != 0)
+        return -EINVAL;
+
+    // send replies
+
+    for (i = 0; i < size / sizeof(reply); ++i)
+    {
+        if (copy_from_user(&reply, &replies_usrptr[i], sizeof(reply)) != 0)
+            ret = -EFAULT;
+        else
+            ret = kbdus_transceiver_send_reply_(transceiver, &reply);
+
+        if (ret != 0)
+            return i == 0 ? ret : (ssize_t)(i * sizeof(reply));
+    }
+
+    return (ssize_t)size;
+}
+
+bool kbdus_transceiver_handle_control_poll(
+    struct kbdus_transceiver *transceiver, struct file *filp, poll_table *wait)
+{
+    return kbdus_inverter_poll(transceiver->inverter, filp, wait);
+}
+
+static int kbdus_transceiver_map_shared_pages_(
+    struct kbdus_transceiver *transceiver, struct vm_area_struct *vma)
+{
+    unsigned long i;
+    int ret;
+
+    if (vma->vm_pgoff + vma_pages(vma) > transceiver->shared_num_pages)
+        return -EINVAL;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_set(vma, VM_MIXEDMAP | VM_DONTEXPAND | VM_DONTDUMP);
+#else
+    vma->vm_flags |= VM_MIXEDMAP | VM_DONTEXPAND | VM_DONTDUMP;
+#endif
+
+    for (i = 0; i < vma_pages(vma); ++i)
+    {
+        ret = vm_insert_page(
+            vma, vma->vm_start + (i << PAGE_SHIFT),
+            transceiver->shared_pages[vma->vm_pgoff + i]);
+
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 int kbdus_transceiver_handle_control_mmap(
     struct kbdus_transceiver *transceiver, struct vm_area_struct *vma)
 {
-    return remap_vmalloc_range(vma, transceiver->shared_memory, vma->vm_pgoff);
+    unsigned long windows_pgoff;
+
+    windows_pgoff =
+        (unsigned long)(KBDUS_PAYLOAD_WINDOWS_MMAP_OFFSET >> PAGE_SHIFT);
+
+    // map rais and preallocated buffers
+
+    if (vma->vm_pgoff < windows_pgoff)
+    {
+        if (!transceiver->shared_pages)
+        {
+            return remap_vmalloc_range(
+                vma, transceiver->shared_memory, vma->vm_pgoff);
+        }
+
+        return kbdus_transceiver_map_shared_pages_(transceiver, vma);
+    }
+
+    // map payload windows, whose pages are inserted on fault
+
+#ifdef KBDUS_TRANSCEIVER_SUPPORTS_ZERO_COPY_
+
+    if (!transceiver->windows
+        || vma->vm_pgoff - windows_pgoff + vma_pages(vma)
+            > (unsigned long)transceiver->num_preallocated_buffers
+                * (transceiver->preallocated_buffer_size >> PAGE_SHIFT))
+    {
+        return -EINVAL;
+    }
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_set(vma, VM_MIXEDMAP | VM_DONTEXPAND | VM_DONTDUMP);
+#else
+    vma->vm_flags |= VM_MIXEDMAP | VM_DONTEXPAND | VM_DONTDUMP;
+#endif
+
+    // mappings created without write access can never gain it, so that the
+    // pages of requests other than *read* requests, which hold the client's
+    // data, can be inserted into them
+
+    if (!(vma->vm_flags & VM_WRITE))
+    {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+        vm_flags_clear(vma, VM_MAYWRITE);
+#else
+        vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+    }
+
+    vma->vm_ops          = &kbdus_transceiver_window_vm_ops_;
+    vma->vm_private_data = transceiver;
+
+    WRITE_ONCE(transceiver->window_mapping, vma->vm_file->f_mapping);
+
+    return 0;
+
+#else
+
+    return -EINVAL;
+
+#endif
 }
 
 /* -------------------------------------------------------------------------- */
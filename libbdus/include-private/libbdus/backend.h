@@ -6,14 +6,73 @@
 /* -------------------------------------------------------------------------- */
 
 #include <bdus.h>
+#include <libbdus/handoff.h>
+#include <libbdus/trace.h>
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* -------------------------------------------------------------------------- */
 
+// Serves the device, recording requests into `trace` if it is not NULL. If
+// `handoff` is not NULL, it is resumed once the device's memory is mapped and
+// starts listening once the device becomes available (see
+// bdus_handoff_resume_() and bdus_handoff_listen_()).
 bool bdus_backend_run_(
-    int control_fd, struct bdus_ctx *ctx, uint32_t max_outstanding_reqs);
+    int control_fd, struct bdus_ctx *ctx, uint32_t max_outstanding_reqs,
+    struct bdus_trace_ *trace, struct bdus_handoff_ *handoff);
+
+// Serves requests generated in-process as configured by `loopback_attrs`,
+// whose `queue_depth` must have been adjusted, instead of requests received
+// from kbdus. `ctx->attrs` must have been adjusted as for a new device, without
+// payload windows, io_uring, chunks, or worker threads spawned on demand.
+bool bdus_backend_run_loopback_(
+    struct bdus_ctx *ctx, const struct bdus_loopback_attrs *loopback_attrs,
+    struct bdus_loopback_results *out_results);
+
+// A device served by bdus_backend_run_many_().
+struct bdus_backend_device_
+{
+    int control_fd;
+    struct bdus_ctx *ctx;
+    uint32_t max_outstanding_reqs;
+
+    // NULL if requests are not traced
+    struct bdus_trace_ *trace;
+};
+
+// Serves all given devices with a single pool of `num_threads` worker threads,
+// one of which is the calling thread, until all devices terminate. Control file
+// descriptions are put in non-blocking mode, and the current process is
+// daemonized once all devices are available if `daemonize` is true.
+bool bdus_backend_run_many_(
+    const struct bdus_backend_device_ *devices, size_t num_devices,
+    size_t num_threads, bool daemonize);
+
+// Restricts the calling thread to the CPUs selected by attributes `worker_cpus`
+// and `worker_numa_nodes`, if any, until bdus_backend_unrestrict_cpus_() is
+// called. Threads it creates inherit the restriction, and memory that kbdus
+// allocates on its behalf is local to those CPUs. Sets `*out_restricted` to
+// whether the thread was restricted.
+bool bdus_backend_restrict_cpus_(
+    const struct bdus_attrs *attrs, bool *out_restricted);
+
+// Restores the CPU affinity that the calling thread had before a successful
+// call to bdus_backend_restrict_cpus_() that restricted it.
+void bdus_backend_unrestrict_cpus_(void);
+
+// Implements bdus_get_request_ioprio().
+uint16_t bdus_backend_get_request_ioprio_(void);
+
+// Implements bdus_splice().
+bool bdus_backend_splice_(int fd, uint64_t offset);
+
+// Implements bdus_defer().
+struct bdus_request *bdus_backend_defer_(void);
+
+// Implements bdus_complete().
+bool bdus_backend_complete_(struct bdus_request *request, int error);
 
 /* -------------------------------------------------------------------------- */
 
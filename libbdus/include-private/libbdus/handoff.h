@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: MIT */
+
+#ifndef LIBBDUS_HEADER_HANDOFF_H_
+#define LIBBDUS_HEADER_HANDOFF_H_
+
+/* -------------------------------------------------------------------------- */
+
+#include <kbdus.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+// The state needed to hand off a device between drivers without detaching its
+// control file description, which is passed from the running driver to its
+// successor over a UNIX domain socket.
+//
+// The running driver listens for successors (see bdus_handoff_listen_()). Once
+// one connects, the control file description is sent to it and the running
+// driver keeps serving the device until the successor has mapped the memory
+// shared with kbdus, the device is then suspended (see `KBDUS_IOCTL_SUSPEND`),
+// and the successor resumes it once the running driver's worker threads have
+// stopped (see bdus_handoff_resume_()).
+struct bdus_handoff_;
+
+// Creates the handoff state of a driver that serves a device through
+// `control_fd`, which was configured as given, and lets other drivers take over
+// the device once bdus_handoff_listen_() is called.
+//
+// Returns NULL and sets the error with bdus_set_error_() on failure.
+struct bdus_handoff_ *bdus_handoff_create_(
+    int control_fd, const struct kbdus_device_and_fd_config *config);
+
+// Connects to the running driver of the given device and receives its control
+// file description and its configuration, which are stored in
+// `*out_control_fd` and `*out_config`. The running driver keeps serving the
+// device until bdus_handoff_resume_() is called.
+//
+// If `allow_handoff` is true, other drivers may in turn take over the device
+// once bdus_handoff_listen_() is called.
+//
+// Returns NULL and sets the error with bdus_set_error_() on failure.
+struct bdus_handoff_ *bdus_handoff_connect_(
+    uint64_t dev_id, bool allow_handoff, int *out_control_fd,
+    struct kbdus_device_and_fd_config *out_config);
+
+// If `handoff` was created by bdus_handoff_connect_(), has the previous driver
+// stop serving the device and resumes it, so that the caller's items can be
+// received. Otherwise, does nothing. `handoff` may be NULL.
+bool bdus_handoff_resume_(struct bdus_handoff_ *handoff);
+
+// Starts letting other drivers take over the device, if allowed. `handoff` may
+// be NULL.
+//
+// Must be called after the process is daemonized, as the listening thread would
+// not survive it.
+bool bdus_handoff_listen_(struct bdus_handoff_ *handoff);
+
+// Stops letting other drivers take over the device, frees `handoff`, which may
+// be NULL, and returns whether the device was handed off to another driver.
+//
+// Must only be called once requests are no longer being served, as the driver
+// to which the device was handed off is then told that it can resume it.
+bool bdus_handoff_destroy_(struct bdus_handoff_ *handoff);
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* LIBBDUS_HEADER_HANDOFF_H_ */
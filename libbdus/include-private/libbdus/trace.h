@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: MIT */
+
+#ifndef LIBBDUS_HEADER_TRACE_H_
+#define LIBBDUS_HEADER_TRACE_H_
+
+/* -------------------------------------------------------------------------- */
+
+#include <bdus.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+// The trace of a device, which records the requests most recently processed by
+// each of the driver's worker threads in a ring of fixed size per thread.
+//
+// Traces are kept in memory shared with other processes, so that they can be
+// read while the driver is running (see bdus_trace_read_()). Each ring has a
+// single writer and is never locked.
+struct bdus_trace_;
+
+// A ring of a `struct bdus_trace_`.
+struct bdus_trace_ring_;
+
+// The maximum number of entries per ring, as allowed for attribute
+// `trace_size`.
+#define BDUS_TRACE_MAX_RING_SIZE_ (UINT32_C(1) << 20)
+
+// Creates the trace of the device with the given id, with `num_rings` rings of
+// `ring_size` entries each, replacing any existing trace of the device.
+//
+// Returns NULL and sets the error with bdus_set_error_() on failure.
+struct bdus_trace_ *
+    bdus_trace_create_(uint64_t dev_id, size_t num_rings, uint32_t ring_size);
+
+// Destroys the given trace, which may be NULL, keeping it readable by other
+// processes unless `remove` is true.
+void bdus_trace_destroy_(struct bdus_trace_ *trace, bool remove);
+
+// Returns the given trace's ring with index `index % num_rings`, or NULL if
+// `trace` is NULL.
+struct bdus_trace_ring_ *
+    bdus_trace_get_ring_(struct bdus_trace_ *trace, size_t index);
+
+// Returns the current time, as used for trace entries.
+uint64_t bdus_trace_now_ns_(void);
+
+// Records a request into the given ring, which must only be written to by the
+// calling thread. `start_ns` and `end_ns` are the times at which the callback
+// serving the request was invoked and returned.
+void bdus_trace_record_(
+    struct bdus_trace_ring_ *ring, uint32_t type, uint64_t arg64,
+    uint32_t arg32, int32_t error, uint64_t start_ns, uint64_t end_ns);
+
+// Returns the name of the given request type, as used for trace entries and
+// device statistics.
+const char *bdus_trace_type_name_(uint32_t type);
+
+// Implements bdus_get_dev_trace().
+bool bdus_trace_read_(
+    uint64_t dev_id, struct bdus_trace_entry **out_entries,
+    size_t *out_num_entries);
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* LIBBDUS_HEADER_TRACE_H_ */
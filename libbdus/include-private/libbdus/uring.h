@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: MIT */
+
+#ifndef LIBBDUS_HEADER_URING_H_
+#define LIBBDUS_HEADER_URING_H_
+
+/* -------------------------------------------------------------------------- */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* -------------------------------------------------------------------------- */
+
+struct bdus_uring_;
+
+// Returns true if the system supports everything that io_uring instances
+// created by `bdus_uring_create_()` need.
+bool bdus_uring_is_supported_(void);
+
+// Creates an io_uring instance for sending replies and receiving items through
+// the given control file description.
+//
+// If `poll` is true, a kernel thread polls the instance's submission queue if
+// possible, and completions are busy-polled instead of waited for.
+//
+// Returns NULL and sets errno on failure, including if io_uring is not
+// supported by the system (in which case errno is set to ENOSYS).
+struct bdus_uring_ *bdus_uring_create_(int control_fd, bool poll);
+
+void bdus_uring_destroy_(struct bdus_uring_ *ring);
+
+// Sends the replies in the first `num_replies` rais (if any) and then receives
+// up to `num_rais` items from the hardware queue with index `queue_index` into
+// the given rais, as if by reading from and writing to the control file
+// description.
+//
+// Items are only received if they are already available, so that io_uring never
+// hands the read off to one of its worker threads, which would be woken up for
+// every item. If none is, this returns 0 after sending the replies (unless the
+// instance was created with `poll`, in which case it keeps trying), and the
+// caller should block waiting for items by other means.
+//
+// Returns the number of received items, or -1 and sets errno on failure.
+int bdus_uring_send_replies_and_receive_items_(
+    struct bdus_uring_ *ring, void *rais, size_t num_replies, size_t num_rais,
+    size_t queue_index);
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* LIBBDUS_HEADER_URING_H_ */
@@ -15,7 +15,7 @@
  * returned by `bdus_get_libbdus_version()`, which is only determined at run
  * time.
  */
-#define BDUS_HEADER_VERSION_PATCH 2
+#define BDUS_HEADER_VERSION_PATCH 3
 
 #if !defined(BDUS_REQUIRE_VERSION_MAJOR)                                       \
     && !defined(BDUS_REQUIRE_VERSION_MINOR)                                    \
@@ -50,9 +50,9 @@
 BDUS_REQUIRE_VERSION_MINOR, and BDUS_REQUIRE_VERSION_PATCH or none at all
 
 #elif BDUS_REQUIRE_VERSION_MAJOR != 0 || BDUS_REQUIRE_VERSION_MINOR != 1       \
-    || BDUS_REQUIRE_VERSION_PATCH > 2
+    || BDUS_REQUIRE_VERSION_PATCH > 3
 
-#error bdus.h has version 0.1.2 but incompatible version was required
+#error bdus.h has version 0.1.3 but incompatible version was required
 
 #error
 
@@ -64,6 +64,7 @@ BDUS_REQUIRE_VERSION_MINOR, and BDUS_REQUIRE_VERSION_PATCH or none at all
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 /* -------------------------------------------------------------------------- */
 
@@ -92,7 +93,10 @@ struct bdus_ctx
     /** \brief Device and driver attributes. */
     const struct bdus_attrs *const attrs;
 
-    /** \brief Whether the driver is being run with `bdus_rerun()`. */
+    /**
+     * \brief Whether the driver is being run with `bdus_rerun()` or
+     *        `bdus_take_over()`.
+     */
     const bool is_rerun;
 
     /**
@@ -116,6 +120,118 @@ struct bdus_ctx
 #endif
 };
 
+#if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+
+/**
+ * \brief A region of a device targeted by a *discard* request.
+ *
+ * See `struct bdus_ops.discard_ranges`.
+ */
+struct bdus_range
+{
+    /** \brief The offset (in bytes) into the device of the region. */
+    uint64_t offset;
+
+    /** \brief The size (in bytes) of the region. */
+    uint32_t size;
+};
+
+/** \brief Zone types. See `struct bdus_zone`. */
+enum bdus_zone_type
+{
+    /** \brief The zone may be written at any offset. */
+    bdus_zone_conventional = 0x1,
+
+    /** \brief The zone may only be written at its write pointer. */
+    bdus_zone_sequential = 0x2,
+};
+
+/** \brief Zone conditions. See `struct bdus_zone`. */
+enum bdus_zone_condition
+{
+    /** \brief The zone has no write pointer (it is conventional). */
+    bdus_zone_not_write_pointer = 0x0,
+
+    /** \brief The zone is empty. */
+    bdus_zone_empty = 0x1,
+
+    /** \brief The zone was opened by being written. */
+    bdus_zone_implicit_open = 0x2,
+
+    /** \brief The zone was opened by a *zone open* request. */
+    bdus_zone_explicit_open = 0x3,
+
+    /** \brief The zone was partially written and then closed. */
+    bdus_zone_closed = 0x4,
+
+    /** \brief The zone may only be read. */
+    bdus_zone_read_only = 0xd,
+
+    /** \brief The zone is full. */
+    bdus_zone_full = 0xe,
+
+    /** \brief The zone may be neither read nor written. */
+    bdus_zone_offline = 0xf,
+};
+
+/**
+ * \brief A zone of a zoned device.
+ *
+ * See `struct bdus_ops.report_zones`.
+ */
+struct bdus_zone
+{
+    /** \brief The offset (in bytes) into the device of the zone. */
+    uint64_t offset;
+
+    /** \brief The size (in bytes) of the zone. */
+    uint64_t size;
+
+    /**
+     * \brief How many bytes of the zone can be written, which must be no
+     *        greater than `size`.
+     */
+    uint64_t capacity;
+
+    /**
+     * \brief The offset (in bytes) into the device of the zone's write
+     *        pointer.
+     *
+     * Ignored for conventional zones.
+     */
+    uint64_t write_pointer;
+
+    /** \brief The zone's type, as an `enum bdus_zone_type` value. */
+    uint8_t type;
+
+    /** \brief The zone's condition, as an `enum bdus_zone_condition` value. */
+    uint8_t condition;
+};
+
+/**
+ * \brief Policies for choosing which pending request is received by the driver
+ *        next.
+ *
+ * See `struct bdus_attrs.dispatch_policy`.
+ */
+enum bdus_dispatch_policy
+{
+    /** \brief Requests are received in the order they were submitted. */
+    bdus_dispatch_fifo,
+
+    /** \brief *Read* requests are received before requests of other types. */
+    bdus_dispatch_reads_first,
+
+    /**
+     * \brief Requests are received in order of their I/O priority (see
+     *        `bdus_get_request_ioprio()`).
+     */
+    bdus_dispatch_priority,
+};
+
+#endif
+
 /**
  * \brief Holds pointers to driver management and request processing callbacks.
  *
@@ -480,6 +596,417 @@ struct bdus_ops
      *         `EIO`.
      */
     int (*ioctl)(uint32_t command, void *argument, struct bdus_ctx *ctx);
+
+#if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+
+    /**
+     * \brief Callback for allocating the memory of request payload buffers.
+     *
+     * If set to `NULL`, BDUS allocates request payload buffers itself. Must be
+     * `NULL` if and only if `free_payload_buffer` is `NULL`.
+     *
+     * Otherwise, this callback is invoked each time BDUS spawns an internal
+     * worker thread (or only once, if attribute `async_queue_depth` is
+     * positive), to allocate a region of memory from which that thread's
+     * payload buffers (*i.e.*, the `buffer` and `argument` parameters of other
+     * callbacks) are taken. Request data is then copied by the kernel directly
+     * to and from this memory. This allows drivers to use, for instance,
+     * memory backed by huge pages or registered for DMA with SPDK or DPDK,
+     * avoiding further copies between BDUS' buffers and their own.
+     *
+     * This callback is invoked after `initialize()` and before any request is
+     * served. If `bdus_run()` daemonizes the current process, it does so after
+     * this callback is invoked, so the allocated memory must remain valid
+     * across `fork()` (otherwise, set `bdus_attrs.dont_daemonize`). The
+     * exception are worker threads spawned later on as load increases (see
+     * attribute `min_concurrent_callbacks`), for which this callback may be
+     * invoked concurrently with other callbacks.
+     *
+     * \param size The size of the region to be allocated, in bytes. This is
+     *        always a positive multiple of the system's page size.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return a pointer to the region,
+     *         which must be aligned in memory to the system's page size. On
+     *         failure, it should return `NULL` and set `errno` to an
+     *         appropriate error number.
+     */
+    void *(*allocate_payload_buffer)(size_t size, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for freeing memory allocated with
+     *        `allocate_payload_buffer()`.
+     *
+     * Must be `NULL` if and only if `allocate_payload_buffer` is `NULL`.
+     *
+     * This callback is invoked once for each region returned by
+     * `allocate_payload_buffer()`, after the thread using the region serves its
+     * last request and before `terminate()` is invoked. Regions of worker
+     * threads that exit due to inactivity are freed as they exit,
+     * concurrently with other callbacks.
+     *
+     * \param buffer The region of memory to be freed.
+     * \param size The size of the region, as given to
+     *        `allocate_payload_buffer()`.
+     * \param ctx Information about the device and driver.
+     */
+    void (*free_payload_buffer)(
+        void *buffer, size_t size, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for waiting for events when serving requests
+     *        asynchronously.
+     *
+     * Only used if attribute `async_queue_depth` is positive.
+     *
+     * This callback is invoked by the thread that serves requests when it has
+     * nothing to do, *i.e.*, when no requests are available or when
+     * `async_queue_depth` requests are already in progress. It should block
+     * until file descriptor \p fd becomes readable or until the driver
+     * completes some deferred request with `bdus_complete()`, whichever comes
+     * first, and then return. This allows drivers to wait for new requests
+     * and for their own events at the same time, *e.g.*, by polling \p fd
+     * along with their own file descriptors using `poll()` or epoll, or by
+     * submitting a poll operation for \p fd to their own io_uring instance.
+     * Returning early is allowed.
+     *
+     * \p fd is -1 when the driver is terminating and the thread is only
+     * waiting for the remaining deferred requests to be completed. (Note that
+     * `poll()` ignores negative file descriptors.)
+     *
+     * If set to `NULL`, the thread instead blocks until new requests arrive or
+     * deferred requests are completed, so requests must then be completed by
+     * other threads.
+     *
+     * \param fd The file descriptor to wait on, or -1.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an
+     *         `errno` value should be returned, causing the driver to
+     *         terminate.
+     */
+    int (*async_wait)(int fd, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *read* requests, taking the request's data
+     *        as a list of memory regions.
+     *
+     * If not `NULL`, this callback is used instead of `read`, which may then
+     * be `NULL`.
+     *
+     * If attribute `zero_copy` is `true`, \p iov describes the request's own
+     * memory, which may be split into several regions (*e.g.*, when the
+     * client's buffers were not aligned to the system's page size), and the
+     * request's data may thus be transferred to its destination without ever
+     * being copied into a single contiguous buffer. Only data that fills whole
+     * pages is accessed directly, and regions holding parts of pages are
+     * copies. Otherwise, or when the request's memory can't be accessed
+     * directly, \p iov describes a single region holding a copy of the
+     * request's data.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p iov points to an array of \p iovcnt positive-sized regions of
+     *     memory whose sizes add up to \p size bytes;
+     *   - \p offset is a multiple of `ctx->attrs->logical_block_size`;
+     *   - \p size is a positive multiple of `ctx->attrs->logical_block_size`;
+     *   - `offset + size <= ctx->attrs->size`;
+     *   - `size <= ctx->attrs->max_read_write_size`.
+     *
+     * The regions are neither necessarily aligned nor a multiple of the logical
+     * block size in size. \p iov and \p iovcnt are suitable for use with, for
+     * instance, `preadv()`, `pwritev()`, or `sendmsg()`.
+     *
+     * \param iov The regions of memory to which the data should be read.
+     * \param iovcnt The number of elements of \p iov.
+     * \param offset The offset (in bytes) into the device at which the read
+     *        should take place.
+     * \param size The number of bytes that should be read.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*readv)(
+        const struct iovec *iov, int iovcnt, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *write* requests, taking the request's data
+     *        as a list of memory regions.
+     *
+     * If not `NULL`, this callback is used instead of `write`, which may then
+     * be `NULL`. See `readv` for how \p iov relates to attribute `zero_copy`.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p iov points to an array of \p iovcnt positive-sized regions of
+     *     memory whose sizes add up to \p size bytes;
+     *   - \p offset is a multiple of `ctx->attrs->logical_block_size`;
+     *   - \p size is a positive multiple of `ctx->attrs->logical_block_size`;
+     *   - `offset + size <= ctx->attrs->size`;
+     *   - `size <= ctx->attrs->max_read_write_size`.
+     *
+     * The regions are neither necessarily aligned nor a multiple of the logical
+     * block size in size. \p iov and \p iovcnt are suitable for use with, for
+     * instance, `preadv()`, `pwritev()`, or `sendmsg()`.
+     *
+     * \param iov The regions of memory containing the data to be written.
+     * \param iovcnt The number of elements of \p iov.
+     * \param offset The offset (in bytes) into the device at which the write
+     *        should take place.
+     * \param size The number of bytes that should be written.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*writev)(
+        const struct iovec *iov, int iovcnt, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *FUA write* requests, taking the request's
+     *        data as a list of memory regions.
+     *
+     * If not `NULL`, this callback is used instead of `fua_write`, which may
+     * then be `NULL`. See `readv` for how \p iov relates to attribute
+     * `zero_copy`. If this callback is implemented, then the `flush` callback
+     * must also be implemented.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p iov points to an array of \p iovcnt positive-sized regions of
+     *     memory whose sizes add up to \p size bytes;
+     *   - \p offset is a multiple of `ctx->attrs->logical_block_size`;
+     *   - \p size is a positive multiple of `ctx->attrs->logical_block_size`;
+     *   - `offset + size <= ctx->attrs->size`;
+     *   - `size <= ctx->attrs->max_read_write_size`.
+     *
+     * The regions are neither necessarily aligned nor a multiple of the logical
+     * block size in size. \p iov and \p iovcnt are suitable for use with, for
+     * instance, `preadv()`, `pwritev()`, or `sendmsg()`.
+     *
+     * \param iov The regions of memory containing the data to be written.
+     * \param iovcnt The number of elements of \p iov.
+     * \param offset The offset (in bytes) into the device at which the write
+     *        should take place.
+     * \param size The number of bytes that should be written.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*fua_writev)(
+        const struct iovec *iov, int iovcnt, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *discard* requests that may target several
+     *        non-contiguous regions.
+     *
+     * If not `NULL`, this callback is used instead of `discard`, which may then
+     * be `NULL`. Otherwise, when attribute `max_discard_ranges` is greater than
+     * 1, the `discard` callback is invoked once for each region of each
+     * request, and the request fails with the first error it returns.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p ranges points to an array of \p num_ranges regions, which are
+     *     neither necessarily sorted nor disjoint;
+     *   - `0 < num_ranges <= ctx->attrs->max_discard_ranges`;
+     *   - The `offset` of each region is a multiple of
+     *     `ctx->attrs->logical_block_size`;
+     *   - The `size` of each region is a positive multiple of
+     *     `ctx->attrs->logical_block_size`;
+     *   - `offset + size <= ctx->attrs->size` for each region;
+     *   - The sizes of all regions add up to no more than
+     *     `ctx->attrs->max_discard_erase_size`.
+     *
+     * \param ranges The regions to be discarded.
+     * \param num_ranges The number of elements of \p ranges.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*discard_ranges)(
+        const struct bdus_range *ranges, uint32_t num_ranges,
+        struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *zone report* requests.
+     *
+     * If this callback is implemented, the device is a host-managed zoned
+     * block device, divided into zones of `ctx->attrs->zone_size` bytes (the
+     * last one possibly being smaller), and callbacks `reset_zone`,
+     * `open_zone`, `close_zone`, `finish_zone`, and `append_to_zone` must also
+     * be implemented, as must callbacks for serving *read* and *write*
+     * requests. This requires Linux 5.10 or later, built with
+     * `CONFIG_BLK_DEV_ZONED`.
+     *
+     * Conventional zones can be written anywhere. Sequential write required
+     * zones can only be written at their write pointer, by *write* and *FUA
+     * write* requests that start at it, which the kernel submits one at a time
+     * for each zone, or by *zone append* requests, any number of which may be
+     * served concurrently for the same zone (see `append_to_zone`).
+     *
+     * This callback must fill in all \p num_zones elements of \p zones, which
+     * are zero-initialized, with the consecutive zones starting at \p offset.
+     * The `size` of each zone must be `ctx->attrs->zone_size`, except for the
+     * last zone of the device.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p offset is a multiple of `ctx->attrs->zone_size`;
+     *   - `offset < ctx->attrs->size`;
+     *   - `0 < num_zones <= 64`;
+     *   - The device has at least \p num_zones zones starting at \p offset.
+     *
+     * \param zones The array of zones to be filled in.
+     * \param offset The offset (in bytes) into the device of the first zone to
+     *        be reported.
+     * \param num_zones The number of elements of \p zones.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*report_zones)(
+        struct bdus_zone *zones, uint64_t offset, uint32_t num_zones,
+        struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *zone reset* requests, which make a zone
+     *        empty, rewinding its write pointer and discarding its data.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p offset is a multiple of `ctx->attrs->zone_size`;
+     *   - `offset < ctx->attrs->size`.
+     *
+     * \param offset The offset (in bytes) into the device of the zone.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*reset_zone)(uint64_t offset, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *zone open* requests, which explicitly
+     *        open a zone.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p offset is a multiple of `ctx->attrs->zone_size`;
+     *   - `offset < ctx->attrs->size`.
+     *
+     * \param offset The offset (in bytes) into the device of the zone.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*open_zone)(uint64_t offset, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *zone close* requests, which close an open
+     *        zone.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p offset is a multiple of `ctx->attrs->zone_size`;
+     *   - `offset < ctx->attrs->size`.
+     *
+     * \param offset The offset (in bytes) into the device of the zone.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*close_zone)(uint64_t offset, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *zone finish* requests, which make a zone
+     *        full.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p offset is a multiple of `ctx->attrs->zone_size`;
+     *   - `offset < ctx->attrs->size`.
+     *
+     * \param offset The offset (in bytes) into the device of the zone.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*finish_zone)(uint64_t offset, struct bdus_ctx *ctx);
+
+    /**
+     * \brief Callback for serving *zone append* requests.
+     *
+     * The data must be written at the zone's write pointer, which must then be
+     * advanced past it, and \p out_offset set to the offset at which it was
+     * written. Unlike *write* requests, *zone append* requests to the same zone
+     * may be served concurrently and in any order, which lets drivers of
+     * log-structured storage accept many concurrent writes per zone.
+     *
+     * When BDUS invokes this callback, it is guaranteed that:
+     *
+     *   - \p zone_offset is a multiple of `ctx->attrs->zone_size`;
+     *   - \p size is a positive multiple of `ctx->attrs->logical_block_size`;
+     *   - `zone_offset + size <= ctx->attrs->size`;
+     *   - `size <= ctx->attrs->max_zone_append_size`.
+     *
+     * \param buffer A buffer containing the data to be written.
+     * \param zone_offset The offset (in bytes) into the device of the zone.
+     * \param size The number of bytes that should be written.
+     * \param out_offset Must be set to the offset (in bytes) into the device
+     *        at which the data was written, if the operation is successful.
+     *        The data must lie entirely within the zone.
+     * \param ctx Information about the device and driver.
+     *
+     * \return On success, this callback should return 0. On failure, an `errno`
+     *         value should be returned to fail the request. Alternatively,
+     *         `bdus_abort` can be returned to indicate an unrecoverable driver
+     *         error and terminate the driver. Values other than 0, `ENOLINK`,
+     *         `ENOSPC`, `ETIMEDOUT`, and `bdus_abort` are converted to `EIO`.
+     */
+    int (*append_to_zone)(
+        const char *buffer, uint64_t zone_offset, uint32_t size,
+        uint64_t *out_offset, struct bdus_ctx *ctx);
+
+#endif
 };
 
 /**
@@ -550,6 +1077,9 @@ struct bdus_attrs
      * - If this value is 0, it is set to 1.
      * - Otherwise, this value is either left unmodified or decreased to an
      *   unspecified positive value (but never increased).
+     * - When using `bdus_rerun()`, if the value resulting from the above rules
+     *   is less than the existing device's number of hardware queues (see
+     *   `num_queues`), it is increased to that number.
      *
      * If this attribute's value (as available in `ctx->attrs` from driver
      * callbacks) is 1, then callbacks are never invoked concurrently, and it is
@@ -587,6 +1117,9 @@ struct bdus_attrs
      *     implemented, this value is set to 0;
      *   - Otherwise, it is set to the original driver's value for this
      *     attribute.
+     *
+     * If attribute `chunk_size` is positive, requests may be larger than it,
+     * but callbacks are given at most that many bytes at once.
      */
     uint32_t max_read_write_size;
 
@@ -743,13 +1276,516 @@ struct bdus_attrs
      * callback invocation showing with what arguments they are being called.
      *
      * Note that messages printed after the driver is daemonized are not
-     * visible, since `stderr` is redirected to `/dev/null`.
+     * visible, since `stderr` is redirected to `/dev/null`. Logging callback
+     * invocations also considerably reduces throughput; see attribute
+     * `trace_size` for a cheaper way of recording served requests.
      */
     bool log;
-};
 
-enum
-{
+#if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+
+    /**
+     * \brief The number of hardware queues of the device.
+     *
+     * Requests submitted to the device are spread among this many queues,
+     * according to the CPU from which they are submitted. Each queue is
+     * serviced by its own subset of the driver's worker threads, and when
+     * there is more than one queue, those threads are pinned to the CPUs
+     * that submit requests to that queue. This can improve scalability for
+     * drivers that are able to process many requests in parallel, as the
+     * kernel hands out and completes the requests of each queue under a lock
+     * of its own.
+     *
+     * When using `bdus_rerun()`, this attribute is ignored and its value in
+     * `ctx->attrs` as available from driver callbacks will be the existing
+     * device's number of hardware queues.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - When using `bdus_run()`:
+     *
+     *   - If this value is 0, it is set to the system's number of online
+     *     CPUs, or to the adjusted value of `max_concurrent_callbacks` if that
+     *     is less;
+     *   - This value is then either left unmodified or decreased to an
+     *     unspecified positive value no greater than the system's number of
+     *     CPUs and the adjusted value of `max_concurrent_callbacks` (but never
+     *     increased).
+     *
+     * - When using `bdus_rerun()`, it is set to the existing device's number
+     *   of hardware queues.
+     */
+    uint32_t num_queues;
+
+    /**
+     * \brief Whether to communicate with the kernel through io_uring.
+     *
+     * If `true`, worker threads send replies and receive requests by
+     * submitting reads and writes on BDUS' control device through io_uring,
+     * instead of issuing ioctl commands. Reads only receive requests that are
+     * already available, and worker threads that find none wait for requests
+     * through an ioctl command, so that io_uring worker threads are never
+     * involved.
+     *
+     * This alone does not usually improve performance, but see also
+     * `io_uring_polling`.
+     *
+     * If the system does not support io_uring (Linux 5.6 or later is
+     * required), ioctl commands are used instead, and this attribute is set to
+     * `false` in `ctx->attrs` as available from driver callbacks.
+     */
+    bool use_io_uring;
+
+    /**
+     * \brief Whether to busy-poll for requests when using io_uring.
+     *
+     * If `true` and io_uring is being used (see `use_io_uring`), worker threads
+     * busy-poll for requests through io_uring instead of sleeping until they
+     * arrive, and submissions are polled by a kernel thread if the process is
+     * privileged enough. This avoids a wakeup per request and can
+     * reduce latency, but each worker thread fully occupies a CPU while the
+     * driver is running.
+     *
+     * This attribute is ignored if io_uring is not being used.
+     */
+    bool io_uring_polling;
+
+    /**
+     * \brief Whether to avoid copying request data between the kernel and the
+     *        driver, when possible.
+     *
+     * If `true`, the `buffer` argument of the `read`, `write`, and `fua_write`
+     * callbacks may point directly to the memory of the request being served,
+     * instead of to a copy of its data. This avoids copying data twice per
+     * request (which can be the main cost of large requests), but each worker
+     * thread then receives requests one at a time. The memory of *write* and
+     * *FUA write* requests is mapped read-only, and writing to it terminates
+     * the driver.
+     *
+     * Requests whose data is not suitably laid out in memory, as well as all
+     * requests of other types, are still served through copies. This attribute
+     * has no effect if the driver implements callback
+     * `allocate_payload_buffer`.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks: if the running kernel does not support avoiding
+     * copies or the driver implements callback `allocate_payload_buffer`, it
+     * is set to `false`.
+     */
+    bool zero_copy;
+
+    /**
+     * \brief The maximum number of requests that can be served at once
+     *        asynchronously, or 0 to serve requests synchronously.
+     *
+     * If 0, each request is served by a callback invocation from start to
+     * finish, and several requests can only be served at once by several
+     * worker threads (see `max_concurrent_callbacks`).
+     *
+     * If positive, no worker threads are spawned. Instead, the thread running
+     * `bdus_run()` or `bdus_rerun()` invokes all callbacks, one at a time, and
+     * request callbacks may call `bdus_defer()` to have their request remain in
+     * progress after they return, completing it later with `bdus_complete()`.
+     * Up to this many requests can be in progress at once, regardless of the
+     * number of threads, which suits drivers that forward requests to
+     * asynchronous interfaces such as io_uring or network sockets. See also
+     * callback `async_wait`.
+     *
+     * When using `bdus_rerun()`, the existing device must have a single
+     * hardware queue.
+     *
+     * If this attribute is positive, then in `ctx->attrs` as available from
+     * driver callbacks `max_concurrent_callbacks` and `num_queues` are set to
+     * 1, and `use_io_uring` and `zero_copy` are set to `false`. This attribute
+     * itself is then either left unmodified or decreased to an unspecified
+     * positive value (but never increased).
+     */
+    uint32_t async_queue_depth;
+
+    /**
+     * \brief The minimum number of worker threads to keep running, or 0 to
+     *        always run `max_concurrent_callbacks` worker threads.
+     *
+     * If this is less than `max_concurrent_callbacks`, BDUS starts with this
+     * many worker threads and spawns more, up to `max_concurrent_callbacks`,
+     * while requests accumulate in the device's hardware queues. Worker threads
+     * beyond the first `min_concurrent_callbacks` exit after waiting for
+     * requests for `idle_worker_timeout_ms` milliseconds, and each worker
+     * thread's payload buffers exist only while it is running. This reduces the
+     * resources used by mostly idle devices.
+     *
+     * Worker threads then receive requests through ioctl commands, and so
+     * `use_io_uring` has no effect.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - If this value is 0 or greater than the adjusted value of
+     *   `max_concurrent_callbacks`, it is set to the latter.
+     * - Otherwise, if it is less than the adjusted value of `num_queues`, it is
+     *   set to the latter, so that every hardware queue always has a worker
+     *   thread.
+     *
+     * If the resulting value is less than the adjusted value of
+     * `max_concurrent_callbacks`, then `use_io_uring` is set to `false` in
+     * `ctx->attrs` as available from driver callbacks.
+     */
+    uint32_t min_concurrent_callbacks;
+
+    /**
+     * \brief How long, in milliseconds, worker threads beyond the first
+     *        `min_concurrent_callbacks` wait for requests before exiting.
+     *
+     * This attribute is ignored if the adjusted value of
+     * `min_concurrent_callbacks` is equal to that of
+     * `max_concurrent_callbacks`.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks: if 0, it is set to 1000.
+     */
+    uint32_t idle_worker_timeout_ms;
+
+    /**
+     * \brief How many of the device's hardware queues are dedicated to polled
+     *        I/O.
+     *
+     * The last `num_poll_queues` of the device's `num_queues` hardware queues
+     * then only serve requests whose clients busy-poll for their completion,
+     * such as those submitted with `preadv2()` and `pwritev2()` and flag
+     * `RWF_HIPRI`, or through an io_uring instance created with flag
+     * `IORING_SETUP_IOPOLL`. Such clients then avoid being put to sleep while
+     * their requests are served, which can reduce latency when the driver
+     * serves requests quickly. Drivers serve these requests like any others.
+     *
+     * When using `bdus_rerun()`, this attribute is ignored and its value in
+     * `ctx->attrs` as available from driver callbacks will be the existing
+     * device's number of poll queues.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - When using `bdus_run()`:
+     *
+     *   - If the running kernel does not support polled I/O, it is set to 0;
+     *   - Otherwise, it is either left unmodified or decreased to a value less
+     *     than the adjusted value of `num_queues` (but never increased).
+     *
+     * - When using `bdus_rerun()`, it is set to the existing device's number
+     *   of poll queues.
+     */
+    uint32_t num_poll_queues;
+
+    /**
+     * \brief For how long, in microseconds, worker threads busy-wait for
+     *        requests before sleeping.
+     *
+     * If positive, a worker thread that finds no requests to serve keeps
+     * checking for new ones for up to this long before going to sleep. When
+     * requests arrive in quick succession, this avoids the cost of waking up
+     * worker threads for each of them, and can reduce latency, at the cost of
+     * CPU time. Busy-waiting also stops early if another task is waiting to run
+     * on the same CPU.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks: it is either left unmodified or decreased to an
+     * unspecified value (but never increased).
+     */
+    uint32_t busy_poll_us;
+
+    /**
+     * \brief The CPUs on which the driver's threads may run, or `NULL` to not
+     *        restrict them.
+     *
+     * If not `NULL`, this must be a comma-separated list of CPU numbers and
+     * ranges of CPU numbers, such as `"0-3,8,10-11"`. The thread running
+     * `bdus_run()` or `bdus_rerun()` and all worker threads are then
+     * restricted to these CPUs while the driver runs. Memory for the device's
+     * rais and payload buffers is also allocated close to these CPUs. When
+     * there is more than one hardware queue, the worker threads of each queue
+     * are pinned to the CPUs that submit requests to it and are listed here,
+     * or to all CPUs listed here if there are none.
+     *
+     * This string must remain valid until `bdus_run()` or `bdus_rerun()`
+     * returns. This attribute is ignored by `bdus_run_many()`, whose threads
+     * may run on any CPU on which the calling thread may run.
+     */
+    const char *worker_cpus;
+
+    /**
+     * \brief The NUMA nodes on whose CPUs the driver's threads may run, or
+     *        `NULL` to not restrict them.
+     *
+     * If not `NULL`, this must be a comma-separated list of NUMA node numbers
+     * and ranges of NUMA node numbers, such as `"0"` or `"0-1"`. This has the
+     * same effect as setting `worker_cpus` to all CPUs of those nodes. If both
+     * attributes are set, the driver's threads are restricted to the CPUs
+     * listed in `worker_cpus` that belong to the given nodes.
+     *
+     * On multi-socket systems, this keeps the driver's threads, the memory
+     * into which they receive requests, and the hardware queues to which those
+     * requests are submitted on the same node, avoiding costly traffic between
+     * sockets.
+     *
+     * This string must remain valid until `bdus_run()` or `bdus_rerun()`
+     * returns. This attribute is ignored by `bdus_run_many()`.
+     */
+    const char *worker_numa_nodes;
+
+    /**
+     * \brief The maximum number of non-contiguous regions that a single
+     *        *discard* request may target.
+     *
+     * If greater than 1, the kernel may merge discards of non-contiguous
+     * regions into a single request, which is then served by a single
+     * invocation of the `discard_ranges` callback (or of the `discard` callback
+     * for each region, if `discard_ranges` is not implemented). This greatly
+     * reduces the number of requests that reach the driver when clients issue
+     * many small discards, such as when running `fstrim` on a fragmented file
+     * system.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - If both the `discard` and `discard_ranges` callbacks are *not*
+     *   implemented, this value is set to 0;
+     * - Otherwise, if this value is 0, the running kernel does not support
+     *   discard requests with several regions, or attribute
+     *   `async_queue_depth` is positive but the `discard_ranges` callback is
+     *   not implemented, it is set to 1;
+     * - Otherwise, this value is either left unmodified or decreased to an
+     *   unspecified positive value (but never increased).
+     */
+    uint32_t max_discard_ranges;
+
+    /**
+     * \brief How to choose which pending request is received by the driver
+     *        next.
+     *
+     * With `bdus_dispatch_fifo`, requests are received in the order in which
+     * they were submitted. With `bdus_dispatch_reads_first`, *read* requests
+     * are received before all others, so that reads are not delayed by large
+     * writes. With `bdus_dispatch_priority`, requests of the real-time I/O
+     * priority class are received first, then those of the best-effort class
+     * or with no priority, and then those of the idle class, each class in
+     * order of priority level (see `ioprio_set(2)`).
+     *
+     * Under any policy other than `bdus_dispatch_fifo`, requests that have been
+     * pending for a long time (currently 500 milliseconds) are received before
+     * all others, so that no request is starved.
+     *
+     * Priorities only decide the order in which requests are received. As
+     * soon as requests are received, they are served in parallel by the
+     * driver's worker threads, which may use `bdus_get_request_ioprio()` to
+     * order their own work.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     */
+    enum bdus_dispatch_policy dispatch_policy;
+
+    /**
+     * \brief The granularity (in bytes) with which the kernel tracks regions of
+     *        the device known to contain only zeros, or 0 to not track them.
+     *
+     * If not 0, must be a power of two greater than or equal to attribute
+     * `logical_block_size`, and attribute `size` must be at most 2^58. Drivers
+     * may then use `bdus_set_zero_range()` to tell the kernel which
+     * regions of the device contain only zeros, such as unallocated regions of
+     * thin-provisioned devices, and *read* requests that only target those
+     * regions are served by the kernel itself, without ever invoking the
+     * driver's callbacks. Regions stop being known to contain only zeros as
+     * soon as requests that may modify them are submitted, and again when
+     * those requests complete.
+     *
+     * Smaller values let more *read* requests be served by the kernel, but
+     * make the kernel use more memory (one bit per extent of this size).
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - If both the `read` and `readv` callbacks are *not* implemented, or if
+     *   callback `report_zones` is implemented, this value is set to 0;
+     * - Otherwise, this value is either left unmodified or increased to an
+     *   unspecified power of two.
+     */
+    uint32_t zero_extent_size;
+
+    /**
+     * \brief The maximum amount of memory (in bytes) used by the kernel to
+     *        cache data read from the device, or 0 to not cache it.
+     *
+     * If not 0, *read* requests that only target data returned by previous
+     * *read* requests may be served by the kernel itself, without invoking the
+     * driver's callbacks. Data is cached with the granularity of the system's
+     * page size, only for *read* requests targeting at most 32 pages (128 KiB
+     * with 4 KiB pages), and the kernel keeps it coherent with requests
+     * submitted to the device. If the device's contents may change by means
+     * other than requests submitted to the device, drivers must use
+     * `bdus_invalidate_read_cache()` to keep the cache coherent.
+     *
+     * All memory used by the cache is allocated when the device is created.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - If both the `read` and `readv` callbacks are *not* implemented, or if
+     *   callback `report_zones` is implemented, this value is set to 0;
+     * - Otherwise, this value is rounded down to a multiple of the system's
+     *   page size.
+     */
+    uint32_t read_cache_size;
+
+    /**
+     * \brief How many of the most recently processed requests each worker
+     *        thread records in the device's trace, or 0 to not trace requests.
+     *
+     * If not 0, must be at most 1048576. Each worker thread then records, for
+     * every request it serves, the request's type, offset, and size, the value
+     * returned by the callback serving it, and when the callback was invoked
+     * and for how long it ran, in a ring of this many entries. Recording does
+     * not involve system calls or locking, so this can be left enabled in
+     * production.
+     *
+     * The trace can be obtained at any time while the driver runs using
+     * `bdus_get_dev_trace()` or the `bdus trace` command, and uses 32 bytes of
+     * memory per entry of each thread. If the driver fails or is killed, its
+     * trace is left behind so that it can still be inspected.
+     *
+     * Unlike most attributes, when using `bdus_rerun()`, the value given by
+     * the new driver is used.
+     */
+    uint32_t trace_size;
+
+    /**
+     * \brief Whether other drivers may take over the device from this driver
+     *        with `bdus_take_over()` without interrupting its clients.
+     *
+     * If this is `true`, the driver listens for drivers attempting to take
+     * over its device once the `on_device_available()` callback returns
+     * (and after being daemonized, if applicable), and keeps serving requests
+     * until the new driver is ready. The new driver then inherits the memory
+     * shared with kbdus and all requests not yet replied to, and this driver's
+     * `terminate()` callback is invoked after it stops serving requests. The
+     * `initialize()` callback of the new driver is thus invoked while this
+     * driver is still serving requests, and both must be able to coexist.
+     * Once the device has been taken over, `bdus_run()`, `bdus_rerun()`, or
+     * `bdus_take_over()` returns `true` without the driver having flushed the
+     * device.
+     *
+     * Must be `false` if `async_queue_depth` is positive and when using
+     * `bdus_run_many()`.
+     *
+     * Unlike most attributes, when using `bdus_rerun()` or `bdus_take_over()`,
+     * the value given by the new driver is used.
+     */
+    bool allow_handoff;
+
+    /**
+     * \brief The maximum amount of data of a *read*, *write*, or *FUA write*
+     *        request that callbacks are given at once, or 0 for no limit.
+     *
+     * If positive, requests of these types that are larger than this are
+     * served by invoking the respective callback once for each consecutive
+     * chunk of at most this many bytes of the request, in order, with the
+     * request's data transferred to or from the driver one chunk at a time.
+     * If a callback fails, the request fails without invoking it for the
+     * remaining chunks. Payload buffers then only need to hold a single
+     * chunk, so `max_read_write_size` can be large without requests being
+     * split by the kernel nor worker threads requiring buffers of that size.
+     *
+     * Chunked requests can't be served using `bdus_splice()`.
+     *
+     * This value is rounded up to a multiple of the system's page size, and
+     * set to 0 if it is then not less than the (adjusted) value of
+     * `max_read_write_size`. This attribute is ignored and set to 0 if
+     * `async_queue_depth` is positive or when using `bdus_run_many()`.
+     *
+     * Unlike most attributes, when using `bdus_rerun()`, the value given by
+     * the new driver is used. When using `bdus_take_over()`, the value used by
+     * the previous driver is used instead.
+     */
+    uint32_t chunk_size;
+
+    /**
+     * \brief The size (in bytes) of the zones of a zoned device.
+     *
+     * Only used if callback `report_zones` is implemented, in which case must
+     * be a power of two greater than or equal to attributes
+     * `logical_block_size` and `physical_block_size`, and no greater than
+     * 2^40.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks: if callback `report_zones` is *not* implemented,
+     * it is set to 0.
+     */
+    uint64_t zone_size;
+
+    /**
+     * \brief The maximum number of sequential zones of a zoned device that may
+     *        be open (explicitly or implicitly) at once, or 0 for no limit.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks: if callback `report_zones` is *not* implemented,
+     * it is set to 0.
+     */
+    uint32_t max_open_zones;
+
+    /**
+     * \brief The maximum number of sequential zones of a zoned device that may
+     *        be open or closed at once, or 0 for no limit.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks: if callback `report_zones` is *not* implemented,
+     * it is set to 0.
+     */
+    uint32_t max_active_zones;
+
+    /**
+     * \brief The maximum size (in bytes) of *zone append* requests.
+     *
+     * When using `bdus_rerun()`, this value is ignored and the original
+     * driver's value for this attribute is used.
+     *
+     * This attribute may take on a different value in `ctx->attrs` as available
+     * from driver callbacks, according to the following rules:
+     *
+     * - If callback `report_zones` is *not* implemented, this value is set to
+     *   0;
+     * - Otherwise, if this value is 0, it is set to the adjusted value of
+     *   `max_read_write_size`;
+     * - Otherwise, this value is either left unmodified or decreased to an
+     *   unspecified positive multiple of `logical_block_size` no greater than
+     *   the adjusted value of `max_read_write_size` (but never increased);
+     * - In both cases, this value is then decreased to `zone_size` if greater
+     *   than it.
+     */
+    uint32_t max_zone_append_size;
+
+#endif
+};
+
+enum
+{
     /**
      * \brief Callback return value indicating that the driver should be
      *        aborted.
@@ -769,6 +1805,10 @@ bool bdus_run_0_1_1_(
     const struct bdus_ops *ops, const struct bdus_attrs *attrs,
     void *private_data);
 
+bool bdus_run_0_1_3_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data);
+
 /**
  * \brief Runs a driver for a new block device with the specified callbacks and
  *        attributes.
@@ -795,6 +1835,9 @@ static inline bool bdus_run(
     void *private_data)
 {
 #if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+    return bdus_run_0_1_3_(ops, attrs, private_data);
+#elif BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1       \
     && BDUS_REQUIRE_VERSION_PATCH >= 1
     return bdus_run_0_1_1_(ops, attrs, private_data);
 #else
@@ -810,6 +1853,10 @@ bool bdus_rerun_0_1_1_(
     uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
     void *private_data);
 
+bool bdus_rerun_0_1_3_(
+    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data);
+
 /**
  * \brief Runs a driver for an *existing* block device with the specified
  *        callbacks and attributes.
@@ -858,6 +1905,9 @@ static inline bool bdus_rerun(
     void *private_data)
 {
 #if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+    return bdus_rerun_0_1_3_(dev_id, ops, attrs, private_data);
+#elif BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1       \
     && BDUS_REQUIRE_VERSION_PATCH >= 1
     return bdus_rerun_0_1_1_(dev_id, ops, attrs, private_data);
 #else
@@ -865,6 +1915,317 @@ static inline bool bdus_rerun(
 #endif
 }
 
+#if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+
+bool bdus_take_over_0_1_3_(
+    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data);
+
+/**
+ * \brief Runs a driver for an existing block device, taking it over from its
+ *        controlling driver without interrupting the device's clients.
+ *
+ * The controlling driver must have been run with attribute `allow_handoff` set
+ * to `true`. Unlike with `bdus_rerun()`, the existing driver is not flushed nor
+ * detached from the device: the new driver inherits the memory that it shares
+ * with kbdus, is initialized while the existing driver keeps serving requests,
+ * and then replies to all requests that the existing driver received but did
+ * not reply to. If the existing driver terminates abnormally while it is being
+ * taken over, the requests that it did not reply to are also served by the new
+ * driver.
+ *
+ * As requests are not interrupted, the new driver must also receive request
+ * data in the same manner as the existing driver. In particular, it must
+ * implement vector callbacks (*e.g.*, `readv()`) if the existing driver did,
+ * and must not implement `allocate_payload_buffer()` if the existing driver
+ * used attribute `zero_copy`. The device and driver attributes are otherwise
+ * adjusted as with `bdus_rerun()`, and attribute `async_queue_depth` must be 0.
+ *
+ * This function fails if the effective user ID of the calling process does not
+ * correspond to the `root` user.
+ *
+ * \param dev_id The numerical identifier of the device.
+ * \param ops Driver callbacks.
+ * \param attrs Device and driver attributes.
+ * \param private_data The initial value for the `private_data` field of the
+ *        `struct bdus_ctx` given to the driver's callbacks.
+ *
+ * \return On success, blocks until the driver is terminated and returns `true`.
+ *         On failure, `false` is returned, `errno` is set to an appropriate
+ *         error number, and the current error message is set to a string
+ *         descriptive of the error (see `bdus_get_error_message()`).
+ */
+static inline bool bdus_take_over(
+    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data)
+{
+    return bdus_take_over_0_1_3_(dev_id, ops, attrs, private_data);
+}
+
+/** \brief Specifies one of the drivers to be run by `bdus_run_many()`. */
+struct bdus_driver
+{
+    /** \brief Driver callbacks. */
+    const struct bdus_ops *ops;
+
+    /** \brief Device and driver attributes. */
+    const struct bdus_attrs *attrs;
+
+    /**
+     * \brief The initial value for the `private_data` field of the `struct
+     *        bdus_ctx` given to the driver's callbacks.
+     */
+    void *private_data;
+};
+
+bool bdus_run_many_0_1_3_(
+    const struct bdus_driver *drivers, size_t num_drivers,
+    uint32_t num_threads);
+
+/**
+ * \brief Runs several drivers, each for a new block device, sharing a single
+ *        set of worker threads and payload buffers among all of them.
+ *
+ * This behaves as if `bdus_run()` were invoked for each driver, except that all
+ * devices are served by the same \p num_threads worker threads (one of which is
+ * the calling thread), and that memory for request payloads is allocated per
+ * worker thread instead of per device. Worker threads wait for requests on all
+ * devices at once with `epoll`, and take turns among devices with pending
+ * requests, so that a busy device does not prevent others from being served.
+ * Compared to running each driver in its own process, this can considerably
+ * reduce memory usage and scheduling overhead when there are many devices.
+ *
+ * Devices are created and their drivers' `initialize()` callbacks invoked in
+ * the order in which they appear in \p drivers. Callback
+ * `on_device_available()` is invoked for each device once it becomes
+ * available, and the current process is daemonized once all devices are
+ * available, unless attribute `dont_daemonize` is `true` for any of the
+ * drivers. If any driver fails (for instance, by returning `bdus_abort` from a
+ * callback), all drivers are terminated. Callback `terminate()` is invoked for
+ * each driver after all devices are terminated.
+ *
+ * Attribute `async_queue_depth` must be 0, and callbacks
+ * `allocate_payload_buffer()` and `free_payload_buffer()` are not supported.
+ * Attributes `max_concurrent_callbacks` and `min_concurrent_callbacks` are set
+ * to \p num_threads in `ctx->attrs` as available from driver callbacks, and
+ * attributes `num_queues`, `num_poll_queues`, `use_io_uring`, `zero_copy`, and
+ * `busy_poll_us` take on their default values.
+ *
+ * This function fails if the effective user ID of the calling process does not
+ * correspond to the `root` user.
+ *
+ * \param drivers The drivers to be run.
+ * \param num_drivers The number of elements of \p drivers, which must be
+ *        positive.
+ * \param num_threads The number of worker threads, or 0 to use a single worker
+ *        thread.
+ *
+ * \return On success, blocks until all drivers are terminated and returns
+ *         `true`. On failure, `false` is returned, `errno` is set to an
+ *         appropriate error number, and the current error message is set to a
+ *         string descriptive of the error (see `bdus_get_error_message()`).
+ */
+static inline bool bdus_run_many(
+    const struct bdus_driver *drivers, size_t num_drivers,
+    uint32_t num_threads)
+{
+    return bdus_run_many_0_1_3_(drivers, num_drivers, num_threads);
+}
+
+bool bdus_splice_0_1_3_(int fd, uint64_t offset);
+
+/**
+ * \brief Has the data of the request being served by the calling thread be
+ *        transferred directly between the request and a file.
+ *
+ * This function may only be called from `read`, `write`, and `fua_write`
+ * callbacks. If it succeeds, the callback's `buffer` argument must not be used
+ * and the callback should return 0. Once the callback returns, the request's
+ * data is then read from or written to the file by the kernel itself, without
+ * being copied to or from the driver's memory.
+ *
+ * For *read* requests, `size` bytes are read from file descriptor \p fd at
+ * offset \p offset into the request. For *write* and *FUA write* requests, the
+ * request's `size` bytes are written to \p fd at offset \p offset (and, for
+ * *FUA write* requests, then synced to stable storage). If the transfer fails
+ * or is short, the request fails with the corresponding `errno` value (or
+ * `EIO`, for short transfers).
+ *
+ * \p fd must not be closed while the driver is running.
+ *
+ * \param fd The file descriptor of the file from or to which data should be
+ *        transferred.
+ * \param offset The offset (in bytes) into the file at which the transfer
+ *        should take place.
+ *
+ * \return On success, `true` is returned. On failure, `false` is returned,
+ *         `errno` is set to an appropriate error number, and the current error
+ *         message is set to a string descriptive of the error (see
+ *         `bdus_get_error_message()`).
+ */
+static inline bool bdus_splice(int fd, uint64_t offset)
+{
+    return bdus_splice_0_1_3_(fd, offset);
+}
+
+/**
+ * \brief Identifies a request whose completion was deferred with
+ *        `bdus_defer()`.
+ */
+struct bdus_request;
+
+uint16_t bdus_get_request_ioprio_0_1_3_(void);
+
+/**
+ * \brief Returns the I/O priority of the request being served by the calling
+ *        thread.
+ *
+ * The priority is encoded as for `ioprio_set(2)`, and its class and level can
+ * be extracted with macros `IOPRIO_PRIO_CLASS()` and `IOPRIO_PRIO_DATA()` from
+ * `<linux/ioprio.h>`. A class of `IOPRIO_CLASS_NONE` means that the request has
+ * no priority of its own.
+ *
+ * This function may be called from request callbacks (*i.e.*, not from
+ * `initialize`, `on_device_available`, `terminate`, `allocate_payload_buffer`,
+ * `free_payload_buffer`, and `async_wait`), and returns 0 if called from
+ * anywhere else.
+ *
+ * \return The I/O priority of the request being served by the calling thread.
+ */
+static inline uint16_t bdus_get_request_ioprio(void)
+{
+    return bdus_get_request_ioprio_0_1_3_();
+}
+
+struct bdus_request *bdus_defer_0_1_3_(void);
+
+/**
+ * \brief Defers the completion of the request being served by the calling
+ *        thread.
+ *
+ * This function may only be called from request callbacks (*i.e.*, not from
+ * `initialize`, `on_device_available`, `terminate`, `allocate_payload_buffer`,
+ * `free_payload_buffer`, and `async_wait`), and only if attribute
+ * `async_queue_depth` is positive.
+ *
+ * If it succeeds, the callback's return value is ignored, and the request
+ * remains in progress until `bdus_complete()` is called with the returned
+ * handle. The callback's `buffer` or `argument` parameter remains valid until
+ * then, so that, for instance, data for *read* requests can be written to it
+ * after the callback returns.
+ *
+ * \return On success, returns a handle to the request. On failure, `NULL` is
+ *         returned, `errno` is set to an appropriate error number, and the
+ *         current error message is set to a string descriptive of the error
+ *         (see `bdus_get_error_message()`).
+ */
+static inline struct bdus_request *bdus_defer(void)
+{
+    return bdus_defer_0_1_3_();
+}
+
+bool bdus_complete_0_1_3_(struct bdus_request *request, int error);
+
+/**
+ * \brief Completes a request whose completion was deferred with
+ *        `bdus_defer()`.
+ *
+ * This function may be called from any thread, including from callbacks, but
+ * only once per request. Requests may be completed in any order. The request's
+ * handle must not be used after this function is called.
+ *
+ * \param request The request's handle, as returned by `bdus_defer()`.
+ * \param error The request's result, as would be returned by its callback
+ *        if it had not been deferred: 0 on success, an `errno` value on
+ *        failure, or `bdus_abort` to terminate the driver.
+ *
+ * \return On success, `true` is returned. On failure, `false` is returned,
+ *         `errno` is set to an appropriate error number, and the current error
+ *         message is set to a string descriptive of the error (see
+ *         `bdus_get_error_message()`). The request is completed regardless,
+ *         but if sending its result to the kernel failed the driver then
+ *         terminates.
+ */
+static inline bool bdus_complete(struct bdus_request *request, int error)
+{
+    return bdus_complete_0_1_3_(request, error);
+}
+
+bool bdus_set_zero_range_0_1_3_(
+    struct bdus_ctx *ctx, uint64_t offset, uint64_t size, bool zero);
+
+/**
+ * \brief Tells the kernel whether a region of the device is known to contain
+ *        only zeros.
+ *
+ * The driver must have set attribute `zero_extent_size`, and the kernel tracks
+ * the device's contents with that granularity: if \p zero is `true`, only
+ * extents that lie entirely within the region become known to contain only
+ * zeros, and otherwise all extents that overlap the region stop being known to
+ * contain only zeros.
+ *
+ * Requests that may modify the region and are still in progress when it is
+ * marked as containing only zeros, including requests that the driver has not
+ * yet received, make it stop being known to contain only zeros when they
+ * complete. However, the driver must ensure that no such request completed
+ * since the region last contained only zeros, *e.g.*, by only marking regions
+ * from callbacks `initialize` or `on_device_available`.
+ *
+ * This function may be called from any thread, including from callbacks, from
+ * the start of callback `initialize` until callback `terminate` returns. It
+ * does not require privileges, and so may be used after the driver drops them.
+ *
+ * \param ctx The driver's context, as given to its callbacks.
+ * \param offset The offset (in bytes) into the device of the region, which
+ *        must be a multiple of the device's logical block size.
+ * \param size The size (in bytes) of the region, which must be a multiple of
+ *        the device's logical block size.
+ * \param zero Whether the region is known to contain only zeros.
+ *
+ * \return On success, returns `true`. On failure, `false` is returned, `errno`
+ *         is set to an appropriate error number, and the current error message
+ *         is set to a string descriptive of the error (see
+ *         `bdus_get_error_message()`).
+ */
+static inline bool bdus_set_zero_range(
+    struct bdus_ctx *ctx, uint64_t offset, uint64_t size, bool zero)
+{
+    return bdus_set_zero_range_0_1_3_(ctx, offset, size, zero);
+}
+
+bool bdus_invalidate_read_cache_0_1_3_(
+    struct bdus_ctx *ctx, uint64_t offset, uint64_t size);
+
+/**
+ * \brief Removes the data of a region of the device from the kernel's read
+ *        cache.
+ *
+ * This must be used if the device's contents change by means other than
+ * requests submitted to the device. It succeeds with no effect if attribute
+ * `read_cache_size` is 0.
+ *
+ * This function may be called from any thread, including from callbacks, from
+ * the start of callback `initialize` until callback `terminate` returns. It
+ * does not require privileges, and so may be used after the driver drops them.
+ *
+ * \param ctx The driver's context, as given to its callbacks.
+ * \param offset The offset (in bytes) into the device of the region.
+ * \param size The size (in bytes) of the region.
+ *
+ * \return On success, returns `true`. On failure, `false` is returned, `errno`
+ *         is set to an appropriate error number, and the current error message
+ *         is set to a string descriptive of the error (see
+ *         `bdus_get_error_message()`).
+ */
+static inline bool bdus_invalidate_read_cache(
+    struct bdus_ctx *ctx, uint64_t offset, uint64_t size)
+{
+    return bdus_invalidate_read_cache_0_1_3_(ctx, offset, size);
+}
+
+#endif
+
 /* -------------------------------------------------------------------------- */
 /* device management */
 
@@ -944,6 +2305,359 @@ static inline bool bdus_destroy_dev(uint64_t dev_id)
     return bdus_destroy_dev_0_1_0_(dev_id);
 }
 
+#if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+
+/**
+ * \brief A request recorded in a device's trace.
+ *
+ * See `struct bdus_attrs.trace_size`.
+ */
+struct bdus_trace_entry
+{
+    /**
+     * \brief The request's type.
+     *
+     * One of `"read"`, `"write"`, `"write_same"`, `"write_zeros_no_unmap"`,
+     * `"write_zeros_may_unmap"`, `"fua_write"`, `"flush"`, `"discard"`,
+     * `"secure_erase"`, and `"ioctl"`.
+     */
+    const char *type;
+
+    /** \brief The offset (in bytes) into the device targeted by the request. */
+    uint64_t offset;
+
+    /**
+     * \brief The size (in bytes) of the region targeted by the request, or the
+     *        command of *ioctl* requests.
+     */
+    uint32_t size;
+
+    /** \brief The value returned by the callback serving the request. */
+    int32_t error;
+
+    /**
+     * \brief The time (in nanoseconds, as given by `clock_gettime()` with
+     *        `CLOCK_MONOTONIC`) at which the callback was invoked.
+     */
+    uint64_t start_ns;
+
+    /**
+     * \brief For how long (in nanoseconds) the callback ran, saturated at
+     *        `UINT32_MAX`.
+     */
+    uint64_t duration_ns;
+
+    /** \brief The index of the worker thread that served the request. */
+    uint32_t thread_index;
+};
+
+bool bdus_get_dev_trace_0_1_3_(
+    uint64_t dev_id, struct bdus_trace_entry **out_entries,
+    size_t *out_num_entries);
+
+/**
+ * \brief Obtains the requests recorded in a device's trace.
+ *
+ * The device's driver must be running with a positive `trace_size` attribute,
+ * or have been killed while doing so. Entries are sorted by start time.
+ *
+ * This function may be called from any thread. It fails if the effective user
+ * ID of the calling process does not correspond to the `root` user.
+ *
+ * \param dev_id The numerical identifier of the device.
+ * \param out_entries Set to an array with the recorded entries, which must be
+ *        freed using `free()`.
+ * \param out_num_entries Set to the number of entries in the array.
+ *
+ * \return On success, returns `true`. On failure, `false` is returned, `errno`
+ *         is set to an appropriate error number, and the current error message
+ *         is set to a string descriptive of the error (see
+ *         `bdus_get_error_message()`).
+ */
+static inline bool bdus_get_dev_trace(
+    uint64_t dev_id, struct bdus_trace_entry **out_entries,
+    size_t *out_num_entries)
+{
+    return bdus_get_dev_trace_0_1_3_(dev_id, out_entries, out_num_entries);
+}
+
+/**
+ * \brief The number of buckets in each latency histogram of `struct
+ *        bdus_request_stats`.
+ *
+ * Bucket 0 counts latencies under 2^10 nanoseconds, bucket `i` counts latencies
+ * in [2^(9+i), 2^(10+i)) nanoseconds, and the last bucket counts all latencies
+ * of at least 2^32 nanoseconds.
+ */
+#define BDUS_STATS_HIST_BUCKETS 24
+
+/**
+ * \brief The number of request types with separate statistics in `struct
+ *        bdus_dev_stats`.
+ */
+#define BDUS_STATS_NUM_REQ_TYPES 10
+
+/**
+ * \brief Statistics about the requests of a given type that a device has
+ *        received.
+ *
+ * All values are cumulative since the device was created.
+ */
+struct bdus_request_stats
+{
+    /**
+     * \brief The request type.
+     *
+     * One of the types given in `struct bdus_trace_entry.type`.
+     */
+    const char *type;
+
+    /** \brief The number of completed requests. */
+    uint64_t requests;
+
+    /** \brief The total size (in bytes) of completed requests. */
+    uint64_t bytes;
+
+    /** \brief The number of requests that failed, excluding timeouts. */
+    uint64_t errors;
+
+    /** \brief The number of requests that timed out. */
+    uint64_t timeouts;
+
+    /** \brief The number of requests merged into other requests. */
+    uint64_t merges;
+
+    /**
+     * \brief The total time (in nanoseconds) that requests spent being served
+     *        by the driver.
+     */
+    uint64_t service_ns;
+
+    /**
+     * \brief Histogram of the time requests spent waiting to be received by the
+     *        driver.
+     */
+    uint64_t queue_wait_hist[BDUS_STATS_HIST_BUCKETS];
+
+    /**
+     * \brief Histogram of the time requests spent being served by the driver.
+     */
+    uint64_t service_hist[BDUS_STATS_HIST_BUCKETS];
+
+    /**
+     * \brief Histogram of the time spent copying requests' data to and from
+     *        the driver.
+     */
+    uint64_t copy_hist[BDUS_STATS_HIST_BUCKETS];
+};
+
+/** \brief Statistics about a device, as given by `bdus_get_dev_stats()`. */
+struct bdus_dev_stats
+{
+    /**
+     * \brief The time (in nanoseconds, as given by `clock_gettime()` with
+     *        `CLOCK_MONOTONIC`) at which the statistics were taken.
+     */
+    uint64_t timestamp_ns;
+
+    /** \brief The number of requests waiting to be received by the driver. */
+    uint32_t num_awaiting_get;
+
+    /**
+     * \brief The number of requests received by the driver but not yet
+     *        completed.
+     */
+    uint32_t num_in_flight;
+
+    /** \brief Statistics for each request type. */
+    struct bdus_request_stats types[BDUS_STATS_NUM_REQ_TYPES];
+};
+
+bool bdus_get_dev_stats_0_1_3_(
+    uint64_t dev_id, struct bdus_dev_stats *out_stats);
+
+/**
+ * \brief Obtains statistics about a device.
+ *
+ * Rates such as requests per second and bandwidth can be computed from two
+ * calls to this function, using the difference between their `timestamp_ns`.
+ * Counters are not read atomically with respect to each other, so values may be
+ * slightly inconsistent if requests are being processed.
+ *
+ * This function may be called from any thread. It fails if the effective user
+ * ID of the calling process does not correspond to the `root` user.
+ *
+ * \param dev_id The numerical identifier of the device.
+ * \param out_stats Set to the device's statistics.
+ *
+ * \return On success, returns `true`. On failure, `false` is returned, `errno`
+ *         is set to an appropriate error number, and the current error message
+ *         is set to a string descriptive of the error (see
+ *         `bdus_get_error_message()`).
+ */
+static inline bool
+    bdus_get_dev_stats(uint64_t dev_id, struct bdus_dev_stats *out_stats)
+{
+    return bdus_get_dev_stats_0_1_3_(dev_id, out_stats);
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* driver benchmarking */
+
+#if BDUS_REQUIRE_VERSION_MAJOR == 0 && BDUS_REQUIRE_VERSION_MINOR == 1         \
+    && BDUS_REQUIRE_VERSION_PATCH >= 3
+
+/**
+ * \brief Configures the requests generated by `bdus_run_loopback()`.
+ *
+ * Each request's type is chosen at random with probability proportional to
+ * its weight, and its offset and size are chosen uniformly at random among
+ * multiples of the device's logical block size. Types with a weight of 0 are
+ * never generated. If all weights are 0, *read* and *write* requests are
+ * generated with equal weights, among those that the driver supports.
+ */
+struct bdus_loopback_attrs
+{
+    /** \brief The weight of *read* requests. */
+    uint32_t read_weight;
+
+    /** \brief The weight of *write* requests. */
+    uint32_t write_weight;
+
+    /** \brief The weight of *FUA write* requests. */
+    uint32_t fua_write_weight;
+
+    /** \brief The weight of *flush* requests. */
+    uint32_t flush_weight;
+
+    /** \brief The weight of *discard* requests. */
+    uint32_t discard_weight;
+
+    /**
+     * \brief The weight of *write zeros* requests, which are generated with
+     *        argument `may_unmap` set to `false`.
+     */
+    uint32_t write_zeros_weight;
+
+    /**
+     * \brief The minimum size (in bytes) of generated requests, or 0 for the
+     *        system's page size.
+     *
+     * Must be a multiple of the device's logical block size. *Flush* requests
+     * have no size.
+     */
+    uint32_t min_request_size;
+
+    /**
+     * \brief The maximum size (in bytes) of generated requests, or 0 for
+     *        `min_request_size`.
+     *
+     * Must be a multiple of the device's logical block size, not less than
+     * `min_request_size`, and not greater than the device's size nor the
+     * (adjusted) maximum size of any request type with a positive weight.
+     */
+    uint32_t max_request_size;
+
+    /**
+     * \brief The maximum number of requests outstanding at once, or 0 for
+     *        twice `max_concurrent_callbacks`.
+     *
+     * As with requests received from the kernel, each worker thread takes
+     * batches of up to `queue_depth / max_concurrent_callbacks` requests (and
+     * at most 16), and serves them one at a time.
+     */
+    uint32_t queue_depth;
+
+    /** \brief The number of requests to generate, which must be positive. */
+    uint64_t num_requests;
+
+    /**
+     * \brief The seed of the random number generator.
+     *
+     * Runs with the same seed and attributes generate the same requests in the
+     * same order if `max_concurrent_callbacks` is 1.
+     */
+    uint64_t seed;
+};
+
+/**
+ * \brief Statistics about the callbacks invoked by `bdus_run_loopback()`.
+ */
+struct bdus_loopback_results
+{
+    /**
+     * \brief For how long (in nanoseconds) the worker threads ran, from
+     *        being started to all requests having been served.
+     */
+    uint64_t elapsed_ns;
+
+    /**
+     * \brief Statistics for each request type.
+     *
+     * Field `service_hist` gives the latency of callbacks serving requests.
+     * Field `queue_wait_hist` gives the time that requests waited, after being
+     * generated, for the callbacks serving them to be invoked. Fields
+     * `timeouts`, `merges`, and `copy_hist` are always zero, and field `bytes`
+     * includes requests that failed.
+     */
+    struct bdus_request_stats types[BDUS_STATS_NUM_REQ_TYPES];
+};
+
+bool bdus_run_loopback_0_1_3_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data, const struct bdus_loopback_attrs *loopback_attrs,
+    struct bdus_loopback_results *out_results);
+
+/**
+ * \brief Runs a driver against requests generated in-process instead of a
+ *        block device, and measures the latency of its callbacks.
+ *
+ * This function does not require kbdus nor any privileges, so drivers can be
+ * profiled and optimized in isolation from the kernel, such as in containers
+ * or continuous integration.
+ *
+ * The driver is run as by `bdus_run()`, with the same worker threads, batching
+ * of requests, and payload buffer management, except that no device is
+ * created. Attributes are validated and adjusted as they would be for a new
+ * device, except that `async_queue_depth` must be 0, `dont_daemonize` is set
+ * to `true`, `min_concurrent_callbacks` is set to `max_concurrent_callbacks`,
+ * and attributes that configure kbdus or how requests are transferred to and
+ * from it (`num_poll_queues`, `use_io_uring`, `io_uring_polling`, `zero_copy`,
+ * `busy_poll_us`, `zero_extent_size`, `read_cache_size`, `trace_size`,
+ * `allow_handoff`, and `chunk_size`) are set to their default values. Discard
+ * requests always target a single region.
+ *
+ * Callback `on_device_available()` is not invoked. In the `struct bdus_ctx`
+ * given to callbacks, fields `id`, `major`, and `minor` are 0 and field `path`
+ * is `"loopback"`. Function `bdus_splice()` may be used but has no effect.
+ *
+ * \param ops Driver callbacks.
+ * \param attrs Device and driver attributes.
+ * \param private_data The initial value for the `private_data` field of the
+ *        `struct bdus_ctx` given to the driver's callbacks.
+ * \param loopback_attrs Configures the generated requests.
+ * \param out_results Set to statistics about the callbacks that served the
+ *        generated requests.
+ *
+ * \return On success, blocks until all requests are served and returns `true`.
+ *         On failure, `false` is returned, `errno` is set to an appropriate
+ *         error number, and the current error message is set to a string
+ *         descriptive of the error (see `bdus_get_error_message()`).
+ */
+static inline bool bdus_run_loopback(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data, const struct bdus_loopback_attrs *loopback_attrs,
+    struct bdus_loopback_results *out_results)
+{
+    return bdus_run_loopback_0_1_3_(
+        ops, attrs, private_data, loopback_attrs, out_results);
+}
+
+#endif
+
 /* -------------------------------------------------------------------------- */
 /* errors */
 
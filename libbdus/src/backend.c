@@ -2,23 +2,32 @@
 /* -------------------------------------------------------------------------- */
 
 #define _DEFAULT_SOURCE
+#define _GNU_SOURCE
 #define _POSIX_C_SOURCE 200112L
 
 #include <bdus.h>
 #include <libbdus/backend.h>
+#include <libbdus/uring.h>
 #include <libbdus/utilities.h>
 
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <kbdus.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 /* -------------------------------------------------------------------------- */
@@ -34,11 +43,9 @@ static int bdus_backend_on_device_available_default_(struct bdus_ctx *ctx)
     return 0;
 }
 
-static bool
-    bdus_backend_on_device_available_(struct bdus_ctx *ctx, int thread_index)
+static bool bdus_backend_invoke_on_device_available_(
+    struct bdus_ctx *ctx, int thread_index)
 {
-    // invoke on_device_available() callback
-
     int ret;
 
     if (ctx->ops->on_device_available)
@@ -68,6 +75,17 @@ static bool
         return false;
     }
 
+    return true;
+}
+
+static bool
+    bdus_backend_on_device_available_(struct bdus_ctx *ctx, int thread_index)
+{
+    // invoke on_device_available() callback
+
+    if (!bdus_backend_invoke_on_device_available_(ctx, thread_index))
+        return false;
+
     // daemonize the current process
 
     if (!ctx->attrs->dont_daemonize)
@@ -100,14 +118,143 @@ static void bdus_backend_process_flush_request_(
     *out_error = (int32_t)ctx->ops->flush(ctx);
 }
 
-static ssize_t bdus_backend_process_request_(
-    struct bdus_ctx *ctx, int thread_index, void *payload, uint32_t type,
-    uint64_t arg64, uint32_t arg32, int32_t *out_error)
+// Invokes callback `readv`, `writev`, or `fua_writev`, whose name is `name`.
+// If `iov` is NULL, the request's data is described by a single region
+// starting at `payload` instead.
+static int32_t bdus_backend_invoke_vector_callback_(
+    struct bdus_ctx *ctx, int thread_index, const char *name,
+    int (*callback)(
+        const struct iovec *, int, uint64_t, uint32_t, struct bdus_ctx *),
+    void *payload, const struct iovec *iov, int iovcnt, uint64_t offset,
+    uint32_t size)
+{
+    struct iovec payload_iov;
+
+    if (!iov)
+    {
+        payload_iov.iov_base = payload;
+        payload_iov.iov_len  = (size_t)size;
+
+        iov    = &payload_iov;
+        iovcnt = 1;
+    }
+
+    // log callback invocation
+
+    if (ctx->attrs->log)
+    {
+        bdus_log_thread_(
+            thread_index, "%s(%p, %d, %" PRIu64 ", %" PRIu32 ", ctx)", name,
+            (const void *)iov, iovcnt, offset, size);
+    }
+
+    // invoke callback
+
+    return (int32_t)callback(iov, iovcnt, offset, size, ctx);
+}
+
+// Serves a *discard* request targeting the `num_ranges` regions in `ranges`,
+// through callback `discard_ranges` if implemented or `discard` otherwise.
+static int32_t bdus_backend_process_discard_request_(
+    struct bdus_ctx *ctx, int thread_index, const struct bdus_range *ranges,
+    uint32_t num_ranges)
+{
+    if (ctx->ops->discard_ranges)
+    {
+        // log callback invocation
+
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                thread_index, "discard_ranges(%p, %" PRIu32 ", ctx)",
+                (const void *)ranges, num_ranges);
+        }
+
+        // invoke 'discard_ranges' callback
+
+        return (int32_t)ctx->ops->discard_ranges(ranges, num_ranges, ctx);
+    }
+
+    for (uint32_t i = 0; i < num_ranges; ++i)
+    {
+        // log callback invocation
+
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                thread_index, "discard(%" PRIu64 ", %" PRIu32 ", ctx)",
+                ranges[i].offset, ranges[i].size);
+        }
+
+        // invoke 'discard' callback
+
+        const int32_t error =
+            (int32_t)ctx->ops->discard(ranges[i].offset, ranges[i].size, ctx);
+
+        if (error != 0)
+            return error;
+    }
+
+    return 0;
+}
+
+// Serves a *zone report* request for at most `max_zones` zones starting at
+// `offset`, setting `*out_num_zones` before invoking the callback so that the
+// reply is complete even if the callback defers the request.
+static void bdus_backend_process_zone_report_request_(
+    struct bdus_ctx *ctx, int thread_index, struct bdus_zone *zones,
+    uint64_t offset, uint32_t max_zones, int32_t *out_error,
+    uint64_t *out_num_zones)
+{
+    // the kernel may ask for more zones than the device has left
+
+    const uint64_t zone_size = ctx->attrs->zone_size;
+
+    const uint32_t num_zones = (uint32_t)bdus_min_(
+        (uint64_t)max_zones,
+        (ctx->attrs->size - offset + zone_size - 1) / zone_size);
+
+    memset(zones, 0, (size_t)num_zones * sizeof(*zones));
+    *out_num_zones = (uint64_t)num_zones;
+
+    // log callback invocation
+
+    if (ctx->attrs->log)
+    {
+        bdus_log_thread_(
+            thread_index, "report_zones(%p, %" PRIu64 ", %" PRIu32 ", ctx)",
+            (void *)zones, offset, num_zones);
+    }
+
+    // invoke 'report_zones' callback
+
+    *out_error = (int32_t)ctx->ops->report_zones(zones, offset, num_zones, ctx);
+}
+
+// If `iov` is not NULL, it describes the data of *read*, *write*, and *FUA
+// write* requests, which is otherwise in `payload`. If `num_ranges` is
+// positive, `payload` holds the regions targeted by a *discard* request.
+// `*out_arg64` receives the 64-bit result of *zone report* and *zone append*
+// requests, and may be NULL for requests of other types.
+static ssize_t bdus_backend_serve_request_(
+    struct bdus_ctx *ctx, int thread_index, void *payload,
+    const struct iovec *iov, int iovcnt, uint32_t type, uint64_t arg64,
+    uint32_t arg32, uint32_t num_ranges, int32_t *out_error,
+    uint64_t *out_arg64)
 {
     switch (type)
     {
     case KBDUS_ITEM_TYPE_READ:
 
+        if (ctx->ops->readv)
+        {
+            *out_error = bdus_backend_invoke_vector_callback_(
+                ctx, thread_index, "readv", ctx->ops->readv, payload, iov,
+                iovcnt, arg64, arg32);
+
+            return *out_error == 0 ? (ssize_t)arg32 : 0;
+        }
+
         // log callback invocation
 
         if (ctx->attrs->log)
@@ -125,6 +272,15 @@ static ssize_t bdus_backend_process_request_(
 
     case KBDUS_ITEM_TYPE_WRITE:
 
+        if (ctx->ops->writev)
+        {
+            *out_error = bdus_backend_invoke_vector_callback_(
+                ctx, thread_index, "writev", ctx->ops->writev, payload, iov,
+                iovcnt, arg64, arg32);
+
+            return 0;
+        }
+
         // log callback invocation
 
         if (ctx->attrs->log)
@@ -195,6 +351,15 @@ static ssize_t bdus_backend_process_request_(
 
     case KBDUS_ITEM_TYPE_FUA_WRITE:
 
+        if (ctx->ops->fua_writev)
+        {
+            *out_error = bdus_backend_invoke_vector_callback_(
+                ctx, thread_index, "fua_writev", ctx->ops->fua_writev, payload,
+                iov, iovcnt, arg64, arg32);
+
+            return 0;
+        }
+
         // log callback invocation
 
         if (ctx->attrs->log)
@@ -218,18 +383,20 @@ static ssize_t bdus_backend_process_request_(
 
     case KBDUS_ITEM_TYPE_DISCARD:
 
-        // log callback invocation
-
-        if (ctx->attrs->log)
+        if (num_ranges > 0)
         {
-            bdus_log_thread_(
-                thread_index, "discard(%" PRIu64 ", %" PRIu32 ", ctx)", arg64,
-                arg32);
-        }
+            // `struct kbdus_range` and `struct bdus_range` have the same layout
 
-        // invoke 'discard' callback
+            *out_error = bdus_backend_process_discard_request_(
+                ctx, thread_index, payload, num_ranges);
+        }
+        else
+        {
+            const struct bdus_range range = { .offset = arg64, .size = arg32 };
 
-        *out_error = (int32_t)ctx->ops->discard(arg64, arg32, ctx);
+            *out_error = bdus_backend_process_discard_request_(
+                ctx, thread_index, &range, 1);
+        }
 
         return 0;
 
@@ -311,418 +478,3901 @@ static ssize_t bdus_backend_process_request_(
                 : 0;
         }
 
-    default:
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
 
-        // unknown request type
+        // `struct kbdus_zone` and `struct bdus_zone` have the same layout
 
-        return (ssize_t)(-1);
-    }
-}
+        bdus_backend_process_zone_report_request_(
+            ctx, thread_index, payload, arg64, arg32, out_error, out_arg64);
 
-/* -------------------------------------------------------------------------- */
+        return *out_error == 0
+            ? (ssize_t)(*out_arg64 * sizeof(struct bdus_zone))
+            : 0;
 
-enum
-{
-    BDUS_STATUS_DEVICE_AVAILABLE_,
-    BDUS_STATUS_TERMINATE_,
-    BDUS_STATUS_ERROR_,
-};
+    case KBDUS_ITEM_TYPE_ZONE_RESET:
 
-struct bdus_thread_ctx_
-{
-    struct bdus_ctx *ctx;
-    int control_fd;
+        // log callback invocation
 
-    pthread_t thread;
-    size_t thread_index;
-    union kbdus_reply_or_item *rai;
-    void *payload;
-    bool allow_device_available;
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                thread_index, "reset_zone(%" PRIu64 ", ctx)", arg64);
+        }
 
-    int status;
-    int error_errno;
-    const char *error_message;
-};
+        // invoke 'reset_zone' callback
 
-static size_t bdus_max_request_payload_size_(const struct bdus_ctx *ctx)
-{
-    size_t size = (size_t)ctx->attrs->max_read_write_size;
+        *out_error = (int32_t)ctx->ops->reset_zone(arg64, ctx);
 
-    if (ctx->ops->write_same)
-        size = bdus_max_(size, (size_t)ctx->attrs->logical_block_size);
+        return 0;
 
-    if (ctx->ops->ioctl)
-        size = bdus_max_(size, (size_t)1 << 14);
+    case KBDUS_ITEM_TYPE_ZONE_OPEN:
 
-    return size;
-}
+        // log callback invocation
 
-/* -------------------------------------------------------------------------- */
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                thread_index, "open_zone(%" PRIu64 ", ctx)", arg64);
+        }
 
-static bool bdus_send_reply_and_receive_item_(struct bdus_thread_ctx_ *context)
-{
-    const int ret = bdus_ioctl_arg_retry_(
-        context->control_fd, KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM,
-        (void *)context->thread_index);
+        // invoke 'open_zone' callback
 
-    if (ret == 0)
-    {
-        return true;
-    }
-    else
-    {
-        context->status      = BDUS_STATUS_ERROR_;
-        context->error_errno = errno;
-        context->error_message =
-            "Failed to issue ioctl with command"
-            " KBDUS_IOCTL_SEND_REPLY_AND_RECEIVE_ITEM to /dev/bdus-control";
+        *out_error = (int32_t)ctx->ops->open_zone(arg64, ctx);
 
-        return false;
-    }
-}
+        return 0;
 
-static bool bdus_process_item_(struct bdus_thread_ctx_ *context)
-{
-    ssize_t reply_payload_size;
+    case KBDUS_ITEM_TYPE_ZONE_CLOSE:
 
-    switch (context->rai->item.type)
-    {
-    case KBDUS_ITEM_TYPE_DEVICE_AVAILABLE:
+        // log callback invocation
 
-        if (context->allow_device_available)
-        {
-            context->status = BDUS_STATUS_DEVICE_AVAILABLE_;
-        }
-        else
+        if (ctx->attrs->log)
         {
-            context->status      = BDUS_STATUS_ERROR_;
-            context->error_errno = EINVAL;
-            context->error_message =
-                "Received \"device available\" notification more than once";
+            bdus_log_thread_(
+                thread_index, "close_zone(%" PRIu64 ", ctx)", arg64);
         }
 
-        return false;
-
-    case KBDUS_ITEM_TYPE_TERMINATE:
+        // invoke 'close_zone' callback
 
-        context->status = BDUS_STATUS_TERMINATE_;
+        *out_error = (int32_t)ctx->ops->close_zone(arg64, ctx);
 
-        return false;
+        return 0;
 
-    case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
+    case KBDUS_ITEM_TYPE_ZONE_FINISH:
 
-        bdus_backend_process_flush_request_(
-            context->ctx, (int)context->thread_index,
-            &context->rai->reply.error);
+        // log callback invocation
 
-        if (context->rai->reply.error == 0)
-        {
-            context->status = BDUS_STATUS_TERMINATE_;
-        }
-        else
+        if (ctx->attrs->log)
         {
-            context->status        = BDUS_STATUS_ERROR_;
-            context->error_errno   = EIO;
-            context->error_message = "Failed to flush before terminating";
+            bdus_log_thread_(
+                thread_index, "finish_zone(%" PRIu64 ", ctx)", arg64);
         }
 
-        return false;
+        // invoke 'finish_zone' callback
 
-    default:
+        *out_error = (int32_t)ctx->ops->finish_zone(arg64, ctx);
 
-        reply_payload_size = bdus_backend_process_request_(
-            context->ctx, (int)context->thread_index, context->payload,
-            context->rai->item.type, context->rai->item.arg64,
-            context->rai->item.arg32, &context->rai->reply.error);
+        return 0;
 
-        if (reply_payload_size < 0)
-        {
-            context->status        = BDUS_STATUS_ERROR_;
-            context->error_errno   = EINVAL;
-            context->error_message = "Received item of unknown type";
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
 
-            return false;
-        }
-        else if (context->rai->reply.error == (int32_t)bdus_abort)
-        {
-            context->status        = BDUS_STATUS_ERROR_;
-            context->error_errno   = EIO;
-            context->error_message = "Driver aborted";
+        // log callback invocation
 
-            return false;
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                thread_index,
+                "append_to_zone(%p, %" PRIu64 ", %" PRIu32 ", &offset, ctx)",
+                payload, arg64, arg32);
         }
 
-        return true;
-    }
-}
+        // invoke 'append_to_zone' callback
 
-static void bdus_work_loop_(struct bdus_thread_ctx_ *context)
-{
-    context->rai->common.user_ptr_or_buffer_index =
-        (uint32_t)context->thread_index;
+        *out_error = (int32_t)ctx->ops->append_to_zone(
+            payload, arg64, arg32, out_arg64, ctx);
 
-    context->rai->common.handle_index            = UINT16_C(0);
-    context->rai->common.use_preallocated_buffer = UINT8_C(1);
+        return 0;
 
-    // receive items, process them, and send replies
+    default:
 
-    while (true)
-    {
-        if (!bdus_send_reply_and_receive_item_(context))
-            break; // error
+        // unknown request type
 
-        if (!bdus_process_item_(context))
-            break; // error or received notification
+        return (ssize_t)(-1);
     }
+}
 
-    // check if error occurred
-
-    if (context->status == BDUS_STATUS_ERROR_)
+// Like bdus_backend_serve_request_(), but also records the request into
+// `trace_ring` if it is not NULL.
+static ssize_t bdus_backend_process_request_(
+    struct bdus_ctx *ctx, struct bdus_trace_ring_ *trace_ring,
+    int thread_index, void *payload, const struct iovec *iov, int iovcnt,
+    uint32_t type, uint64_t arg64, uint32_t arg32, uint32_t num_ranges,
+    int32_t *out_error, uint64_t *out_arg64)
+{
+    if (!trace_ring)
     {
-        // work loop failed, terminate control file description so that other
-        // worker threads terminate
-
-        if (bdus_ioctl_retry_(context->control_fd, KBDUS_IOCTL_TERMINATE) != 0)
-            abort();
+        return bdus_backend_serve_request_(
+            ctx, thread_index, payload, iov, iovcnt, type, arg64, arg32,
+            num_ranges, out_error, out_arg64);
     }
-}
 
-static void *bdus_work_loop_void_(void *context)
-{
-    bdus_work_loop_(context);
-    return NULL;
+    const uint64_t start_ns = bdus_trace_now_ns_();
+
+    const ssize_t reply_payload_size = bdus_backend_serve_request_(
+        ctx, thread_index, payload, iov, iovcnt, type, arg64, arg32,
+        num_ranges, out_error, out_arg64);
+
+    bdus_trace_record_(
+        trace_ring, type, arg64, arg32, *out_error, start_ns,
+        bdus_trace_now_ns_());
+
+    return reply_payload_size;
 }
 
 /* -------------------------------------------------------------------------- */
 
-static bool bdus_run_3_(struct bdus_thread_ctx_ *contexts, size_t num_threads)
+// The maximum number of items that a worker thread receives at once.
+enum
 {
-    // run multi-threaded until device terminates or error
+    BDUS_MAX_BATCH_SIZE_ = 16,
+};
 
-    for (size_t i = 1; i < num_threads; ++i)
-    {
-        const int ret = pthread_create(
-            &contexts[i].thread, NULL, bdus_work_loop_void_, &contexts[i]);
+enum
+{
+    BDUS_STATUS_DEVICE_AVAILABLE_,
+    BDUS_STATUS_TERMINATE_,
+    BDUS_STATUS_IDLE_,
+    BDUS_STATUS_ERROR_,
+};
 
-        if (ret != 0)
-        {
-            if (bdus_ioctl_retry_(contexts[i].control_fd, KBDUS_IOCTL_TERMINATE)
-                != 0)
-            {
-                abort();
+enum
+{
+    BDUS_THREAD_STOPPED_, // not running, and joined if it ever ran
+    BDUS_THREAD_RUNNING_,
+    BDUS_THREAD_EXITED_, // exited due to inactivity, but not yet joined
+};
+
+struct bdus_thread_ctx_;
+
+// After a payload buffer in process memory serves this many requests in a row
+// whose payloads all fit in a smaller size class than the memory backing the
+// buffer, the excess memory is released.
+#define BDUS_PAYLOAD_TRIM_THRESHOLD_ 256
+
+// How much of a payload buffer in process memory is backed by memory. Buffers
+// are only backed by memory once used, up to the size class (the page size
+// times a power of two) of the largest payload they have held.
+struct bdus_payload_usage_
+{
+    size_t backed_size;
+
+    // the number of consecutive requests whose payloads fit in a smaller size
+    // class than `backed_size`, and the largest such size class
+    uint32_t num_smaller;
+    size_t max_smaller_size;
+};
+
+// The worker threads of a driver, only some of which may be running at any
+// given time if `min_threads` is less than `num_threads`.
+struct bdus_pool_
+{
+    struct bdus_thread_ctx_ *contexts;
+    size_t num_threads;
+    size_t min_threads;
+
+    // what is needed to set up the payload buffers of threads spawned on
+    // demand
+    size_t max_payload_size;
+    size_t rai_memory_size;
+    size_t single_payload_memory_size;
+    size_t page_size;
+
+    // protects `allow_spawning` and the `state` of every thread
+    pthread_mutex_t mutex;
+    bool allow_spawning;
+
+    // NULL if the device is not being handed off
+    struct bdus_handoff_ *handoff;
+};
+
+// The number of request types that bdus_backend_run_loopback_() can generate.
+#define BDUS_LOOPBACK_NUM_TYPES_ 6
+
+// The state shared by the worker threads of a driver run by
+// bdus_backend_run_loopback_().
+struct bdus_loopback_
+{
+    const struct bdus_loopback_attrs *attrs;
+
+    // the types of requests to generate, and the sum of the weights of each
+    // type and those before it
+    uint32_t types[BDUS_LOOPBACK_NUM_TYPES_];
+    uint64_t cumulative_weights[BDUS_LOOPBACK_NUM_TYPES_];
+    size_t num_types;
+
+    // the number of requests not yet taken by any worker thread
+    uint64_t remaining;
+
+    // set when a worker thread fails, so that the others stop taking requests
+    bool stop;
+};
+
+// The state of a worker thread of a driver run by bdus_backend_run_loopback_().
+struct bdus_loopback_thread_
+{
+    struct bdus_loopback_ *shared;
+
+    // the state of the thread's xorshift64* random number generator, which is
+    // never 0
+    uint64_t random_state;
+
+    // the time at which the thread's current batch of requests was generated
+    uint64_t batch_ns;
+
+    // indexed by request type minus `KBDUS_ITEM_TYPE_READ`
+    struct bdus_request_stats stats[BDUS_STATS_NUM_REQ_TYPES];
+};
+
+struct bdus_thread_ctx_
+{
+    struct bdus_ctx *ctx;
+    int control_fd;
+
+    // if not NULL, items are generated in-process instead of being received
+    // from kbdus, and `control_fd` is -1
+    struct bdus_loopback_thread_ *loopback;
+
+    // processes a single item, and is chosen by bdus_select_item_processor_()
+    // once the rest of the context is initialized
+    bool (*process_item)(
+        struct bdus_thread_ctx_ *context, union kbdus_reply_or_item *rai,
+        void *payload, const struct iovec *iov, int iovcnt);
+
+    // the driver's 'read' and 'write' callbacks, if `process_item` is
+    // bdus_process_item_read_write_()
+    int (*read)(
+        char *buffer, uint64_t offset, uint32_t size, struct bdus_ctx *ctx);
+    int (*write)(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx);
+
+    struct bdus_pool_ *pool;
+    int state;
+
+    pthread_t thread;
+    size_t thread_index;
+    bool allow_device_available;
+
+    // NULL if requests are not traced
+    struct bdus_trace_ring_ *trace_ring;
+
+    // the thread's batch of rais, from which items are received from the
+    // hardware queue with index `batch.queue_index`
+    struct kbdus_batch batch;
+    union kbdus_reply_or_item *rais;
+
+    // if not NULL, replies and items are transferred through this io_uring
+    // instance instead of ioctls, and the first `num_replies` rais hold
+    // replies yet to be sent
+    struct bdus_uring_ *uring;
+    size_t num_replies;
+
+    // if payload windows are used (see `window`), the payload buffer for the
+    // first rai is preallocated, and those for the remaining rais are
+    // consecutive `payload_size` buffers in `extra_payloads`; otherwise, the
+    // buffers for all rais are in `extra_payloads`
+    void *payload;
+    char *extra_payloads;
+    size_t payload_size;
+
+    // if not NULL, `extra_payloads` was mapped by libbdus itself and has the
+    // given size, and this describes how much of each buffer is backed by
+    // memory
+    struct bdus_payload_usage_ *payload_usage;
+    size_t extra_payloads_size;
+
+    // if not NULL, the payload window paired with the preallocated buffer,
+    // through which the first rai's payload is accessed when the kernel
+    // mapped it instead of copying it, and a read-only mapping of the same
+    // window, through which the payloads of requests other than *read*
+    // requests are accessed (kbdus only maps those into read-only mappings)
+    void *window;
+    void *read_only_window;
+
+    // if `window` is not NULL, room for as many regions as the window has
+    // pages, describing the first rai's payload when the kernel mapped it
+    // into the window as several segments
+    struct iovec *window_iovecs;
+    size_t max_window_iovecs;
+
+    // if not NULL, the region allocated by the driver's
+    // allocate_payload_buffer() callback, which holds the payload buffers of
+    // all rais instead of the above
+    void *driver_payloads;
+
+    bool pin_to_cpus;
+    cpu_set_t cpus;
+
+    int status;
+    int error_errno;
+    const char *error_message;
+};
+
+// The reply to the *read*, *write*, or *FUA write* request being served by the
+// calling thread's callback, if any.
+static __thread struct kbdus_reply *bdus_splice_reply_ = NULL;
+
+// The I/O priority of the request being served by the calling thread's
+// callback, or 0 if there is none.
+static __thread uint16_t bdus_request_ioprio_ = 0;
+
+uint16_t bdus_backend_get_request_ioprio_(void)
+{
+    return bdus_request_ioprio_;
+}
+
+bool bdus_backend_splice_(int fd, uint64_t offset)
+{
+    if (!bdus_splice_reply_)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "bdus_splice() may only be called from read, write, and fua_write"
+            " callbacks");
+
+        return false;
+    }
+
+    if (fd < 0)
+    {
+        bdus_set_error_(EBADF, "Invalid file descriptor %d", fd);
+        return false;
+    }
+
+    bdus_splice_reply_->splice_offset = offset;
+    bdus_splice_reply_->splice_fd     = (int32_t)fd;
+    bdus_splice_reply_->use_splice    = UINT8_C(1);
+
+    return true;
+}
+
+static size_t bdus_max_request_payload_size_(const struct bdus_ctx *ctx)
+{
+    size_t size = (size_t)ctx->attrs->max_read_write_size;
+
+    // only a single chunk of a large request is held at once
+
+    if (ctx->attrs->chunk_size > 0)
+        size = bdus_min_(size, (size_t)ctx->attrs->chunk_size);
+
+    if (ctx->ops->write_same)
+        size = bdus_max_(size, (size_t)ctx->attrs->logical_block_size);
+
+    if (ctx->ops->ioctl)
+        size = bdus_max_(size, (size_t)1 << 14);
+
+    if (ctx->attrs->max_discard_ranges > 1)
+    {
+        size = bdus_max_(
+            size, (size_t)ctx->attrs->max_discard_ranges
+                      * sizeof(struct kbdus_range));
+    }
+
+    if (ctx->ops->report_zones)
+    {
+        size = bdus_max_(size, (size_t)ctx->attrs->max_zone_append_size);
+        size = bdus_max_(
+            size,
+            (size_t)KBDUS_MAX_ZONES_PER_REPORT * sizeof(struct kbdus_zone));
+    }
+
+    return size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint64_t bdus_loopback_random_(struct bdus_loopback_thread_ *loopback)
+{
+    uint64_t x = loopback->random_state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+
+    loopback->random_state = x;
+
+    return x * UINT64_C(2685821657736338717);
+}
+
+// Returns a random multiple of `block_size` in [`min`, `max`], which must both
+// be multiples of it.
+static uint64_t bdus_loopback_random_multiple_(
+    struct bdus_loopback_thread_ *loopback, uint64_t min, uint64_t max,
+    uint64_t block_size)
+{
+    const uint64_t num_choices = (max - min) / block_size + 1;
+
+    return min + (bdus_loopback_random_(loopback) % num_choices) * block_size;
+}
+
+// Generates the given thread's next batch of items, taking them from the
+// requests not yet taken by any thread, or a single "terminate" notification
+// if there are none left. Returns the number of generated items.
+static size_t bdus_loopback_generate_items_(struct bdus_thread_ctx_ *context)
+{
+    struct bdus_loopback_thread_ *const loopback = context->loopback;
+    struct bdus_loopback_ *const shared          = loopback->shared;
+
+    const struct bdus_attrs *const attrs = context->ctx->attrs;
+
+    // take requests
+
+    uint64_t remaining = __atomic_load_n(&shared->remaining, __ATOMIC_RELAXED);
+    uint64_t num_items;
+
+    do
+    {
+        num_items = __atomic_load_n(&shared->stop, __ATOMIC_RELAXED)
+            ? 0
+            : bdus_min_(remaining, (uint64_t)context->batch.size);
+    } while (num_items > 0
+             && !__atomic_compare_exchange_n(
+                 &shared->remaining, &remaining, remaining - num_items, true,
+                 __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (num_items == 0)
+    {
+        context->rais[0].item.type = KBDUS_ITEM_TYPE_TERMINATE;
+        return 1;
+    }
+
+    // generate items (replies overwrite some of their fields, which are thus
+    // all reset)
+
+    const uint64_t total_weight =
+        shared->cumulative_weights[shared->num_types - 1];
+
+    const uint64_t block_size = (uint64_t)attrs->logical_block_size;
+
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        struct kbdus_item *const item = &context->rais[i].item;
+
+        const uint64_t weight = bdus_loopback_random_(loopback) % total_weight;
+
+        size_t t = 0;
+
+        while (weight >= shared->cumulative_weights[t])
+            ++t;
+
+        item->type = (uint8_t)shared->types[t];
+
+        if (item->type == KBDUS_ITEM_TYPE_FLUSH)
+        {
+            item->arg32 = 0;
+            item->arg64 = 0;
+        }
+        else
+        {
+            item->arg32 = (uint32_t)bdus_loopback_random_multiple_(
+                loopback, (uint64_t)shared->attrs->min_request_size,
+                (uint64_t)shared->attrs->max_request_size, block_size);
+
+            item->arg64 = bdus_loopback_random_multiple_(
+                loopback, 0, attrs->size - (uint64_t)item->arg32, block_size);
+        }
+
+        item->payload_is_mapped  = UINT8_C(0);
+        item->payload_is_chunked = UINT8_C(0);
+        item->num_segments       = UINT16_C(0);
+        item->num_ranges         = UINT16_C(0);
+        item->ioprio             = UINT16_C(0);
+        item->op_flags           = UINT8_C(0);
+    }
+
+    loopback->batch_ns = bdus_trace_now_ns_();
+
+    return (size_t)num_items;
+}
+
+// Returns the index of the bucket of a `struct bdus_request_stats` histogram
+// that counts the given latency.
+static size_t bdus_loopback_hist_bucket_(uint64_t ns)
+{
+    size_t bucket = 0;
+
+    for (ns >>= 10; ns > 0 && bucket < BDUS_STATS_HIST_BUCKETS - 1; ns >>= 1)
+        ++bucket;
+
+    return bucket;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the number of received items, or 0 on error or if the thread timed
+// out waiting for items.
+static size_t
+    bdus_send_replies_and_receive_items_(struct bdus_thread_ctx_ *context)
+{
+    if (context->loopback)
+        return bdus_loopback_generate_items_(context);
+
+    if (context->uring)
+    {
+        const int ret = bdus_uring_send_replies_and_receive_items_(
+            context->uring, context->rais, context->num_replies,
+            (size_t)context->batch.size, (size_t)context->batch.queue_index);
+
+        if (ret > 0)
+        {
+            context->num_replies = (size_t)ret;
+            return (size_t)ret;
+        }
+        else if (ret < 0)
+        {
+            context->status      = BDUS_STATUS_ERROR_;
+            context->error_errno = errno;
+            context->error_message =
+                "Failed to send replies and receive items through io_uring on"
+                " /dev/bdus-control";
+
+            return 0;
+        }
+
+        // no items were available and the replies were sent, so block in the
+        // ioctl below, which wakes up only this thread once an item arrives
+
+        for (size_t i = 0; i < (size_t)context->batch.size; ++i)
+            context->rais[i].reply.handle_index = 0;
+
+        context->num_replies = 0;
+    }
+
+    const int ret = bdus_ioctl_arg_retry_(
+        context->control_fd, KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS,
+        &context->batch);
+
+    if (ret > 0)
+    {
+        if (context->uring)
+            context->num_replies = (size_t)ret;
+
+        return (size_t)ret;
+    }
+    else if (ret < 0 && errno == ETIMEDOUT)
+    {
+        context->status = BDUS_STATUS_IDLE_;
+        return 0;
+    }
+    else
+    {
+        context->status      = BDUS_STATUS_ERROR_;
+        context->error_errno = ret == 0 ? EIO : errno;
+        context->error_message =
+            "Failed to issue ioctl with command"
+            " KBDUS_IOCTL_SEND_REPLIES_AND_RECEIVE_ITEMS to /dev/bdus-control";
+
+        return 0;
+    }
+}
+
+// Transfers the given chunk of the data of the request being served, setting
+// `*out_error` if the request was already completed. Returns false on error.
+static bool bdus_transfer_chunk_(
+    struct bdus_thread_ctx_ *context, struct kbdus_chunk *chunk,
+    int32_t *out_error)
+{
+    if (bdus_ioctl_arg_retry_(
+            context->control_fd, KBDUS_IOCTL_TRANSFER_CHUNK, chunk)
+        >= 0)
+    {
+        return true;
+    }
+
+    if (errno == ENOENT)
+    {
+        // the request timed out or the device was terminated, so the reply
+        // is ignored
+
+        *out_error = (int32_t)ETIMEDOUT;
+        return true;
+    }
+
+    context->status      = BDUS_STATUS_ERROR_;
+    context->error_errno = errno;
+    context->error_message =
+        "Failed to issue ioctl with command KBDUS_IOCTL_TRANSFER_CHUNK to"
+        " /dev/bdus-control";
+
+    return false;
+}
+
+// Serves a *read*, *write*, or *FUA write* request whose data is transferred
+// in chunks, invoking the respective callback for each chunk, which `payload`
+// holds in turn. Returns false on error.
+static bool bdus_process_chunked_item_(
+    struct bdus_thread_ctx_ *context, union kbdus_reply_or_item *rai,
+    void *payload)
+{
+    struct bdus_ctx *const ctx = context->ctx;
+
+    const uint32_t chunk_size = ctx->attrs->chunk_size;
+
+    // reply field `error` aliases item field `arg32`, so item fields must be
+    // read before it is set
+
+    const uint32_t type   = rai->item.type;
+    const uint64_t offset = rai->item.arg64;
+    const uint32_t size   = rai->item.arg32;
+
+    struct kbdus_chunk chunk = {
+        .user_ptr_or_buffer_index = rai->item.user_ptr_or_buffer_index,
+        .handle_seqnum            = rai->item.handle_seqnum,
+        .handle_index             = rai->item.handle_index,
+        .use_preallocated_buffer  = rai->item.use_preallocated_buffer,
+    };
+
+    const uint64_t start_ns = context->trace_ring ? bdus_trace_now_ns_() : 0;
+
+    int32_t error = 0;
+
+    for (uint32_t pos = 0; pos < size && error == 0; pos += chunk_size)
+    {
+        chunk.offset = pos;
+
+        // get the chunk's data for write and FUA write requests
+
+        if (type != KBDUS_ITEM_TYPE_READ
+            && (!bdus_transfer_chunk_(context, &chunk, &error) || error != 0))
+        {
+            break;
+        }
+
+        // serve chunk
+
+        bdus_backend_serve_request_(
+            ctx, (int)context->thread_index, payload, NULL, 0, type,
+            offset + pos, bdus_min_(size - pos, chunk_size), 0, &error, NULL);
+
+        // put the chunk's data for read requests
+
+        if (type == KBDUS_ITEM_TYPE_READ && error == 0
+            && !bdus_transfer_chunk_(context, &chunk, &error))
+        {
+            break;
+        }
+    }
+
+    rai->reply.error = error;
+
+    if (context->trace_ring)
+    {
+        bdus_trace_record_(
+            context->trace_ring, type, offset, size, error, start_ns,
+            bdus_trace_now_ns_());
+    }
+
+    return context->status != BDUS_STATUS_ERROR_;
+}
+
+static bool bdus_process_item_(
+    struct bdus_thread_ctx_ *context, union kbdus_reply_or_item *rai,
+    void *payload, const struct iovec *iov, int iovcnt)
+{
+    ssize_t reply_payload_size;
+    uint16_t num_ranges;
+
+    switch (rai->item.type)
+    {
+    case KBDUS_ITEM_TYPE_DEVICE_AVAILABLE:
+
+        if (context->allow_device_available)
+        {
+            context->status = BDUS_STATUS_DEVICE_AVAILABLE_;
+        }
+        else
+        {
+            context->status      = BDUS_STATUS_ERROR_;
+            context->error_errno = EINVAL;
+            context->error_message =
+                "Received \"device available\" notification more than once";
+        }
+
+        return false;
+
+    case KBDUS_ITEM_TYPE_TERMINATE:
+
+        context->status = BDUS_STATUS_TERMINATE_;
+
+        return false;
+
+    case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
+
+        bdus_backend_process_flush_request_(
+            context->ctx, (int)context->thread_index, &rai->reply.error);
+
+        if (rai->reply.error == 0)
+        {
+            context->status = BDUS_STATUS_TERMINATE_;
+        }
+        else
+        {
+            context->status        = BDUS_STATUS_ERROR_;
+            context->error_errno   = EIO;
+            context->error_message = "Failed to flush before terminating";
+        }
+
+        return false;
+
+    default:
+
+        // reply field `use_splice` aliases item field `num_ranges`, so item
+        // fields must be read before it is cleared
+
+        num_ranges = rai->item.num_ranges;
+
+        bdus_request_ioprio_ = rai->item.ioprio;
+
+        // reply field `splice_fd` aliases item field `payload_is_chunked`, so
+        // the latter must be checked before letting callbacks use bdus_splice()
+
+        if (rai->item.payload_is_chunked)
+        {
+            rai->reply.use_splice = UINT8_C(0);
+
+            const bool success =
+                bdus_process_chunked_item_(context, rai, payload);
+
+            bdus_request_ioprio_ = 0;
+
+            if (!success)
+                return false;
+
+            reply_payload_size = 0;
+        }
+        else
+        {
+            // let read, write, and FUA write callbacks use bdus_splice()
+
+            rai->reply.use_splice = UINT8_C(0);
+
+            if (rai->item.type == KBDUS_ITEM_TYPE_READ
+                || rai->item.type == KBDUS_ITEM_TYPE_WRITE
+                || rai->item.type == KBDUS_ITEM_TYPE_FUA_WRITE)
+            {
+                bdus_splice_reply_ = &rai->reply;
+            }
+
+            reply_payload_size = bdus_backend_process_request_(
+                context->ctx, context->trace_ring, (int)context->thread_index,
+                payload, iov, iovcnt, rai->item.type, rai->item.arg64,
+                rai->item.arg32, num_ranges, &rai->reply.error,
+                &rai->reply.arg64);
+        }
+
+        bdus_splice_reply_   = NULL;
+        bdus_request_ioprio_ = 0;
+
+        if (reply_payload_size < 0)
+        {
+            context->status        = BDUS_STATUS_ERROR_;
+            context->error_errno   = EINVAL;
+            context->error_message = "Received item of unknown type";
+
+            return false;
+        }
+        else if (rai->reply.error == (int32_t)bdus_abort)
+        {
+            context->status        = BDUS_STATUS_ERROR_;
+            context->error_errno   = EIO;
+            context->error_message = "Driver aborted";
+
+            return false;
+        }
+
+        return true;
+    }
+}
+
+// Like bdus_process_item_(), but serves *read* and *write* requests whose data
+// is not transferred in chunks by invoking the driver's callbacks directly,
+// skipping the logging, tracing, and per-type dispatch that the generic path
+// performs for every request. Only used if callbacks are not logged, requests
+// are not traced, and the driver implements no vector callbacks.
+static bool bdus_process_item_read_write_(
+    struct bdus_thread_ctx_ *context, union kbdus_reply_or_item *rai,
+    void *payload, const struct iovec *iov, int iovcnt)
+{
+    const uint32_t type = rai->item.type;
+
+    if ((type != KBDUS_ITEM_TYPE_READ && type != KBDUS_ITEM_TYPE_WRITE)
+        || rai->item.payload_is_chunked)
+    {
+        return bdus_process_item_(context, rai, payload, iov, iovcnt);
+    }
+
+    // reply field `error` aliases item field `arg32`, so item fields must be
+    // read before it is set
+
+    const uint64_t offset = rai->item.arg64;
+    const uint32_t size   = rai->item.arg32;
+
+    bdus_request_ioprio_ = rai->item.ioprio;
+
+    // let callbacks use bdus_splice()
+
+    rai->reply.use_splice = UINT8_C(0);
+    bdus_splice_reply_    = &rai->reply;
+
+    const int ret = type == KBDUS_ITEM_TYPE_READ
+        ? context->read(payload, offset, size, context->ctx)
+        : context->write(payload, offset, size, context->ctx);
+
+    bdus_splice_reply_   = NULL;
+    bdus_request_ioprio_ = 0;
+
+    rai->reply.error = (int32_t)ret;
+
+    if (ret == bdus_abort)
+    {
+        context->status        = BDUS_STATUS_ERROR_;
+        context->error_errno   = EIO;
+        context->error_message = "Driver aborted";
+
+        return false;
+    }
+
+    return true;
+}
+
+// Chooses the function with which the given thread processes items, which is
+// done once so that the checks it involves aren't repeated for every request.
+static void bdus_select_item_processor_(struct bdus_thread_ctx_ *context)
+{
+    const struct bdus_ctx *const ctx = context->ctx;
+
+    if (ctx->attrs->log || context->trace_ring || ctx->ops->readv
+        || ctx->ops->writev || !ctx->ops->read || !ctx->ops->write)
+    {
+        context->process_item = bdus_process_item_;
+    }
+    else
+    {
+        context->process_item = bdus_process_item_read_write_;
+        context->read         = ctx->ops->read;
+        context->write        = ctx->ops->write;
+    }
+}
+
+// Fills `context->window_iovecs` according to the segments that the kernel
+// stored in the preallocated buffer, which describe the layout of the first
+// rai's payload in the given mapping of the payload window. Returns false on
+// error.
+static bool bdus_window_segments_to_iovecs_(
+    struct bdus_thread_ctx_ *context, char *window, size_t num_segments)
+{
+    const struct kbdus_segment *const segments = context->payload;
+
+    const size_t window_size = context->pool->single_payload_memory_size;
+
+    if (num_segments > context->max_window_iovecs)
+        goto error;
+
+    for (size_t i = 0; i < num_segments; ++i)
+    {
+        const size_t offset = (size_t)segments[i].offset;
+        const size_t size   = (size_t)segments[i].size;
+
+        if (size == 0 || offset > window_size || size > window_size - offset)
+            goto error;
+
+        context->window_iovecs[i].iov_base = window + offset;
+        context->window_iovecs[i].iov_len  = size;
+    }
+
+    return true;
+
+error:
+    context->status        = BDUS_STATUS_ERROR_;
+    context->error_errno   = EINVAL;
+    context->error_message = "Received item with invalid payload segments";
+
+    return false;
+}
+
+// Returns the size of the payload that the given item or its reply may have.
+static size_t bdus_item_payload_size_(
+    const struct bdus_ctx *ctx, const struct kbdus_item *item)
+{
+    switch (item->type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+    case KBDUS_ITEM_TYPE_WRITE:
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        return item->payload_is_chunked ? (size_t)ctx->attrs->chunk_size
+                                        : (size_t)item->arg32;
+
+    case KBDUS_ITEM_TYPE_WRITE_SAME:
+        return (size_t)ctx->attrs->logical_block_size;
+
+    case KBDUS_ITEM_TYPE_DISCARD:
+        return (size_t)item->num_ranges * sizeof(struct kbdus_range);
+
+    case KBDUS_ITEM_TYPE_IOCTL:
+        return (size_t)_IOC_SIZE(item->arg32);
+
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+        return (size_t)item->arg32 * sizeof(struct kbdus_zone);
+
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
+        return (size_t)item->arg32;
+
+    default:
+        return 0;
+    }
+}
+
+// Accounts for a payload of the given size having been held by the buffer with
+// the given index in `extra_payloads`, releasing the memory backing the buffer
+// beyond the size class of recent payloads if it has long been unused.
+static void bdus_note_payload_use_(
+    struct bdus_thread_ctx_ *context, size_t buffer_index, size_t size)
+{
+    struct bdus_payload_usage_ *const usage =
+        &context->payload_usage[buffer_index];
+
+    size_t size_class = context->pool->page_size;
+
+    while (size_class < size)
+        size_class *= 2;
+
+    size_class = bdus_min_(size_class, context->payload_size);
+
+    if (size_class >= usage->backed_size)
+    {
+        usage->backed_size      = size_class;
+        usage->num_smaller      = 0;
+        usage->max_smaller_size = 0;
+
+        return;
+    }
+
+    usage->max_smaller_size = bdus_max_(usage->max_smaller_size, size_class);
+
+    if (++usage->num_smaller < BDUS_PAYLOAD_TRIM_THRESHOLD_)
+        return;
+
+    // the buffer's contents beyond the current payload are no longer needed
+    // (if this fails, the memory simply remains in use)
+
+    char *const buffer =
+        context->extra_payloads + context->payload_size * buffer_index;
+
+    if (madvise(
+            buffer + usage->max_smaller_size,
+            usage->backed_size - usage->max_smaller_size, MADV_DONTNEED)
+        == 0)
+    {
+        usage->backed_size = usage->max_smaller_size;
+    }
+
+    usage->num_smaller      = 0;
+    usage->max_smaller_size = 0;
+}
+
+// Like bdus_process_item_(), but also accounts for the request in the thread's
+// loopback statistics.
+static bool bdus_loopback_process_item_(
+    struct bdus_thread_ctx_ *context, union kbdus_reply_or_item *rai,
+    void *payload)
+{
+    struct bdus_loopback_thread_ *const loopback = context->loopback;
+
+    // the item is overwritten by its reply when processed
+
+    const uint32_t type = rai->item.type;
+    const uint32_t size = rai->item.arg32;
+
+    const uint64_t start_ns = bdus_trace_now_ns_();
+
+    const bool success = context->process_item(context, rai, payload, NULL, 0);
+
+    const uint64_t end_ns = bdus_trace_now_ns_();
+
+    if (type >= KBDUS_ITEM_TYPE_READ
+        && type < KBDUS_ITEM_TYPE_READ + BDUS_STATS_NUM_REQ_TYPES)
+    {
+        struct bdus_request_stats *const s =
+            &loopback->stats[type - KBDUS_ITEM_TYPE_READ];
+
+        s->requests += 1;
+        s->bytes += (uint64_t)size;
+        s->errors += rai->reply.error != 0 ? 1 : 0;
+        s->service_ns += end_ns - start_ns;
+
+        s->queue_wait_hist[bdus_loopback_hist_bucket_(
+            start_ns - loopback->batch_ns)] += 1;
+
+        s->service_hist[bdus_loopback_hist_bucket_(end_ns - start_ns)] += 1;
+    }
+
+    return success;
+}
+
+// Processes every received item in the thread's batch. Returns false if an
+// error occurred or a notification was received (notifications are always
+// received alone).
+static bool
+    bdus_process_items_(struct bdus_thread_ctx_ *context, size_t num_items)
+{
+    const size_t num_preallocated = context->window ? 1 : 0;
+
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        void *payload;
+        const struct iovec *iov = NULL;
+        int iovcnt              = 0;
+
+        if (i >= num_preallocated)
+        {
+            payload = context->extra_payloads
+                + context->payload_size * (i - num_preallocated);
+
+            // the item is overwritten by its reply when processed
+
+            if (context->payload_usage)
+            {
+                bdus_note_payload_use_(
+                    context, i - num_preallocated,
+                    bdus_item_payload_size_(
+                        context->ctx, &context->rais[i].item));
+            }
+        }
+        else if (context->rais[0].item.payload_is_mapped)
+        {
+            // the payload was mapped into the window, which may only be
+            // written to for *read* requests
+
+            char *const window =
+                context->rais[0].item.type == KBDUS_ITEM_TYPE_READ
+                ? context->window
+                : context->read_only_window;
+
+            if (context->rais[0].item.num_segments > 0)
+            {
+                // the payload was mapped as segments, which vector callbacks
+                // take as is (kbdus only does this if the driver only uses
+                // vector callbacks for requests with data)
+
+                iovcnt = (int)context->rais[0].item.num_segments;
+
+                if (!bdus_window_segments_to_iovecs_(
+                        context, window, (size_t)iovcnt))
+                {
+                    return false;
+                }
+
+                iov     = context->window_iovecs;
+                payload = iov[0].iov_base;
+            }
+            else
+            {
+                payload = window;
+            }
+        }
+        else
+        {
+            payload = context->payload;
+        }
+
+        if (context->loopback)
+        {
+            if (!bdus_loopback_process_item_(
+                    context, &context->rais[i], payload))
+            {
+                return false;
+            }
+        }
+        else if (!context->process_item(
+                     context, &context->rais[i], payload, iov, iovcnt))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Defined below, as the threads it spawns run `bdus_work_loop_()`.
+static void bdus_spawn_thread_(struct bdus_thread_ctx_ *context);
+
+// Makes all worker threads of the given thread's driver stop serving requests.
+static void bdus_stop_workers_(struct bdus_thread_ctx_ *context)
+{
+    if (context->loopback)
+    {
+        __atomic_store_n(
+            &context->loopback->shared->stop, true, __ATOMIC_RELAXED);
+    }
+    else if (bdus_ioctl_retry_(context->control_fd, KBDUS_IOCTL_TERMINATE) != 0)
+    {
+        abort();
+    }
+}
+
+static void bdus_work_loop_(struct bdus_thread_ctx_ *context)
+{
+    const bool may_spawn =
+        context->pool->min_threads < context->pool->num_threads;
+
+    // receive batches of items, process them, and send replies
+
+    while (true)
+    {
+        const size_t num_items = bdus_send_replies_and_receive_items_(context);
+
+        if (num_items == 0)
+            break; // error or timed out
+
+        // have another thread help if requests are accumulating in the queue
+
+        if (may_spawn && context->batch.num_awaiting > 0)
+            bdus_spawn_thread_(context);
+
+        if (!bdus_process_items_(context, num_items))
+            break; // error or received notification
+    }
+
+    // check if error occurred
+
+    if (context->status == BDUS_STATUS_ERROR_)
+    {
+        // work loop failed, terminate control file description so that other
+        // worker threads terminate
+
+        bdus_stop_workers_(context);
+    }
+}
+
+// Defined below, along with the other payload buffer management functions.
+static void bdus_free_thread_payloads_(struct bdus_thread_ctx_ *context);
+
+static void *bdus_work_loop_void_(void *context)
+{
+    struct bdus_thread_ctx_ *const c = context;
+
+    bdus_work_loop_(c);
+
+    // release the resources of threads that exit due to inactivity right
+    // away, leaving them to be joined later
+
+    if (c->status == BDUS_STATUS_IDLE_)
+    {
+        if (c->ctx->attrs->log)
+        {
+            bdus_log_(
+                "worker thread %zu exiting due to inactivity", c->thread_index);
+        }
+
+        bdus_free_thread_payloads_(c);
+
+        if (pthread_mutex_lock(&c->pool->mutex) != 0)
+            abort();
+
+        c->state = BDUS_THREAD_EXITED_;
+
+        if (pthread_mutex_unlock(&c->pool->mutex) != 0)
+            abort();
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Parses a comma-separated list of numbers and ranges of numbers, such as
+// "0-3,8,10-11", into `*out_set`, ignoring numbers not less than CPU_SETSIZE.
+// Whitespace around list elements is allowed, and so is an empty list. Used for
+// both CPU and NUMA node numbers.
+static bool bdus_parse_list_(const char *list, cpu_set_t *out_set)
+{
+    CPU_ZERO(out_set);
+
+    const char *p = list;
+
+    while (isspace((unsigned char)*p))
+        ++p;
+
+    if (*p == '\0')
+        return true;
+
+    while (true)
+    {
+        // parse number or range
+
+        char *end;
+
+        if (!isdigit((unsigned char)*p))
+            return false;
+
+        const unsigned long first = strtoul(p, &end, 10);
+        unsigned long last        = first;
+
+        p = end;
+
+        if (*p == '-')
+        {
+            ++p;
+
+            if (!isdigit((unsigned char)*p))
+                return false;
+
+            last = strtoul(p, &end, 10);
+            p    = end;
+
+            if (last < first)
+                return false;
+        }
+
+        for (unsigned long i = first; i <= last && i < CPU_SETSIZE; ++i)
+            CPU_SET((size_t)i, out_set);
+
+        // advance to next element
+
+        while (isspace((unsigned char)*p))
+            ++p;
+
+        if (*p == '\0')
+            return true;
+
+        if (*p != ',')
+            return false;
+
+        ++p;
+
+        while (isspace((unsigned char)*p))
+            ++p;
+    }
+}
+
+// Parses the list in the sysfs file at the given path into `*out_set`.
+static bool bdus_read_list_file_(const char *path, cpu_set_t *out_set)
+{
+    char list[4096];
+
+    FILE *const file = fopen(path, "r");
+
+    if (!file)
+        return false;
+
+    const bool read = fgets(list, (int)sizeof(list), file) != NULL;
+
+    fclose(file);
+
+    if (!read)
+    {
+        errno = EIO;
+        return false;
+    }
+
+    if (!bdus_parse_list_(list, out_set))
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    return true;
+}
+
+// Sets `*out_cpus` to the set of CPUs that submit requests to the hardware
+// queue with the given index of the given device, as reported by sysfs.
+static bool bdus_get_queue_cpus_(
+    uint64_t dev_id, size_t queue_index, cpu_set_t *out_cpus)
+{
+    char path[64];
+
+    const int ret = snprintf(
+        path, sizeof(path), "/sys/block/bdus-%" PRIu64 "/mq/%zu/cpu_list",
+        dev_id, queue_index);
+
+    if (ret <= 0 || (size_t)ret >= sizeof(path))
+        return false;
+
+    return bdus_read_list_file_(path, out_cpus) && CPU_COUNT(out_cpus) > 0;
+}
+
+// Adds the CPUs of the given NUMA nodes to `*cpus`.
+static bool bdus_get_node_cpus_(const cpu_set_t *nodes, cpu_set_t *cpus)
+{
+    for (size_t node = 0; node < CPU_SETSIZE; ++node)
+    {
+        if (!CPU_ISSET(node, nodes))
+            continue;
+
+        char path[64];
+        cpu_set_t node_cpus;
+
+        snprintf(
+            path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist",
+            node);
+
+        if (!bdus_read_list_file_(path, &node_cpus))
+        {
+            bdus_set_error_append_errno_(
+                errno, "Failed to determine the CPUs of NUMA node %zu", node);
+
+            return false;
+        }
+
+        CPU_OR(cpus, cpus, &node_cpus);
+    }
+
+    return true;
+}
+
+// The CPU affinity of the calling thread before it was restricted by
+// bdus_backend_restrict_cpus_().
+static __thread cpu_set_t bdus_unrestricted_cpus_;
+
+bool bdus_backend_restrict_cpus_(
+    const struct bdus_attrs *attrs, bool *out_restricted)
+{
+    *out_restricted = false;
+
+    if (!attrs->worker_cpus && !attrs->worker_numa_nodes)
+        return true;
+
+    // determine CPUs
+
+    cpu_set_t cpus;
+
+    if (!attrs->worker_cpus)
+    {
+        CPU_ZERO(&cpus);
+
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &cpus);
+    }
+    else if (!bdus_parse_list_(attrs->worker_cpus, &cpus))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value '%s' for attribute 'worker_cpus', must be a list of"
+            " CPU numbers and ranges such as '0-3,8'",
+            attrs->worker_cpus);
+
+        return false;
+    }
+
+    if (attrs->worker_numa_nodes)
+    {
+        cpu_set_t nodes;
+        cpu_set_t node_cpus;
+
+        if (!bdus_parse_list_(attrs->worker_numa_nodes, &nodes))
+        {
+            bdus_set_error_(
+                EINVAL,
+                "Invalid value '%s' for attribute 'worker_numa_nodes', must be"
+                " a list of NUMA node numbers and ranges such as '0-1'",
+                attrs->worker_numa_nodes);
+
+            return false;
+        }
+
+        CPU_ZERO(&node_cpus);
+
+        if (!bdus_get_node_cpus_(&nodes, &node_cpus))
+            return false;
+
+        CPU_AND(&cpus, &cpus, &node_cpus);
+    }
+
+    if (CPU_COUNT(&cpus) == 0)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attributes 'worker_cpus' and 'worker_numa_nodes' select no CPUs");
+
+        return false;
+    }
+
+    // restrict the calling thread, remembering its original affinity
+
+    int ret = pthread_getaffinity_np(
+        pthread_self(), sizeof(bdus_unrestricted_cpus_),
+        &bdus_unrestricted_cpus_);
+
+    if (ret != 0)
+    {
+        bdus_set_error_append_errno_(ret, "pthread_getaffinity_np() failed");
+        return false;
+    }
+
+    ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    if (ret != 0)
+    {
+        bdus_set_error_append_errno_(
+            ret,
+            "Failed to restrict the driver to the CPUs selected by attributes"
+            " 'worker_cpus' and 'worker_numa_nodes'");
+
+        return false;
+    }
+
+    *out_restricted = true;
+
+    return true;
+}
+
+void bdus_backend_unrestrict_cpus_(void)
+{
+    const int previous_errno = errno;
+
+    pthread_setaffinity_np(
+        pthread_self(), sizeof(bdus_unrestricted_cpus_),
+        &bdus_unrestricted_cpus_);
+
+    errno = previous_errno;
+}
+
+// If the device has more than one hardware queue, determine the CPUs to which
+// each worker thread should be pinned. Each thread services the hardware queue
+// with index `thread_index % num_queues`.
+static void bdus_determine_thread_cpus_(
+    struct bdus_thread_ctx_ *contexts, size_t num_threads)
+{
+    const struct bdus_ctx *const ctx = contexts[0].ctx;
+    const size_t num_queues          = (size_t)ctx->attrs->num_queues;
+
+    if (num_queues <= 1)
+        return;
+
+    // threads are never pinned to CPUs on which the current thread may not run
+    // (e.g., due to attributes `worker_cpus` and `worker_numa_nodes`), and
+    // otherwise inherit its affinity
+
+    cpu_set_t allowed_cpus;
+
+    const bool have_allowed_cpus =
+        pthread_getaffinity_np(
+            pthread_self(), sizeof(allowed_cpus), &allowed_cpus)
+        == 0;
+
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        struct bdus_thread_ctx_ *const c = &contexts[i];
+
+        if (i < num_queues)
+        {
+            c->pin_to_cpus = bdus_get_queue_cpus_(ctx->id, i, &c->cpus);
+
+            if (!c->pin_to_cpus && ctx->attrs->log)
+            {
+                bdus_log_(
+                    "failed to determine CPUs of hardware queue %zu, not"
+                    " pinning its worker threads",
+                    i);
+            }
+
+            if (c->pin_to_cpus && have_allowed_cpus)
+            {
+                CPU_AND(&c->cpus, &c->cpus, &allowed_cpus);
+                c->pin_to_cpus = CPU_COUNT(&c->cpus) > 0;
+            }
+        }
+        else
+        {
+            c->pin_to_cpus = contexts[i % num_queues].pin_to_cpus;
+            c->cpus        = contexts[i % num_queues].cpus;
+        }
+    }
+}
+
+// If requested, create an io_uring instance for each worker thread, falling
+// back to ioctls if that is not possible.
+static void bdus_create_urings_(
+    struct bdus_thread_ctx_ *contexts, size_t num_threads)
+{
+    const struct bdus_ctx *const ctx = contexts[0].ctx;
+
+    if (!ctx->attrs->use_io_uring)
+        return;
+
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        struct bdus_thread_ctx_ *const c = &contexts[i];
+
+        c->uring =
+            bdus_uring_create_(c->control_fd, ctx->attrs->io_uring_polling);
+
+        c->num_replies = 0;
+
+        if (!c->uring)
+        {
+            if (ctx->attrs->log)
+            {
+                bdus_log_(
+                    "failed to set up io_uring (%s), falling back to ioctls",
+                    strerror(errno));
+            }
+
+            for (; i > 0; --i)
+            {
+                bdus_uring_destroy_(contexts[i - 1].uring);
+                contexts[i - 1].uring = NULL;
+            }
+
+            return;
+        }
+    }
+}
+
+static int bdus_create_thread_(struct bdus_thread_ctx_ *context)
+{
+    pthread_attr_t attr;
+    int ret;
+
+    if (!context->pin_to_cpus)
+    {
+        return pthread_create(
+            &context->thread, NULL, bdus_work_loop_void_, context);
+    }
+
+    ret = pthread_attr_init(&attr);
+
+    if (ret != 0)
+        return ret;
+
+    ret = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &context->cpus);
+
+    if (ret == 0)
+    {
+        ret = pthread_create(
+            &context->thread, &attr, bdus_work_loop_void_, context);
+    }
+
+    if (pthread_attr_destroy(&attr) != 0)
+        abort();
+
+    return ret;
+}
+
+// Prevents further threads from being spawned, and joins all threads that
+// were spawned.
+static void bdus_join_threads_(struct bdus_pool_ *pool)
+{
+    if (pthread_mutex_lock(&pool->mutex) != 0)
+        abort();
+
+    pool->allow_spawning = false;
+
+    if (pthread_mutex_unlock(&pool->mutex) != 0)
+        abort();
+
+    for (size_t i = 1; i < pool->num_threads; ++i)
+    {
+        struct bdus_thread_ctx_ *const c = &pool->contexts[i];
+
+        // threads that exit due to inactivity change their state themselves
+
+        if (pthread_mutex_lock(&pool->mutex) != 0)
+            abort();
+
+        const int state = c->state;
+
+        if (pthread_mutex_unlock(&pool->mutex) != 0)
+            abort();
+
+        if (state != BDUS_THREAD_STOPPED_)
+        {
+            if (pthread_join(c->thread, NULL) != 0)
+                abort();
+
+            c->state = BDUS_THREAD_STOPPED_;
+        }
+    }
+}
+
+static bool bdus_run_3_(struct bdus_pool_ *pool)
+{
+    struct bdus_thread_ctx_ *const contexts = pool->contexts;
+
+    // pin the current thread to the CPUs of the first hardware queue, if
+    // applicable, remembering its original affinity
+
+    cpu_set_t original_cpus;
+
+    const bool restore_cpus = contexts[0].pin_to_cpus
+        && pthread_getaffinity_np(
+               pthread_self(), sizeof(original_cpus), &original_cpus)
+            == 0
+        && pthread_setaffinity_np(
+               pthread_self(), sizeof(contexts[0].cpus), &contexts[0].cpus)
+            == 0;
+
+    // run multi-threaded until device terminates or error, starting with the
+    // threads that are always running (the pool's mutex isn't needed here, as
+    // no other threads exist yet and threads spawned on demand never touch
+    // the state of those that are always running)
+
+    pool->allow_spawning = true;
+
+    for (size_t i = 1; i < pool->min_threads; ++i)
+    {
+        const int ret = bdus_create_thread_(&contexts[i]);
+
+        if (ret == 0)
+        {
+            contexts[i].state = BDUS_THREAD_RUNNING_;
+        }
+        else
+        {
+            bdus_stop_workers_(&contexts[i]);
+
+            bdus_join_threads_(pool);
+
+            if (restore_cpus)
+            {
+                pthread_setaffinity_np(
+                    pthread_self(), sizeof(original_cpus), &original_cpus);
+            }
+
+            bdus_set_error_append_errno_(ret, "pthread_create() failed");
+            return false;
+        }
+    }
+
+    // run first worker thread
+
+    bdus_work_loop_(&contexts[0]);
+
+    // join worker threads
+
+    bdus_join_threads_(pool);
+
+    // restore the current thread's original affinity
+
+    if (restore_cpus)
+    {
+        pthread_setaffinity_np(
+            pthread_self(), sizeof(original_cpus), &original_cpus);
+    }
+
+    // check if any thread failed
+
+    for (size_t i = 0; i < pool->num_threads; ++i)
+    {
+        if (contexts[i].status == BDUS_STATUS_ERROR_)
+        {
+            bdus_set_error_append_errno_(
+                contexts[i].error_errno, "%s", contexts[i].error_message);
+
+            return false;
+        }
+    }
+
+    // success
+
+    return true;
+}
+
+static bool bdus_run_2_(struct bdus_ctx *ctx, struct bdus_pool_ *pool)
+{
+    struct bdus_thread_ctx_ *const contexts = pool->contexts;
+
+    // if taking over the device from another driver, only now have it stop
+    // serving the device, as our memory is already mapped
+
+    if (!bdus_handoff_resume_(pool->handoff))
+        return false;
+
+    // run single-threaded until device becomes available, terminates, or error
+    // (no threads are spawned on demand yet)
+
+    {
+        struct bdus_thread_ctx_ *const context = &contexts[0];
+
+        context->allow_device_available = true;
+
+        bdus_work_loop_(&contexts[0]);
+
+        switch (context->status)
+        {
+        case BDUS_STATUS_DEVICE_AVAILABLE_:
+            break;
+
+        case BDUS_STATUS_TERMINATE_:
+            return true;
+
+        case BDUS_STATUS_ERROR_:
+            bdus_set_error_append_errno_(
+                context->error_errno, "%s", context->error_message);
+            return false;
+        }
+
+        context->allow_device_available = false;
+
+        // invoke on_device_available() callback and daemonize the current
+        // process
+
+        if (!bdus_backend_on_device_available_(ctx, (int)context->thread_index))
+            return false;
+    }
+
+    // let other drivers take over the device, if allowed (only now, as
+    // daemonization forks the current process)
+
+    if (!bdus_handoff_listen_(pool->handoff))
+        return false;
+
+    // determine CPUs to which to pin worker threads (the device's sysfs
+    // directory is guaranteed to exist at this point)
+
+    bdus_determine_thread_cpus_(contexts, pool->num_threads);
+
+    // set up io_uring if applicable (only now, as daemonization forks the
+    // current process)
+
+    bdus_create_urings_(contexts, pool->num_threads);
+
+    // multi-threaded
+
+    return bdus_run_3_(pool);
+}
+
+static void *bdus_mmap_(
+    int control_fd, size_t offset, size_t length, bool writable, bool populate)
+{
+    void *ptr = mmap(
+        NULL, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        populate ? MAP_SHARED | MAP_POPULATE : MAP_SHARED, control_fd,
+        (off_t)offset);
+
+    if (ptr == MAP_FAILED)
+    {
+        bdus_set_error_append_errno_(
+            errno,
+            "mmap() on /dev/bdus-control at offset %zu of length %zu failed",
+            offset, length);
+
+        ptr = NULL;
+    }
+
+    return ptr;
+}
+
+// Unmaps or frees the payload buffers and io_uring instance of the given
+// thread, if any.
+static void bdus_free_thread_payloads_(struct bdus_thread_ctx_ *context)
+{
+    const size_t single_payload_memory_size =
+        context->pool->single_payload_memory_size;
+
+    if (context->uring)
+        bdus_uring_destroy_(context->uring);
+
+    if (context->driver_payloads)
+    {
+        struct bdus_ctx *const ctx = context->ctx;
+
+        const size_t size =
+            single_payload_memory_size * (size_t)context->batch.size;
+
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                (int)context->thread_index, "free_payload_buffer(%p, %zu, ctx)",
+                context->driver_payloads, size);
+        }
+
+        ctx->ops->free_payload_buffer(context->driver_payloads, size, ctx);
+    }
+    else
+    {
+        if (context->extra_payloads
+            && munmap(context->extra_payloads, context->extra_payloads_size)
+                != 0)
+        {
+            abort();
+        }
+
+        free(context->payload_usage);
+        free(context->window_iovecs);
+
+        if (context->window
+            && munmap(context->window, single_payload_memory_size) != 0)
+        {
+            abort();
+        }
+
+        if (context->read_only_window
+            && munmap(context->read_only_window, single_payload_memory_size)
+                != 0)
+        {
+            abort();
+        }
+
+        if (context->payload
+            && munmap(context->payload, single_payload_memory_size) != 0)
+        {
+            abort();
+        }
+    }
+
+    // the thread's payload buffers may be set up again if it is respawned
+
+    context->uring            = NULL;
+    context->driver_payloads  = NULL;
+    context->extra_payloads   = NULL;
+    context->payload_usage    = NULL;
+    context->window           = NULL;
+    context->read_only_window = NULL;
+    context->window_iovecs    = NULL;
+    context->payload          = NULL;
+}
+
+// Unmaps or frees the payload buffers and io_uring instances of the first
+// `num_threads` threads.
+static void
+    bdus_free_payloads_(struct bdus_thread_ctx_ *contexts, size_t num_threads)
+{
+    for (size_t i = num_threads; i > 0; --i)
+        bdus_free_thread_payloads_(&contexts[i - 1]);
+}
+
+// Allocates the payload buffers of the given thread using the driver's
+// allocate_payload_buffer() callback, and initializes its rais to use them.
+static bool bdus_init_driver_payloads_(
+    struct bdus_thread_ctx_ *context, size_t single_payload_memory_size,
+    size_t page_size)
+{
+    struct bdus_ctx *const ctx = context->ctx;
+
+    const size_t size =
+        single_payload_memory_size * (size_t)context->batch.size;
+
+    // invoke allocate_payload_buffer() callback
+
+    if (ctx->attrs->log)
+    {
+        bdus_log_thread_(
+            (int)context->thread_index, "allocate_payload_buffer(%zu, ctx)",
+            size);
+    }
+
+    char *const payloads = ctx->ops->allocate_payload_buffer(size, ctx);
+
+    if (!payloads)
+    {
+        bdus_set_error_append_errno_(
+            errno, "Driver callback allocate_payload_buffer() failed");
+
+        return false;
+    }
+
+    context->driver_payloads = payloads;
+
+    if ((uintptr_t)payloads % page_size != 0)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Driver callback allocate_payload_buffer() returned a buffer that"
+            " is not aligned to the system's page size");
+
+        return false;
+    }
+
+    // all rais use buffers in the allocated region
+
+    context->extra_payloads = payloads;
+    context->payload_size   = single_payload_memory_size;
+
+    for (size_t i = 0; i < context->batch.size; ++i)
+    {
+        context->rais[i].common.user_ptr_or_buffer_index =
+            (uint64_t)(uintptr_t)(payloads + single_payload_memory_size * i);
+
+        context->rais[i].common.handle_index            = UINT16_C(0);
+        context->rais[i].common.use_preallocated_buffer = UINT8_C(0);
+    }
+
+    return true;
+}
+
+// Maps and allocates the payload buffers of the given thread, and initializes
+// its rais to use them.
+static bool bdus_init_payloads_(
+    struct bdus_thread_ctx_ *context, size_t max_payload_size,
+    size_t rai_memory_size, size_t single_payload_memory_size,
+    size_t page_size)
+{
+    if (max_payload_size > 0 && context->ctx->ops->allocate_payload_buffer)
+    {
+        return bdus_init_driver_payloads_(
+            context, single_payload_memory_size, page_size);
+    }
+
+    // if payload windows are used, the first rai uses the thread's
+    // preallocated buffer, which is paired with its window
+
+    size_t num_preallocated = 0;
+
+    if (max_payload_size > 0 && context->ctx->attrs->zero_copy)
+    {
+        context->rais[0].common.user_ptr_or_buffer_index =
+            (uint64_t)context->thread_index;
+
+        context->rais[0].common.handle_index            = UINT16_C(0);
+        context->rais[0].common.use_preallocated_buffer = UINT8_C(1);
+
+        context->payload = bdus_mmap_(
+            context->control_fd,
+            rai_memory_size
+                + single_payload_memory_size * context->thread_index,
+            single_payload_memory_size, true, true);
+
+        if (!context->payload)
+            return false;
+
+        // the payload window must not be populated, as it only holds pages
+        // while the first rai holds a request mapped into it
+
+        const size_t window_offset = (size_t)KBDUS_PAYLOAD_WINDOWS_MMAP_OFFSET
+            + single_payload_memory_size * context->thread_index;
+
+        context->window = bdus_mmap_(
+            context->control_fd, window_offset, single_payload_memory_size,
+            true, false);
+
+        if (!context->window)
+            return false;
+
+        context->read_only_window = bdus_mmap_(
+            context->control_fd, window_offset, single_payload_memory_size,
+            false, false);
+
+        if (!context->read_only_window)
+            return false;
+
+        context->max_window_iovecs = single_payload_memory_size / page_size;
+        context->window_iovecs     = calloc(
+            context->max_window_iovecs, sizeof(*context->window_iovecs));
+
+        if (!context->window_iovecs)
+        {
+            bdus_set_error_append_errno_(errno, "calloc() failed");
+            return false;
+        }
+
+        num_preallocated = 1;
+    }
+
+    // the remaining rais use buffers in process memory, which are only backed
+    // by memory as they are used
+
+    const size_t num_extra = (size_t)context->batch.size - num_preallocated;
+
+    if (max_payload_size > 0 && num_extra > 0)
+    {
+        const size_t size = single_payload_memory_size * num_extra;
+
+        void *const extra_payloads = mmap(
+            NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (extra_payloads == MAP_FAILED)
+        {
+            bdus_set_error_append_errno_(errno, "mmap() failed");
+            return false;
+        }
+
+        context->extra_payloads      = extra_payloads;
+        context->extra_payloads_size = size;
+        context->payload_size        = single_payload_memory_size;
+
+        context->payload_usage =
+            calloc(num_extra, sizeof(*context->payload_usage));
+
+        if (!context->payload_usage)
+        {
+            bdus_set_error_append_errno_(errno, "calloc() failed");
+            return false;
+        }
+    }
+
+    for (size_t i = num_preallocated; i < context->batch.size; ++i)
+    {
+        context->rais[i].common.user_ptr_or_buffer_index =
+            context->extra_payloads
+            ? (uint64_t)(uintptr_t)(
+                context->extra_payloads
+                + context->payload_size * (i - num_preallocated))
+            : UINT64_C(0);
+
+        context->rais[i].common.handle_index            = UINT16_C(0);
+        context->rais[i].common.use_preallocated_buffer = UINT8_C(0);
+    }
+
+    return true;
+}
+
+// Returns a thread that services the hardware queue with the given index and
+// isn't running, among those that may exit due to inactivity, or NULL if there
+// is none or spawning threads is not allowed. Must be called with the pool's
+// mutex held.
+static struct bdus_thread_ctx_ *
+    bdus_find_stopped_thread_(struct bdus_pool_ *pool, size_t queue_index)
+{
+    const size_t num_queues = (size_t)pool->contexts[0].ctx->attrs->num_queues;
+
+    if (!pool->allow_spawning)
+        return NULL;
+
+    for (size_t i = pool->min_threads; i < pool->num_threads; ++i)
+    {
+        if (i % num_queues == queue_index
+            && pool->contexts[i].state != BDUS_THREAD_RUNNING_)
+        {
+            return &pool->contexts[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Spawns a thread to help the given thread receive items from its hardware
+// queue, setting up the new thread's payload buffers, if not all threads that
+// service that queue are running. Failures are only logged, as the threads
+// that are already running keep serving requests.
+static void bdus_spawn_thread_(struct bdus_thread_ctx_ *context)
+{
+    struct bdus_pool_ *const pool    = context->pool;
+    const struct bdus_ctx *const ctx = context->ctx;
+
+    if (pthread_mutex_lock(&pool->mutex) != 0)
+        abort();
+
+    struct bdus_thread_ctx_ *const c =
+        bdus_find_stopped_thread_(pool, (size_t)context->batch.queue_index);
+
+    if (c)
+    {
+        // threads that exited due to inactivity must be joined before being
+        // spawned again
+
+        if (c->state == BDUS_THREAD_EXITED_
+            && pthread_join(c->thread, NULL) != 0)
+        {
+            abort();
+        }
+
+        c->state = BDUS_THREAD_STOPPED_;
+
+        if (ctx->attrs->log)
+            bdus_log_("spawning worker thread %zu", c->thread_index);
+
+        if (!bdus_init_payloads_(
+                c, pool->max_payload_size, pool->rai_memory_size,
+                pool->single_payload_memory_size, pool->page_size))
+        {
+            if (ctx->attrs->log)
+            {
+                bdus_log_(
+                    "failed to spawn worker thread %zu: %s", c->thread_index,
+                    bdus_get_error_message_());
+            }
+
+            bdus_free_thread_payloads_(c);
+        }
+        else
+        {
+            const int ret = bdus_create_thread_(c);
+
+            if (ret == 0)
+            {
+                c->state = BDUS_THREAD_RUNNING_;
+            }
+            else
+            {
+                if (ctx->attrs->log)
+                {
+                    bdus_log_(
+                        "failed to spawn worker thread %zu: %s",
+                        c->thread_index, strerror(ret));
+                }
+
+                bdus_free_thread_payloads_(c);
+            }
+        }
+    }
+
+    if (pthread_mutex_unlock(&pool->mutex) != 0)
+        abort();
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct bdus_async_ctx_;
+
+struct bdus_request
+{
+    // the request's item, and then its reply
+    union kbdus_reply_or_item rai;
+
+    struct bdus_async_ctx_ *async;
+    void *payload;
+
+    // the next request in the free list, while free
+    struct bdus_request *next_free;
+};
+
+struct bdus_async_ctx_
+{
+    struct bdus_ctx *ctx;
+    int control_fd;
+
+    // NULL if requests are not traced
+    struct bdus_trace_ring_ *trace_ring;
+
+    struct bdus_request *requests;
+    size_t num_requests;
+
+    // the payload buffers of all requests, consecutive `payload_size` buffers
+    void *payloads;
+    size_t payload_size;
+
+    // protects the fields below, which are also accessed by bdus_complete()
+    pthread_mutex_t mutex;
+    pthread_cond_t request_completed;
+
+    struct bdus_request *free_requests;
+    size_t num_deferred;
+    uint64_t num_completed;
+
+    // set when completing a deferred request fails or aborts the driver
+    int error_errno;
+    const char *error_message;
+};
+
+// The request being served by the calling thread's callback, if any and if its
+// completion may still be deferred.
+static __thread struct bdus_request *bdus_defer_request_ = NULL;
+
+struct bdus_request *bdus_backend_defer_(void)
+{
+    struct bdus_request *const request = bdus_defer_request_;
+
+    if (!request)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "bdus_defer() may only be called once from request callbacks, and"
+            " only if attribute 'async_queue_depth' is positive");
+
+        return NULL;
+    }
+
+    struct bdus_async_ctx_ *const async = request->async;
+
+    if (pthread_mutex_lock(&async->mutex) != 0)
+        abort();
+
+    ++async->num_deferred;
+
+    if (pthread_mutex_unlock(&async->mutex) != 0)
+        abort();
+
+    bdus_defer_request_ = NULL;
+
+    return request;
+}
+
+// Sends the given replies. Returns false and sets errno on failure.
+static bool bdus_async_send_replies_(
+    int control_fd, const union kbdus_reply_or_item *replies,
+    size_t num_replies)
+{
+    size_t num_sent = 0;
+
+    while (num_sent < num_replies)
+    {
+        const ssize_t ret = write(
+            control_fd, &replies[num_sent], 64 * (num_replies - num_sent));
+
+        if (ret < 0)
+        {
+            if (errno != EINTR)
+                return false;
+        }
+        else if (ret == 0 || ret % 64 != 0)
+        {
+            errno = EIO;
+            return false;
+        }
+        else
+        {
+            num_sent += (size_t)ret / 64;
+        }
+    }
+
+    return true;
+}
+
+bool bdus_backend_complete_(struct bdus_request *request, int error)
+{
+    if (!request)
+    {
+        bdus_set_error_(EINVAL, "Invalid request handle NULL");
+        return false;
+    }
+
+    struct bdus_async_ctx_ *const async = request->async;
+
+    // send reply, unless the driver is aborting
+
+    int error_errno           = 0;
+    const char *error_message = NULL;
+
+    if (error == bdus_abort)
+    {
+        error_errno   = EIO;
+        error_message = "Driver aborted";
+    }
+    else
+    {
+        request->rai.reply.error = (int32_t)error;
+
+        if (!bdus_async_send_replies_(async->control_fd, &request->rai, 1))
+        {
+            error_errno   = errno;
+            error_message = "Failed to send reply to /dev/bdus-control";
+        }
+    }
+
+    // free request and record error, if any
+
+    if (pthread_mutex_lock(&async->mutex) != 0)
+        abort();
+
+    request->next_free   = async->free_requests;
+    async->free_requests = request;
+
+    --async->num_deferred;
+    ++async->num_completed;
+
+    const bool first_error = error_errno != 0 && async->error_errno == 0;
+
+    if (first_error)
+    {
+        async->error_errno   = error_errno;
+        async->error_message = error_message;
+    }
+
+    if (pthread_cond_broadcast(&async->request_completed) != 0)
+        abort();
+
+    if (pthread_mutex_unlock(&async->mutex) != 0)
+        abort();
+
+    // terminate control file description on error, so that the thread serving
+    // requests stops even if blocked receiving items
+
+    if (error_errno != 0)
+    {
+        if (first_error
+            && bdus_ioctl_retry_(async->control_fd, KBDUS_IOCTL_TERMINATE)
+                != 0)
+        {
+            abort();
+        }
+
+        bdus_set_error_append_errno_(error_errno, "%s", error_message);
+        return false;
+    }
+
+    return true;
+}
+
+// Waits until some deferred request is completed, or until `fd` is readable if
+// the driver implements async_wait() and `fd` is not -1.
+static bool bdus_async_wait_(struct bdus_async_ctx_ *async, int fd)
+{
+    struct bdus_ctx *const ctx = async->ctx;
+
+    // invoke async_wait() callback if implemented
+
+    if (ctx->ops->async_wait)
+    {
+        if (ctx->attrs->log)
+            bdus_log_thread_(0, "async_wait(%d, ctx)", fd);
+
+        const int ret = ctx->ops->async_wait(fd, ctx);
+
+        if (ret != 0)
+        {
+            bdus_set_error_append_errno_(
+                ret, "Driver callback async_wait() failed");
+
+            return false;
+        }
+
+        return true;
+    }
+
+    // otherwise wait for other threads to complete deferred requests
+
+    if (pthread_mutex_lock(&async->mutex) != 0)
+        abort();
+
+    const uint64_t num_completed = async->num_completed;
+
+    while (async->num_completed == num_completed && async->num_deferred > 0)
+    {
+        if (pthread_cond_wait(&async->request_completed, &async->mutex) != 0)
+            abort();
+    }
+
+    if (pthread_mutex_unlock(&async->mutex) != 0)
+        abort();
+
+    return true;
+}
+
+// Waits until all deferred requests are completed.
+static bool bdus_async_drain_(struct bdus_async_ctx_ *async)
+{
+    while (true)
+    {
+        if (pthread_mutex_lock(&async->mutex) != 0)
+            abort();
+
+        const size_t num_deferred = async->num_deferred;
+
+        if (pthread_mutex_unlock(&async->mutex) != 0)
+            abort();
+
+        if (num_deferred == 0)
+            return true;
+
+        if (!bdus_async_wait_(async, -1))
+            return false;
+    }
+}
+
+// Checks whether completing a deferred request failed and moves up to `max`
+// free requests to `out_requests`. Returns the number of requests moved, or
+// (size_t)-1 on error.
+static size_t bdus_async_take_free_requests_(
+    struct bdus_async_ctx_ *async, struct bdus_request **out_requests,
+    size_t max)
+{
+    size_t num_requests = 0;
+
+    if (pthread_mutex_lock(&async->mutex) != 0)
+        abort();
+
+    if (async->error_errno != 0)
+    {
+        bdus_set_error_append_errno_(
+            async->error_errno, "%s", async->error_message);
+
+        num_requests = (size_t)(-1);
+    }
+    else
+    {
+        while (num_requests < max && async->free_requests)
+        {
+            out_requests[num_requests++] = async->free_requests;
+            async->free_requests         = async->free_requests->next_free;
+        }
+    }
+
+    if (pthread_mutex_unlock(&async->mutex) != 0)
+        abort();
+
+    return num_requests;
+}
+
+static void bdus_async_put_free_requests_(
+    struct bdus_async_ctx_ *async, struct bdus_request **requests,
+    size_t num_requests)
+{
+    if (pthread_mutex_lock(&async->mutex) != 0)
+        abort();
+
+    for (size_t i = 0; i < num_requests; ++i)
+    {
+        requests[i]->next_free = async->free_requests;
+        async->free_requests   = requests[i];
+    }
+
+    if (pthread_mutex_unlock(&async->mutex) != 0)
+        abort();
+}
+
+// Serves the given request, returning whether its completion was deferred, or
+// sets `*out_error` to true if an error occurred.
+static bool bdus_async_process_request_(
+    struct bdus_async_ctx_ *async, struct bdus_request *request,
+    bool *out_error)
+{
+    union kbdus_reply_or_item *const rai = &request->rai;
+
+    // reply field `use_splice` aliases item field `num_ranges`, so item fields
+    // must be read before it is cleared
+
+    const uint16_t num_ranges = rai->item.num_ranges;
+
+    bdus_request_ioprio_ = rai->item.ioprio;
+
+    // let read, write, and FUA write callbacks use bdus_splice(), and all
+    // request callbacks use bdus_defer()
+
+    rai->reply.use_splice = UINT8_C(0);
+
+    if (rai->item.type == KBDUS_ITEM_TYPE_READ
+        || rai->item.type == KBDUS_ITEM_TYPE_WRITE
+        || rai->item.type == KBDUS_ITEM_TYPE_FUA_WRITE)
+    {
+        bdus_splice_reply_ = &rai->reply;
+    }
+
+    bdus_defer_request_ = request;
+
+    const ssize_t reply_payload_size = bdus_backend_process_request_(
+        async->ctx, async->trace_ring, 0, request->payload, NULL, 0,
+        rai->item.type, rai->item.arg64, rai->item.arg32, num_ranges,
+        &rai->reply.error, &rai->reply.arg64);
+
+    const bool deferred = !bdus_defer_request_;
+
+    bdus_defer_request_  = NULL;
+    bdus_splice_reply_   = NULL;
+    bdus_request_ioprio_ = 0;
+
+    *out_error = false;
+
+    if (reply_payload_size < 0)
+    {
+        bdus_set_error_(EINVAL, "Received item of unknown type");
+        *out_error = true;
+    }
+    else if (!deferred && rai->reply.error == (int32_t)bdus_abort)
+    {
+        bdus_set_error_(EIO, "Driver aborted");
+        *out_error = true;
+    }
+
+    return deferred;
+}
+
+// Receives items and serves them until the driver is terminated.
+static bool bdus_async_loop_(struct bdus_async_ctx_ *async)
+{
+    struct kbdus_item items[BDUS_MAX_BATCH_SIZE_];
+    union kbdus_reply_or_item replies[BDUS_MAX_BATCH_SIZE_];
+    struct bdus_request *requests[BDUS_MAX_BATCH_SIZE_];
+    struct bdus_request *replied_requests[BDUS_MAX_BATCH_SIZE_];
+
+    bool allow_device_available = true;
+
+    while (true)
+    {
+        // take free requests into which to receive items, waiting for deferred
+        // requests to complete if there are none
+
+        const size_t num_requests = bdus_async_take_free_requests_(
+            async, requests, BDUS_MAX_BATCH_SIZE_);
+
+        if (num_requests == (size_t)(-1))
+            return false;
+
+        if (num_requests == 0)
+        {
+            if (!bdus_async_wait_(async, -1))
+                return false;
+
+            continue;
+        }
+
+        // receive items, waiting for them to arrive if the control file
+        // description is in non-blocking mode and there are none
+
+        for (size_t i = 0; i < num_requests; ++i)
+        {
+            memset(&items[i], 0, sizeof(items[i]));
+
+            items[i].user_ptr_or_buffer_index =
+                (uint64_t)(uintptr_t)requests[i]->payload;
+        }
+
+        const ssize_t ret =
+            pread(async->control_fd, items, 64 * num_requests, 0);
+
+        const size_t num_items = ret > 0 ? (size_t)ret / 64 : 0;
+
+        bdus_async_put_free_requests_(
+            async, requests + num_items, num_requests - num_items);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret < 0 && errno == EAGAIN)
+        {
+            if (!bdus_async_wait_(async, async->control_fd))
+                return false;
+
+            continue;
+        }
+
+        if (ret <= 0)
+        {
+            bdus_set_error_append_errno_(
+                ret == 0 ? EIO : errno,
+                "Failed to receive items from /dev/bdus-control");
+
+            return false;
+        }
+
+        // process items, collecting replies to requests that were not deferred
+
+        size_t num_replies = 0;
+
+        for (size_t i = 0; i < num_items; ++i)
+        {
+            struct bdus_request *const request = requests[i];
+
+            request->rai.item = items[i];
+
+            switch (request->rai.item.type)
+            {
+            case KBDUS_ITEM_TYPE_DEVICE_AVAILABLE:
+
+                bdus_async_put_free_requests_(async, &requests[i], 1);
+
+                if (!allow_device_available)
+                {
+                    bdus_set_error_(
+                        EINVAL,
+                        "Received \"device available\" notification more than"
+                        " once");
+
+                    return false;
+                }
+
+                allow_device_available = false;
+
+                if (!bdus_backend_on_device_available_(async->ctx, 0))
+                    return false;
+
+                break;
+
+            case KBDUS_ITEM_TYPE_TERMINATE:
+
+                bdus_async_put_free_requests_(async, &requests[i], 1);
+
+                return true;
+
+            case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
+            {
+                int32_t error;
+
+                bdus_async_put_free_requests_(async, &requests[i], 1);
+
+                // ensure that previously received writes are flushed
+
+                if (!bdus_async_drain_(async))
+                    return false;
+
+                bdus_backend_process_flush_request_(async->ctx, 0, &error);
+
+                if (error != 0)
+                {
+                    bdus_set_error_(EIO, "Failed to flush before terminating");
+                    return false;
+                }
+
+                return true;
+            }
+
+            default:
+            {
+                bool error;
+
+                if (bdus_async_process_request_(async, request, &error))
+                    break;
+
+                replies[num_replies]          = request->rai;
+                replied_requests[num_replies] = request;
+
+                ++num_replies;
+
+                if (error)
+                {
+                    bdus_async_put_free_requests_(
+                        async, replied_requests, num_replies);
+
+                    bdus_async_put_free_requests_(
+                        async, requests + i + 1, num_items - i - 1);
+
+                    return false;
+                }
+
+                break;
+            }
+            }
+        }
+
+        // send replies
+
+        const bool sent = num_replies == 0
+            || bdus_async_send_replies_(
+                async->control_fd, replies, num_replies);
+
+        bdus_async_put_free_requests_(async, replied_requests, num_replies);
+
+        if (!sent)
+        {
+            bdus_set_error_append_errno_(
+                errno, "Failed to send replies to /dev/bdus-control");
+
+            return false;
+        }
+    }
+}
+
+// Allocates the payload buffers of all requests, using the driver's
+// allocate_payload_buffer() callback if implemented.
+static bool bdus_async_init_payloads_(
+    struct bdus_async_ctx_ *async, size_t max_payload_size, size_t page_size)
+{
+    struct bdus_ctx *const ctx = async->ctx;
+
+    if (max_payload_size == 0)
+        return true;
+
+    const size_t payload_size = bdus_round_up_(max_payload_size, page_size);
+    const size_t size         = payload_size * async->num_requests;
+
+    if (ctx->ops->allocate_payload_buffer)
+    {
+        if (ctx->attrs->log)
+            bdus_log_thread_(0, "allocate_payload_buffer(%zu, ctx)", size);
+
+        async->payloads = ctx->ops->allocate_payload_buffer(size, ctx);
+
+        if (!async->payloads)
+        {
+            bdus_set_error_append_errno_(
+                errno, "Driver callback allocate_payload_buffer() failed");
+
+            return false;
+        }
+
+        async->payload_size = payload_size;
+
+        if ((uintptr_t)async->payloads % page_size != 0)
+        {
+            bdus_set_error_(
+                EINVAL,
+                "Driver callback allocate_payload_buffer() returned a buffer"
+                " that is not aligned to the system's page size");
+
+            return false;
+        }
+    }
+    else
+    {
+        const int ret = posix_memalign(&async->payloads, page_size, size);
+
+        if (ret != 0)
+        {
+            async->payloads = NULL;
+            bdus_set_error_append_errno_(ret, "posix_memalign() failed");
+            return false;
+        }
+
+        async->payload_size = payload_size;
+    }
+
+    for (size_t i = 0; i < async->num_requests; ++i)
+    {
+        async->requests[i].payload =
+            (char *)async->payloads + payload_size * i;
+    }
+
+    return true;
+}
+
+static void bdus_async_free_payloads_(struct bdus_async_ctx_ *async)
+{
+    struct bdus_ctx *const ctx = async->ctx;
+
+    const size_t size = async->payload_size * async->num_requests;
+
+    if (!async->payloads)
+        return;
+
+    if (ctx->ops->free_payload_buffer)
+    {
+        if (ctx->attrs->log)
+        {
+            bdus_log_thread_(
+                0, "free_payload_buffer(%p, %zu, ctx)", async->payloads, size);
+        }
+
+        ctx->ops->free_payload_buffer(async->payloads, size, ctx);
+    }
+    else
+    {
+        free(async->payloads);
+    }
+}
+
+// Serves requests from the calling thread, allowing their completion to be
+// deferred.
+static bool bdus_run_async_(
+    int control_fd, struct bdus_ctx *ctx, struct bdus_trace_ *trace)
+{
+    const size_t page_size = bdus_get_page_size_();
+
+    if (page_size == 0)
+        return false;
+
+    // have reads of items not block if the driver waits for them itself
+
+    if (ctx->ops->async_wait)
+    {
+        const int flags = fcntl(control_fd, F_GETFL);
+
+        if (flags < 0 || fcntl(control_fd, F_SETFL, flags | O_NONBLOCK) != 0)
+        {
+            bdus_set_error_append_errno_(
+                errno, "Failed to put /dev/bdus-control in non-blocking mode");
+
+            return false;
+        }
+    }
+
+    // initialize context and requests
+
+    struct bdus_async_ctx_ async = {
+        .ctx          = ctx,
+        .control_fd   = control_fd,
+        .trace_ring   = bdus_trace_get_ring_(trace, 0),
+        .num_requests = (size_t)ctx->attrs->async_queue_depth,
+    };
+
+    async.requests = calloc(async.num_requests, sizeof(*async.requests));
+
+    if (!async.requests)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+        return false;
+    }
+
+    for (size_t i = async.num_requests; i > 0; --i)
+    {
+        async.requests[i - 1].async     = &async;
+        async.requests[i - 1].next_free = async.free_requests;
+        async.free_requests             = &async.requests[i - 1];
+    }
+
+    if (!bdus_async_init_payloads_(
+            &async, bdus_max_request_payload_size_(ctx), page_size))
+    {
+        bdus_async_free_payloads_(&async);
+        free(async.requests);
+        return false;
+    }
+
+    if (pthread_mutex_init(&async.mutex, NULL) != 0
+        || pthread_cond_init(&async.request_completed, NULL) != 0)
+    {
+        abort();
+    }
+
+    // serve requests
+
+    const bool success = bdus_async_loop_(&async);
+
+    // on error, terminate control file description so that the kernel fails
+    // pending requests, whose replies are then ignored
+
+    if (!success
+        && bdus_ioctl_retry_(control_fd, KBDUS_IOCTL_TERMINATE) != 0)
+    {
+        abort();
+    }
+
+    // wait for the driver to complete all deferred requests, as their buffers
+    // must remain valid until then (if waiting fails, their memory is leaked)
+
+    const int previous_errno = errno;
+
+    if (!bdus_async_drain_(&async))
+        return false;
+
+    errno = previous_errno;
+
+    // free everything
+
+    if (pthread_cond_destroy(&async.request_completed) != 0
+        || pthread_mutex_destroy(&async.mutex) != 0)
+    {
+        abort();
+    }
+
+    bdus_async_free_payloads_(&async);
+    free(async.requests);
+
+    return success;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool bdus_backend_run_(
+    int control_fd, struct bdus_ctx *ctx, uint32_t max_outstanding_reqs,
+    struct bdus_trace_ *trace, struct bdus_handoff_ *handoff)
+{
+    if (ctx->attrs->async_queue_depth > 0)
+        return bdus_run_async_(control_fd, ctx, trace);
+
+    const size_t num_threads = (size_t)ctx->attrs->max_concurrent_callbacks;
+    const size_t num_queues  = (size_t)ctx->attrs->num_queues;
+
+    // split the rais evenly among threads, so that each thread receives
+    // batches of up to `batch_size` items (only the first of which can use the
+    // thread's preallocated buffer, and thus avoid copies)
+
+    const size_t batch_size = ctx->attrs->zero_copy
+        ? (size_t)1
+        : bdus_clamp_(
+            (size_t)max_outstanding_reqs / num_threads, (size_t)1,
+            (size_t)BDUS_MAX_BATCH_SIZE_);
+
+    const size_t page_size = bdus_get_page_size_();
+
+    if (page_size == 0)
+        return false;
+
+    // allocate and initialize context structures
+
+    struct bdus_thread_ctx_ *const contexts =
+        calloc(num_threads, sizeof(*contexts));
+
+    if (!contexts)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+        return false;
+    }
+
+    // map memory
+
+    const size_t max_payload_size = bdus_max_request_payload_size_(ctx);
+
+    const size_t rai_memory_size =
+        bdus_round_up_(max_outstanding_reqs * 64, page_size);
+
+    const size_t single_payload_memory_size =
+        bdus_round_up_(max_payload_size, page_size);
+
+    void *const rai_memory =
+        bdus_mmap_(control_fd, 0, rai_memory_size, true, true);
+
+    if (!rai_memory)
+    {
+        free(contexts);
+        return false;
+    }
+
+    // only the first `min_concurrent_callbacks` threads are always running,
+    // the payload buffers of the others are set up when they are spawned
+
+    struct bdus_pool_ pool = {
+        .contexts    = contexts,
+        .num_threads = num_threads,
+        .min_threads = (size_t)ctx->attrs->min_concurrent_callbacks,
+
+        .max_payload_size           = max_payload_size,
+        .rai_memory_size            = rai_memory_size,
+        .single_payload_memory_size = single_payload_memory_size,
+        .page_size                  = page_size,
+
+        .allow_spawning = false,
+
+        .handoff = handoff,
+    };
+
+    if (pthread_mutex_init(&pool.mutex, NULL) != 0)
+        abort();
+
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        struct bdus_thread_ctx_ *const c = &contexts[i];
+
+        c->ctx        = ctx;
+        c->control_fd = control_fd;
+
+        c->pool  = &pool;
+        c->state = BDUS_THREAD_STOPPED_;
+
+        c->thread_index           = i;
+        c->allow_device_available = false;
+
+        c->trace_ring = bdus_trace_get_ring_(trace, i);
+
+        bdus_select_item_processor_(c);
+
+        c->batch = (struct kbdus_batch) {
+            .first_index = (uint64_t)(batch_size * i),
+            .size        = (uint32_t)batch_size,
+            .queue_index = (uint32_t)(i % num_queues),
+            .timeout_ms  = i < pool.min_threads
+                ? UINT32_C(0)
+                : ctx->attrs->idle_worker_timeout_ms,
+        };
+
+        c->rais = (union kbdus_reply_or_item *)((char *)rai_memory
+                                                + 64 * batch_size * i);
+
+        if (i < pool.min_threads
+            && !bdus_init_payloads_(
+                c, max_payload_size, rai_memory_size,
+                single_payload_memory_size, page_size))
+        {
+            bdus_free_payloads_(contexts, i + 1);
+
+            if (pthread_mutex_destroy(&pool.mutex) != 0)
+                abort();
+
+            if (munmap(rai_memory, rai_memory_size) != 0)
+                abort();
+
+            free(contexts);
+
+            return false;
+        }
+    }
+
+    // delegate things
+
+    const bool success = bdus_run_2_(ctx, &pool);
+
+    // free context structures and unmap memory
+
+    bdus_free_payloads_(contexts, num_threads);
+
+    if (pthread_mutex_destroy(&pool.mutex) != 0)
+        abort();
+
+    if (munmap(rai_memory, rai_memory_size) != 0)
+        abort();
+
+    free(contexts);
+
+    // return success indication
+
+    return success;
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the initial state of the random number generator of the worker thread
+// with the given index, derived from `seed` using SplitMix64.
+static uint64_t bdus_loopback_seed_(uint64_t seed, size_t thread_index)
+{
+    uint64_t z =
+        seed + UINT64_C(0x9E3779B97F4A7C15) * ((uint64_t)thread_index + 1);
+
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    z = z ^ (z >> 31);
+
+    return z != 0 ? z : 1;
+}
+
+// Determines the types of requests to generate, which must include at least
+// one type.
+static void bdus_loopback_init_types_(
+    struct bdus_loopback_ *loopback,
+    const struct bdus_loopback_attrs *loopback_attrs)
+{
+    const uint32_t types[BDUS_LOOPBACK_NUM_TYPES_] = {
+        KBDUS_ITEM_TYPE_READ,      KBDUS_ITEM_TYPE_WRITE,
+        KBDUS_ITEM_TYPE_FUA_WRITE, KBDUS_ITEM_TYPE_FLUSH,
+        KBDUS_ITEM_TYPE_DISCARD,   KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP,
+    };
+
+    const uint32_t weights[BDUS_LOOPBACK_NUM_TYPES_] = {
+        loopback_attrs->read_weight,      loopback_attrs->write_weight,
+        loopback_attrs->fua_write_weight, loopback_attrs->flush_weight,
+        loopback_attrs->discard_weight,   loopback_attrs->write_zeros_weight,
+    };
+
+    uint64_t total_weight = 0;
+
+    loopback->num_types = 0;
+
+    for (size_t i = 0; i < BDUS_LOOPBACK_NUM_TYPES_; ++i)
+    {
+        if (weights[i] > 0)
+        {
+            total_weight += (uint64_t)weights[i];
+
+            loopback->types[loopback->num_types]              = types[i];
+            loopback->cumulative_weights[loopback->num_types] = total_weight;
+
+            ++loopback->num_types;
+        }
+    }
+}
+
+// Adds the statistics of every worker thread to `out_results`.
+static void bdus_loopback_gather_results_(
+    const struct bdus_loopback_thread_ *threads, size_t num_threads,
+    struct bdus_loopback_results *out_results)
+{
+    for (size_t i = 0; i < BDUS_STATS_NUM_REQ_TYPES; ++i)
+    {
+        struct bdus_request_stats *const t = &out_results->types[i];
+
+        t->type = bdus_trace_type_name_(KBDUS_ITEM_TYPE_READ + (uint32_t)i);
+
+        for (size_t j = 0; j < num_threads; ++j)
+        {
+            const struct bdus_request_stats *const s = &threads[j].stats[i];
+
+            t->requests += s->requests;
+            t->bytes += s->bytes;
+            t->errors += s->errors;
+            t->service_ns += s->service_ns;
+
+            for (size_t k = 0; k < BDUS_STATS_HIST_BUCKETS; ++k)
+            {
+                t->queue_wait_hist[k] += s->queue_wait_hist[k];
+                t->service_hist[k] += s->service_hist[k];
+            }
+        }
+    }
+}
+
+bool bdus_backend_run_loopback_(
+    struct bdus_ctx *ctx, const struct bdus_loopback_attrs *loopback_attrs,
+    struct bdus_loopback_results *out_results)
+{
+    const size_t num_threads = (size_t)ctx->attrs->max_concurrent_callbacks;
+
+    // split the queue depth evenly among threads, as bdus_backend_run_() does
+    // with the rais
+
+    const size_t batch_size = bdus_clamp_(
+        (size_t)loopback_attrs->queue_depth / num_threads, (size_t)1,
+        (size_t)BDUS_MAX_BATCH_SIZE_);
+
+    const size_t page_size = bdus_get_page_size_();
+
+    if (page_size == 0)
+        return false;
+
+    // determine the requests to generate
+
+    struct bdus_loopback_ loopback = {
+        .attrs     = loopback_attrs,
+        .remaining = loopback_attrs->num_requests,
+        .stop      = false,
+    };
+
+    bdus_loopback_init_types_(&loopback, loopback_attrs);
+
+    // allocate context structures, with rais in process memory instead of
+    // memory shared with kbdus
+
+    struct bdus_thread_ctx_ *const contexts =
+        calloc(num_threads, sizeof(*contexts));
+
+    struct bdus_loopback_thread_ *const threads =
+        calloc(num_threads, sizeof(*threads));
+
+    union kbdus_reply_or_item *const rais =
+        calloc(num_threads * batch_size, sizeof(*rais));
+
+    if (!contexts || !threads || !rais)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+
+        free(rais);
+        free(threads);
+        free(contexts);
+
+        return false;
+    }
+
+    // all threads are always running
+
+    const size_t max_payload_size = bdus_max_request_payload_size_(ctx);
+
+    struct bdus_pool_ pool = {
+        .contexts    = contexts,
+        .num_threads = num_threads,
+        .min_threads = num_threads,
+
+        .max_payload_size = max_payload_size,
+        .rai_memory_size  = 0,
+        .single_payload_memory_size =
+            bdus_round_up_(max_payload_size, page_size),
+        .page_size = page_size,
+
+        .allow_spawning = false,
+
+        .handoff = NULL,
+    };
+
+    if (pthread_mutex_init(&pool.mutex, NULL) != 0)
+        abort();
+
+    // initialize context structures and set up payload buffers
+
+    size_t num_initialized = 0;
+    bool success           = true;
+
+    while (success && num_initialized < num_threads)
+    {
+        const size_t i = num_initialized++;
+
+        struct bdus_thread_ctx_ *const c = &contexts[i];
+
+        threads[i].shared       = &loopback;
+        threads[i].random_state = bdus_loopback_seed_(loopback_attrs->seed, i);
+
+        c->ctx        = ctx;
+        c->control_fd = -1;
+        c->loopback   = &threads[i];
+
+        c->pool  = &pool;
+        c->state = BDUS_THREAD_STOPPED_;
+
+        c->thread_index           = i;
+        c->allow_device_available = false;
+
+        bdus_select_item_processor_(c);
+
+        c->batch = (struct kbdus_batch) {
+            .first_index = (uint64_t)(batch_size * i),
+            .size        = (uint32_t)batch_size,
+        };
+
+        c->rais = rais + batch_size * i;
+
+        success = bdus_init_payloads_(
+            c, max_payload_size, pool.rai_memory_size,
+            pool.single_payload_memory_size, page_size);
+    }
+
+    // serve requests
+
+    const uint64_t start_ns = bdus_trace_now_ns_();
+
+    success = success && bdus_run_3_(&pool);
+
+    if (success)
+    {
+        *out_results = (struct bdus_loopback_results) {
+            .elapsed_ns = bdus_trace_now_ns_() - start_ns,
+        };
+
+        bdus_loopback_gather_results_(threads, num_threads, out_results);
+    }
+
+    // free context structures
+
+    bdus_free_payloads_(contexts, num_initialized);
+
+    if (pthread_mutex_destroy(&pool.mutex) != 0)
+        abort();
+
+    free(rais);
+    free(threads);
+    free(contexts);
+
+    // return success indication
+
+    return success;
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct bdus_many_device_
+{
+    struct bdus_ctx *ctx;
+    int control_fd;
+
+    // NULL if requests are not traced, otherwise with a ring per thread
+    struct bdus_trace_ *trace;
+
+    // whether the "device available" notification was received, and how many
+    // batches of the device's requests are being served, both protected by the
+    // mutex of the `struct bdus_many_ctx_`
+    bool available;
+    size_t num_batches_being_served;
+};
+
+// The state shared by the worker threads serving several devices.
+struct bdus_many_ctx_
+{
+    struct bdus_many_device_ *devices;
+    size_t num_devices;
+
+    // every device's control file description is registered with
+    // EPOLLONESHOT, so that each of its batches of items is received by a
+    // single thread, and is then rearmed to let threads serve other ready
+    // devices first; `stop_fd` is level-triggered, so that writing to it wakes
+    // up all threads
+    int epoll_fd;
+    int stop_fd;
+
+    size_t batch_size;
+    size_t payload_size;
+
+    // protects the fields below, and is used with `batch_served` to wait for
+    // threads to finish serving a device's requests
+    pthread_mutex_t mutex;
+    pthread_cond_t batch_served;
+
+    size_t num_unavailable; // devices yet to become available or terminate
+    size_t num_running;     // devices yet to terminate
+
+    // set when any thread fails, after which all devices are terminated
+    bool failed;
+    int error_errno;
+    char error_message[1024];
+};
+
+struct bdus_many_thread_
+{
+    struct bdus_many_ctx_ *many;
+
+    pthread_t thread;
+    size_t thread_index;
+
+    // items are received into these rais, whose payload buffers are
+    // consecutive `many->payload_size` buffers in `payloads`
+    union kbdus_reply_or_item rais[BDUS_MAX_BATCH_SIZE_];
+    char *payloads;
+};
+
+static void bdus_many_stop_(struct bdus_many_ctx_ *many)
+{
+    const uint64_t value = 1;
+
+    if (write(many->stop_fd, &value, sizeof(value)) != (ssize_t)sizeof(value))
+        abort();
+}
+
+// Records the calling thread's current error, if no thread failed before, and
+// terminates all devices, so that threads stop once they are all terminated.
+static void bdus_many_fail_(struct bdus_many_ctx_ *many)
+{
+    const int error_errno = errno;
+
+    if (pthread_mutex_lock(&many->mutex) != 0)
+        abort();
+
+    const bool first_error = !many->failed;
+
+    if (first_error)
+    {
+        many->failed      = true;
+        many->error_errno = error_errno;
+
+        snprintf(
+            many->error_message, sizeof(many->error_message), "%s",
+            bdus_get_error_message_());
+    }
+
+    if (pthread_mutex_unlock(&many->mutex) != 0)
+        abort();
+
+    if (first_error)
+    {
+        for (size_t i = 0; i < many->num_devices; ++i)
+        {
+            if (bdus_ioctl_retry_(
+                    many->devices[i].control_fd, KBDUS_IOCTL_TERMINATE)
+                != 0)
+            {
+                abort();
             }
+        }
+    }
+}
+
+// Accounts for a device no longer being served, stopping all threads if it was
+// the last one.
+static void bdus_many_device_terminated_(
+    struct bdus_many_ctx_ *many, struct bdus_many_device_ *device)
+{
+    if (pthread_mutex_lock(&many->mutex) != 0)
+        abort();
+
+    if (!device->available)
+    {
+        device->available = true;
+        --many->num_unavailable;
+    }
+
+    const bool last = --many->num_running == 0;
+
+    if (pthread_mutex_unlock(&many->mutex) != 0)
+        abort();
+
+    if (last)
+        bdus_many_stop_(many);
+}
+
+// Has the given device's control file description be reported by epoll again
+// once it has items to be received.
+static bool bdus_many_rearm_(
+    struct bdus_many_ctx_ *many, struct bdus_many_device_ *device)
+{
+    struct epoll_event event = {
+        .events   = EPOLLIN | EPOLLONESHOT,
+        .data.ptr = device,
+    };
+
+    if (epoll_ctl(many->epoll_fd, EPOLL_CTL_MOD, device->control_fd, &event)
+        != 0)
+    {
+        bdus_set_error_append_errno_(errno, "epoll_ctl() failed");
+        return false;
+    }
+
+    return true;
+}
+
+// Serves the requests in the given batch of received items, which must not
+// include notifications, and sends their replies.
+static bool bdus_many_process_requests_(
+    struct bdus_many_thread_ *thread, struct bdus_many_device_ *device,
+    size_t num_items)
+{
+    struct bdus_ctx *const ctx = device->ctx;
+
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        union kbdus_reply_or_item *const rai = &thread->rais[i];
+
+        // reply field `use_splice` aliases item field `num_ranges`, so item
+        // fields must be read before it is cleared
+
+        const uint16_t num_ranges = rai->item.num_ranges;
+
+        bdus_request_ioprio_ = rai->item.ioprio;
+
+        // let read, write, and FUA write callbacks use bdus_splice()
+
+        rai->reply.use_splice = UINT8_C(0);
+
+        if (rai->item.type == KBDUS_ITEM_TYPE_READ
+            || rai->item.type == KBDUS_ITEM_TYPE_WRITE
+            || rai->item.type == KBDUS_ITEM_TYPE_FUA_WRITE)
+        {
+            bdus_splice_reply_ = &rai->reply;
+        }
+
+        const ssize_t reply_payload_size = bdus_backend_process_request_(
+            ctx, bdus_trace_get_ring_(device->trace, thread->thread_index),
+            (int)thread->thread_index,
+            thread->payloads + thread->many->payload_size * i, NULL, 0,
+            rai->item.type, rai->item.arg64, rai->item.arg32, num_ranges,
+            &rai->reply.error, &rai->reply.arg64);
+
+        bdus_splice_reply_   = NULL;
+        bdus_request_ioprio_ = 0;
+
+        if (reply_payload_size < 0)
+        {
+            bdus_set_error_(EINVAL, "Received item of unknown type");
+            return false;
+        }
+
+        if (rai->reply.error == (int32_t)bdus_abort)
+        {
+            bdus_set_error_(EIO, "Driver aborted");
+            return false;
+        }
+    }
+
+    if (!bdus_async_send_replies_(device->control_fd, thread->rais, num_items))
+    {
+        bdus_set_error_append_errno_(
+            errno, "Failed to send replies to /dev/bdus-control");
+
+        return false;
+    }
+
+    return true;
+}
+
+// Receives a batch of items from the given device, which epoll reported as
+// readable, and serves them. Sets `*out_terminated` to true if the device is
+// no longer to be served, in which case it is not rearmed.
+static bool bdus_many_serve_device_(
+    struct bdus_many_thread_ *thread, struct bdus_many_device_ *device,
+    bool *out_terminated)
+{
+    struct bdus_many_ctx_ *const many = thread->many;
 
-            for (; i > 1; --i)
-            {
-                if (pthread_join(contexts[i - 1].thread, NULL) != 0)
-                    abort();
-            }
+    *out_terminated = false;
 
-            bdus_set_error_append_errno_(ret, "pthread_create() failed");
-            return false;
-        }
+    // receive items without blocking, as another thread may have received
+    // them first
+
+    for (size_t i = 0; i < many->batch_size; ++i)
+    {
+        memset(&thread->rais[i], 0, sizeof(thread->rais[i]));
+
+        thread->rais[i].item.user_ptr_or_buffer_index =
+            (uint64_t)(uintptr_t)(thread->payloads + many->payload_size * i);
     }
 
-    // run first worker thread
+    const ssize_t ret =
+        pread(device->control_fd, thread->rais, 64 * many->batch_size, 0);
 
-    bdus_work_loop_(&contexts[0]);
+    if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        *out_terminated = !bdus_many_rearm_(many, device);
+        return !*out_terminated;
+    }
 
-    // join worker threads
+    if (ret <= 0)
+    {
+        bdus_set_error_append_errno_(
+            ret == 0 ? EIO : errno,
+            "Failed to receive items from /dev/bdus-control");
+
+        *out_terminated = true;
+        return false;
+    }
+
+    const size_t num_items = (size_t)ret / 64;
+
+    // handle notifications, which are always received alone
 
-    for (size_t i = 1; i < num_threads; ++i)
+    switch (thread->rais[0].item.type)
     {
-        if (pthread_join(contexts[i].thread, NULL) != 0)
+    case KBDUS_ITEM_TYPE_DEVICE_AVAILABLE:
+    {
+        if (pthread_mutex_lock(&many->mutex) != 0)
+            abort();
+
+        const bool duplicate = device->available;
+
+        // on_device_available() must not run concurrently with callbacks
+        // serving requests received previously
+
+        while (device->num_batches_being_served > 0)
+        {
+            if (pthread_cond_wait(&many->batch_served, &many->mutex) != 0)
+                abort();
+        }
+
+        if (!duplicate)
+        {
+            device->available = true;
+            --many->num_unavailable;
+        }
+
+        if (pthread_mutex_unlock(&many->mutex) != 0)
             abort();
+
+        bool success;
+
+        if (duplicate)
+        {
+            bdus_set_error_(
+                EINVAL,
+                "Received \"device available\" notification more than once");
+
+            success = false;
+        }
+        else
+        {
+            success = bdus_backend_invoke_on_device_available_(
+                device->ctx, (int)thread->thread_index);
+        }
+
+        // rearm even on failure, so that the termination notification is
+        // received
+
+        if (!bdus_many_rearm_(many, device))
+        {
+            *out_terminated = true;
+            return false;
+        }
+
+        return success;
     }
 
-    // check if any thread failed
+    case KBDUS_ITEM_TYPE_TERMINATE:
 
-    for (size_t i = 0; i < num_threads; ++i)
+        *out_terminated = true;
+        return true;
+
+    case KBDUS_ITEM_TYPE_FLUSH_AND_TERMINATE:
     {
-        if (contexts[i].status == BDUS_STATUS_ERROR_)
-        {
-            bdus_set_error_append_errno_(
-                contexts[i].error_errno, "%s", contexts[i].error_message);
+        int32_t error;
+
+        *out_terminated = true;
+
+        bdus_backend_process_flush_request_(
+            device->ctx, (int)thread->thread_index, &error);
 
+        if (error != 0)
+        {
+            bdus_set_error_(EIO, "Failed to flush before terminating");
             return false;
         }
+
+        return true;
     }
 
-    // success
+    default:
+    {
+        // let other threads receive further items from the device while these
+        // are served
 
-    return true;
+        if (pthread_mutex_lock(&many->mutex) != 0)
+            abort();
+
+        ++device->num_batches_being_served;
+
+        if (pthread_mutex_unlock(&many->mutex) != 0)
+            abort();
+
+        const bool rearmed = bdus_many_rearm_(many, device);
+
+        const bool success =
+            rearmed && bdus_many_process_requests_(thread, device, num_items);
+
+        if (pthread_mutex_lock(&many->mutex) != 0)
+            abort();
+
+        if (--device->num_batches_being_served == 0
+            && pthread_cond_broadcast(&many->batch_served) != 0)
+        {
+            abort();
+        }
+
+        if (pthread_mutex_unlock(&many->mutex) != 0)
+            abort();
+
+        *out_terminated = !rearmed;
+        return success;
+    }
+    }
 }
 
-static bool bdus_run_2_(
-    struct bdus_ctx *ctx, struct bdus_thread_ctx_ *contexts, size_t num_threads)
+// Serves devices as epoll reports them readable, until all of them are
+// terminated or, if `until_available` is true, until none is yet to become
+// available.
+static void
+    bdus_many_loop_(struct bdus_many_thread_ *thread, bool until_available)
 {
-    // run single-threaded until device becomes available, terminates, or error
+    struct bdus_many_ctx_ *const many = thread->many;
 
+    while (true)
     {
-        struct bdus_thread_ctx_ *const context = &contexts[0];
+        if (until_available)
+        {
+            if (pthread_mutex_lock(&many->mutex) != 0)
+                abort();
 
-        context->allow_device_available = true;
+            const size_t num_unavailable = many->num_unavailable;
 
-        bdus_work_loop_(&contexts[0]);
+            if (pthread_mutex_unlock(&many->mutex) != 0)
+                abort();
 
-        switch (context->status)
+            if (num_unavailable == 0)
+                return;
+        }
+
+        struct epoll_event event;
+
+        const int ret = epoll_wait(many->epoll_fd, &event, 1, -1);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret < 0)
         {
-        case BDUS_STATUS_DEVICE_AVAILABLE_:
-            break;
+            bdus_set_error_append_errno_(errno, "epoll_wait() failed");
+            bdus_many_fail_(many);
+            bdus_many_stop_(many);
+            return;
+        }
 
-        case BDUS_STATUS_TERMINATE_:
-            return true;
+        if (ret == 0)
+            continue;
 
-        case BDUS_STATUS_ERROR_:
-            bdus_set_error_append_errno_(
-                context->error_errno, "%s", context->error_message);
-            return false;
+        if (!event.data.ptr)
+            return; // `stop_fd` is readable
+
+        struct bdus_many_device_ *const device = event.data.ptr;
+
+        bool terminated;
+
+        if (!bdus_many_serve_device_(thread, device, &terminated))
+            bdus_many_fail_(many);
+
+        if (terminated)
+            bdus_many_device_terminated_(many, device);
+    }
+}
+
+static void *bdus_many_loop_void_(void *thread)
+{
+    bdus_many_loop_(thread, false);
+    return NULL;
+}
+
+// Serves devices from the calling thread alone until all are available, then
+// daemonizes the current process if requested, and then serves them from all
+// threads.
+static void bdus_many_run_threads_(
+    struct bdus_many_ctx_ *many, struct bdus_many_thread_ *threads,
+    size_t num_threads, bool daemonize)
+{
+    bdus_many_loop_(&threads[0], true);
+
+    if (pthread_mutex_lock(&many->mutex) != 0)
+        abort();
+
+    const bool stopped = many->failed || many->num_running == 0;
+
+    if (pthread_mutex_unlock(&many->mutex) != 0)
+        abort();
+
+    // daemonize the current process now, as it is still single-threaded
+
+    if (!stopped && daemonize)
+    {
+        if (many->devices[0].ctx->attrs->log)
+            bdus_log_no_args_("daemonizing...");
+
+        if (!bdus_daemonize_())
+        {
+            bdus_set_error_(EINVAL, "Failed to daemonize the current process");
+            bdus_many_fail_(many);
         }
+    }
 
-        context->allow_device_available = false;
+    // spawn remaining threads, if any, and join the pool
 
-        // invoke on_device_available() callback and daemonize the current
-        // process
+    size_t num_spawned = 0;
 
-        if (!bdus_backend_on_device_available_(ctx, (int)context->thread_index))
-            return false;
+    for (size_t i = 1; !stopped && i < num_threads; ++i)
+    {
+        const int ret = pthread_create(
+            &threads[i].thread, NULL, bdus_many_loop_void_, &threads[i]);
+
+        if (ret != 0)
+        {
+            bdus_set_error_append_errno_(ret, "pthread_create() failed");
+            bdus_many_fail_(many);
+            break;
+        }
+
+        ++num_spawned;
     }
 
-    // multi-threaded
+    bdus_many_loop_(&threads[0], false);
 
-    return bdus_run_3_(contexts, num_threads);
+    for (size_t i = 1; i <= num_spawned; ++i)
+    {
+        if (pthread_join(threads[i].thread, NULL) != 0)
+            abort();
+    }
 }
 
-static void *bdus_mmap_(int control_fd, size_t offset, size_t length)
+// Registers the control file descriptions of all devices and `many->stop_fd`
+// with `many->epoll_fd`.
+static bool bdus_many_register_fds_(struct bdus_many_ctx_ *many)
 {
-    void *ptr = mmap(
-        NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
-        control_fd, (off_t)offset);
+    struct epoll_event event = {
+        .events   = EPOLLIN,
+        .data.ptr = NULL,
+    };
 
-    if (ptr == MAP_FAILED)
+    if (epoll_ctl(many->epoll_fd, EPOLL_CTL_ADD, many->stop_fd, &event) != 0)
     {
-        bdus_set_error_append_errno_(
-            errno,
-            "mmap() on /dev/bdus-control at offset %zu of length %zu failed",
-            offset, length);
+        bdus_set_error_append_errno_(errno, "epoll_ctl() failed");
+        return false;
+    }
 
-        ptr = NULL;
+    for (size_t i = 0; i < many->num_devices; ++i)
+    {
+        struct bdus_many_device_ *const device = &many->devices[i];
+
+        const int flags = fcntl(device->control_fd, F_GETFL);
+
+        if (flags < 0
+            || fcntl(device->control_fd, F_SETFL, flags | O_NONBLOCK) != 0)
+        {
+            bdus_set_error_append_errno_(
+                errno, "Failed to put /dev/bdus-control in non-blocking mode");
+
+            return false;
+        }
+
+        event = (struct epoll_event) {
+            .events   = EPOLLIN | EPOLLONESHOT,
+            .data.ptr = device,
+        };
+
+        if (epoll_ctl(
+                many->epoll_fd, EPOLL_CTL_ADD, device->control_fd, &event)
+            != 0)
+        {
+            bdus_set_error_append_errno_(errno, "epoll_ctl() failed");
+            return false;
+        }
     }
 
-    return ptr;
+    return true;
 }
 
-bool bdus_backend_run_(
-    int control_fd, struct bdus_ctx *ctx, uint32_t max_outstanding_reqs)
+static bool bdus_many_run_(
+    struct bdus_many_ctx_ *many, size_t num_threads, bool daemonize)
 {
-    const size_t num_threads = (size_t)ctx->attrs->max_concurrent_callbacks;
-
     const size_t page_size = bdus_get_page_size_();
 
     if (page_size == 0)
         return false;
 
-    // allocate and initialize context structures
+    // all threads share a single set of payload buffers large enough for any
+    // device's requests
 
-    struct bdus_thread_ctx_ *const contexts =
-        calloc(num_threads, sizeof(*contexts));
+    size_t max_payload_size = 0;
 
-    if (!contexts)
+    for (size_t i = 0; i < many->num_devices; ++i)
+    {
+        max_payload_size = bdus_max_(
+            max_payload_size,
+            bdus_max_request_payload_size_(many->devices[i].ctx));
+    }
+
+    many->payload_size = bdus_round_up_(max_payload_size, page_size);
+
+    struct bdus_many_thread_ *const threads =
+        calloc(num_threads, sizeof(*threads));
+
+    if (!threads)
     {
         bdus_set_error_append_errno_(errno, "calloc() failed");
         return false;
     }
 
-    // map memory
+    char *payloads = NULL;
 
-    const size_t max_payload_size = bdus_max_request_payload_size_(ctx);
+    if (many->payload_size > 0)
+    {
+        const int ret = posix_memalign(
+            (void **)&payloads, page_size,
+            many->payload_size * many->batch_size * num_threads);
 
-    const size_t rai_memory_size =
-        bdus_round_up_(max_outstanding_reqs * 64, page_size);
+        if (ret != 0)
+        {
+            free(threads);
+            bdus_set_error_append_errno_(ret, "posix_memalign() failed");
+            return false;
+        }
+    }
 
-    const size_t single_payload_memory_size =
-        bdus_round_up_(max_payload_size, page_size);
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        threads[i].many         = many;
+        threads[i].thread_index = i;
+        threads[i].payloads =
+            payloads ? payloads + many->payload_size * many->batch_size * i
+                     : NULL;
+    }
 
-    void *const rai_memory = bdus_mmap_(control_fd, 0, rai_memory_size);
+    // serve requests
 
-    if (!rai_memory)
+    if (pthread_mutex_init(&many->mutex, NULL) != 0
+        || pthread_cond_init(&many->batch_served, NULL) != 0)
     {
-        free(contexts);
-        return false;
+        abort();
     }
 
-    for (size_t i = 0; i < num_threads; ++i)
-    {
-        struct bdus_thread_ctx_ *const c = &contexts[i];
+    bdus_many_run_threads_(many, threads, num_threads, daemonize);
 
-        c->ctx        = ctx;
-        c->control_fd = control_fd;
+    if (pthread_cond_destroy(&many->batch_served) != 0
+        || pthread_mutex_destroy(&many->mutex) != 0)
+    {
+        abort();
+    }
 
-        c->thread_index           = i;
-        c->allow_device_available = false;
+    free(payloads);
+    free(threads);
 
-        c->rai = (union kbdus_reply_or_item *)((char *)rai_memory + 64 * i);
+    if (many->failed)
+    {
+        bdus_set_error_(many->error_errno, "%s", many->error_message);
+        return false;
+    }
 
-        if (max_payload_size == 0)
-        {
-            c->payload = NULL;
-        }
-        else
-        {
-            c->payload = bdus_mmap_(
-                control_fd, rai_memory_size + single_payload_memory_size * i,
-                single_payload_memory_size);
+    return true;
+}
 
-            if (!c->payload)
-            {
-                if (max_payload_size > 0)
-                {
-                    for (; i > 0; --i)
-                    {
-                        if (munmap(
-                                contexts[i - 1].payload,
-                                single_payload_memory_size)
-                            != 0)
-                        {
-                            abort();
-                        }
-                    }
-                }
+bool bdus_backend_run_many_(
+    const struct bdus_backend_device_ *devices, size_t num_devices,
+    size_t num_threads, bool daemonize)
+{
+    struct bdus_many_ctx_ many = {
+        .num_devices     = num_devices,
+        .epoll_fd        = -1,
+        .stop_fd         = -1,
+        .num_unavailable = num_devices,
+        .num_running     = num_devices,
+    };
 
-                if (munmap(rai_memory, rai_memory_size) != 0)
-                    abort();
+    // split each device's rais evenly among threads, as when serving a single
+    // device
 
-                free(contexts);
+    many.batch_size = BDUS_MAX_BATCH_SIZE_;
 
-                return false;
-            }
-        }
+    for (size_t i = 0; i < num_devices; ++i)
+    {
+        many.batch_size = bdus_min_(
+            many.batch_size,
+            bdus_max_(
+                (size_t)devices[i].max_outstanding_reqs / num_threads,
+                (size_t)1));
     }
 
-    // delegate things
+    // create epoll instance
 
-    const bool success = bdus_run_2_(ctx, contexts, num_threads);
+    many.devices = calloc(num_devices, sizeof(*many.devices));
 
-    // free context structures and unmap memory
+    if (!many.devices)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+        return false;
+    }
 
-    if (max_payload_size > 0)
+    for (size_t i = 0; i < num_devices; ++i)
     {
-        for (size_t i = num_threads; i > 0; --i)
-        {
-            if (munmap(contexts[i - 1].payload, single_payload_memory_size)
-                != 0)
-            {
-                abort();
-            }
-        }
+        many.devices[i].ctx        = devices[i].ctx;
+        many.devices[i].control_fd = devices[i].control_fd;
+        many.devices[i].trace      = devices[i].trace;
     }
 
-    if (munmap(rai_memory, rai_memory_size) != 0)
-        abort();
+    many.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    many.stop_fd  = eventfd(0, EFD_CLOEXEC);
 
-    free(contexts);
+    bool success = many.epoll_fd >= 0 && many.stop_fd >= 0;
 
-    // return success indication
+    if (!success)
+        bdus_set_error_append_errno_(errno, "Failed to set up epoll");
+
+    success = success && bdus_many_register_fds_(&many);
+
+    // serve requests
+
+    success = success && bdus_many_run_(&many, num_threads, daemonize);
+
+    // clean up
+
+    if (many.stop_fd >= 0)
+        bdus_close_keep_errno_(many.stop_fd);
+
+    if (many.epoll_fd >= 0)
+        bdus_close_keep_errno_(many.epoll_fd);
+
+    free(many.devices);
 
     return success;
 }
@@ -7,6 +7,9 @@
 
 #include <bdus.h>
 #include <libbdus/backend.h>
+#include <libbdus/handoff.h>
+#include <libbdus/trace.h>
+#include <libbdus/uring.h>
 #include <libbdus/utilities.h>
 
 #include <ctype.h>
@@ -228,10 +231,51 @@ static int bdus_open_control_(bool check_version_compatibility)
 /* -------------------------------------------------------------------------- */
 /* driver development -- common */
 
+// The `struct bdus_ctx` given to a driver's callbacks, along with the control
+// file description attached to its device (or -1 if there is none), through
+// which bdus_set_zero_range() and bdus_invalidate_read_cache() act on it.
+struct bdus_ctx_and_fd_
+{
+    struct bdus_ctx ctx;
+    int control_fd;
+};
+
+// Returns the file descriptor of the control file description attached to the
+// device of the driver whose callbacks are given `ctx`, or -1 if there is none.
+static int bdus_get_ctx_control_fd_(const struct bdus_ctx *ctx)
+{
+    return ((const struct bdus_ctx_and_fd_ *)(const void *)ctx)->control_fd;
+}
+
+// Copies the fields of `struct bdus_attrs` that exist in versions of BDUS prior
+// to 0.1.3, zero-initializing the remaining fields. This avoids reading past
+// the end of `struct bdus_attrs` values of drivers compiled against older
+// versions of `bdus.h`.
+static struct bdus_attrs bdus_copy_attrs_0_1_0_(const struct bdus_attrs *attrs)
+{
+    struct bdus_attrs attrs_copy;
+
+    memset(&attrs_copy, 0, sizeof(attrs_copy));
+    memcpy(&attrs_copy, attrs, offsetof(struct bdus_attrs, num_queues));
+
+    return attrs_copy;
+}
+
+// Same as bdus_copy_attrs_0_1_0_(), but for `struct bdus_ops`.
+static struct bdus_ops bdus_copy_ops_0_1_0_(const struct bdus_ops *ops)
+{
+    struct bdus_ops ops_copy;
+
+    memset(&ops_copy, 0, sizeof(ops_copy));
+    memcpy(&ops_copy, ops, offsetof(struct bdus_ops, allocate_payload_buffer));
+
+    return ops_copy;
+}
+
 #define bdus_log_op_(ops, op)                                                  \
     do                                                                         \
     {                                                                          \
-        bdus_log_("   %-21s   %s", #op "()", (ops)->op ? "non-NULL" : "NULL"); \
+        bdus_log_("   %-25s   %s", #op "()", (ops)->op ? "non-NULL" : "NULL"); \
     } while (0)
 
 #define bdus_log_attr_(attrs, original_attrs, attr, fmt)                       \
@@ -266,6 +310,34 @@ static int bdus_open_control_(bool check_version_compatibility)
         }                                                                      \
     } while (0)
 
+#define bdus_log_attr_str_(attrs, attr)                                        \
+    do                                                                         \
+    {                                                                          \
+        bdus_log_(                                                             \
+            "   %-26s   %s", #attr, (attrs)->attr ? (attrs)->attr : "NULL");   \
+    } while (0)
+
+// Whether the driver's payload buffers are paired with payload windows (see
+// `struct kbdus_fd_config.zero_copy`). Only those buffers are preallocated by
+// kbdus, others being in process memory that is only backed by memory once
+// used.
+static bool bdus_uses_payload_windows_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs)
+{
+    return attrs->zero_copy && !ops->allocate_payload_buffer;
+}
+
+// Whether the driver implements callbacks that take request data as a list of
+// memory regions, and no flat callback for the same request type, in which case
+// kbdus may map request data that is not laid out contiguously into payload
+// windows.
+static bool bdus_has_vector_callbacks_(const struct bdus_ops *ops)
+{
+    return (ops->readv || ops->writev || ops->fua_writev)
+        && (!ops->read || ops->readv) && (!ops->write || ops->writev)
+        && (!ops->fua_write || ops->fua_writev);
+}
+
 static void bdus_log_ops_and_attrs_(
     const struct bdus_ops *ops, const struct bdus_attrs *attrs,
     const struct bdus_attrs *original_attrs)
@@ -283,6 +355,19 @@ static void bdus_log_ops_and_attrs_(
     bdus_log_op_(ops, discard);
     bdus_log_op_(ops, secure_erase);
     bdus_log_op_(ops, ioctl);
+    bdus_log_op_(ops, allocate_payload_buffer);
+    bdus_log_op_(ops, free_payload_buffer);
+    bdus_log_op_(ops, async_wait);
+    bdus_log_op_(ops, readv);
+    bdus_log_op_(ops, writev);
+    bdus_log_op_(ops, fua_writev);
+    bdus_log_op_(ops, discard_ranges);
+    bdus_log_op_(ops, report_zones);
+    bdus_log_op_(ops, reset_zone);
+    bdus_log_op_(ops, open_zone);
+    bdus_log_op_(ops, close_zone);
+    bdus_log_op_(ops, finish_zone);
+    bdus_log_op_(ops, append_to_zone);
 
     bdus_log_no_args_("struct bdus_attrs:");
     bdus_log_attr_(attrs, original_attrs, logical_block_size, PRIu32);
@@ -293,57 +378,124 @@ static void bdus_log_ops_and_attrs_(
     bdus_log_attr_(attrs, original_attrs, max_write_zeros_size, PRIu32);
     bdus_log_attr_(attrs, original_attrs, max_discard_erase_size, PRIu32);
     bdus_log_attr_(attrs, original_attrs, max_concurrent_callbacks, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, num_queues, PRIu32);
     bdus_log_attr_bool_(attrs, original_attrs, disable_partition_scanning);
     bdus_log_attr_bool_(attrs, original_attrs, recoverable);
     bdus_log_attr_bool_(attrs, original_attrs, dont_daemonize);
     bdus_log_attr_bool_(attrs, original_attrs, log);
+    bdus_log_attr_bool_(attrs, original_attrs, use_io_uring);
+    bdus_log_attr_bool_(attrs, original_attrs, io_uring_polling);
+    bdus_log_attr_bool_(attrs, original_attrs, zero_copy);
+    bdus_log_attr_(attrs, original_attrs, async_queue_depth, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, min_concurrent_callbacks, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, idle_worker_timeout_ms, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, num_poll_queues, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, busy_poll_us, PRIu32);
+    bdus_log_attr_str_(attrs, worker_cpus);
+    bdus_log_attr_str_(attrs, worker_numa_nodes);
+    bdus_log_attr_(attrs, original_attrs, max_discard_ranges, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, dispatch_policy, "d");
+    bdus_log_attr_(attrs, original_attrs, zero_extent_size, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, read_cache_size, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, trace_size, PRIu32);
+    bdus_log_attr_bool_(attrs, original_attrs, allow_handoff);
+    bdus_log_attr_(attrs, original_attrs, chunk_size, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, zone_size, PRIu64);
+    bdus_log_attr_(attrs, original_attrs, max_open_zones, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, max_active_zones, PRIu32);
+    bdus_log_attr_(attrs, original_attrs, max_zone_append_size, PRIu32);
 }
 
-static bool bdus_execute_driver_(
-    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
-    const struct bdus_attrs *original_attrs, void *private_data, int control_fd,
-    const struct kbdus_device_config *device_config,
-    uint32_t max_outstanding_reqs, bool is_rerun)
+// Adjusts attributes for serving requests asynchronously, which is done by a
+// single thread that receives requests through read() on the control device.
+static void bdus_adjust_attrs_async_(
+    const struct bdus_ops *ops, struct bdus_attrs *attrs)
 {
-    // get device path
+    attrs->max_concurrent_callbacks = 1;
+    attrs->num_queues               = 1;
+    attrs->use_io_uring             = false;
+    attrs->zero_copy                = false;
+    attrs->chunk_size               = 0;
 
-    char dev_path[32];
+    // a 'discard' callback that defers its request can't be invoked again for
+    // the request's other regions
+
+    if (!ops->discard_ranges)
+        attrs->max_discard_ranges = bdus_min_(attrs->max_discard_ranges, 1u);
+}
+
+// Adjusts attribute `num_queues`, which must be done after adjusting
+// `max_concurrent_callbacks`. Requests in the same hardware queue contend for
+// that queue's lock in the kernel, so by default there is one hardware queue
+// per online CPU, but no more than the maximum number of worker threads.
+static void bdus_adjust_attrs_num_queues_(struct bdus_attrs *attrs)
+{
+    if (attrs->num_queues == 0)
+    {
+        const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
 
-    const int ret = snprintf(
-        dev_path, sizeof(dev_path), "/dev/bdus-%" PRIu64, device_config->id);
+        attrs->num_queues = num_cpus > 0
+            ? (uint32_t)bdus_min_((unsigned long)num_cpus, UINT32_MAX)
+            : UINT32_C(1);
+    }
+
+    attrs->num_queues = bdus_clamp_(
+        attrs->num_queues, UINT32_C(1), attrs->max_concurrent_callbacks);
+}
 
-    if (ret <= 0 || (size_t)ret >= sizeof(dev_path))
+// Adjusts the attributes that control how many worker threads are running and
+// how they receive requests, which must be done after adjusting
+// `max_concurrent_callbacks` and `num_queues`.
+static void bdus_adjust_attrs_workers_(struct bdus_attrs *attrs)
+{
+    if (attrs->min_concurrent_callbacks == 0
+        || attrs->min_concurrent_callbacks > attrs->max_concurrent_callbacks)
     {
-        bdus_set_error_(EIO, "snprintf() failed");
-        return false;
+        attrs->min_concurrent_callbacks = attrs->max_concurrent_callbacks;
+    }
+    else if (attrs->min_concurrent_callbacks < attrs->num_queues)
+    {
+        attrs->min_concurrent_callbacks = attrs->num_queues;
     }
 
-    // create bdus_ctx structure
+    // idle worker threads time out while receiving items, which is only
+    // supported through ioctls
 
-    struct bdus_ctx ctx = {
-        .id           = device_config->id,
-        .path         = dev_path,
-        .ops          = ops,
-        .attrs        = attrs,
-        .is_rerun     = is_rerun,
-        .private_data = private_data,
-        .major        = device_config->major,
-        .minor        = device_config->minor,
-    };
+    if (attrs->min_concurrent_callbacks < attrs->max_concurrent_callbacks)
+        attrs->use_io_uring = false;
 
-    // log attribute adjustment
+    // let drivers tell whether io_uring is used
 
-    if (ctx.attrs->log)
-        bdus_log_ops_and_attrs_(ops, attrs, original_attrs);
+    if (attrs->use_io_uring && !bdus_uring_is_supported_())
+        attrs->use_io_uring = false;
 
-    // invoke `initialize()` callback
+    if (attrs->idle_worker_timeout_ms == 0)
+        attrs->idle_worker_timeout_ms = 1000;
+}
+
+// Writes the path of the device with the given identifier to `dev_path`, which
+// must have room for at least 32 characters.
+static bool bdus_get_dev_path_(char *dev_path, uint64_t dev_id)
+{
+    const int ret = snprintf(dev_path, 32, "/dev/bdus-%" PRIu64, dev_id);
+
+    if (ret <= 0 || ret >= 32)
+    {
+        bdus_set_error_(EIO, "snprintf() failed");
+        return false;
+    }
+
+    return true;
+}
 
-    if (ctx.ops->initialize)
+static bool bdus_invoke_initialize_(struct bdus_ctx *ctx)
+{
+    if (ctx->ops->initialize)
     {
-        if (ctx.attrs->log)
+        if (ctx->attrs->log)
             bdus_log_thread_no_args_(0, "initialize(ctx)");
 
-        const int ret = ctx.ops->initialize(&ctx);
+        const int ret = ctx->ops->initialize(ctx);
 
         if (ret != 0)
         {
@@ -355,24 +507,24 @@ static bool bdus_execute_driver_(
     }
     else
     {
-        if (ctx.attrs->log)
+        if (ctx->attrs->log)
             bdus_log_thread_no_args_(0, "initialize(ctx) [not implemented]");
     }
 
-    // delegate work to backend
-
-    const bool success =
-        bdus_backend_run_(control_fd, &ctx, max_outstanding_reqs);
-
-    // invoke `terminate()` callback
+    return true;
+}
 
-    if (ctx.ops->terminate)
+// `success` is whether serving requests succeeded, in which case an error of
+// the `terminate()` callback is reported.
+static bool bdus_invoke_terminate_(struct bdus_ctx *ctx, bool success)
+{
+    if (ctx->ops->terminate)
     {
-        if (ctx.attrs->log)
+        if (ctx->attrs->log)
             bdus_log_thread_no_args_(0, "terminate(ctx)");
 
         const int e   = errno;
-        const int ret = ctx.ops->terminate(&ctx);
+        const int ret = ctx->ops->terminate(ctx);
         errno         = e;
 
         if (success && ret != 0) // avoid replacing previous error
@@ -385,26 +537,135 @@ static bool bdus_execute_driver_(
     }
     else
     {
-        if (ctx.attrs->log)
+        if (ctx->attrs->log)
             bdus_log_thread_no_args_(0, "terminate(ctx) [not implemented]");
     }
 
-    // report success to kbdus
+    return success;
+}
+
+static bool bdus_mark_as_successful_(int control_fd)
+{
+    if (bdus_ioctl_retry_(control_fd, KBDUS_IOCTL_MARK_AS_SUCCESSFUL) != 0)
+    {
+        bdus_set_error_control_ioctl_generic_(
+            errno, "KBDUS_IOCTL_MARK_AS_SUCCESSFUL");
+
+        return false;
+    }
+
+    return true;
+}
+
+// If `handoff` is not NULL, the device is being taken over from another driver
+// through it, and it is destroyed by this function.
+static bool bdus_execute_driver_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    const struct bdus_attrs *original_attrs, void *private_data, int control_fd,
+    const struct kbdus_device_and_fd_config *kbdus_config, bool is_rerun,
+    struct bdus_handoff_ *handoff)
+{
+    const struct kbdus_device_config *const device_config =
+        &kbdus_config->device;
+
+    // get device path
+
+    char dev_path[32];
+
+    if (!bdus_get_dev_path_(dev_path, device_config->id))
+    {
+        bdus_handoff_destroy_(handoff);
+        return false;
+    }
+
+    // create bdus_ctx structure
 
-    if (success)
+    struct bdus_ctx_and_fd_ ctx_and_fd = {
+        .ctx = {
+            .id           = device_config->id,
+            .path         = dev_path,
+            .ops          = ops,
+            .attrs        = attrs,
+            .is_rerun     = is_rerun,
+            .private_data = private_data,
+            .major        = device_config->major,
+            .minor        = device_config->minor,
+        },
+        .control_fd = control_fd,
+    };
+
+    struct bdus_ctx *const ctx = &ctx_and_fd.ctx;
+
+    // log attribute adjustment
+
+    if (ctx->attrs->log)
+        bdus_log_ops_and_attrs_(ops, attrs, original_attrs);
+
+    // create trace, with a ring per worker thread
+
+    struct bdus_trace_ *trace = NULL;
+
+    if (attrs->trace_size > 0)
     {
-        if (bdus_ioctl_retry_(control_fd, KBDUS_IOCTL_MARK_AS_SUCCESSFUL) != 0)
+        trace = bdus_trace_create_(
+            ctx->id,
+            attrs->async_queue_depth > 0
+                ? (size_t)1
+                : (size_t)attrs->max_concurrent_callbacks,
+            attrs->trace_size);
+
+        if (!trace)
         {
-            bdus_set_error_control_ioctl_generic_(
-                errno, "KBDUS_IOCTL_MARK_AS_SUCCESSFUL");
+            bdus_handoff_destroy_(handoff);
+            return false;
+        }
+    }
+
+    // let other drivers take over the device, if allowed
+
+    if (!handoff && attrs->allow_handoff)
+    {
+        handoff = bdus_handoff_create_(control_fd, kbdus_config);
 
+        if (!handoff)
+        {
+            bdus_trace_destroy_(trace, true);
             return false;
         }
     }
 
-    // return
+    // invoke `initialize()` callback (if taking over the device, the previous
+    // driver is still serving it)
 
-    return success;
+    if (!bdus_invoke_initialize_(ctx))
+    {
+        bdus_handoff_destroy_(handoff);
+        bdus_trace_destroy_(trace, true);
+        return false;
+    }
+
+    // delegate work to backend
+
+    bool success = bdus_backend_run_(
+        control_fd, ctx, device_config->max_outstanding_reqs, trace, handoff);
+
+    // if the device was handed off to another driver, let it resume the device
+    // before invoking the `terminate()` callback
+
+    const bool handed_off = bdus_handoff_destroy_(handoff);
+
+    // invoke `terminate()` callback
+
+    success = bdus_invoke_terminate_(ctx, success);
+
+    // destroy trace, keeping it if the driver failed
+
+    bdus_trace_destroy_(trace, success);
+
+    // report success to kbdus, unless the control file description now belongs
+    // to another driver
+
+    return success && (handed_off || bdus_mark_as_successful_(control_fd));
 }
 
 /* -------------------------------------------------------------------------- */
@@ -412,13 +673,42 @@ static bool bdus_execute_driver_(
 
 static bool bdus_validate_ops_run_(const struct bdus_ops *ops)
 {
-    // 'fua_write' implies 'flush'
+    // 'fua_write' and 'fua_writev' imply 'flush'
+
+    if ((ops->fua_write || ops->fua_writev) && !ops->flush)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "The driver implements callback 'fua_write' or 'fua_writev' but"
+            " not 'flush'");
+
+        return false;
+    }
+
+    // 'allocate_payload_buffer' and 'free_payload_buffer' imply each other
+
+    if (!ops->allocate_payload_buffer != !ops->free_payload_buffer)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "The driver must implement both or neither of callbacks"
+            " 'allocate_payload_buffer' and 'free_payload_buffer'");
+
+        return false;
+    }
+
+    // 'report_zones' implies the other zone callbacks, reads, and writes
 
-    if (ops->fua_write && !ops->flush)
+    if (ops->report_zones
+        && (!ops->reset_zone || !ops->open_zone || !ops->close_zone
+            || !ops->finish_zone || !ops->append_to_zone
+            || (!ops->read && !ops->readv) || (!ops->write && !ops->writev)))
     {
         bdus_set_error_(
             EINVAL,
-            "The driver implements callback 'fua_write' but not 'flush'");
+            "The driver implements callback 'report_zones' but not all of"
+            " 'reset_zone', 'open_zone', 'close_zone', 'finish_zone',"
+            " 'append_to_zone', 'read' or 'readv', and 'write' or 'writev'");
 
         return false;
     }
@@ -428,6 +718,66 @@ static bool bdus_validate_ops_run_(const struct bdus_ops *ops)
     return true;
 }
 
+// Validates attribute 'zone_size', which is only used if the driver implements
+// callback 'report_zones'.
+static bool bdus_validate_zone_size_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs)
+{
+    if (!ops->report_zones)
+        return true;
+
+    const uint32_t adjusted_physical_block_size =
+        bdus_max_(attrs->physical_block_size, attrs->logical_block_size);
+
+    if (!bdus_is_power_of_two_(attrs->zone_size)
+        || attrs->zone_size < (uint64_t)adjusted_physical_block_size
+        || attrs->zone_size > (UINT64_C(1) << 40))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu64
+            " for attribute 'zone_size', must be a power of two greater than "
+            "or equal to attribute 'physical_block_size' (which is %" PRIu32
+            ") and less than or equal to 2^40",
+            attrs->zone_size, adjusted_physical_block_size);
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool bdus_validate_trace_size_(const struct bdus_attrs *attrs)
+{
+    if (attrs->trace_size > BDUS_TRACE_MAX_RING_SIZE_)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu32
+            " for attribute 'trace_size', must be at most %" PRIu32,
+            attrs->trace_size, BDUS_TRACE_MAX_RING_SIZE_);
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool bdus_validate_allow_handoff_(const struct bdus_attrs *attrs)
+{
+    if (attrs->allow_handoff && attrs->async_queue_depth > 0)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'allow_handoff' must be false when attribute"
+            " 'async_queue_depth' is positive");
+
+        return false;
+    }
+
+    return true;
+}
+
 static bool bdus_validate_attrs_run_(const struct bdus_attrs *attrs)
 {
     // get system page size
@@ -552,17 +902,74 @@ static bool bdus_validate_attrs_run_(const struct bdus_attrs *attrs)
         return false;
     }
 
+    // validate 'zero_extent_size'
+
+    if (attrs->zero_extent_size != 0
+        && (!bdus_is_power_of_two_(attrs->zero_extent_size)
+            || attrs->zero_extent_size < attrs->logical_block_size))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu32
+            " for attribute 'zero_extent_size', must be 0 or a power of two "
+            "greater than or equal to attribute 'logical_block_size' (which is "
+            "%" PRIu32 ")",
+            attrs->zero_extent_size, attrs->logical_block_size);
+
+        return false;
+    }
+
+    if (attrs->zero_extent_size != 0 && attrs->size > (UINT64_C(1) << 58))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'zero_extent_size' must be 0 when attribute 'size' is"
+            " greater than 2^58 (it is %" PRIu64 ")",
+            attrs->size);
+
+        return false;
+    }
+
+    // validate 'dispatch_policy'
+
+    if (attrs->dispatch_policy != bdus_dispatch_fifo
+        && attrs->dispatch_policy != bdus_dispatch_reads_first
+        && attrs->dispatch_policy != bdus_dispatch_priority)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %d for attribute 'dispatch_policy', must be"
+            " bdus_dispatch_fifo, bdus_dispatch_reads_first, or"
+            " bdus_dispatch_priority",
+            (int)attrs->dispatch_policy);
+
+        return false;
+    }
+
+    // validate 'trace_size'
+
+    if (!bdus_validate_trace_size_(attrs))
+        return false;
+
+    // validate 'allow_handoff'
+
+    if (!bdus_validate_allow_handoff_(attrs))
+        return false;
+
     // success
 
     return true;
 }
 
-static bool bdus_run_impl_(
+// Validates the given operations and attributes, creates a device accordingly,
+// and adjusts the attributes to match the device. If `shared_workers` is true,
+// the device's requests are to be received into payload buffers shared with
+// other devices, and so it gets no preallocated buffers.
+static bool bdus_create_device_(
     const struct bdus_ops *ops_copy, struct bdus_attrs *attrs_copy,
-    void *private_data, int control_fd)
+    int control_fd, bool shared_workers,
+    struct kbdus_device_and_fd_config *out_config)
 {
-    const struct bdus_attrs original_attrs = *attrs_copy;
-
     // validate operations and attributes
 
     if (!bdus_validate_ops_run_(ops_copy))
@@ -571,11 +978,19 @@ static bool bdus_run_impl_(
     if (!bdus_validate_attrs_run_(attrs_copy))
         return false;
 
+    if (!bdus_validate_zone_size_(ops_copy, attrs_copy))
+        return false;
+
     // create configuration
 
+    if (attrs_copy->async_queue_depth > 0)
+        bdus_adjust_attrs_async_(ops_copy, attrs_copy);
+
     if (attrs_copy->max_concurrent_callbacks == 0)
         attrs_copy->max_concurrent_callbacks = 1;
 
+    bdus_adjust_attrs_num_queues_(attrs_copy);
+
     struct kbdus_device_and_fd_config kbdus_config =
     {
         .device =
@@ -589,16 +1004,24 @@ static bool bdus_run_impl_(
             .max_write_same_size    = attrs_copy->max_write_same_size,
             .max_write_zeros_size   = attrs_copy->max_write_zeros_size,
             .max_discard_erase_size = attrs_copy->max_discard_erase_size,
+            .max_discard_ranges     = (uint16_t)bdus_min_(
+                attrs_copy->max_discard_ranges, UINT16_MAX),
 
-            .max_outstanding_reqs   = 2 * attrs_copy->max_concurrent_callbacks,
+            .max_outstanding_reqs   = attrs_copy->async_queue_depth > 0
+                ? attrs_copy->async_queue_depth
+                : 2 * attrs_copy->max_concurrent_callbacks,
 
-            .supports_read          = (ops_copy->read         != NULL),
-            .supports_write         = (ops_copy->write        != NULL),
+            .supports_read          = (ops_copy->read         != NULL
+                                       || ops_copy->readv     != NULL),
+            .supports_write         = (ops_copy->write        != NULL
+                                       || ops_copy->writev    != NULL),
             .supports_write_same    = (ops_copy->write_same   != NULL),
             .supports_write_zeros   = (ops_copy->write_zeros  != NULL),
-            .supports_fua_write     = (ops_copy->fua_write    != NULL),
+            .supports_fua_write     = (ops_copy->fua_write    != NULL
+                                       || ops_copy->fua_writev != NULL),
             .supports_flush         = (ops_copy->flush        != NULL),
-            .supports_discard       = (ops_copy->discard      != NULL),
+            .supports_discard       = (ops_copy->discard      != NULL
+                                       || ops_copy->discard_ranges != NULL),
             .supports_secure_erase  = (ops_copy->secure_erase != NULL),
             .supports_ioctl         = (ops_copy->ioctl        != NULL),
 
@@ -609,11 +1032,34 @@ static bool bdus_run_impl_(
                 !attrs_copy->disable_partition_scanning,
 
             .recoverable = attrs_copy->recoverable,
+
+            .dispatch_policy = (uint8_t)attrs_copy->dispatch_policy,
+
+            .zero_extent_size = attrs_copy->zero_extent_size,
+            .read_cache_size  = attrs_copy->read_cache_size,
+
+            .num_queues      = attrs_copy->num_queues,
+            .num_poll_queues = attrs_copy->num_poll_queues,
+
+            .zoned                = (ops_copy->report_zones != NULL),
+            .zone_size            = attrs_copy->zone_size,
+            .max_open_zones       = attrs_copy->max_open_zones,
+            .max_active_zones     = attrs_copy->max_active_zones,
+            .max_zone_append_size = attrs_copy->max_zone_append_size,
         },
 
         .fd =
         {
-            .num_preallocated_buffers = attrs_copy->max_concurrent_callbacks,
+            .num_preallocated_buffers =
+                !shared_workers
+                    && bdus_uses_payload_windows_(ops_copy, attrs_copy)
+                ? attrs_copy->max_concurrent_callbacks
+                : 0,
+            .zero_copy                =
+                bdus_uses_payload_windows_(ops_copy, attrs_copy),
+            .busy_poll_us             = attrs_copy->busy_poll_us,
+            .scatter_gather           = bdus_has_vector_callbacks_(ops_copy),
+            .chunk_size               = attrs_copy->chunk_size,
         },
     };
 
@@ -647,38 +1093,95 @@ static bool bdus_run_impl_(
     attrs_copy->max_discard_erase_size =
         kbdus_config.device.max_discard_erase_size;
 
-    attrs_copy->max_concurrent_callbacks =
-        kbdus_config.fd.num_preallocated_buffers;
+    attrs_copy->max_discard_ranges = kbdus_config.device.max_discard_ranges;
+    attrs_copy->zero_extent_size   = kbdus_config.device.zero_extent_size;
+    attrs_copy->read_cache_size    = kbdus_config.device.read_cache_size;
 
-    // delegate remaining work
+    attrs_copy->zone_size        = kbdus_config.device.zone_size;
+    attrs_copy->max_open_zones   = kbdus_config.device.max_open_zones;
+    attrs_copy->max_active_zones = kbdus_config.device.max_active_zones;
 
-    return bdus_execute_driver_(
-        ops_copy, attrs_copy, &original_attrs, private_data, control_fd,
-        &kbdus_config.device, kbdus_config.device.max_outstanding_reqs, false);
-}
+    attrs_copy->max_zone_append_size =
+        kbdus_config.device.max_zone_append_size;
 
-BDUS_EXPORT_ bool bdus_run_0_1_0_(
-    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
-    void *private_data)
-{
-    // copy operations and attributes
+    if (kbdus_config.fd.num_preallocated_buffers > 0)
+    {
+        attrs_copy->max_concurrent_callbacks =
+            kbdus_config.fd.num_preallocated_buffers;
+    }
 
-    const struct bdus_ops ops_copy = *ops;
-    struct bdus_attrs attrs_copy   = *attrs;
+    attrs_copy->num_queues      = kbdus_config.device.num_queues;
+    attrs_copy->num_poll_queues = kbdus_config.device.num_poll_queues;
 
-    // open control device
+    attrs_copy->zero_copy    = kbdus_config.fd.zero_copy != 0;
+    attrs_copy->busy_poll_us = kbdus_config.fd.busy_poll_us;
+    attrs_copy->chunk_size   = kbdus_config.fd.chunk_size;
 
-    const int control_fd = bdus_open_control_(true);
+    attrs_copy->async_queue_depth = bdus_min_(
+        attrs_copy->async_queue_depth,
+        kbdus_config.device.max_outstanding_reqs);
 
-    if (control_fd < 0)
-        return false;
+    bdus_adjust_attrs_workers_(attrs_copy);
 
-    // delegate remaining work
+    *out_config = kbdus_config;
 
-    const bool success =
-        bdus_run_impl_(&ops_copy, &attrs_copy, private_data, control_fd);
+    return true;
+}
 
-    // close control device
+static bool bdus_run_impl_(
+    const struct bdus_ops *ops_copy, struct bdus_attrs *attrs_copy,
+    void *private_data, int control_fd)
+{
+    const struct bdus_attrs original_attrs = *attrs_copy;
+
+    // create device
+
+    struct kbdus_device_and_fd_config kbdus_config;
+
+    if (!bdus_create_device_(
+            ops_copy, attrs_copy, control_fd, false, &kbdus_config))
+    {
+        return false;
+    }
+
+    // delegate remaining work
+
+    return bdus_execute_driver_(
+        ops_copy, attrs_copy, &original_attrs, private_data, control_fd,
+        &kbdus_config, false, NULL);
+}
+
+static bool bdus_run_(
+    const struct bdus_ops *ops_copy, struct bdus_attrs *attrs_copy,
+    void *private_data)
+{
+    // open control device
+
+    const int control_fd = bdus_open_control_(true);
+
+    if (control_fd < 0)
+        return false;
+
+    // restrict the current thread to the requested CPUs, if any, before the
+    // device's memory is allocated
+
+    bool restricted_cpus;
+
+    if (!bdus_backend_restrict_cpus_(attrs_copy, &restricted_cpus))
+    {
+        bdus_close_keep_errno_(control_fd);
+        return false;
+    }
+
+    // delegate remaining work
+
+    const bool success =
+        bdus_run_impl_(ops_copy, attrs_copy, private_data, control_fd);
+
+    // restore the current thread's CPU affinity and close control device
+
+    if (restricted_cpus)
+        bdus_backend_unrestrict_cpus_();
 
     bdus_close_keep_errno_(control_fd);
 
@@ -687,6 +1190,20 @@ BDUS_EXPORT_ bool bdus_run_0_1_0_(
     return success;
 }
 
+BDUS_EXPORT_ bool bdus_run_0_1_0_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data)
+{
+    // copy operations and attributes
+
+    const struct bdus_ops ops_copy = bdus_copy_ops_0_1_0_(ops);
+    struct bdus_attrs attrs_copy   = bdus_copy_attrs_0_1_0_(attrs);
+
+    // delegate remaining work
+
+    return bdus_run_(&ops_copy, &attrs_copy, private_data);
+}
+
 BDUS_EXPORT_ bool bdus_run_0_1_1_(
     const struct bdus_ops *ops, const struct bdus_attrs *attrs,
     void *private_data)
@@ -694,39 +1211,66 @@ BDUS_EXPORT_ bool bdus_run_0_1_1_(
     return bdus_run_0_1_0_(ops, attrs, private_data);
 }
 
+BDUS_EXPORT_ bool bdus_run_0_1_3_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data)
+{
+    // copy operations and attributes
+
+    const struct bdus_ops ops_copy = *ops;
+    struct bdus_attrs attrs_copy   = *attrs;
+
+    // delegate remaining work
+
+    return bdus_run_(&ops_copy, &attrs_copy, private_data);
+}
+
 /* -------------------------------------------------------------------------- */
 /* driver development -- bdus_rerun() */
 
 static bool bdus_validate_ops_rerun_(
     const struct bdus_ops *ops, const struct kbdus_device_config *device_config)
 {
-    // 'fua_write' implies 'flush'
+    // 'fua_write' and 'fua_writev' imply 'flush'
+
+    if ((ops->fua_write || ops->fua_writev) && !ops->flush)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "The driver implements callback 'fua_write' or 'fua_writev' but"
+            " not 'flush'");
+
+        return false;
+    }
+
+    // 'allocate_payload_buffer' and 'free_payload_buffer' imply each other
 
-    if (ops->fua_write && !ops->flush)
+    if (!ops->allocate_payload_buffer != !ops->free_payload_buffer)
     {
         bdus_set_error_(
             EINVAL,
-            "The driver implements callback 'fua_write' but not 'flush'");
+            "The driver must implement both or neither of callbacks"
+            " 'allocate_payload_buffer' and 'free_payload_buffer'");
 
         return false;
     }
 
     // check if already supported operations are still supported
 
-    if (device_config->supports_read && !ops->read)
+    if (device_config->supports_read && !ops->read && !ops->readv)
     {
         bdus_set_error_(
             EINVAL,
             "The device supports \"read\" requests but the driver does not "
-            "implement callback 'read'");
+            "implement callback 'read' or 'readv'");
     }
 
-    if (device_config->supports_write && !ops->write)
+    if (device_config->supports_write && !ops->write && !ops->writev)
     {
         bdus_set_error_(
             EINVAL,
             "The device supports \"write\" requests but the driver does not "
-            "implement callback 'write'");
+            "implement callback 'write' or 'writev'");
     }
 
     if (device_config->supports_write_same && !ops->write_same)
@@ -745,12 +1289,13 @@ static bool bdus_validate_ops_rerun_(
             "not implement callback 'write_zeros'");
     }
 
-    if (device_config->supports_fua_write && !ops->fua_write)
+    if (device_config->supports_fua_write && !ops->fua_write
+        && !ops->fua_writev)
     {
         bdus_set_error_(
             EINVAL,
             "The device supports \"FUA write\" requests but the driver does "
-            "not implement callback 'fua_write'");
+            "not implement callback 'fua_write' or 'fua_writev'");
     }
 
     if (device_config->supports_flush && !ops->flush)
@@ -770,12 +1315,13 @@ static bool bdus_validate_ops_rerun_(
             "implements callback 'flush'");
     }
 
-    if (device_config->supports_discard && !ops->discard)
+    if (device_config->supports_discard && !ops->discard
+        && !ops->discard_ranges)
     {
         bdus_set_error_(
             EINVAL,
             "The device supports \"discard\" requests but the driver does not "
-            "implement callback 'discard'");
+            "implement callback 'discard' or 'discard_ranges'");
     }
 
     if (device_config->supports_secure_erase && !ops->secure_erase)
@@ -794,6 +1340,34 @@ static bool bdus_validate_ops_rerun_(
             "implement callback 'ioctl'");
     }
 
+    // whether the device is zoned can't change
+
+    if (!device_config->zoned != !ops->report_zones)
+    {
+        bdus_set_error_(
+            EINVAL,
+            device_config->zoned
+                ? "The device is zoned but the driver does not implement"
+                  " callback 'report_zones'"
+                : "The device is not zoned but the driver implements callback"
+                  " 'report_zones'");
+
+        return false;
+    }
+
+    if (ops->report_zones
+        && (!ops->reset_zone || !ops->open_zone || !ops->close_zone
+            || !ops->finish_zone || !ops->append_to_zone))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "The driver implements callback 'report_zones' but not all of"
+            " 'reset_zone', 'open_zone', 'close_zone', 'finish_zone', and"
+            " 'append_to_zone'");
+
+        return false;
+    }
+
     // success
 
     return true;
@@ -926,11 +1500,92 @@ static bool bdus_validate_attrs_rerun_(
             device_config->recoverable ? "true" : "false");
     }
 
+    // validate 'zone_size'
+
+    if (attrs->zone_size != 0 && attrs->zone_size != device_config->zone_size)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu64
+            " for attribute 'zone_size', must be 0 or equal to the existing "
+            "device's zone size (which is %" PRIu64 ")",
+            attrs->zone_size, (uint64_t)device_config->zone_size);
+
+        return false;
+    }
+
+    // validate 'trace_size'
+
+    if (!bdus_validate_trace_size_(attrs))
+        return false;
+
+    // validate 'allow_handoff'
+
+    if (!bdus_validate_allow_handoff_(attrs))
+        return false;
+
     // success
 
     return true;
 }
 
+// Adjusts the attributes of a driver that is about to serve an existing device
+// to match the device's configuration.
+static void bdus_adjust_attrs_rerun_(
+    struct bdus_attrs *attrs_copy,
+    const struct kbdus_device_and_fd_config *kbdus_config)
+{
+    attrs_copy->logical_block_size  = kbdus_config->device.logical_block_size;
+    attrs_copy->physical_block_size = kbdus_config->device.physical_block_size;
+    attrs_copy->size                = kbdus_config->device.size;
+
+    attrs_copy->max_read_write_size = kbdus_config->device.max_read_write_size;
+    attrs_copy->max_write_same_size = kbdus_config->device.max_write_same_size;
+
+    attrs_copy->max_write_zeros_size =
+        kbdus_config->device.max_write_zeros_size;
+
+    attrs_copy->max_discard_erase_size =
+        kbdus_config->device.max_discard_erase_size;
+
+    attrs_copy->max_discard_ranges = kbdus_config->device.max_discard_ranges;
+
+    attrs_copy->dispatch_policy =
+        (enum bdus_dispatch_policy)kbdus_config->device.dispatch_policy;
+
+    attrs_copy->zero_extent_size = kbdus_config->device.zero_extent_size;
+    attrs_copy->read_cache_size  = kbdus_config->device.read_cache_size;
+
+    attrs_copy->zone_size        = kbdus_config->device.zone_size;
+    attrs_copy->max_open_zones   = kbdus_config->device.max_open_zones;
+    attrs_copy->max_active_zones = kbdus_config->device.max_active_zones;
+
+    attrs_copy->max_zone_append_size =
+        kbdus_config->device.max_zone_append_size;
+
+    attrs_copy->disable_partition_scanning =
+        !kbdus_config->device.enable_partition_scanning;
+
+    if (kbdus_config->fd.num_preallocated_buffers > 0)
+    {
+        attrs_copy->max_concurrent_callbacks =
+            kbdus_config->fd.num_preallocated_buffers;
+    }
+
+    attrs_copy->num_queues      = kbdus_config->device.num_queues;
+    attrs_copy->num_poll_queues = kbdus_config->device.num_poll_queues;
+
+    attrs_copy->zero_copy    = kbdus_config->fd.zero_copy != 0;
+    attrs_copy->busy_poll_us = kbdus_config->fd.busy_poll_us;
+    attrs_copy->chunk_size   = kbdus_config->fd.chunk_size;
+
+    attrs_copy->async_queue_depth = bdus_min_(
+        attrs_copy->async_queue_depth,
+        kbdus_config->device.max_outstanding_reqs);
+
+    bdus_adjust_attrs_workers_(attrs_copy);
+}
+
 static bool bdus_rerun_impl_(
     uint64_t dev_id, const struct bdus_ops *ops_copy,
     struct bdus_attrs *attrs_copy, void *private_data, int control_fd)
@@ -939,13 +1594,21 @@ static bool bdus_rerun_impl_(
 
     // create configuration
 
+    if (attrs_copy->async_queue_depth > 0)
+        bdus_adjust_attrs_async_(ops_copy, attrs_copy);
+
     if (attrs_copy->max_concurrent_callbacks == 0)
         attrs_copy->max_concurrent_callbacks = 1;
 
     struct kbdus_device_and_fd_config kbdus_config = {
         .device = { .id = dev_id },
-        .fd     = { .num_preallocated_buffers =
-                    attrs_copy->max_concurrent_callbacks },
+        .fd     = {
+            .zero_copy                =
+                bdus_uses_payload_windows_(ops_copy, attrs_copy),
+            .busy_poll_us             = attrs_copy->busy_poll_us,
+            .scatter_gather           = bdus_has_vector_callbacks_(ops_copy),
+            .chunk_size               = attrs_copy->chunk_size,
+        },
     };
 
     // get existing device's configuration
@@ -979,6 +1642,43 @@ static bool bdus_rerun_impl_(
     if (!bdus_validate_attrs_rerun_(attrs_copy, &kbdus_config.device))
         return false;
 
+    // asynchronous mode serves a single hardware queue
+
+    if (attrs_copy->async_queue_depth > 0 && kbdus_config.device.num_queues > 1)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'async_queue_depth' is positive but the device has %"
+            PRIu32 " hardware queues",
+            kbdus_config.device.num_queues);
+
+        return false;
+    }
+
+    if (attrs_copy->async_queue_depth > 0
+        && kbdus_config.device.max_discard_ranges > 1
+        && !ops_copy->discard_ranges)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'async_queue_depth' is positive and the device's"
+            " \"discard\" requests may target several regions, but the driver"
+            " does not implement callback 'discard_ranges'");
+
+        return false;
+    }
+
+    // ensure that every hardware queue is serviced by at least one thread
+
+    attrs_copy->max_concurrent_callbacks = bdus_max_(
+        attrs_copy->max_concurrent_callbacks, kbdus_config.device.num_queues);
+
+    if (bdus_uses_payload_windows_(ops_copy, attrs_copy))
+    {
+        kbdus_config.fd.num_preallocated_buffers =
+            attrs_copy->max_concurrent_callbacks;
+    }
+
     // attach to device (do not retry ioctl if interrupted to avoid race
     // condition where device is destroyed between retries, or another driver
     // starts attaching to it)
@@ -1015,39 +1715,19 @@ static bool bdus_rerun_impl_(
 
     // adjust attributes
 
-    attrs_copy->logical_block_size  = kbdus_config.device.logical_block_size;
-    attrs_copy->physical_block_size = kbdus_config.device.physical_block_size;
-    attrs_copy->size                = kbdus_config.device.size;
-
-    attrs_copy->max_read_write_size  = kbdus_config.device.max_read_write_size;
-    attrs_copy->max_write_same_size  = kbdus_config.device.max_write_same_size;
-    attrs_copy->max_write_zeros_size = kbdus_config.device.max_write_zeros_size;
-
-    attrs_copy->max_discard_erase_size =
-        kbdus_config.device.max_discard_erase_size;
-
-    attrs_copy->disable_partition_scanning =
-        !kbdus_config.device.enable_partition_scanning;
-
-    attrs_copy->max_concurrent_callbacks =
-        kbdus_config.fd.num_preallocated_buffers;
+    bdus_adjust_attrs_rerun_(attrs_copy, &kbdus_config);
 
     // delegate remaining work
 
     return bdus_execute_driver_(
         ops_copy, attrs_copy, &original_attrs, private_data, control_fd,
-        &kbdus_config.device, kbdus_config.device.max_outstanding_reqs, true);
+        &kbdus_config, true, NULL);
 }
 
-BDUS_EXPORT_ bool bdus_rerun_0_1_0_(
-    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
-    void *private_data)
+static bool bdus_rerun_(
+    uint64_t dev_id, const struct bdus_ops *ops_copy,
+    struct bdus_attrs *attrs_copy, void *private_data)
 {
-    // copy operations and attributes
-
-    const struct bdus_ops ops_copy = *ops;
-    struct bdus_attrs attrs_copy   = *attrs;
-
     // open control device
 
     const int control_fd = bdus_open_control_(true);
@@ -1055,12 +1735,26 @@ BDUS_EXPORT_ bool bdus_rerun_0_1_0_(
     if (control_fd < 0)
         return false;
 
+    // restrict the current thread to the requested CPUs, if any, before the
+    // device's memory is allocated
+
+    bool restricted_cpus;
+
+    if (!bdus_backend_restrict_cpus_(attrs_copy, &restricted_cpus))
+    {
+        bdus_close_keep_errno_(control_fd);
+        return false;
+    }
+
     // delegate remaining work
 
     const bool success = bdus_rerun_impl_(
-        dev_id, &ops_copy, &attrs_copy, private_data, control_fd);
+        dev_id, ops_copy, attrs_copy, private_data, control_fd);
 
-    // close control device
+    // restore the current thread's CPU affinity and close control device
+
+    if (restricted_cpus)
+        bdus_backend_unrestrict_cpus_();
 
     bdus_close_keep_errno_(control_fd);
 
@@ -1069,6 +1763,20 @@ BDUS_EXPORT_ bool bdus_rerun_0_1_0_(
     return success;
 }
 
+BDUS_EXPORT_ bool bdus_rerun_0_1_0_(
+    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data)
+{
+    // copy operations and attributes
+
+    const struct bdus_ops ops_copy = bdus_copy_ops_0_1_0_(ops);
+    struct bdus_attrs attrs_copy   = bdus_copy_attrs_0_1_0_(attrs);
+
+    // delegate remaining work
+
+    return bdus_rerun_(dev_id, &ops_copy, &attrs_copy, private_data);
+}
+
 BDUS_EXPORT_ bool bdus_rerun_0_1_1_(
     uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
     void *private_data)
@@ -1076,77 +1784,987 @@ BDUS_EXPORT_ bool bdus_rerun_0_1_1_(
     return bdus_rerun_0_1_0_(dev_id, ops, attrs, private_data);
 }
 
-/* -------------------------------------------------------------------------- */
-/* device management */
-
-BDUS_EXPORT_ bool
-    bdus_get_dev_id_from_path_0_1_0_(uint64_t *out_dev_id, const char *dev_path)
+BDUS_EXPORT_ bool bdus_rerun_0_1_3_(
+    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data)
 {
-    // open control device
+    // copy operations and attributes
 
-    const int control_fd = bdus_open_control_(true);
+    const struct bdus_ops ops_copy = *ops;
+    struct bdus_attrs attrs_copy   = *attrs;
 
-    if (control_fd < 0)
-        return false;
+    // delegate remaining work
 
-    // translate path to id
+    return bdus_rerun_(dev_id, &ops_copy, &attrs_copy, private_data);
+}
 
-    uint64_t path_or_id = (uint64_t)dev_path;
+/* -------------------------------------------------------------------------- */
+/* driver development -- bdus_take_over() */
 
-    const int ret = bdus_ioctl_arg_retry_(
-        control_fd, KBDUS_IOCTL_DEVICE_PATH_TO_ID, &path_or_id);
+static bool bdus_take_over_impl_(
+    const struct bdus_ops *ops_copy, struct bdus_attrs *attrs_copy,
+    void *private_data, int control_fd,
+    const struct kbdus_device_and_fd_config *kbdus_config,
+    struct bdus_handoff_ *handoff)
+{
+    const struct bdus_attrs original_attrs = *attrs_copy;
 
-    // close control device
+    // validate operations and attributes
 
-    bdus_close_keep_errno_(control_fd);
+    if (!bdus_validate_ops_rerun_(ops_copy, &kbdus_config->device)
+        || !bdus_validate_attrs_rerun_(attrs_copy, &kbdus_config->device))
+    {
+        bdus_handoff_destroy_(handoff);
+        return false;
+    }
 
-    // check result
+    // the control file description is inherited, so its configuration must
+    // suit the driver
 
-    if (ret == 0)
+    if (attrs_copy->async_queue_depth > 0)
     {
-        *out_dev_id = path_or_id;
-
-        return true;
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'async_queue_depth' must be 0 when using"
+            " bdus_take_over()");
+    }
+    else if (
+        kbdus_config->fd.scatter_gather
+        && !bdus_has_vector_callbacks_(ops_copy))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "The device's previous driver received request data as lists of"
+            " memory regions, but the driver does not implement callbacks"
+            " 'readv', 'writev', and 'fua_writev' in place of their flat"
+            " counterparts");
+    }
+    else if (kbdus_config->fd.zero_copy && ops_copy->allocate_payload_buffer)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "The device's previous driver used attribute 'zero_copy', which"
+            " is incompatible with callback 'allocate_payload_buffer'");
     }
     else
     {
-        switch (errno)
-        {
-        case EACCES:
-            bdus_set_error_(
-                errno, "Access denied while traversing %s", dev_path);
-            break;
+        // adjust attributes
 
-        case ELOOP:
-            bdus_set_error_(
-                errno,
-                "Too many symbolic links encountered while traversing %s",
-                dev_path);
-            break;
+        if (attrs_copy->max_concurrent_callbacks == 0)
+            attrs_copy->max_concurrent_callbacks = 1;
 
-        case ENOENT:
-        case ENOTDIR:
-            bdus_set_error_(errno, "%s does not exist", dev_path);
-            break;
+        bdus_adjust_attrs_rerun_(attrs_copy, kbdus_config);
 
-        case ENOTBLK:
-            bdus_set_error_(errno, "%s is not a block special file", dev_path);
-            break;
+        // delegate remaining work
 
-        case EINVAL:
-            bdus_set_error_(
-                errno, "%s does not refer to a device created by BDUS",
-                dev_path);
-            break;
+        return bdus_execute_driver_(
+            ops_copy, attrs_copy, &original_attrs, private_data, control_fd,
+            kbdus_config, true, handoff);
+    }
 
-        case ENODEV:
-            bdus_set_error_(
-                errno, "The device referred to by %s does not exist", dev_path);
-            break;
+    bdus_handoff_destroy_(handoff);
+    return false;
+}
 
-        case ECHILD:
-            bdus_set_error_(
-                EINVAL,
+static bool bdus_take_over_(
+    uint64_t dev_id, const struct bdus_ops *ops_copy,
+    struct bdus_attrs *attrs_copy, void *private_data)
+{
+    // check privileges, as only root may serve devices
+
+    if (!bdus_check_privileges_())
+        return false;
+
+    // restrict the current thread to the requested CPUs, if any
+
+    bool restricted_cpus;
+
+    if (!bdus_backend_restrict_cpus_(attrs_copy, &restricted_cpus))
+        return false;
+
+    // receive the control file description from the device's current driver
+
+    int control_fd;
+    struct kbdus_device_and_fd_config kbdus_config;
+
+    struct bdus_handoff_ *const handoff = bdus_handoff_connect_(
+        dev_id, attrs_copy->allow_handoff, &control_fd, &kbdus_config);
+
+    bool success = false;
+
+    if (handoff)
+    {
+        // delegate remaining work
+
+        if (bdus_check_version_compatibility_(control_fd))
+        {
+            success = bdus_take_over_impl_(
+                ops_copy, attrs_copy, private_data, control_fd, &kbdus_config,
+                handoff);
+        }
+        else
+        {
+            bdus_handoff_destroy_(handoff);
+        }
+
+        bdus_close_keep_errno_(control_fd);
+    }
+
+    // restore the current thread's CPU affinity
+
+    if (restricted_cpus)
+        bdus_backend_unrestrict_cpus_();
+
+    // return success indication
+
+    return success;
+}
+
+BDUS_EXPORT_ bool bdus_take_over_0_1_3_(
+    uint64_t dev_id, const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data)
+{
+    // copy operations and attributes
+
+    const struct bdus_ops ops_copy = *ops;
+    struct bdus_attrs attrs_copy   = *attrs;
+
+    // delegate remaining work
+
+    return bdus_take_over_(dev_id, &ops_copy, &attrs_copy, private_data);
+}
+
+/* -------------------------------------------------------------------------- */
+/* driver development -- bdus_run_many() */
+
+// A driver being run by bdus_run_many().
+struct bdus_many_driver_
+{
+    struct bdus_ops ops;
+    struct bdus_attrs attrs;
+    struct bdus_attrs original_attrs;
+
+    char dev_path[32];
+    struct bdus_ctx_and_fd_ ctx_and_fd;
+
+    // -1 if not yet opened
+    int control_fd;
+
+    // NULL if attribute `trace_size` is 0 or the trace wasn't yet created
+    struct bdus_trace_ *trace;
+
+    // whether the `initialize()` callback succeeded
+    bool initialized;
+};
+
+// Adjusts attributes for serving requests with worker threads shared with
+// other devices, which receive requests through read() on the control device.
+static void
+    bdus_adjust_attrs_shared_(struct bdus_attrs *attrs, uint32_t num_threads)
+{
+    attrs->max_concurrent_callbacks = num_threads;
+    attrs->min_concurrent_callbacks = num_threads;
+    attrs->num_queues               = 1;
+    attrs->num_poll_queues          = 0;
+    attrs->use_io_uring             = false;
+    attrs->zero_copy                = false;
+    attrs->busy_poll_us             = 0;
+    attrs->chunk_size               = 0;
+}
+
+static bool bdus_validate_driver_many_(const struct bdus_driver *driver)
+{
+    if (!driver->ops || !driver->attrs)
+    {
+        bdus_set_error_(EINVAL, "Drivers must have callbacks and attributes");
+        return false;
+    }
+
+    if (driver->attrs->async_queue_depth > 0)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'async_queue_depth' must be 0 when using"
+            " bdus_run_many()");
+
+        return false;
+    }
+
+    if (driver->attrs->allow_handoff)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'allow_handoff' must be false when using"
+            " bdus_run_many()");
+
+        return false;
+    }
+
+    if (driver->ops->allocate_payload_buffer)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Callbacks 'allocate_payload_buffer' and 'free_payload_buffer'"
+            " are not supported by bdus_run_many()");
+
+        return false;
+    }
+
+    return true;
+}
+
+// Creates the device of the given driver and invokes its `initialize()`
+// callback. `index` is the driver's index in the array given to
+// bdus_run_many().
+static bool bdus_start_driver_many_(
+    struct bdus_many_driver_ *d, const struct bdus_driver *driver,
+    size_t index, uint32_t num_threads,
+    struct bdus_backend_device_ *out_device)
+{
+    // copy operations and attributes
+
+    if (!bdus_validate_driver_many_(driver))
+        return false;
+
+    d->ops            = *driver->ops;
+    d->attrs          = *driver->attrs;
+    d->original_attrs = d->attrs;
+
+    bdus_adjust_attrs_shared_(&d->attrs, num_threads);
+
+    // open control device, checking version compatibility only once
+
+    d->control_fd = bdus_open_control_(index == 0);
+
+    if (d->control_fd < 0)
+        return false;
+
+    // create device
+
+    struct kbdus_device_and_fd_config kbdus_config;
+
+    if (!bdus_create_device_(
+            &d->ops, &d->attrs, d->control_fd, true, &kbdus_config))
+    {
+        return false;
+    }
+
+    if (!bdus_get_dev_path_(d->dev_path, kbdus_config.device.id))
+        return false;
+
+    // `struct bdus_ctx` has const fields, and so must be copied into place
+
+    const struct bdus_ctx ctx = {
+        .id           = kbdus_config.device.id,
+        .path         = d->dev_path,
+        .ops          = &d->ops,
+        .attrs        = &d->attrs,
+        .is_rerun     = false,
+        .private_data = driver->private_data,
+        .major        = kbdus_config.device.major,
+        .minor        = kbdus_config.device.minor,
+    };
+
+    memcpy(&d->ctx_and_fd.ctx, &ctx, sizeof(ctx));
+
+    d->ctx_and_fd.control_fd = d->control_fd;
+
+    // create trace, with a ring per worker thread
+
+    if (d->attrs.trace_size > 0)
+    {
+        d->trace = bdus_trace_create_(
+            ctx.id, (size_t)num_threads, d->attrs.trace_size);
+
+        if (!d->trace)
+            return false;
+    }
+
+    *out_device = (struct bdus_backend_device_) {
+        .control_fd           = d->control_fd,
+        .ctx                  = &d->ctx_and_fd.ctx,
+        .max_outstanding_reqs = kbdus_config.device.max_outstanding_reqs,
+        .trace                = d->trace,
+    };
+
+    // log attribute adjustment
+
+    if (d->attrs.log)
+        bdus_log_ops_and_attrs_(&d->ops, &d->attrs, &d->original_attrs);
+
+    // invoke `initialize()` callback
+
+    d->initialized = bdus_invoke_initialize_(&d->ctx_and_fd.ctx);
+
+    return d->initialized;
+}
+
+static bool bdus_run_many_(
+    struct bdus_many_driver_ *ds, struct bdus_backend_device_ *devices,
+    const struct bdus_driver *drivers, size_t num_drivers,
+    uint32_t num_threads)
+{
+    // create devices and initialize drivers
+
+    bool daemonize = true;
+
+    for (size_t i = 0; i < num_drivers; ++i)
+    {
+        if (!bdus_start_driver_many_(
+                &ds[i], &drivers[i], i, num_threads, &devices[i]))
+        {
+            return false;
+        }
+
+        daemonize = daemonize && !ds[i].attrs.dont_daemonize;
+    }
+
+    // delegate work to backend
+
+    bool success = bdus_backend_run_many_(
+        devices, num_drivers, (size_t)num_threads, daemonize);
+
+    // invoke `terminate()` callbacks, keeping the first error
+
+    for (size_t i = 0; i < num_drivers; ++i)
+    {
+        success = bdus_invoke_terminate_(&ds[i].ctx_and_fd.ctx, success);
+        ds[i].initialized = false;
+    }
+
+    // report success to kbdus
+
+    for (size_t i = 0; success && i < num_drivers; ++i)
+        success = bdus_mark_as_successful_(ds[i].control_fd);
+
+    return success;
+}
+
+BDUS_EXPORT_ bool bdus_run_many_0_1_3_(
+    const struct bdus_driver *drivers, size_t num_drivers, uint32_t num_threads)
+{
+    if (num_drivers == 0)
+    {
+        bdus_set_error_(EINVAL, "At least one driver must be given");
+        return false;
+    }
+
+    if (num_threads == 0)
+        num_threads = 1;
+
+    // allocate driver state
+
+    struct bdus_many_driver_ *const ds = calloc(num_drivers, sizeof(*ds));
+
+    struct bdus_backend_device_ *const devices =
+        calloc(num_drivers, sizeof(*devices));
+
+    if (!ds || !devices)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+        free(devices);
+        free(ds);
+        return false;
+    }
+
+    for (size_t i = 0; i < num_drivers; ++i)
+        ds[i].control_fd = -1;
+
+    // delegate remaining work
+
+    const bool success =
+        bdus_run_many_(ds, devices, drivers, num_drivers, num_threads);
+
+    // on failure, terminate drivers that were initialized but never ran
+
+    for (size_t i = 0; i < num_drivers; ++i)
+    {
+        if (ds[i].initialized)
+            bdus_invoke_terminate_(&ds[i].ctx_and_fd.ctx, false);
+    }
+
+    // destroy traces, keeping them if a driver failed, and close control
+    // devices
+
+    for (size_t i = num_drivers; i > 0; --i)
+    {
+        bdus_trace_destroy_(ds[i - 1].trace, success);
+
+        if (ds[i - 1].control_fd >= 0)
+            bdus_close_keep_errno_(ds[i - 1].control_fd);
+    }
+
+    free(devices);
+    free(ds);
+
+    return success;
+}
+
+/* -------------------------------------------------------------------------- */
+/* driver development -- bdus_splice() */
+
+BDUS_EXPORT_ bool bdus_splice_0_1_3_(int fd, uint64_t offset)
+{
+    return bdus_backend_splice_(fd, offset);
+}
+
+BDUS_EXPORT_ uint16_t bdus_get_request_ioprio_0_1_3_(void)
+{
+    return bdus_backend_get_request_ioprio_();
+}
+
+BDUS_EXPORT_ struct bdus_request *bdus_defer_0_1_3_(void)
+{
+    return bdus_backend_defer_();
+}
+
+BDUS_EXPORT_ bool bdus_complete_0_1_3_(struct bdus_request *request, int error)
+{
+    return bdus_backend_complete_(request, error);
+}
+
+/* -------------------------------------------------------------------------- */
+/* driver development -- bdus_set_zero_range(), bdus_invalidate_read_cache() */
+
+BDUS_EXPORT_ bool bdus_set_zero_range_0_1_3_(
+    struct bdus_ctx *ctx, uint64_t offset, uint64_t size, bool zero)
+{
+    const int control_fd = bdus_get_ctx_control_fd_(ctx);
+
+    // drivers run by bdus_run_loopback() have no zero map
+
+    if (control_fd < 0)
+    {
+        bdus_set_error_(
+            EOPNOTSUPP, "The device's attribute 'zero_extent_size' is 0");
+        return false;
+    }
+
+    // update device's zero map
+
+    struct kbdus_zero_range zero_range = {
+        .offset = offset,
+        .size   = size,
+        .zero   = zero ? UINT8_C(1) : UINT8_C(0),
+    };
+
+    const int ret = bdus_ioctl_arg_retry_(
+        control_fd, KBDUS_IOCTL_SET_ZERO_RANGE, &zero_range);
+
+    if (ret != 0)
+    {
+        if (errno == EOPNOTSUPP)
+        {
+            bdus_set_error_(
+                errno, "The device's attribute 'zero_extent_size' is 0");
+        }
+        else if (errno == ERANGE)
+        {
+            bdus_set_error_(
+                errno,
+                "The region is not aligned to the device's logical block size"
+                " or extends beyond the end of the device");
+        }
+        else
+        {
+            bdus_set_error_control_ioctl_generic_(
+                errno, "KBDUS_IOCTL_SET_ZERO_RANGE");
+        }
+    }
+
+    // return success indicator
+
+    return ret == 0;
+}
+
+BDUS_EXPORT_ bool bdus_invalidate_read_cache_0_1_3_(
+    struct bdus_ctx *ctx, uint64_t offset, uint64_t size)
+{
+    const int control_fd = bdus_get_ctx_control_fd_(ctx);
+
+    // drivers run by bdus_run_loopback() have no read cache
+
+    if (control_fd < 0)
+        return true;
+
+    // invalidate device's read cache
+
+    struct kbdus_cache_range cache_range = {
+        .offset = offset,
+        .size   = size,
+    };
+
+    const int ret = bdus_ioctl_arg_retry_(
+        control_fd, KBDUS_IOCTL_INVALIDATE_READ_CACHE, &cache_range);
+
+    if (ret != 0)
+    {
+        if (errno == ERANGE)
+        {
+            bdus_set_error_(
+                errno, "The region extends beyond the end of the device");
+        }
+        else
+        {
+            bdus_set_error_control_ioctl_generic_(
+                errno, "KBDUS_IOCTL_INVALIDATE_READ_CACHE");
+        }
+    }
+
+    // return success indicator
+
+    return ret == 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* driver development -- bdus_run_loopback() */
+
+// The default and maximum values that kbdus uses for attribute
+// `max_read_write_size` (see kbdus/include-private/kbdus/config.h).
+#define BDUS_DEFAULT_MAX_READ_WRITE_SIZE_ (UINT32_C(1) << 18)
+#define BDUS_HARD_MAX_READ_WRITE_SIZE_ (UINT32_C(1) << 24)
+
+// Adjusts the given maximum request size as kbdus would, given whether the
+// respective requests are supported.
+static uint32_t bdus_adjust_max_size_loopback_(
+    uint32_t max_size, bool supported, uint32_t logical_block_size)
+{
+    if (!supported)
+        return 0;
+
+    if (max_size == 0)
+        max_size = UINT32_MAX;
+
+    return max_size - max_size % logical_block_size;
+}
+
+// Adjusts attributes as kbdus would when creating a device, and disables the
+// features that only concern requests received from kbdus.
+static void bdus_adjust_attrs_loopback_(
+    const struct bdus_ops *ops, struct bdus_attrs *attrs)
+{
+    const uint32_t lbs = attrs->logical_block_size;
+
+    if (attrs->physical_block_size == 0)
+        attrs->physical_block_size = lbs;
+
+    if (!ops->read && !ops->readv && !ops->write && !ops->writev
+        && !ops->fua_write && !ops->fua_writev)
+    {
+        attrs->max_read_write_size = 0;
+    }
+    else if (attrs->max_read_write_size == 0)
+    {
+        attrs->max_read_write_size = BDUS_DEFAULT_MAX_READ_WRITE_SIZE_;
+    }
+    else
+    {
+        attrs->max_read_write_size = bdus_min_(
+            attrs->max_read_write_size, BDUS_HARD_MAX_READ_WRITE_SIZE_);
+
+        attrs->max_read_write_size -= attrs->max_read_write_size % lbs;
+    }
+
+    attrs->max_write_same_size = bdus_adjust_max_size_loopback_(
+        attrs->max_write_same_size, ops->write_same != NULL, lbs);
+
+    attrs->max_write_zeros_size = bdus_adjust_max_size_loopback_(
+        attrs->max_write_zeros_size, ops->write_zeros != NULL, lbs);
+
+    attrs->max_discard_erase_size = bdus_adjust_max_size_loopback_(
+        attrs->max_discard_erase_size,
+        ops->discard || ops->discard_ranges || ops->secure_erase, lbs);
+
+    attrs->max_discard_ranges = ops->discard || ops->discard_ranges ? 1 : 0;
+
+    if (attrs->max_concurrent_callbacks == 0)
+        attrs->max_concurrent_callbacks = 1;
+
+    bdus_adjust_attrs_num_queues_(attrs);
+
+    attrs->min_concurrent_callbacks = attrs->max_concurrent_callbacks;
+
+    bdus_adjust_attrs_workers_(attrs);
+
+    attrs->dont_daemonize   = true;
+    attrs->num_poll_queues  = 0;
+    attrs->use_io_uring     = false;
+    attrs->io_uring_polling = false;
+    attrs->zero_copy        = false;
+    attrs->busy_poll_us     = 0;
+    attrs->zero_extent_size = 0;
+    attrs->read_cache_size  = 0;
+    attrs->trace_size       = 0;
+    attrs->allow_handoff    = false;
+    attrs->chunk_size       = 0;
+
+    attrs->zone_size            = 0;
+    attrs->max_open_zones       = 0;
+    attrs->max_active_zones     = 0;
+    attrs->max_zone_append_size = 0;
+}
+
+// Fails if requests of a type with the given weight would be generated but
+// the driver doesn't support them.
+static bool bdus_validate_weight_loopback_(
+    uint32_t weight, bool supported, const char *weight_name,
+    const char *callback_names)
+{
+    if (weight > 0 && !supported)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Loopback attribute '%s' must be 0 if the driver implements none"
+            " of callbacks %s",
+            weight_name, callback_names);
+
+        return false;
+    }
+
+    return true;
+}
+
+// Fails if requests of a type with the given weight would be generated but
+// may be larger than the given (adjusted) attribute allows.
+static bool bdus_validate_max_size_loopback_(
+    uint32_t max_request_size, uint32_t weight, uint32_t max_size,
+    const char *max_size_name)
+{
+    if (weight > 0 && max_request_size > max_size)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu32
+            " for loopback attribute 'max_request_size', must be less than or"
+            " equal to attribute '%s' (which is %" PRIu32 ")",
+            max_request_size, max_size_name, max_size);
+
+        return false;
+    }
+
+    return true;
+}
+
+// Validates the given loopback attributes against the driver's callbacks and
+// adjusted attributes, and gives default values to those that are 0.
+static bool bdus_adjust_loopback_attrs_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    struct bdus_loopback_attrs *loopback_attrs)
+{
+    const bool supports_read  = ops->read || ops->readv;
+    const bool supports_write = ops->write || ops->writev;
+
+    // validate weights, defaulting to reads and writes
+
+    if (loopback_attrs->read_weight == 0 && loopback_attrs->write_weight == 0
+        && loopback_attrs->fua_write_weight == 0
+        && loopback_attrs->flush_weight == 0
+        && loopback_attrs->discard_weight == 0
+        && loopback_attrs->write_zeros_weight == 0)
+    {
+        loopback_attrs->read_weight  = supports_read ? 1 : 0;
+        loopback_attrs->write_weight = supports_write ? 1 : 0;
+
+        if (!supports_read && !supports_write)
+        {
+            bdus_set_error_(
+                EINVAL,
+                "The driver implements neither reads nor writes, so the"
+                " weights of the requests to generate must be given");
+
+            return false;
+        }
+    }
+
+    if (!bdus_validate_weight_loopback_(
+            loopback_attrs->read_weight, supports_read, "read_weight",
+            "'read' and 'readv'")
+        || !bdus_validate_weight_loopback_(
+            loopback_attrs->write_weight, supports_write, "write_weight",
+            "'write' and 'writev'")
+        || !bdus_validate_weight_loopback_(
+            loopback_attrs->fua_write_weight,
+            ops->fua_write || ops->fua_writev, "fua_write_weight",
+            "'fua_write' and 'fua_writev'")
+        || !bdus_validate_weight_loopback_(
+            loopback_attrs->flush_weight, ops->flush != NULL, "flush_weight",
+            "'flush'")
+        || !bdus_validate_weight_loopback_(
+            loopback_attrs->discard_weight, ops->discard || ops->discard_ranges,
+            "discard_weight", "'discard' and 'discard_ranges'")
+        || !bdus_validate_weight_loopback_(
+            loopback_attrs->write_zeros_weight, ops->write_zeros != NULL,
+            "write_zeros_weight", "'write_zeros'"))
+    {
+        return false;
+    }
+
+    // validate sizes
+
+    if (loopback_attrs->min_request_size == 0)
+    {
+        const size_t page_size = bdus_get_page_size_();
+
+        if (page_size == 0)
+            return false;
+
+        loopback_attrs->min_request_size = (uint32_t)page_size;
+    }
+
+    if (loopback_attrs->max_request_size == 0)
+        loopback_attrs->max_request_size = loopback_attrs->min_request_size;
+
+    if (!bdus_is_positive_multiple_of_(
+            loopback_attrs->min_request_size, attrs->logical_block_size))
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu32
+            " for loopback attribute 'min_request_size', must be a multiple of"
+            " attribute 'logical_block_size' (which is %" PRIu32 ")",
+            loopback_attrs->min_request_size, attrs->logical_block_size);
+
+        return false;
+    }
+
+    if (loopback_attrs->max_request_size % attrs->logical_block_size != 0
+        || loopback_attrs->max_request_size < loopback_attrs->min_request_size
+        || (uint64_t)loopback_attrs->max_request_size > attrs->size)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Invalid value %" PRIu32
+            " for loopback attribute 'max_request_size', must be a multiple of"
+            " attribute 'logical_block_size' (which is %" PRIu32
+            ") greater than or equal to loopback attribute 'min_request_size'"
+            " (which is %" PRIu32
+            ") and less than or equal to attribute 'size' (which is %" PRIu64
+            ")",
+            loopback_attrs->max_request_size, attrs->logical_block_size,
+            loopback_attrs->min_request_size, attrs->size);
+
+        return false;
+    }
+
+    if (!bdus_validate_max_size_loopback_(
+            loopback_attrs->max_request_size,
+            loopback_attrs->read_weight | loopback_attrs->write_weight
+                | loopback_attrs->fua_write_weight,
+            attrs->max_read_write_size, "max_read_write_size")
+        || !bdus_validate_max_size_loopback_(
+            loopback_attrs->max_request_size,
+            loopback_attrs->discard_weight, attrs->max_discard_erase_size,
+            "max_discard_erase_size")
+        || !bdus_validate_max_size_loopback_(
+            loopback_attrs->max_request_size,
+            loopback_attrs->write_zeros_weight, attrs->max_write_zeros_size,
+            "max_write_zeros_size"))
+    {
+        return false;
+    }
+
+    // validate number of requests
+
+    if (loopback_attrs->num_requests == 0)
+    {
+        bdus_set_error_(
+            EINVAL, "Loopback attribute 'num_requests' must be positive");
+
+        return false;
+    }
+
+    // adjust queue depth (the default being that of
+    // `struct kbdus_device_config.max_outstanding_reqs`)
+
+    if (loopback_attrs->queue_depth == 0)
+        loopback_attrs->queue_depth = 2 * attrs->max_concurrent_callbacks;
+
+    return true;
+}
+
+static bool bdus_run_loopback_impl_(
+    const struct bdus_ops *ops_copy, struct bdus_attrs *attrs_copy,
+    void *private_data, struct bdus_loopback_attrs *loopback_attrs_copy,
+    struct bdus_loopback_results *out_results)
+{
+    const struct bdus_attrs original_attrs = *attrs_copy;
+
+    // validate and adjust attributes
+
+    if (attrs_copy->async_queue_depth > 0)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Attribute 'async_queue_depth' must be 0 when using"
+            " bdus_run_loopback()");
+
+        return false;
+    }
+
+    if (ops_copy->report_zones)
+    {
+        bdus_set_error_(
+            EINVAL,
+            "Drivers that implement callback 'report_zones' can't be run with"
+            " bdus_run_loopback()");
+
+        return false;
+    }
+
+    if (!bdus_validate_ops_run_(ops_copy))
+        return false;
+
+    if (!bdus_validate_attrs_run_(attrs_copy))
+        return false;
+
+    bdus_adjust_attrs_loopback_(ops_copy, attrs_copy);
+
+    if (!bdus_adjust_loopback_attrs_(ops_copy, attrs_copy, loopback_attrs_copy))
+        return false;
+
+    // create bdus_ctx structure
+
+    struct bdus_ctx_and_fd_ ctx_and_fd = {
+        .ctx = {
+            .id           = 0,
+            .path         = "loopback",
+            .ops          = ops_copy,
+            .attrs        = attrs_copy,
+            .is_rerun     = false,
+            .private_data = private_data,
+            .major        = 0,
+            .minor        = 0,
+        },
+        .control_fd = -1,
+    };
+
+    struct bdus_ctx *const ctx = &ctx_and_fd.ctx;
+
+    // log attribute adjustment
+
+    if (ctx->attrs->log)
+        bdus_log_ops_and_attrs_(ops_copy, attrs_copy, &original_attrs);
+
+    // invoke `initialize()` callback
+
+    if (!bdus_invoke_initialize_(ctx))
+        return false;
+
+    // delegate work to backend
+
+    const bool success =
+        bdus_backend_run_loopback_(ctx, loopback_attrs_copy, out_results);
+
+    // invoke `terminate()` callback
+
+    return bdus_invoke_terminate_(ctx, success);
+}
+
+BDUS_EXPORT_ bool bdus_run_loopback_0_1_3_(
+    const struct bdus_ops *ops, const struct bdus_attrs *attrs,
+    void *private_data, const struct bdus_loopback_attrs *loopback_attrs,
+    struct bdus_loopback_results *out_results)
+{
+    // copy operations and attributes
+
+    const struct bdus_ops ops_copy                 = *ops;
+    struct bdus_attrs attrs_copy                   = *attrs;
+    struct bdus_loopback_attrs loopback_attrs_copy = *loopback_attrs;
+
+    // restrict the current thread to the requested CPUs, if any
+
+    bool restricted_cpus;
+
+    if (!bdus_backend_restrict_cpus_(&attrs_copy, &restricted_cpus))
+        return false;
+
+    // delegate remaining work
+
+    const bool success = bdus_run_loopback_impl_(
+        &ops_copy, &attrs_copy, private_data, &loopback_attrs_copy,
+        out_results);
+
+    // restore the current thread's CPU affinity
+
+    if (restricted_cpus)
+        bdus_backend_unrestrict_cpus_();
+
+    // return success indication
+
+    return success;
+}
+
+/* -------------------------------------------------------------------------- */
+/* device management */
+
+BDUS_EXPORT_ bool
+    bdus_get_dev_id_from_path_0_1_0_(uint64_t *out_dev_id, const char *dev_path)
+{
+    // open control device
+
+    const int control_fd = bdus_open_control_(true);
+
+    if (control_fd < 0)
+        return false;
+
+    // translate path to id
+
+    uint64_t path_or_id = (uint64_t)dev_path;
+
+    const int ret = bdus_ioctl_arg_retry_(
+        control_fd, KBDUS_IOCTL_DEVICE_PATH_TO_ID, &path_or_id);
+
+    // close control device
+
+    bdus_close_keep_errno_(control_fd);
+
+    // check result
+
+    if (ret == 0)
+    {
+        *out_dev_id = path_or_id;
+
+        return true;
+    }
+    else
+    {
+        switch (errno)
+        {
+        case EACCES:
+            bdus_set_error_(
+                errno, "Access denied while traversing %s", dev_path);
+            break;
+
+        case ELOOP:
+            bdus_set_error_(
+                errno,
+                "Too many symbolic links encountered while traversing %s",
+                dev_path);
+            break;
+
+        case ENOENT:
+        case ENOTDIR:
+            bdus_set_error_(errno, "%s does not exist", dev_path);
+            break;
+
+        case ENOTBLK:
+            bdus_set_error_(errno, "%s is not a block special file", dev_path);
+            break;
+
+        case EINVAL:
+            bdus_set_error_(
+                errno, "%s does not refer to a device created by BDUS",
+                dev_path);
+            break;
+
+        case ENODEV:
+            bdus_set_error_(
+                errno, "The device referred to by %s does not exist", dev_path);
+            break;
+
+        case ECHILD:
+            bdus_set_error_(
+                EINVAL,
                 "%s refers to a partition of a device created by BDUS and not"
                 " to the device itself",
                 dev_path);
@@ -1249,6 +2867,84 @@ BDUS_EXPORT_ bool bdus_destroy_dev_0_1_0_(uint64_t dev_id)
     return ret == 0;
 }
 
+BDUS_EXPORT_ bool bdus_get_dev_trace_0_1_3_(
+    uint64_t dev_id, struct bdus_trace_entry **out_entries,
+    size_t *out_num_entries)
+{
+    // check privileges, as the trace is only accessible to root
+
+    if (!bdus_check_privileges_())
+        return false;
+
+    // read trace
+
+    return bdus_trace_read_(dev_id, out_entries, out_num_entries);
+}
+
+BDUS_EXPORT_ bool
+    bdus_get_dev_stats_0_1_3_(uint64_t dev_id, struct bdus_dev_stats *out_stats)
+{
+    // open control device
+
+    const int control_fd = bdus_open_control_(true);
+
+    if (control_fd < 0)
+        return false;
+
+    // get device statistics
+
+    struct kbdus_device_stats stats = { .id = dev_id };
+
+    const int ret = bdus_ioctl_arg_retry_(
+        control_fd, KBDUS_IOCTL_GET_DEVICE_STATS, &stats);
+
+    if (ret != 0)
+    {
+        if (errno == ENODEV)
+            bdus_set_error_(errno, "The device no longer exists");
+        else if (errno == EINVAL)
+            bdus_set_error_(errno, "The device does not exist");
+        else
+            bdus_set_error_control_ioctl_generic_(
+                errno, "KBDUS_IOCTL_GET_DEVICE_STATS");
+    }
+    else
+    {
+        out_stats->timestamp_ns     = stats.timestamp_ns;
+        out_stats->num_awaiting_get = stats.num_awaiting_get;
+        out_stats->num_in_flight    = stats.num_in_flight;
+
+        for (size_t i = 0; i < BDUS_STATS_NUM_REQ_TYPES; ++i)
+        {
+            const struct kbdus_request_stats *const s = &stats.types[i];
+            struct bdus_request_stats *const t        = &out_stats->types[i];
+
+            t->type = bdus_trace_type_name_(KBDUS_ITEM_TYPE_READ + (uint32_t)i);
+
+            t->requests   = s->requests;
+            t->bytes      = s->bytes;
+            t->errors     = s->errors;
+            t->timeouts   = s->timeouts;
+            t->merges     = s->merges;
+            t->service_ns = s->service_ns;
+
+            memcpy(
+                t->queue_wait_hist, s->queue_wait_hist,
+                sizeof(t->queue_wait_hist));
+            memcpy(t->service_hist, s->service_hist, sizeof(t->service_hist));
+            memcpy(t->copy_hist, s->copy_hist, sizeof(t->copy_hist));
+        }
+    }
+
+    // close control device
+
+    bdus_close_keep_errno_(control_fd);
+
+    // return success indicator
+
+    return ret == 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* errors */
 
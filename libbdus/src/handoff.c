@@ -0,0 +1,638 @@
+/* SPDX-License-Identifier: MIT */
+/* -------------------------------------------------------------------------- */
+
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200112L
+
+#include <libbdus/handoff.h>
+#include <libbdus/utilities.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <kbdus.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+
+// Drivers listen on abstract UNIX domain sockets named "bdus-handoff-<dev_id>",
+// and the following messages are exchanged over each connection, in order:
+//
+//   1. OFFER, running driver -> successor, carrying the control fd;
+//   2. READY, successor -> running driver, once the successor is set up;
+//   3. SUSPENDED or FAILED, running driver -> successor, once the device was
+//      suspended and the running driver stopped serving requests, or if the
+//      device could not be suspended.
+//
+// Either side closing the connection before this is complete cancels the
+// handoff, unless the device was already suspended.
+enum
+{
+    BDUS_HANDOFF_MSG_OFFER_,
+    BDUS_HANDOFF_MSG_READY_,
+    BDUS_HANDOFF_MSG_SUSPENDED_,
+    BDUS_HANDOFF_MSG_FAILED_,
+};
+
+struct bdus_handoff_msg_
+{
+    uint32_t type;
+    int32_t error; // the errno value for FAILED messages
+    struct kbdus_device_and_fd_config config; // only valid on OFFER messages
+};
+
+struct bdus_handoff_
+{
+    int control_fd;
+    struct kbdus_device_and_fd_config config;
+
+    // connection to the previous driver, or -1 if not taking over the device or
+    // already resumed
+    int predecessor_fd;
+
+    // whether other drivers may take over the device, and whether
+    // bdus_handoff_listen_() was called and started `thread`
+    bool allow_handoff;
+    bool listening;
+    pthread_t thread;
+
+    // protects the fields below, which are shared with `thread`
+    pthread_mutex_t mutex;
+
+    bool stopping;
+    bool suspended;
+
+    // -1 if not open
+    int listen_fd;
+    int successor_fd;
+};
+
+static socklen_t
+    bdus_handoff_get_address_(struct sockaddr_un *address, uint64_t dev_id)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+
+    // abstract socket, whose name starts after the initial null byte
+
+    const int len = snprintf(
+        address->sun_path + 1, sizeof(address->sun_path) - 1,
+        "bdus-handoff-%" PRIu64, dev_id);
+
+    return (socklen_t)(
+        offsetof(struct sockaddr_un, sun_path) + 1 + (size_t)len);
+}
+
+// Only processes running as root may take part in handoffs, as they share
+// control over the device.
+static bool bdus_handoff_check_peer_(int socket_fd)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+        return false;
+
+    return cred.uid == 0;
+}
+
+static bool bdus_handoff_send_(
+    int socket_fd, const struct bdus_handoff_msg_ *msg, int fd_to_send)
+{
+    struct iovec iov = {
+        .iov_base = (void *)msg,
+        .iov_len  = sizeof(*msg),
+    };
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msghdr = {
+        .msg_iov    = &iov,
+        .msg_iovlen = 1,
+    };
+
+    if (fd_to_send >= 0)
+    {
+        memset(&control, 0, sizeof(control));
+
+        msghdr.msg_control    = control.buf;
+        msghdr.msg_controllen = sizeof(control.buf);
+
+        struct cmsghdr *const cmsg = CMSG_FIRSTHDR(&msghdr);
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+
+        memcpy(CMSG_DATA(cmsg), &fd_to_send, sizeof(int));
+    }
+
+    ssize_t ret;
+
+    do
+        ret = sendmsg(socket_fd, &msghdr, MSG_NOSIGNAL);
+    while (ret < 0 && errno == EINTR);
+
+    return ret == (ssize_t)sizeof(*msg);
+}
+
+// Receives a message, storing any received fd into `*out_fd` if not NULL and
+// setting it to -1 otherwise. Returns false if the connection was closed or on
+// error.
+static bool bdus_handoff_receive_(
+    int socket_fd, struct bdus_handoff_msg_ *msg, int *out_fd)
+{
+    struct iovec iov = {
+        .iov_base = msg,
+        .iov_len  = sizeof(*msg),
+    };
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msghdr = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+
+    ssize_t ret;
+
+    do
+        ret = recvmsg(socket_fd, &msghdr, MSG_CMSG_CLOEXEC);
+    while (ret < 0 && errno == EINTR);
+
+    // close any received fd that the caller does not expect
+
+    int fd = -1;
+
+    if (ret >= 0)
+    {
+        const struct cmsghdr *const cmsg = CMSG_FIRSTHDR(&msghdr);
+
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET
+            && cmsg->cmsg_type == SCM_RIGHTS
+            && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    if (out_fd)
+        *out_fd = fd;
+    else if (fd >= 0)
+        close(fd);
+
+    if (ret != (ssize_t)sizeof(*msg) || (msghdr.msg_flags & MSG_CTRUNC))
+    {
+        if (out_fd && fd >= 0)
+        {
+            close(fd);
+            *out_fd = -1;
+        }
+
+        errno = ret < 0 ? errno : EPROTO;
+        return false;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* running driver */
+
+struct bdus_handoff_ *bdus_handoff_create_(
+    int control_fd, const struct kbdus_device_and_fd_config *config)
+{
+    struct bdus_handoff_ *const handoff = calloc(1, sizeof(*handoff));
+
+    if (!handoff)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&handoff->mutex, NULL) != 0)
+        abort();
+
+    handoff->control_fd     = control_fd;
+    handoff->config         = *config;
+    handoff->predecessor_fd = -1;
+    handoff->allow_handoff  = true;
+    handoff->listen_fd      = -1;
+    handoff->successor_fd   = -1;
+
+    return handoff;
+}
+
+// Offers the device to the successor connected through
+// `handoff->successor_fd`, and returns whether the device was suspended.
+static bool bdus_handoff_offer_(struct bdus_handoff_ *handoff)
+{
+    const int successor_fd = handoff->successor_fd;
+
+    if (!bdus_handoff_check_peer_(successor_fd))
+        return false;
+
+    // send control fd to successor and wait for it to be set up
+
+    struct bdus_handoff_msg_ msg = {
+        .type   = BDUS_HANDOFF_MSG_OFFER_,
+        .config = handoff->config,
+    };
+
+    if (!bdus_handoff_send_(successor_fd, &msg, handoff->control_fd))
+        return false;
+
+    if (!bdus_handoff_receive_(successor_fd, &msg, NULL)
+        || msg.type != BDUS_HANDOFF_MSG_READY_)
+    {
+        return false;
+    }
+
+    // suspend the device, which makes our worker threads stop once they reply
+    // to the requests they are serving, and stop listening, so that the
+    // successor can in turn listen for drivers
+
+    if (pthread_mutex_lock(&handoff->mutex) != 0)
+        abort();
+
+    int error = ENODEV;
+
+    if (!handoff->stopping)
+    {
+        if (bdus_ioctl_retry_(handoff->control_fd, KBDUS_IOCTL_SUSPEND) == 0)
+        {
+            handoff->suspended = true;
+
+            close(handoff->listen_fd);
+            handoff->listen_fd = -1;
+        }
+        else
+        {
+            error = errno;
+        }
+    }
+
+    const bool suspended = handoff->suspended;
+
+    if (pthread_mutex_unlock(&handoff->mutex) != 0)
+        abort();
+
+    if (!suspended)
+    {
+        msg = (struct bdus_handoff_msg_) {
+            .type  = BDUS_HANDOFF_MSG_FAILED_,
+            .error = error,
+        };
+
+        bdus_handoff_send_(successor_fd, &msg, -1);
+    }
+
+    return suspended;
+}
+
+static void *bdus_handoff_listen_thread_(void *arg)
+{
+    struct bdus_handoff_ *const handoff = arg;
+
+    while (true)
+    {
+        const int successor_fd =
+            accept4(handoff->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+        if (successor_fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            break; // stopping, or unrecoverable error
+        }
+
+        if (pthread_mutex_lock(&handoff->mutex) != 0)
+            abort();
+
+        const bool stopping = handoff->stopping;
+
+        if (!stopping)
+            handoff->successor_fd = successor_fd;
+
+        if (pthread_mutex_unlock(&handoff->mutex) != 0)
+            abort();
+
+        if (stopping)
+        {
+            close(successor_fd);
+            break;
+        }
+
+        if (bdus_handoff_offer_(handoff))
+            break; // keep the connection open until the handoff completes
+
+        // the handoff was canceled, so keep listening
+
+        if (pthread_mutex_lock(&handoff->mutex) != 0)
+            abort();
+
+        handoff->successor_fd = -1;
+
+        if (pthread_mutex_unlock(&handoff->mutex) != 0)
+            abort();
+
+        close(successor_fd);
+    }
+
+    return NULL;
+}
+
+bool bdus_handoff_listen_(struct bdus_handoff_ *handoff)
+{
+    if (!handoff || !handoff->allow_handoff)
+        return true;
+
+    // create socket
+
+    handoff->listen_fd =
+        socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    if (handoff->listen_fd < 0)
+    {
+        bdus_set_error_append_errno_(errno, "socket() failed");
+        return false;
+    }
+
+    struct sockaddr_un address;
+
+    const socklen_t address_len =
+        bdus_handoff_get_address_(&address, handoff->config.device.id);
+
+    if (bind(handoff->listen_fd, (const struct sockaddr *)&address, address_len)
+            != 0
+        || listen(handoff->listen_fd, 1) != 0)
+    {
+        bdus_set_error_append_errno_(
+            errno, "Failed to listen for drivers taking over the device");
+
+        goto error_close;
+    }
+
+    // start listening thread
+
+    if (pthread_create(
+            &handoff->thread, NULL, bdus_handoff_listen_thread_, handoff)
+        != 0)
+    {
+        bdus_set_error_(EIO, "pthread_create() failed");
+        goto error_close;
+    }
+
+    handoff->listening = true;
+
+    return true;
+
+error_close:
+    bdus_close_keep_errno_(handoff->listen_fd);
+    handoff->listen_fd = -1;
+    return false;
+}
+
+bool bdus_handoff_destroy_(struct bdus_handoff_ *handoff)
+{
+    if (!handoff)
+        return false;
+
+    // stop listening thread
+
+    if (handoff->listening)
+    {
+        if (pthread_mutex_lock(&handoff->mutex) != 0)
+            abort();
+
+        handoff->stopping = true;
+
+        if (handoff->listen_fd >= 0)
+            shutdown(handoff->listen_fd, SHUT_RDWR);
+
+        if (handoff->successor_fd >= 0 && !handoff->suspended)
+            shutdown(handoff->successor_fd, SHUT_RDWR);
+
+        if (pthread_mutex_unlock(&handoff->mutex) != 0)
+            abort();
+
+        if (pthread_join(handoff->thread, NULL) != 0)
+            abort();
+    }
+
+    // let the successor resume the device, as we no longer serve it
+
+    const bool handed_off = handoff->suspended;
+
+    if (handed_off)
+    {
+        const struct bdus_handoff_msg_ msg = {
+            .type = BDUS_HANDOFF_MSG_SUSPENDED_,
+        };
+
+        bdus_handoff_send_(handoff->successor_fd, &msg, -1);
+    }
+
+    // free everything
+
+    if (handoff->successor_fd >= 0)
+        bdus_close_keep_errno_(handoff->successor_fd);
+
+    if (handoff->listen_fd >= 0)
+        bdus_close_keep_errno_(handoff->listen_fd);
+
+    if (handoff->predecessor_fd >= 0)
+        bdus_close_keep_errno_(handoff->predecessor_fd);
+
+    if (pthread_mutex_destroy(&handoff->mutex) != 0)
+        abort();
+
+    free(handoff);
+
+    return handed_off;
+}
+
+/* -------------------------------------------------------------------------- */
+/* successor */
+
+struct bdus_handoff_ *bdus_handoff_connect_(
+    uint64_t dev_id, bool allow_handoff, int *out_control_fd,
+    struct kbdus_device_and_fd_config *out_config)
+{
+    // connect to running driver
+
+    const int socket_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    if (socket_fd < 0)
+    {
+        bdus_set_error_append_errno_(errno, "socket() failed");
+        return NULL;
+    }
+
+    struct sockaddr_un address;
+    const socklen_t address_len = bdus_handoff_get_address_(&address, dev_id);
+
+    int ret;
+
+    do
+        ret = connect(
+            socket_fd, (const struct sockaddr *)&address, address_len);
+    while (ret != 0 && errno == EINTR);
+
+    if (ret != 0)
+    {
+        if (errno == ECONNREFUSED || errno == ENOENT)
+        {
+            bdus_set_error_(
+                errno,
+                "The device does not exist or its driver does not allow being"
+                " taken over (see attribute 'allow_handoff')");
+        }
+        else
+        {
+            bdus_set_error_append_errno_(
+                errno, "Failed to connect to the device's driver");
+        }
+
+        goto error_close_socket;
+    }
+
+    if (!bdus_handoff_check_peer_(socket_fd))
+    {
+        bdus_set_error_(EPERM, "The device's driver is not running as root");
+        goto error_close_socket;
+    }
+
+    // receive control fd
+
+    struct bdus_handoff_msg_ msg;
+    int control_fd;
+
+    if (!bdus_handoff_receive_(socket_fd, &msg, &control_fd)
+        || msg.type != BDUS_HANDOFF_MSG_OFFER_ || control_fd < 0
+        || msg.config.device.id != dev_id)
+    {
+        if (control_fd >= 0)
+            close(control_fd);
+
+        bdus_set_error_(
+            EPROTO, "The device's driver did not hand off the device");
+
+        goto error_close_socket;
+    }
+
+    // create handoff state
+
+    struct bdus_handoff_ *const handoff = bdus_handoff_create_(-1, &msg.config);
+
+    if (!handoff)
+    {
+        bdus_close_keep_errno_(control_fd);
+        goto error_close_socket;
+    }
+
+    handoff->control_fd     = control_fd;
+    handoff->predecessor_fd = socket_fd;
+    handoff->allow_handoff  = allow_handoff;
+
+    *out_control_fd = control_fd;
+    *out_config     = msg.config;
+
+    return handoff;
+
+error_close_socket:
+    bdus_close_keep_errno_(socket_fd);
+    return NULL;
+}
+
+bool bdus_handoff_resume_(struct bdus_handoff_ *handoff)
+{
+    if (!handoff || handoff->predecessor_fd < 0)
+        return true;
+
+    // have the previous driver suspend the device and stop serving it
+
+    struct bdus_handoff_msg_ msg = {
+        .type = BDUS_HANDOFF_MSG_READY_,
+    };
+
+    if (!bdus_handoff_send_(handoff->predecessor_fd, &msg, -1))
+    {
+        bdus_set_error_append_errno_(
+            errno, "Failed to communicate with the device's driver");
+
+        return false;
+    }
+
+    // if the connection is closed without a reply, the previous driver
+    // terminated abruptly, and resuming the device below only succeeds if it
+    // had already suspended it, in which case any requests it didn't reply to
+    // are received again
+
+    if (bdus_handoff_receive_(handoff->predecessor_fd, &msg, NULL)
+        && msg.type == BDUS_HANDOFF_MSG_FAILED_)
+    {
+        bdus_set_error_(
+            msg.error, "The device's driver failed to suspend the device");
+
+        return false;
+    }
+
+    bdus_close_keep_errno_(handoff->predecessor_fd);
+    handoff->predecessor_fd = -1;
+
+    // resume device
+
+    if (bdus_ioctl_retry_(handoff->control_fd, KBDUS_IOCTL_RESUME) != 0)
+    {
+        if (errno == ENODEV)
+        {
+            bdus_set_error_(errno, "The device no longer exists");
+        }
+        else if (errno == EINVAL)
+        {
+            bdus_set_error_(
+                errno, "The device's driver did not hand off the device");
+        }
+        else if (errno == EINPROGRESS)
+        {
+            bdus_set_error_(
+                errno,
+                "Another driver is already taking control of the device");
+        }
+        else
+        {
+            bdus_set_error_append_errno_(
+                errno,
+                "ioctl() on /dev/bdus-control with command KBDUS_IOCTL_RESUME"
+                " failed");
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,460 @@
+/* SPDX-License-Identifier: MIT */
+/* -------------------------------------------------------------------------- */
+
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200112L
+
+#include <bdus.h>
+#include <libbdus/trace.h>
+#include <libbdus/utilities.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <kbdus.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+
+// Traces are stored in files named "bdus-trace-<dev_id>" in this directory,
+// with a header followed by `num_rings` rings, each with a 64-byte header and
+// then `ring_size` records.
+#define BDUS_TRACE_DIR_ "/dev/shm"
+
+#define BDUS_TRACE_MAGIC_ UINT32_C(0x42445452) // "BDTR"
+
+struct bdus_trace_header_
+{
+    uint32_t magic;
+    uint32_t num_rings;
+    uint32_t ring_size;
+    uint32_t reserved_;
+    uint64_t dev_id;
+    uint8_t padding_[40];
+};
+
+struct bdus_trace_record_
+{
+    uint64_t start_ns;
+    uint64_t arg64;
+    uint32_t arg32;
+    uint32_t duration_ns; // saturated at UINT32_MAX
+    int32_t error;
+    uint8_t type; // a `enum kbdus_item_type` value
+    uint8_t padding_[3];
+};
+
+struct bdus_trace_ring_
+{
+    // the number of records ever written to the ring, the last `ring_size` of
+    // which are in `records`, with record `i` at index `i % ring_size`
+    uint64_t head;
+
+    uint32_t ring_size;
+    uint8_t padding_[52];
+
+    struct bdus_trace_record_ records[];
+};
+
+struct bdus_trace_
+{
+    void *memory;
+    size_t memory_size;
+
+    int fd;
+    char path[64];
+
+    size_t num_rings;
+    size_t ring_memory_size;
+};
+
+static size_t bdus_trace_memory_size_(size_t num_rings, uint32_t ring_size)
+{
+    return sizeof(struct bdus_trace_header_)
+        + num_rings
+        * (sizeof(struct bdus_trace_ring_)
+           + (size_t)ring_size * sizeof(struct bdus_trace_record_));
+}
+
+static void bdus_trace_get_path_(char path[64], uint64_t dev_id)
+{
+    snprintf(path, 64, BDUS_TRACE_DIR_ "/bdus-trace-%" PRIu64, dev_id);
+}
+
+const char *bdus_trace_type_name_(uint32_t type)
+{
+    switch (type)
+    {
+    case KBDUS_ITEM_TYPE_READ:
+        return "read";
+    case KBDUS_ITEM_TYPE_WRITE:
+        return "write";
+    case KBDUS_ITEM_TYPE_WRITE_SAME:
+        return "write_same";
+    case KBDUS_ITEM_TYPE_WRITE_ZEROS_NO_UNMAP:
+        return "write_zeros_no_unmap";
+    case KBDUS_ITEM_TYPE_WRITE_ZEROS_MAY_UNMAP:
+        return "write_zeros_may_unmap";
+    case KBDUS_ITEM_TYPE_FUA_WRITE:
+        return "fua_write";
+    case KBDUS_ITEM_TYPE_FLUSH:
+        return "flush";
+    case KBDUS_ITEM_TYPE_DISCARD:
+        return "discard";
+    case KBDUS_ITEM_TYPE_SECURE_ERASE:
+        return "secure_erase";
+    case KBDUS_ITEM_TYPE_IOCTL:
+        return "ioctl";
+    case KBDUS_ITEM_TYPE_ZONE_REPORT:
+        return "zone_report";
+    case KBDUS_ITEM_TYPE_ZONE_RESET:
+        return "zone_reset";
+    case KBDUS_ITEM_TYPE_ZONE_OPEN:
+        return "zone_open";
+    case KBDUS_ITEM_TYPE_ZONE_CLOSE:
+        return "zone_close";
+    case KBDUS_ITEM_TYPE_ZONE_FINISH:
+        return "zone_finish";
+    case KBDUS_ITEM_TYPE_ZONE_APPEND:
+        return "zone_append";
+    default:
+        return "unknown";
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct bdus_trace_ *
+    bdus_trace_create_(uint64_t dev_id, size_t num_rings, uint32_t ring_size)
+{
+    struct bdus_trace_ *const trace = calloc(1, sizeof(*trace));
+
+    if (!trace)
+    {
+        bdus_set_error_append_errno_(errno, "calloc() failed");
+        return NULL;
+    }
+
+    trace->num_rings   = num_rings;
+    trace->memory_size = bdus_trace_memory_size_(num_rings, ring_size);
+
+    trace->ring_memory_size = sizeof(struct bdus_trace_ring_)
+        + (size_t)ring_size * sizeof(struct bdus_trace_record_);
+
+    // create file, replacing any existing one without affecting processes
+    // that still have it mapped
+
+    bdus_trace_get_path_(trace->path, dev_id);
+
+    if (unlink(trace->path) != 0 && errno != ENOENT)
+    {
+        bdus_set_error_append_errno_(
+            errno, "Failed to remove existing trace file %s", trace->path);
+        goto error_free_trace;
+    }
+
+    trace->fd = open(
+        trace->path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+    if (trace->fd < 0)
+    {
+        bdus_set_error_append_errno_(
+            errno, "Failed to create trace file %s", trace->path);
+        goto error_free_trace;
+    }
+
+    if (ftruncate(trace->fd, (off_t)trace->memory_size) != 0)
+    {
+        bdus_set_error_append_errno_(errno, "ftruncate() failed");
+        goto error_remove_file;
+    }
+
+    // map file
+
+    trace->memory = mmap(
+        NULL, trace->memory_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, trace->fd, 0);
+
+    if (trace->memory == MAP_FAILED)
+    {
+        bdus_set_error_append_errno_(errno, "mmap() failed");
+        goto error_remove_file;
+    }
+
+    // initialize rings, and only then the header, which marks the trace as
+    // valid
+
+    for (size_t i = 0; i < num_rings; ++i)
+        bdus_trace_get_ring_(trace, i)->ring_size = ring_size;
+
+    struct bdus_trace_header_ *const header = trace->memory;
+
+    header->num_rings = (uint32_t)num_rings;
+    header->ring_size = ring_size;
+    header->dev_id    = dev_id;
+
+    __atomic_store_n(&header->magic, BDUS_TRACE_MAGIC_, __ATOMIC_RELEASE);
+
+    return trace;
+
+error_remove_file:
+    unlink(trace->path);
+    bdus_close_keep_errno_(trace->fd);
+error_free_trace:
+    free(trace);
+    return NULL;
+}
+
+void bdus_trace_destroy_(struct bdus_trace_ *trace, bool remove)
+{
+    if (!trace)
+        return;
+
+    // only remove the file if it was not since replaced by another driver
+
+    struct stat fd_stat;
+    struct stat path_stat;
+
+    if (remove && fstat(trace->fd, &fd_stat) == 0
+        && stat(trace->path, &path_stat) == 0
+        && fd_stat.st_dev == path_stat.st_dev
+        && fd_stat.st_ino == path_stat.st_ino)
+    {
+        unlink(trace->path);
+    }
+
+    munmap(trace->memory, trace->memory_size);
+    bdus_close_keep_errno_(trace->fd);
+
+    free(trace);
+}
+
+struct bdus_trace_ring_ *
+    bdus_trace_get_ring_(struct bdus_trace_ *trace, size_t index)
+{
+    if (!trace)
+        return NULL;
+
+    return (struct bdus_trace_ring_ *)((char *)trace->memory
+                                       + sizeof(struct bdus_trace_header_)
+                                       + trace->ring_memory_size
+                                           * (index % trace->num_rings));
+}
+
+uint64_t bdus_trace_now_ns_(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        return 0;
+
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+void bdus_trace_record_(
+    struct bdus_trace_ring_ *ring, uint32_t type, uint64_t arg64,
+    uint32_t arg32, int32_t error, uint64_t start_ns, uint64_t end_ns)
+{
+    const uint64_t head = ring->head;
+
+    struct bdus_trace_record_ *const record =
+        &ring->records[head % ring->ring_size];
+
+    record->start_ns    = start_ns;
+    record->arg64       = arg64;
+    record->arg32       = arg32;
+    record->duration_ns = (uint32_t)bdus_min_(end_ns - start_ns, UINT32_MAX);
+    record->error       = error;
+    record->type        = (uint8_t)type;
+
+    // publish the record
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------------------------------------------------- */
+
+// Appends the valid records of the given ring to `entries`, returning the
+// number of appended entries. `buffer` must have room for `ring_size` records.
+static size_t bdus_trace_read_ring_(
+    const struct bdus_trace_ring_ *ring, uint32_t ring_size,
+    uint32_t thread_index, struct bdus_trace_record_ *buffer,
+    struct bdus_trace_entry *entries)
+{
+    // copy records, which the writer may be concurrently overwriting
+
+    const uint64_t head_before = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    memcpy(buffer, ring->records, (size_t)ring_size * sizeof(*buffer));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    const uint64_t head_after = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    // only records written before the copy started and not overwritten until
+    // it ended are valid, and the writer may have been overwriting the oldest
+    // of them
+
+    const uint64_t first =
+        head_after >= ring_size ? head_after - ring_size + 1 : 0;
+
+    size_t num_entries = 0;
+
+    for (uint64_t i = first; i < head_before; ++i)
+    {
+        const struct bdus_trace_record_ *const r = &buffer[i % ring_size];
+
+        entries[num_entries++] = (struct bdus_trace_entry) {
+            .type         = bdus_trace_type_name_(r->type),
+            .offset       = r->arg64,
+            .size         = r->arg32,
+            .error        = r->error,
+            .start_ns     = r->start_ns,
+            .duration_ns  = (uint64_t)r->duration_ns,
+            .thread_index = thread_index,
+        };
+    }
+
+    return num_entries;
+}
+
+static int bdus_trace_compare_entries_(const void *a, const void *b)
+{
+    const struct bdus_trace_entry *const x = a;
+    const struct bdus_trace_entry *const y = b;
+
+    return (x->start_ns > y->start_ns) - (x->start_ns < y->start_ns);
+}
+
+bool bdus_trace_read_(
+    uint64_t dev_id, struct bdus_trace_entry **out_entries,
+    size_t *out_num_entries)
+{
+    bool success = false;
+
+    // open and map file
+
+    char path[64];
+    bdus_trace_get_path_(path, dev_id);
+
+    const int fd = bdus_open_retry_(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            bdus_set_error_(
+                errno,
+                "The device does not exist or its driver is not running with"
+                " a positive 'trace_size' attribute");
+        }
+        else
+        {
+            bdus_set_error_append_errno_(
+                errno, "Failed to open trace file %s", path);
+        }
+
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+        bdus_set_error_append_errno_(errno, "fstat() failed");
+        goto out_close;
+    }
+
+    const size_t memory_size = (size_t)st.st_size;
+
+    if (memory_size < sizeof(struct bdus_trace_header_))
+    {
+        bdus_set_error_(EINVAL, "Invalid trace file %s", path);
+        goto out_close;
+    }
+
+    const char *const memory =
+        mmap(NULL, memory_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (memory == MAP_FAILED)
+    {
+        bdus_set_error_append_errno_(errno, "mmap() failed");
+        goto out_close;
+    }
+
+    // validate header
+
+    const struct bdus_trace_header_ *const header = (const void *)memory;
+
+    const uint32_t magic = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE);
+
+    const size_t num_rings = (size_t)header->num_rings;
+    const uint32_t ring_size = header->ring_size;
+
+    if (magic != BDUS_TRACE_MAGIC_ || header->dev_id != dev_id
+        || num_rings == 0 || ring_size == 0
+        || bdus_trace_memory_size_(num_rings, ring_size) != memory_size)
+    {
+        bdus_set_error_(EINVAL, "Invalid trace file %s", path);
+        goto out_unmap;
+    }
+
+    // read rings
+
+    const size_t ring_memory_size = sizeof(struct bdus_trace_ring_)
+        + (size_t)ring_size * sizeof(struct bdus_trace_record_);
+
+    struct bdus_trace_record_ *const buffer =
+        malloc((size_t)ring_size * sizeof(*buffer));
+
+    struct bdus_trace_entry *const entries =
+        malloc(num_rings * (size_t)ring_size * sizeof(*entries));
+
+    if (!buffer || !entries)
+    {
+        bdus_set_error_append_errno_(errno, "malloc() failed");
+        free(entries);
+        free(buffer);
+        goto out_unmap;
+    }
+
+    size_t num_entries = 0;
+
+    for (size_t i = 0; i < num_rings; ++i)
+    {
+        const struct bdus_trace_ring_ *const ring =
+            (const void *)(memory + sizeof(struct bdus_trace_header_)
+                           + ring_memory_size * i);
+
+        num_entries += bdus_trace_read_ring_(
+            ring, ring_size, (uint32_t)i, buffer, entries + num_entries);
+    }
+
+    free(buffer);
+
+    // sort entries by start time
+
+    qsort(entries, num_entries, sizeof(*entries), bdus_trace_compare_entries_);
+
+    *out_entries     = entries;
+    *out_num_entries = num_entries;
+
+    success = true;
+
+out_unmap:
+    munmap((void *)memory, memory_size);
+out_close:
+    bdus_close_keep_errno_(fd);
+    return success;
+}
+
+/* -------------------------------------------------------------------------- */
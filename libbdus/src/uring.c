@@ -0,0 +1,448 @@
+/* SPDX-License-Identifier: MIT */
+/* -------------------------------------------------------------------------- */
+
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200112L
+
+#include <libbdus/uring.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)              \
+    && defined(__NR_io_uring_register) && defined(IORING_FEAT_RW_CUR_POS)
+#define BDUS_HAVE_IO_URING_ 1
+#endif
+#endif
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef BDUS_HAVE_IO_URING_
+
+struct bdus_uring_
+{
+    int unused_;
+};
+
+bool bdus_uring_is_supported_(void)
+{
+    return false;
+}
+
+struct bdus_uring_ *bdus_uring_create_(int control_fd, bool poll)
+{
+    (void)control_fd;
+    (void)poll;
+
+    errno = ENOSYS;
+    return NULL;
+}
+
+void bdus_uring_destroy_(struct bdus_uring_ *ring)
+{
+    (void)ring;
+}
+
+int bdus_uring_send_replies_and_receive_items_(
+    struct bdus_uring_ *ring, void *rais, size_t num_replies, size_t num_rais,
+    size_t queue_index)
+{
+    (void)ring;
+    (void)rais;
+    (void)num_replies;
+    (void)num_rais;
+    (void)queue_index;
+
+    errno = ENOSYS;
+    return -1;
+}
+
+#else
+
+struct bdus_uring_
+{
+    int fd;
+
+    bool sq_poll; // submission queue is polled by a kernel thread
+    bool cq_poll; // completion queue is busy-polled
+
+    void *rings;
+    size_t rings_size;
+
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_flags;
+    unsigned *sq_array;
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+// from <linux/fs.h>, which conflicts with some libc headers
+#ifndef RWF_NOWAIT
+#define RWF_NOWAIT 0x00000008
+#endif
+
+static int bdus_uring_setup_(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int bdus_uring_enter_(
+    int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(
+        __NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int bdus_uring_register_files_(int fd, const int *fds, unsigned num_fds)
+{
+    return (int)syscall(
+        __NR_io_uring_register, fd, IORING_REGISTER_FILES, fds, num_fds);
+}
+
+static bool
+    bdus_uring_map_(struct bdus_uring_ *ring, const struct io_uring_params *p)
+{
+    // map submission and completion queue rings (always a single mapping, as
+    // IORING_FEAT_SINGLE_MMAP is required)
+
+    const size_t sq_ring_size =
+        p->sq_off.array + p->sq_entries * sizeof(unsigned);
+
+    const size_t cq_ring_size =
+        p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+    ring->rings_size =
+        sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+
+    ring->rings = mmap(
+        NULL, ring->rings_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+
+    if (ring->rings == MAP_FAILED)
+        return false;
+
+    // map submission queue entries
+
+    ring->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sqes = mmap(
+        NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if (ring->sqes == MAP_FAILED)
+    {
+        munmap(ring->rings, ring->rings_size);
+        return false;
+    }
+
+    // locate ring fields
+
+    char *const rings = ring->rings;
+
+    ring->sq_tail  = (unsigned *)(rings + p->sq_off.tail);
+    ring->sq_mask  = (unsigned *)(rings + p->sq_off.ring_mask);
+    ring->sq_flags = (unsigned *)(rings + p->sq_off.flags);
+    ring->sq_array = (unsigned *)(rings + p->sq_off.array);
+
+    ring->cq_head = (unsigned *)(rings + p->cq_off.head);
+    ring->cq_tail = (unsigned *)(rings + p->cq_off.tail);
+    ring->cq_mask = (unsigned *)(rings + p->cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe *)(rings + p->cq_off.cqes);
+
+    return true;
+}
+
+// Whether the kernel supports everything we need, given the features reported
+// when setting up an io_uring instance.
+static bool bdus_uring_features_are_supported_(uint32_t features)
+{
+    // IORING_FEAT_RW_CUR_POS was introduced along with non-vectored reads and
+    // writes
+
+    return (features & IORING_FEAT_SINGLE_MMAP)
+        && (features & IORING_FEAT_RW_CUR_POS);
+}
+
+bool bdus_uring_is_supported_(void)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    const int fd = bdus_uring_setup_(2, &params);
+
+    if (fd < 0)
+        return false;
+
+    close(fd);
+
+    return bdus_uring_features_are_supported_(params.features);
+}
+
+struct bdus_uring_ *bdus_uring_create_(int control_fd, bool poll)
+{
+    struct bdus_uring_ *const ring = calloc(1, sizeof(*ring));
+
+    if (!ring)
+        return NULL;
+
+    // create io_uring instance with room for a write and a read, trying to
+    // have its submission queue polled by a kernel thread if requested (which
+    // may require privileges)
+
+    struct io_uring_params params;
+
+    ring->fd = -1;
+
+    if (poll)
+    {
+        memset(&params, 0, sizeof(params));
+
+        params.flags          = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = 1000;
+
+        ring->fd      = bdus_uring_setup_(2, &params);
+        ring->sq_poll = ring->fd >= 0;
+    }
+
+    if (ring->fd < 0)
+    {
+        memset(&params, 0, sizeof(params));
+
+        ring->fd = bdus_uring_setup_(2, &params);
+    }
+
+    if (ring->fd < 0)
+    {
+        free(ring);
+        return NULL;
+    }
+
+    ring->cq_poll = poll;
+
+    // ensure that the kernel is recent enough to support everything we need
+
+    if (!bdus_uring_features_are_supported_(params.features))
+    {
+        close(ring->fd);
+        free(ring);
+        errno = ENOSYS;
+        return NULL;
+    }
+
+    // map rings and register the control file description (fixed files are
+    // required by submission queue polling on older kernels)
+
+    if (!bdus_uring_map_(ring, &params))
+    {
+        const int previous_errno = errno;
+        close(ring->fd);
+        free(ring);
+        errno = previous_errno;
+        return NULL;
+    }
+
+    if (bdus_uring_register_files_(ring->fd, &control_fd, 1) != 0)
+    {
+        const int previous_errno = errno;
+        bdus_uring_destroy_(ring);
+        errno = previous_errno;
+        return NULL;
+    }
+
+    return ring;
+}
+
+void bdus_uring_destroy_(struct bdus_uring_ *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->rings, ring->rings_size);
+    close(ring->fd);
+    free(ring);
+}
+
+// Must only be called by the thread that owns the ring.
+static void bdus_uring_push_sqe_(
+    struct bdus_uring_ *ring, uint8_t opcode, uint8_t flags, void *buffer,
+    size_t size, uint64_t offset, uint32_t rw_flags, uint64_t user_data)
+{
+    const unsigned tail  = *ring->sq_tail;
+    const unsigned index = tail & *ring->sq_mask;
+
+    struct io_uring_sqe *const sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+
+    sqe->opcode    = opcode;
+    sqe->flags     = (uint8_t)(IOSQE_FIXED_FILE | flags);
+    sqe->fd        = 0; // index of the registered control file description
+    sqe->off       = offset;
+    sqe->addr      = (uint64_t)(uintptr_t)buffer;
+    sqe->len       = (uint32_t)size;
+    sqe->rw_flags  = rw_flags;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Submits the last `num_sqes` pushed submission queue entries and waits until
+// all of them complete, returning the index of the first of their completion
+// queue entries, which must then be consumed, or -1 and setting errno on
+// failure.
+static int64_t bdus_uring_submit_and_wait_(
+    struct bdus_uring_ *ring, unsigned num_sqes)
+{
+    // submit requests, waking up polling kernel thread if necessary
+
+    unsigned to_submit = num_sqes;
+
+    if (ring->sq_poll)
+    {
+        to_submit = 0;
+
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED)
+            & IORING_SQ_NEED_WAKEUP)
+        {
+            if (bdus_uring_enter_(ring->fd, 0, 0, IORING_ENTER_SQ_WAKEUP) < 0)
+                return -1;
+        }
+    }
+
+    // wait until all requests complete, either by busy-polling or by blocking
+
+    const unsigned head = *ring->cq_head;
+
+    while (__atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) - head < num_sqes)
+    {
+        if (ring->cq_poll && to_submit == 0)
+            continue;
+
+        const int ret = bdus_uring_enter_(
+            ring->fd, to_submit, ring->cq_poll ? 0 : num_sqes,
+            ring->cq_poll ? 0 : IORING_ENTER_GETEVENTS);
+
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        to_submit -= (unsigned)ret;
+    }
+
+    return (int64_t)head;
+}
+
+int bdus_uring_send_replies_and_receive_items_(
+    struct bdus_uring_ *ring, void *rais, size_t num_replies, size_t num_rais,
+    size_t queue_index)
+{
+    // enqueue write of replies linked to the subsequent non-blocking read of
+    // items, so that the latter only starts after the former completes (the
+    // control file description supports IOCB_NOWAIT, so both are attempted
+    // inline and never handed off to io_uring worker threads)
+
+    unsigned num_sqes = 0;
+
+    if (num_replies > 0)
+    {
+        bdus_uring_push_sqe_(
+            ring, IORING_OP_WRITE, IOSQE_IO_LINK, rais, 64 * num_replies, 0, 0,
+            0);
+
+        ++num_sqes;
+    }
+
+    while (true)
+    {
+        bdus_uring_push_sqe_(
+            ring, IORING_OP_READ, 0, rais, 64 * num_rais, (uint64_t)queue_index,
+            RWF_NOWAIT, 1);
+
+        ++num_sqes;
+
+        const int64_t head = bdus_uring_submit_and_wait_(ring, num_sqes);
+
+        if (head < 0)
+            return -1;
+
+        // consume completions
+
+        int result       = 0;
+        int result_err   = 0;
+        bool would_block = false;
+
+        for (unsigned i = 0; i < num_sqes; ++i)
+        {
+            const struct io_uring_cqe *const cqe =
+                &ring->cqes[((unsigned)head + i) & *ring->cq_mask];
+
+            if (cqe->user_data == 1 && cqe->res == -EAGAIN)
+            {
+                would_block = true;
+            }
+            else if (cqe->res < 0)
+            {
+                // keep the write's error, as the read is then canceled
+                if (result_err == 0)
+                    result_err = -cqe->res;
+            }
+            else if (cqe->user_data == 0)
+            {
+                if ((size_t)cqe->res != 64 * num_replies && result_err == 0)
+                    result_err = EIO;
+            }
+            else
+            {
+                result = cqe->res / 64;
+            }
+        }
+
+        __atomic_store_n(
+            ring->cq_head, (unsigned)head + num_sqes, __ATOMIC_RELEASE);
+
+        if (result_err != 0)
+        {
+            errno = result_err;
+            return -1;
+        }
+
+        if (!would_block)
+            return result;
+
+        // no items were available, so either let the caller block or, if
+        // busy-polling, try again (the replies were already sent)
+
+        if (!ring->cq_poll)
+            return 0;
+
+        num_sqes = 0;
+    }
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,270 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served when attribute
+# async_queue_depth is positive and their completion is deferred, both when
+# they are completed out of order from callback async_wait() and when they are
+# completed by another thread, and that several deferred requests are then
+# actually in progress at once.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <unistd.h>
+
+    #define QUEUE_DEPTH 8
+
+    struct pending_request
+    {
+        struct bdus_request *request;
+        char *buffer;
+        uint64_t offset;
+        uint32_t size;
+        bool is_read;
+    };
+
+    static char *data;
+
+    /* deferred requests not yet completed */
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    static pthread_cond_t cond   = PTHREAD_COND_INITIALIZER;
+    static struct pending_request pending[QUEUE_DEPTH];
+    static size_t num_pending;
+
+    /* the most requests that were pending at once */
+    static size_t max_pending;
+
+    /* whether requests are completed by the completer thread, which is only
+       created once requests arrive, as the driver daemonizes before that */
+    static bool use_completer;
+    static pthread_once_t completer_once = PTHREAD_ONCE_INIT;
+
+    static bool failed;
+
+    static void complete_pending(struct pending_request *p)
+    {
+        if (p->is_read)
+            memcpy(p->buffer, data + p->offset, (size_t)p->size);
+        else
+            memcpy(data + p->offset, p->buffer, (size_t)p->size);
+
+        if (!bdus_complete(p->request, 0))
+            failed = true;
+    }
+
+    /* Completes all pending requests, most recently received first. */
+    static void complete_all_pending(void)
+    {
+        pthread_mutex_lock(&mutex);
+
+        while (num_pending > 0)
+        {
+            struct pending_request p = pending[--num_pending];
+
+            pthread_mutex_unlock(&mutex);
+            complete_pending(&p);
+            pthread_mutex_lock(&mutex);
+        }
+
+        pthread_mutex_unlock(&mutex);
+    }
+
+    static void *run_completer(void *arg)
+    {
+        pthread_mutex_lock(&mutex);
+
+        while (true)
+        {
+            while (num_pending == 0)
+                pthread_cond_wait(&cond, &mutex);
+
+            /* let requests accumulate */
+
+            pthread_mutex_unlock(&mutex);
+            usleep(1000);
+            complete_all_pending();
+            pthread_mutex_lock(&mutex);
+        }
+
+        return NULL;
+    }
+
+    static void create_completer(void)
+    {
+        pthread_t completer;
+
+        if (pthread_create(&completer, NULL, run_completer, NULL) != 0)
+            failed = true;
+    }
+
+    static int defer(
+        char *buffer, uint64_t offset, uint32_t size, bool is_read
+        )
+    {
+        if (use_completer)
+            pthread_once(&completer_once, create_completer);
+
+        struct bdus_request *const request = bdus_defer();
+
+        if (!request)
+            return bdus_abort;
+
+        pthread_mutex_lock(&mutex);
+
+        if (num_pending == QUEUE_DEPTH)
+        {
+            failed = true;
+        }
+        else
+        {
+            pending[num_pending++] = (struct pending_request) {
+                .request = request,
+                .buffer  = buffer,
+                .offset  = offset,
+                .size    = size,
+                .is_read = is_read,
+            };
+
+            if (num_pending > max_pending)
+                max_pending = num_pending;
+        }
+
+        pthread_cond_signal(&cond);
+        pthread_mutex_unlock(&mutex);
+
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        return defer(buffer, offset, size, true);
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        return defer((char *)buffer, offset, size, false);
+    }
+
+    static int device_async_wait(int fd, struct bdus_ctx *ctx)
+    {
+        pthread_mutex_lock(&mutex);
+        const bool has_pending = num_pending > 0;
+        pthread_mutex_unlock(&mutex);
+
+        if (has_pending)
+        {
+            complete_all_pending();
+        }
+        else if (fd >= 0)
+        {
+            struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+            if (poll(&pfd, 1, -1) < 0)
+                return 1;
+        }
+
+        return 0;
+    }
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 3)
+            return 2;
+
+        use_completer = strcmp(argv[1], "completer") == 0;
+
+        const struct bdus_ops device_ops = {
+            .read       = device_read,
+            .write      = device_write,
+            .async_wait = use_completer ? NULL : device_async_wait,
+        };
+
+        const struct bdus_attrs device_attrs = {
+            .size               = 1 << 26,
+            .logical_block_size = 512,
+            .async_queue_depth  = QUEUE_DEPTH,
+        };
+
+        data = malloc((size_t)device_attrs.size);
+
+        if (!data || !bdus_run(&device_ops, &device_attrs, NULL))
+            return 1;
+
+        /* report results once the device is destroyed */
+
+        FILE *const report = fopen(argv[2], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(report, "%zu %d\n", max_pending, failed ? 1 : 0);
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+for mode in async_wait completer; do
+
+    # create device
+
+    device_path="$( "${driver_binary}" "${mode}" "${report_path}" )"
+    driver_pid="$( pgrep --full "${driver_binary}" )"
+
+    # write and verify data
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=64k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # destroy device and wait for the driver to terminate
+
+    bdus destroy "${device_path}"
+    tail --pid="${driver_pid}" -f /dev/null
+
+    # ensure that several requests were deferred at once and that every
+    # deferred request was successfully completed
+
+    read -r max_pending failed < "${report_path}"
+
+    (( max_pending > 1 && failed == 0 ))
+
+done
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,54 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served when attribute
+# busy_poll_us is positive, both when using ioctls and when using io_uring, and
+# that worker threads then actually receive requests while busy-waiting.
+
+# ---------------------------------------------------------------------------- #
+
+for use_io_uring in 0 1; do
+
+    # create device
+
+    device_path="$(
+        run_driver_ram busy_poll_us=1000 use_io_uring="${use_io_uring}"
+        )"
+    device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+
+    # skip test if debugfs is not mounted
+
+    stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+    [[ -e "${stats_path}" ]] || exit 0
+
+    # write and verify data (each request is submitted as soon as the previous
+    # one completes, and so usually while the driver is busy-waiting)
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+size=16m
+blocksize=4k
+ioengine=psync
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # ensure that busy-waiting found requests
+
+    hits="$( grep '^busy_poll hits ' "${stats_path}" | cut -d ' ' -f3 )"
+    (( hits > 0 ))
+
+    # destroy device
+
+    bdus destroy "${device_path}"
+
+done
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,161 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that, when attribute chunk_size is positive, read and write
+# requests larger than it are served by invoking the respective callback once
+# for each chunk, in order, and that their data is transferred correctly.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    #define REQUEST_SIZE (UINT64_C(1) << 18)
+
+    /*
+     * the largest amount of data given to a callback, and the number of times
+     * that a callback was given, not the start of a request, but the data that
+     * immediately follows the data last given to the same thread
+     */
+    static uint32_t max_size;
+    static unsigned long num_next_chunks;
+
+    static __thread uint64_t next_offset = UINT64_MAX;
+
+    static void record(uint64_t offset, uint32_t size)
+    {
+        uint32_t current = __atomic_load_n(&max_size, __ATOMIC_RELAXED);
+
+        while (size > current
+               && !__atomic_compare_exchange_n(
+                   &max_size, &current, size, false, __ATOMIC_RELAXED,
+                   __ATOMIC_RELAXED
+                   ))
+        {
+        }
+
+        if (offset % REQUEST_SIZE != 0 && offset == next_offset)
+            __atomic_add_fetch(&num_next_chunks, 1, __ATOMIC_RELAXED);
+
+        next_offset = offset + size;
+    }
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = malloc((size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        record(offset, size);
+        memcpy(buffer, (char *)ctx->private_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        record(offset, size);
+        memcpy((char *)ctx->private_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize = device_initialize,
+        .terminate  = device_terminate,
+        .read       = device_read,
+        .write      = device_write,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = 1 << 26,
+        .logical_block_size         = 512,
+        .max_read_write_size        = 1 << 20,
+        .max_concurrent_callbacks   = 2,
+        .chunk_size                 = 1 << 12,
+        .disable_partition_scanning = true,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 2 || !bdus_run(&device_ops, &device_attrs, NULL))
+            return 1;
+
+        /* report served chunks once the device is destroyed */
+
+        FILE *const report = fopen(argv[1], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(
+            report, "%lu %lu\n", (unsigned long)max_size, num_next_chunks
+            );
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+# create device
+
+device_path="$( "${driver_binary}" "${report_path}" )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# write and verify data with requests much larger than a chunk
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=256k
+ioengine=libaio
+iodepth=8
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+# destroy device and wait for the driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ensure that callbacks were given at most a chunk of data at once, and that the
+# chunks of each request were given one after the other
+
+read -r max_size num_next_chunks < "${report_path}"
+
+(( max_size == 4096 && num_next_chunks > 0 ))
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,217 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that discard requests are correctly served by callback
+# discard_ranges when attribute max_discard_ranges is greater than 1, and that
+# requests then actually target several regions. The latter are generated by
+# an XFS file system mounted with online discard, which discards the extents
+# freed by each log commit together.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _GNU_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <linux/fs.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+
+    /* only changed by the single worker thread */
+    static unsigned long num_requests;
+    static uint32_t max_num_ranges;
+    static unsigned long num_invalid;
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int fd = *(int *)ctx->private_data;
+
+        if (pread(fd, buffer, (size_t)size, (off_t)offset) != (ssize_t)size)
+            return errno ? errno : EIO;
+
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int fd = *(int *)ctx->private_data;
+
+        if (pwrite(fd, buffer, (size_t)size, (off_t)offset) != (ssize_t)size)
+            return errno ? errno : EIO;
+
+        return 0;
+    }
+
+    static int device_flush(struct bdus_ctx *ctx)
+    {
+        const int fd = *(int *)ctx->private_data;
+
+        return fdatasync(fd) == 0 ? 0 : errno;
+    }
+
+    static int device_discard_ranges(
+        const struct bdus_range *ranges, uint32_t num_ranges,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int fd = *(int *)ctx->private_data;
+        const uint32_t lbs = ctx->attrs->logical_block_size;
+
+        ++num_requests;
+
+        if (num_ranges > max_num_ranges)
+            max_num_ranges = num_ranges;
+
+        if (num_ranges == 0 || num_ranges > ctx->attrs->max_discard_ranges)
+            ++num_invalid;
+
+        uint64_t total_size = 0;
+
+        for (uint32_t i = 0; i < num_ranges; ++i)
+        {
+            if (ranges[i].size == 0 || ranges[i].offset % lbs != 0
+                || ranges[i].size % lbs != 0
+                || ranges[i].offset + ranges[i].size > ctx->attrs->size)
+            {
+                ++num_invalid;
+                continue;
+            }
+
+            total_size += ranges[i].size;
+
+            uint64_t range[2] = { ranges[i].offset, ranges[i].size };
+
+            if (ioctl(fd, BLKDISCARD, range) != 0)
+                return errno;
+        }
+
+        if (total_size > ctx->attrs->max_discard_erase_size)
+            ++num_invalid;
+
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .read           = device_read,
+        .write          = device_write,
+        .flush          = device_flush,
+        .discard_ranges = device_discard_ranges,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                     = 1 << 30,
+        .logical_block_size       = 512,
+        .max_concurrent_callbacks = 1,
+        .max_discard_erase_size   = 1 << 26,
+        .max_discard_ranges       = 64,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 3)
+            return 1;
+
+        int fd = open(argv[1], O_RDWR | O_DIRECT);
+
+        if (fd < 0 || !bdus_run(&device_ops, &device_attrs, &fd))
+            return 1;
+
+        close(fd);
+
+        /* report discard requests once the device is destroyed */
+
+        FILE *const report = fopen(argv[2], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(
+            report, "%lu %lu %lu\n", num_requests,
+            (unsigned long)max_num_ranges, num_invalid
+            );
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+data_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}" "${data_path}"; }' EXIT
+
+# create devices
+
+ram_device_path="$( run_driver_ram )"
+device_path="$( "${driver_binary}" "${ram_device_path}" "${report_path}" )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# create and mount file system with online discard
+
+mkfs.xfs "${device_path}"
+
+mntp="$( mktemp -d )"
+trap '{ rmdir "${mntp}"; rm -f "${driver_binary}" "${report_path}" \
+    "${data_path}"; }' EXIT
+
+mount -o discard "${device_path}" "${mntp}"
+trap '{ umount "${mntp}"; rmdir "${mntp}"; rm -f "${driver_binary}" \
+    "${report_path}" "${data_path}"; }' EXIT
+
+# write files, then delete every other one so that freed extents are not
+# contiguous (sync makes the deletions be committed, and thus discarded)
+
+head -c 262144 /dev/urandom > "${data_path}"
+
+for (( i = 0; i < 64; ++i )); do
+    cp "${data_path}" "${mntp}/${i}"
+done
+
+sync
+
+for (( i = 0; i < 64; i += 2 )); do
+    rm "${mntp}/${i}"
+done
+
+sync
+
+# ensure that the remaining files are intact after remounting
+
+umount "${mntp}"
+mount -o discard "${device_path}" "${mntp}"
+
+for (( i = 1; i < 64; i += 2 )); do
+    cmp "${data_path}" "${mntp}/${i}"
+done
+
+# unmount file system
+
+umount "${mntp}"
+trap '{ rmdir "${mntp}"; rm -f "${driver_binary}" "${report_path}" \
+    "${data_path}"; }' EXIT
+
+# destroy device and wait for the driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ensure that all discard requests were valid and that some of them targeted
+# several regions
+
+read -r num_requests max_num_ranges num_invalid < "${report_path}"
+
+(( num_requests > 0 && max_num_ranges > 1 && num_invalid == 0 ))
+
+# ---------------------------------------------------------------------------- #
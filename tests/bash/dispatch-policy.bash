@@ -0,0 +1,226 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served under every value of
+# attribute dispatch_policy, and that requests which await being received by
+# the driver are then received in the order given by that policy.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <unistd.h>
+
+    #define MIB (UINT64_C(1) << 20)
+
+    /*
+     * the requests to offsets 1 to 4 MiB received after the worker thread was
+     * first held up, in the order they were received
+     */
+    static int held_up;
+    static char received[4][3];
+    static int num_received;
+
+    static void record(const char *type, uint64_t offset, uint32_t size)
+    {
+        if (held_up && size == 4096 && offset % MIB == 0 && offset >= MIB
+            && offset <= 4 * MIB && num_received < 4)
+        {
+            snprintf(
+                received[num_received], sizeof(received[num_received]),
+                "%s%d", type, (int)(offset / MIB)
+                );
+
+            ++num_received;
+        }
+    }
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = calloc(1, (size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        record("r", offset, size);
+
+        memcpy(buffer, (char *)ctx->private_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        /* hold up the worker thread so that other requests pile up */
+
+        if (offset == 0 && size == 4096)
+        {
+            held_up = 1;
+            usleep(350000);
+        }
+
+        record("w", offset, size);
+
+        memcpy((char *)ctx->private_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize = device_initialize,
+        .terminate  = device_terminate,
+        .read       = device_read,
+        .write      = device_write,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 3)
+            return 1;
+
+        /* a single worker thread receives requests from a single queue */
+
+        const struct bdus_attrs device_attrs = {
+            .size                       = 1 << 26,
+            .logical_block_size         = 512,
+            .max_concurrent_callbacks   = 1,
+            .num_queues                 = 1,
+            .disable_partition_scanning = true,
+            .dispatch_policy            = (enum bdus_dispatch_policy)atoi(
+                argv[2]
+                ),
+        };
+
+        if (!bdus_run(&device_ops, &device_attrs, NULL))
+            return 1;
+
+        /* report received requests once the device is destroyed */
+
+        FILE *const report = fopen(argv[1], "w");
+
+        if (!report)
+            return 1;
+
+        for (int i = 0; i < num_received; ++i)
+            fprintf(report, "%s%s", i > 0 ? " " : "", received[i]);
+
+        fprintf(report, "\n");
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+# the requests submitted while the driver is held up, in submission order, as
+# "<type><offset in MiB>:<ionice arguments>", where the I/O priorities make
+# the order differ under each policy
+
+requests=( w1:-c3 r2:-c2,-n7 w3:-c1,-n0 r4:-c2,-n0 )
+
+# the order in which the driver should receive those requests under each policy
+# (fifo, reads_first, and priority)
+
+expected_orders=( "w1 r2 w3 r4" "r2 r4 w1 w3" "w3 r4 r2 w1" )
+
+for policy in 0 1 2; do
+
+    # skip checking the priority policy if the kernel doesn't propagate the
+    # submitting thread's I/O priority to direct I/O requests
+
+    (( policy < 2 )) || kernel_is_at_least 5.0 || continue
+
+    # create device
+
+    device_path="$( "${driver_binary}" "${report_path}" "${policy}" )"
+    driver_pid="$( pgrep --full "${driver_binary}" )"
+
+    # write and verify data, away from the regions used below
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+offset=32m
+size=16m
+blocksize=4k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # hold up the driver's worker thread and submit requests in the meantime
+    # (the worker is held up for much less than the time after which requests
+    # are received regardless of the dispatch policy)
+
+    pids=()
+
+    dd if=/dev/zero of="${device_path}" bs=4096 count=1 oflag=direct &
+    pids+=( "$!" )
+
+    sleep 0.05
+
+    for request in "${requests[@]}"; do
+
+        type="${request:0:1}"
+        offset="${request:1:1}"
+        IFS=, read -r -a ionice_args <<< "${request#*:}"
+
+        if [[ "${type}" = r ]]; then
+            ionice "${ionice_args[@]}" dd if="${device_path}" of=/dev/null \
+                bs=4096 count=1 skip=$(( offset * 256 )) iflag=direct &
+        else
+            ionice "${ionice_args[@]}" dd if=/dev/zero of="${device_path}" \
+                bs=4096 count=1 seek=$(( offset * 256 )) oflag=direct &
+        fi
+
+        pids+=( "$!" )
+
+        sleep 0.03
+
+    done
+
+    for pid in "${pids[@]}"; do
+        wait "${pid}"
+    done
+
+    # destroy device and wait for the driver to terminate
+
+    bdus destroy "${device_path}"
+    tail --pid="${driver_pid}" -f /dev/null
+
+    # ensure that the driver received requests in the expected order
+
+    [[ "$( cat "${report_path}" )" = "${expected_orders[policy]}" ]]
+
+done
+
+# ---------------------------------------------------------------------------- #
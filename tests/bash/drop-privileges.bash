@@ -2,7 +2,8 @@
 # ---------------------------------------------------------------------------- #
 
 # This test ensures that a driver continues to function after dropping superuser
-# privileges in its initialize() callback.
+# privileges in its initialize() callback, including marking regions of the
+# device as containing only zeros and invalidating its read cache.
 
 # ---------------------------------------------------------------------------- #
 
@@ -42,14 +43,33 @@ driver='
         return 0;
     }
 
+    static int device_on_device_available(struct bdus_ctx *ctx)
+    {
+        // the second half of the device contains only zeros
+
+        const uint64_t half = ctx->attrs->size / 2;
+
+        if (!bdus_set_zero_range(ctx, half, half, true)
+            || !bdus_invalidate_read_cache(ctx, 0, ctx->attrs->size))
+        {
+            return 1;
+        }
+
+        printf("%s\n", ctx->path);
+        return fflush(stdout) == 0 ? 0 : 1;
+    }
+
     static const struct bdus_ops device_ops = {
-        .initialize = device_initialize,
-        .read       = device_read,
+        .initialize          = device_initialize,
+        .read                = device_read,
+        .on_device_available = device_on_device_available,
     };
 
     static const struct bdus_attrs device_attrs = {
         .size               = 1 << 30,
         .logical_block_size = 512,
+        .zero_extent_size   = 1 << 12,
+        .read_cache_size    = 1 << 20,
     };
 
     int main(void)
@@ -0,0 +1,63 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served regardless of whether
+# worker threads use the fast path for *read* and *write* requests, which they
+# do unless requests are traced, and of whether requests are chunked, which
+# makes the fast path defer to the generic one. It also ensures that requests
+# are recorded in the trace when tracing is enabled.
+
+# ---------------------------------------------------------------------------- #
+
+# compile driver
+
+driver_binary="$( compile_driver_ram )"
+trap '{ rm -f "${driver_binary}"; }' EXIT
+
+for arg in trace_size=0 chunk_size=16384 trace_size=65536; do
+
+    # create device
+
+    device_path="$(
+        "${driver_binary}" max_read_write_size=131072 "${arg}"
+        )"
+    driver_pid="$( pgrep --full "${driver_binary}" )"
+
+    # write and verify data, with requests of several sizes
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+bsrange=512-128k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # ensure that reads and writes were traced, if tracing is enabled
+
+    if [[ "${arg}" == trace_size=65536 ]]; then
+        for type in read write; do
+            num_entries="$(
+                { bdus trace "${device_path}" |
+                    grep -E "^ *[0-9.]+ +[0-9]+ ${type} " || true; } | wc -l
+                )"
+            (( num_entries > 0 ))
+        done
+    fi
+
+    # destroy device
+
+    bdus destroy "${device_path}"
+    tail --pid="${driver_pid}" -f /dev/null
+
+done
+
+# ---------------------------------------------------------------------------- #
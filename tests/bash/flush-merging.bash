@@ -0,0 +1,103 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that *flush* requests submitted concurrently through
+# different hardware queues, while no *write* request completes, are merged into
+# each other instead of all reaching the driver.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <string.h>
+    #include <unistd.h>
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memset(buffer, 0, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        return 0;
+    }
+
+    static int device_flush(struct bdus_ctx *ctx)
+    {
+        usleep(100000);
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .read  = device_read,
+        .write = device_write,
+        .flush = device_flush,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                     = 1 << 30,
+        .logical_block_size       = 512,
+        .max_concurrent_callbacks = 16,
+        .num_queues               = 16,
+    };
+
+    int main(void)
+    {
+        return bdus_run(&device_ops, &device_attrs, NULL) ? 0 : 1;
+    }
+    '
+
+# skip test if there aren't several CPUs, and thus hardware queues
+
+num_cpus="$( nproc )"
+(( num_cpus >= 2 )) || exit 0
+
+# create device
+
+device_path="$( run_c driver )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+
+# skip test if debugfs is not mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+[[ -e "${stats_path}" ]] || exit 0
+
+# submit flush requests from every CPU at once (each fsync() on the device
+# submits one)
+
+pids=()
+
+for (( cpu = 0; cpu < num_cpus; ++cpu )); do
+    (
+        set +o xtrace  # too verbose
+
+        for (( i = 0; i < 20; ++i )); do
+            taskset --cpu-list "${cpu}" sync "${device_path}"
+        done
+    ) &
+    pids+=( "$!" )
+done
+
+for pid in "${pids[@]}"; do
+    wait "${pid}"
+done
+
+# ensure that flush requests were merged
+
+merges="$( grep '^flush merges ' "${stats_path}" | cut -d ' ' -f3 )"
+(( merges > 0 ))
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,164 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that a driver run with attribute allow_handoff can be taken
+# over by another driver with bdus_take_over() while clients keep using the
+# device, that the previous driver's bdus_run() then returns successfully, and
+# that the new driver then serves subsequent requests.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _GNU_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <unistd.h>
+
+    static unsigned long num_served;
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int fd = *(int *)ctx->private_data;
+
+        __atomic_add_fetch(&num_served, 1, __ATOMIC_RELAXED);
+
+        if (pread(fd, buffer, (size_t)size, (off_t)offset) != (ssize_t)size)
+            return errno ? errno : EIO;
+
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int fd = *(int *)ctx->private_data;
+
+        __atomic_add_fetch(&num_served, 1, __ATOMIC_RELAXED);
+
+        if (pwrite(fd, buffer, (size_t)size, (off_t)offset) != (ssize_t)size)
+            return errno ? errno : EIO;
+
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .read  = device_read,
+        .write = device_write,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = 1 << 30,
+        .logical_block_size         = 512,
+        .max_concurrent_callbacks   = 4,
+        .allow_handoff              = true,
+        .disable_partition_scanning = true,
+    };
+
+    /* usage: driver <underlying_dev> <report_path> [<dev_path>] */
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 3 && argc != 4)
+            return 2;
+
+        int fd = open(argv[1], O_RDWR | O_DIRECT);
+
+        if (fd < 0)
+            return 1;
+
+        uint64_t dev_id;
+
+        const int success = argc == 3
+            ? bdus_run(&device_ops, &device_attrs, &fd)
+            : bdus_get_dev_id_from_path(&dev_id, argv[3])
+                && bdus_take_over(dev_id, &device_ops, &device_attrs, &fd);
+
+        close(fd);
+
+        if (!success)
+            return 1;
+
+        /* report served requests once the driver stops serving them */
+
+        FILE *const report = fopen(argv[2], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(report, "%lu\n", num_served);
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_paths=( "$( mktemp )" "$( mktemp )" )
+trap '{ rm -f "${driver_binary}" "${report_paths[@]}"; }' EXIT
+
+# create devices
+
+ram_device_path="$( run_driver_ram )"
+
+device_path="$(
+    "${driver_binary}" "${ram_device_path}" "${report_paths[0]}"
+    )"
+driver_pids=( "$( pgrep --full "${driver_binary}" )" )
+
+# write and verify data while the device is taken over
+
+fio - <<EOF &
+[global]
+filename=${device_path}
+size=256m
+blocksize=4k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+fio_pid="$!"
+
+sleep 1
+
+"${driver_binary}" "${ram_device_path}" "${report_paths[1]}" "${device_path}"
+driver_pids+=( "$( pgrep --full "${driver_binary}.*${report_paths[1]}" )" )
+
+# ensure that the original driver terminates
+
+tail --pid="${driver_pids[0]}" -f /dev/null
+
+# ensure that fio succeeds
+
+wait "${fio_pid}"
+
+# destroy device and wait for the new driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pids[1]}" -f /dev/null
+
+# ensure that both drivers served requests (the reports are only written if
+# bdus_run() and bdus_take_over() returned true)
+
+read -r num_served_original < "${report_paths[0]}"
+read -r num_served_new < "${report_paths[1]}"
+
+(( num_served_original > 0 && num_served_new > 0 ))
+
+# ---------------------------------------------------------------------------- #
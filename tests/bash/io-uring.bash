@@ -0,0 +1,71 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served when attribute
+# use_io_uring is set, both with and without attribute io_uring_polling, and
+# that the driver then actually receives them through io_uring, without any
+# io_uring worker threads.
+
+# ---------------------------------------------------------------------------- #
+
+# skip test if libbdus can't use io_uring on this kernel
+
+kernel_is_at_least 5.6 || exit 0
+
+# compile driver
+
+driver_binary="$( compile_driver_ram )"
+trap '{ rm -f "${driver_binary}"; }' EXIT
+
+for polling in 0 1; do
+
+    # create device
+
+    device_path="$(
+        "${driver_binary}" use_io_uring=1 io_uring_polling="${polling}"
+        )"
+    driver_pid="$( pgrep --full "${driver_binary}" )"
+
+    # write and verify data
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=4k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # ensure that the driver set up io_uring instances
+
+    find "/proc/${driver_pid}/fd" -type l -printf '%l\n' |
+        grep -F 'anon_inode:[io_uring]' > /dev/null
+
+    # ensure that no io_uring worker threads were created, i.e., that reads from
+    # the control device did not block (io_uring worker threads only became
+    # threads of the process in Linux 5.12)
+
+    if kernel_is_at_least 5.12; then
+        num_workers="$(
+            { grep -h '^iou-wrk' /proc/"${driver_pid}"/task/*/comm || true; } |
+                wc -l
+            )"
+        (( num_workers == 0 ))
+    fi
+
+    # destroy device
+
+    bdus destroy "${device_path}"
+    tail --pid="${driver_pid}" -f /dev/null
+
+done
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,256 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that bdus_run_loopback() serves the configured number of
+# generated requests of the configured types and sizes with the driver's
+# callbacks, without creating a device or requiring privileges, that the
+# statistics it reports match the callbacks that were invoked, and that a given
+# seed always generates the same requests.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _GNU_SOURCE
+
+    #include <bdus.h>
+
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    #define DEVICE_SIZE (1 << 22)
+    #define MIN_REQUEST_SIZE (1 << 9)
+    #define MAX_REQUEST_SIZE (1 << 16)
+
+    enum { TYPE_READ, TYPE_WRITE, TYPE_FLUSH, TYPE_DISCARD, NUM_TYPES };
+
+    static const char *const type_names[NUM_TYPES] = {
+        "read", "write", "flush", "discard"
+    };
+
+    static char device_data[DEVICE_SIZE];
+
+    /* the number of requests served by each callback, the number of invalid
+     * requests, and a hash of the sequence of served requests */
+    static uint64_t served[NUM_TYPES];
+    static uint64_t num_invalid;
+    static uint64_t digest = UINT64_C(14695981039346656037);
+
+    static void record(
+        struct bdus_ctx *ctx, int type, uint64_t offset, uint32_t size
+        )
+    {
+        __atomic_add_fetch(&served[type], 1, __ATOMIC_RELAXED);
+
+        if (type != TYPE_FLUSH
+            && (size < MIN_REQUEST_SIZE || size > MAX_REQUEST_SIZE
+                || size % MIN_REQUEST_SIZE != 0
+                || offset % MIN_REQUEST_SIZE != 0
+                || offset + size > DEVICE_SIZE))
+        {
+            __atomic_add_fetch(&num_invalid, 1, __ATOMIC_RELAXED);
+        }
+
+        if (strcmp(ctx->path, "loopback") != 0)
+            __atomic_add_fetch(&num_invalid, 1, __ATOMIC_RELAXED);
+
+        const uint64_t value = (uint64_t)type << 62 ^ offset << 16 ^ size;
+        uint64_t current = __atomic_load_n(&digest, __ATOMIC_RELAXED);
+
+        while (!__atomic_compare_exchange_n(
+            &digest, &current, (current ^ value) * UINT64_C(1099511628211),
+            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+            ))
+        {
+        }
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        record(ctx, TYPE_READ, offset, size);
+        memcpy(buffer, device_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        record(ctx, TYPE_WRITE, offset, size);
+        memcpy(device_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static int device_flush(struct bdus_ctx *ctx)
+    {
+        record(ctx, TYPE_FLUSH, 0, 0);
+        return 0;
+    }
+
+    static int device_discard(
+        uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        record(ctx, TYPE_DISCARD, offset, size);
+
+        /* fail some requests, which must be reported as errors */
+        return (offset / MIN_REQUEST_SIZE) % 2 == 0 ? 0 : 5;
+    }
+
+    static int device_on_device_available(struct bdus_ctx *ctx)
+    {
+        __atomic_add_fetch(&num_invalid, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .read                = device_read,
+        .write               = device_write,
+        .flush               = device_flush,
+        .discard             = device_discard,
+        .on_device_available = device_on_device_available,
+    };
+
+    static const struct bdus_request_stats *find_stats(
+        const struct bdus_loopback_results *results, const char *type
+        )
+    {
+        for (size_t i = 0; i < BDUS_STATS_NUM_REQ_TYPES; ++i)
+        {
+            if (strcmp(results->types[i].type, type) == 0)
+                return &results->types[i];
+        }
+
+        return NULL;
+    }
+
+    static void print_stats(
+        const char *name, uint64_t num_served,
+        const struct bdus_loopback_results *results
+        )
+    {
+        const struct bdus_request_stats *const stats =
+            find_stats(results, name);
+
+        uint64_t hist_total = 0;
+
+        for (size_t i = 0; i < BDUS_STATS_HIST_BUCKETS; ++i)
+            hist_total += stats ? stats->service_hist[i] : 0;
+
+        printf(
+            "%s %llu %llu %llu %llu\n", name, (unsigned long long)num_served,
+            stats ? (unsigned long long)stats->requests : 0,
+            stats ? (unsigned long long)stats->errors : 0,
+            (unsigned long long)hist_total
+            );
+    }
+
+    /* usage: driver <seed> <max_concurrent_callbacks> [write_zeros] */
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 3 && argc != 4)
+            return 2;
+
+        const struct bdus_attrs device_attrs = {
+            .size                     = DEVICE_SIZE,
+            .logical_block_size       = 512,
+            .max_concurrent_callbacks = (uint32_t)strtoul(argv[2], NULL, 10),
+        };
+
+        /* the driver does not support write zeros requests */
+
+        const struct bdus_loopback_attrs loopback_attrs = {
+            .read_weight        = 4,
+            .write_weight       = 2,
+            .flush_weight       = 1,
+            .discard_weight     = 1,
+            .write_zeros_weight = argc == 4 ? 1 : 0,
+            .min_request_size   = MIN_REQUEST_SIZE,
+            .max_request_size   = MAX_REQUEST_SIZE,
+            .queue_depth        = 32,
+            .num_requests       = 1 << 14,
+            .seed               = strtoull(argv[1], NULL, 10),
+        };
+
+        struct bdus_loopback_results results;
+
+        if (!bdus_run_loopback(
+            &device_ops, &device_attrs, NULL, &loopback_attrs, &results
+            ))
+        {
+            return 1;
+        }
+
+        for (int i = 0; i < NUM_TYPES; ++i)
+            print_stats(type_names[i], served[i], &results);
+
+        print_stats("fua_write", 0, &results);
+
+        printf(
+            "invalid %llu\ndigest %llx\n", (unsigned long long)num_invalid,
+            (unsigned long long)digest
+            );
+
+        return 0;
+    }
+    '
+
+# compile driver (and let any user run it)
+
+driver_binary="$( compile_c driver )"
+results_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${results_path}"; }' EXIT
+
+chmod a+rx "${driver_binary}"
+
+# run driver without privileges and with several worker threads
+
+setpriv --reuid=65534 --regid=65534 --clear-groups \
+    "${driver_binary}" 42 4 > "${results_path}"
+
+# ensure that the requested number of valid requests of the configured types
+# was served, that statistics match the callbacks that were invoked, that only
+# failed requests were counted as errors, and that other types were unused
+# (fields are TYPE SERVED REQUESTS ERRORS HISTOGRAM_TOTAL)
+
+awk '
+    $1 == "invalid" { invalid = $2 }
+    NF == 5 && $1 != "fua_write" {
+        total += $2
+        if ($2 == 0 || $3 != $2 || $5 != $2) bad = 1
+        if (($1 == "discard") != ($4 > 0)) bad = 1
+    }
+    $1 == "fua_write" && $3 != 0 { bad = 1 }
+    END { exit bad || invalid != 0 || total != 16384 }
+    ' "${results_path}"
+
+# ensure that the same seed generates the same sequence of requests, and that
+# another seed does not, when requests are served one at a time
+
+function digest()
+{
+    "${driver_binary}" "$1" 1 | awk '$1 == "digest" { print $2 }'
+}
+
+digest_42="$( digest 42 )"
+
+[[ -n "${digest_42}" ]]
+[[ "$( digest 42 )" == "${digest_42}" ]]
+[[ "$( digest 43 )" != "${digest_42}" ]]
+
+# ensure that weights of types that the driver doesn't support are rejected
+
+if "${driver_binary}" 42 4 write_zeros; then
+    exit 1
+fi
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,81 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that the number of hardware queues that sysfs reports for
+# devices is within the documented bounds of attribute num_queues, that there
+# is one per online CPU (up to max_concurrent_callbacks) by default, and that
+# requests submitted from every CPU, and thus through every hardware queue, are
+# correctly served.
+
+# ---------------------------------------------------------------------------- #
+
+# compile driver
+
+driver_binary="$( compile_driver_ram )"
+trap '{ rm -f "${driver_binary}"; }' EXIT
+
+num_cpus="$( nproc )"
+num_online_cpus="$( getconf _NPROCESSORS_ONLN )"
+cpu_list="$( taskset --cpu-list --pid "$$" | cut -d ':' -f2 | tr -d ' ' )"
+
+# each CPU gets its own region of the 1 GiB device, of at most 64 MiB
+
+job_size_mib=$(( num_cpus <= 16 ? 64 : 1024 / num_cpus ))
+
+for num_queues in 0 1 2 4 4294967295; do
+
+    # create device
+
+    device_path="$(
+        "${driver_binary}" max_concurrent_callbacks=4 num_queues="${num_queues}"
+        )"
+    driver_pid="$( pgrep --full "${driver_binary}" )"
+
+    # ensure that the device has at least one hardware queue and no more than
+    # requested, than max_concurrent_callbacks, or than there are CPUs
+
+    actual_num_queues="$(
+        find "/sys/block/$( basename "${device_path}" )/mq" \
+            -mindepth 1 -maxdepth 1 -type d | wc -l
+        )"
+
+    (( actual_num_queues >= 1 ))
+    (( actual_num_queues <= 4 && actual_num_queues <= num_cpus ))
+    (( num_queues == 0 || actual_num_queues <= num_queues ))
+
+    # ensure that by default there is a hardware queue per online CPU, up to
+    # max_concurrent_callbacks
+
+    (( num_queues != 0
+        || actual_num_queues == ( num_online_cpus < 4 ? num_online_cpus : 4 ) ))
+
+    # write and verify data from every CPU
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+size=${job_size_mib}m
+blocksize=4k
+ioengine=libaio
+iodepth=4
+direct=1
+numjobs=${num_cpus}
+cpus_allowed=${cpu_list}
+cpus_allowed_policy=split
+offset_increment=${job_size_mib}m
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # destroy device
+
+    bdus destroy "${device_path}"
+    tail --pid="${driver_pid}" -f /dev/null
+
+done
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,192 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that callbacks allocate_payload_buffer() and
+# free_payload_buffer() are invoked for the same regions, and that the buffers
+# given to read and write callbacks lie in the allocated regions.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <sys/mman.h>
+
+    #define MAX_REGIONS 64
+
+    /* only changed before and after requests are served */
+    static char *regions[MAX_REGIONS];
+    static size_t region_sizes[MAX_REGIONS];
+    static size_t num_allocated;
+    static size_t num_freed;
+
+    static bool in_regions(const char *buffer, size_t size)
+    {
+        for (size_t i = 0; i < num_allocated; ++i)
+        {
+            if (buffer >= regions[i]
+                && buffer + size <= regions[i] + region_sizes[i])
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = malloc((size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        if (!in_regions(buffer, (size_t)size))
+            return EIO;
+
+        memcpy(buffer, (char *)ctx->private_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        if (!in_regions(buffer, (size_t)size))
+            return EIO;
+
+        memcpy((char *)ctx->private_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static void *device_allocate_payload_buffer(
+        size_t size, struct bdus_ctx *ctx
+        )
+    {
+        if (num_allocated == MAX_REGIONS)
+        {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        void *const region = mmap(
+            NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+            -1, 0
+            );
+
+        if (region == MAP_FAILED)
+            return NULL;
+
+        regions[num_allocated]      = region;
+        region_sizes[num_allocated] = size;
+
+        ++num_allocated;
+
+        return region;
+    }
+
+    static void device_free_payload_buffer(
+        void *buffer, size_t size, struct bdus_ctx *ctx
+        )
+    {
+        if (in_regions(buffer, size))
+            ++num_freed;
+
+        munmap(buffer, size);
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize              = device_initialize,
+        .terminate               = device_terminate,
+        .read                    = device_read,
+        .write                   = device_write,
+        .allocate_payload_buffer = device_allocate_payload_buffer,
+        .free_payload_buffer     = device_free_payload_buffer,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                     = 1 << 26,
+        .logical_block_size       = 512,
+        .max_concurrent_callbacks = 4,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 2 || !bdus_run(&device_ops, &device_attrs, NULL))
+            return 1;
+
+        /* report allocated and freed regions once the device is destroyed */
+
+        FILE *const report = fopen(argv[1], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(report, "%zu %zu\n", num_allocated, num_freed);
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+# create device
+
+device_path="$( "${driver_binary}" "${report_path}" )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# write and verify data (the driver fails requests whose buffers lie outside
+# the regions it allocated)
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=64k
+ioengine=libaio
+iodepth=8
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+# destroy device and wait for the driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ensure that regions were allocated and all of them were freed
+
+read -r num_allocated num_freed < "${report_path}"
+
+(( num_allocated > 0 && num_freed == num_allocated ))
+
+# ---------------------------------------------------------------------------- #
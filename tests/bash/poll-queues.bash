@@ -0,0 +1,53 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served when attribute
+# num_poll_queues is positive, both for polled and non-polled requests, and
+# that polled requests are actually completed through the poll queues.
+
+# ---------------------------------------------------------------------------- #
+
+# skip test if kbdus doesn't support poll queues on this kernel
+
+kernel_is_at_least 5.0 || exit 0
+
+# create device (at least one hardware queue must serve non-polled requests)
+
+device_path="$( run_driver_ram num_queues=2 num_poll_queues=1 )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+
+# skip test if debugfs is not mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+[[ -e "${stats_path}" ]] || exit 0
+
+# write and verify data with non-polled and polled requests (O_DIRECT is
+# required for RWF_HIPRI to have an effect)
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=64k
+ioengine=pvsync2
+direct=1
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+
+[non-polled]
+hipri=0
+
+[polled]
+stonewall
+hipri=1
+EOF
+
+# ensure that requests were completed through the poll queues
+
+polled="$( grep '^poll_queues requests ' "${stats_path}" | cut -d ' ' -f3 )"
+(( polled > 0 ))
+
+# ---------------------------------------------------------------------------- #
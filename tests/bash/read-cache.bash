@@ -0,0 +1,253 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that, when attribute read_cache_size is positive, repeated
+# reads of the same region are served without invoking the driver, that the
+# cache is kept coherent with writes and bdus_invalidate_read_cache(), and
+# that writes to one region of the device don't prevent concurrent reads of
+# another region from being cached and then served from the cache.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <sys/ioctl.h>
+
+    /*
+     * data is stored XORed with a mask, which the ioctl callback flips so that
+     * the data changes without the kernel knowing, unless the command asks for
+     * the changed region to be invalidated
+     */
+    static unsigned char mask;
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = calloc(1, (size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const unsigned char *const data =
+            (unsigned char *)ctx->private_data + offset;
+
+        for (size_t i = 0; i < (size_t)size; ++i)
+            buffer[i] = (char)(data[i] ^ mask);
+
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        unsigned char *const data =
+            (unsigned char *)ctx->private_data + offset;
+
+        for (size_t i = 0; i < (size_t)size; ++i)
+            data[i] = (unsigned char)buffer[i] ^ mask;
+
+        return 0;
+    }
+
+    static int device_ioctl(
+        uint32_t command, void *argument, struct bdus_ctx *ctx)
+    {
+        if (_IOC_NR(command) == 1)
+        {
+            return bdus_invalidate_read_cache(
+                ctx, UINT64_C(32) << 20, UINT64_C(64) << 10
+                ) ? 0 : 5;
+        }
+
+        mask ^= 0xff;
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize = device_initialize,
+        .terminate  = device_terminate,
+        .read       = device_read,
+        .write      = device_write,
+        .ioctl      = device_ioctl,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = 1 << 26,
+        .logical_block_size         = 512,
+        .max_concurrent_callbacks   = 1,
+        .read_cache_size            = 1 << 20,
+        .disable_partition_scanning = true,
+    };
+
+    int main(void)
+    {
+        return bdus_run(&device_ops, &device_attrs, NULL) ? 0 : 1;
+    }
+    '
+
+client='
+    #include <fcntl.h>
+    #include <string.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+
+    /* usage: client <dev_path> change | invalidate */
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 3)
+            return 2;
+
+        const unsigned long command = strcmp(argv[2], "invalidate") == 0
+            ? _IO(42, 1)
+            : _IO(42, 0);
+
+        const int fd = open(argv[1], O_RDONLY);
+
+        if (fd < 0 || ioctl(fd, command) != 0)
+            return 1;
+
+        return close(fd) == 0 ? 0 : 1;
+    }
+    '
+
+function read_region()
+{
+    dd if="$1" bs=64k count=1 skip=512 iflag=direct status=none | md5sum
+}
+
+# compile client and create device
+
+client_binary="$( compile_c client )"
+data_path="$( mktemp )"
+trap '{ rm -f "${client_binary}" "${data_path}"; }' EXIT
+
+device_path="$( run_c driver )"
+
+# ensure that a region that was read is then served from the cache, even after
+# its data changes behind the kernel's back
+
+empty_sum="$( read_region "${device_path}" )"
+
+"${client_binary}" "${device_path}" change
+
+[[ "$( read_region "${device_path}" )" = "${empty_sum}" ]]
+
+# ensure that the changed data is read after the driver invalidates the region
+
+"${client_binary}" "${device_path}" invalidate
+
+changed_sum="$( read_region "${device_path}" )"
+[[ "${changed_sum}" != "${empty_sum}" ]]
+
+# ensure that written data is read back
+
+head -c 65536 /dev/urandom > "${data_path}"
+dd if="${data_path}" of="${device_path}" bs=64k seek=512 oflag=direct \
+    status=none
+
+[[ "$( read_region "${device_path}" )" = "$( md5sum < "${data_path}" )" ]]
+
+bdus destroy "${device_path}"
+
+# compile RAM driver
+
+driver_binary="$( compile_driver_ram )"
+trap '{ rm -f "${client_binary}" "${data_path}" "${driver_binary}"; }' EXIT
+
+# create device
+
+device_path="$( "${driver_binary}" read_cache_size=4194304 )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# write and verify data
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=4k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+# skip the rest of the test if debugfs is not mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+if [[ -e "${stats_path}" ]]; then
+
+    function get_stat()
+    {
+        grep "^read_cache $1 " "${stats_path}" | cut -d ' ' -f3
+    }
+
+    hits_before="$( get_stat hits )"
+    misses_before="$( get_stat misses )"
+
+    # repeatedly read a 1 MiB region, which fits in the cache, while other
+    # requests keep writing to a disjoint region
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+blocksize=4k
+ioengine=libaio
+iodepth=16
+direct=1
+time_based=1
+runtime=5
+
+[write]
+readwrite=randwrite
+offset=0
+size=32m
+
+[read]
+readwrite=randread
+offset=48m
+size=1m
+EOF
+
+    # ensure that most reads were served from the cache
+
+    hits=$(( $( get_stat hits ) - hits_before ))
+    misses=$(( $( get_stat misses ) - misses_before ))
+
+    (( hits > misses ))
+
+fi
+
+# destroy device
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,117 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests to several devices are correctly served when
+# their drivers are run with bdus_run_many(), and that all devices are then
+# served by the given number of threads.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stdint.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    #define NUM_DEVICES 4
+    #define NUM_THREADS 2
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = malloc((size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memcpy(buffer, (char *)ctx->private_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memcpy((char *)ctx->private_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize = device_initialize,
+        .terminate  = device_terminate,
+        .read       = device_read,
+        .write      = device_write,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = 1 << 26,
+        .logical_block_size         = 512,
+        .disable_partition_scanning = true,
+    };
+
+    int main(void)
+    {
+        struct bdus_driver drivers[NUM_DEVICES];
+
+        for (size_t i = 0; i < NUM_DEVICES; ++i)
+        {
+            drivers[i].ops          = &device_ops;
+            drivers[i].attrs        = &device_attrs;
+            drivers[i].private_data = NULL;
+        }
+
+        return bdus_run_many(drivers, NUM_DEVICES, NUM_THREADS) ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+trap '{ rm -f "${driver_binary}"; }' EXIT
+
+# create devices
+
+mapfile -t device_paths < <( "${driver_binary}" )
+(( ${#device_paths[@]} == 4 ))
+
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# write and verify data on all devices at once (if devices shared any data,
+# verification would fail)
+
+fio - <<EOF
+[global]
+size=64m
+blocksize=64k
+ioengine=libaio
+iodepth=8
+direct=1
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+
+$(
+    for path in "${device_paths[@]}"; do
+        printf '[%s]\nfilename=%s\n\n' "$( basename "${path}" )" "${path}"
+    done
+)
+EOF
+
+# ensure that the driver only has the requested number of threads
+
+(( $( find "/proc/${driver_pid}/task" -mindepth 1 -maxdepth 1 | wc -l ) == 2 ))
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,346 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served by callbacks readv and
+# writev when attribute zero_copy is set, including when request data is not
+# laid out contiguously in memory, in which case it is mapped into the driver's
+# memory as several segments, and that the pages holding those segments expose
+# nothing but the request's data.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+
+    /* the most segments that a single request was given in */
+    static int max_iovcnt;
+
+    /* the number of requests given in several segments whose pages held
+       nonzero bytes outside of those segments */
+    static int num_exposed;
+
+    static void update_max_iovcnt(int iovcnt)
+    {
+        int max = __atomic_load_n(&max_iovcnt, __ATOMIC_SEQ_CST);
+
+        while (iovcnt > max
+               && !__atomic_compare_exchange_n(
+                   &max_iovcnt, &max, iovcnt, false, __ATOMIC_SEQ_CST,
+                   __ATOMIC_SEQ_CST
+                   ))
+        {
+        }
+    }
+
+    static bool is_in_segments(const struct iovec *iov, int iovcnt, char *p)
+    {
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            char *const base = iov[i].iov_base;
+
+            if (p >= base && p < base + iov[i].iov_len)
+                return true;
+        }
+
+        return false;
+    }
+
+    /* checks that the pages holding segments have no data of their own */
+    static void check_segments(const struct iovec *iov, int iovcnt)
+    {
+        const uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+        update_max_iovcnt(iovcnt);
+
+        /* a single segment may be a copy in a buffer with other data */
+
+        if (iovcnt == 1)
+            return;
+
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            const uintptr_t start = (uintptr_t)iov[i].iov_base;
+            const uintptr_t end   = start + iov[i].iov_len;
+
+            char *p = (char *)(start - start % page_size);
+            char *const page_end =
+                (char *)(end + (page_size - end % page_size) % page_size);
+
+            for (; p < page_end; ++p)
+            {
+                if (*p != 0 && !is_in_segments(iov, iovcnt, p))
+                {
+                    __atomic_add_fetch(&num_exposed, 1, __ATOMIC_SEQ_CST);
+                    return;
+                }
+            }
+        }
+    }
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = malloc((size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_readv(
+        const struct iovec *iov, int iovcnt, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        char *const data = ctx->private_data;
+
+        check_segments(iov, iovcnt);
+
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            if (iov[i].iov_len > size)
+                return EIO;
+
+            memcpy(iov[i].iov_base, data + offset, iov[i].iov_len);
+
+            offset += iov[i].iov_len;
+            size -= (uint32_t)iov[i].iov_len;
+        }
+
+        return size == 0 ? 0 : EIO;
+    }
+
+    static int device_writev(
+        const struct iovec *iov, int iovcnt, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        char *const data = ctx->private_data;
+
+        check_segments(iov, iovcnt);
+
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            if (iov[i].iov_len > size)
+                return EIO;
+
+            memcpy(data + offset, iov[i].iov_base, iov[i].iov_len);
+
+            offset += iov[i].iov_len;
+            size -= (uint32_t)iov[i].iov_len;
+        }
+
+        return size == 0 ? 0 : EIO;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize = device_initialize,
+        .terminate  = device_terminate,
+        .readv      = device_readv,
+        .writev     = device_writev,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = 1 << 20,
+        .logical_block_size         = 512,
+        .max_concurrent_callbacks   = 4,
+        .disable_partition_scanning = true,
+        .zero_copy                  = true,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 2 || !bdus_run(&device_ops, &device_attrs, NULL))
+            return 1;
+
+        /* report results once the device is destroyed */
+
+        FILE *const report = fopen(argv[1], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(report, "%d %d\n", max_iovcnt, num_exposed);
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+submit_pieces='
+    #define _GNU_SOURCE
+
+    #include <fcntl.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <string.h>
+    #include <sys/mman.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+
+    enum
+    {
+        DEVICE_SIZE = 1 << 20,
+        PIECE_SIZE  = 1 << 10,
+        NUM_PIECES  = 16,
+        PAGE_STRIDE = 1 << 12,
+    };
+
+    /* Writes and reads back consecutive regions of the device, with each
+       request data split into pieces that lie at the given offset within
+       distinct pages of bufs, except that every other piece fills its whole
+       page if mix_whole_pages is true. */
+    static bool write_and_read_back(
+        int fd, char *bufs, size_t piece_offset, bool mix_whole_pages
+        )
+    {
+        char *const write_buf = bufs;
+        char *const read_buf  = bufs + NUM_PIECES * PAGE_STRIDE;
+
+        struct iovec write_iov[NUM_PIECES];
+        struct iovec read_iov[NUM_PIECES];
+
+        size_t request_size = 0;
+
+        for (size_t i = 0; i < NUM_PIECES; ++i)
+        {
+            const bool whole  = mix_whole_pages && i % 2 == 1;
+            const size_t skip = i * PAGE_STRIDE + (whole ? 0 : piece_offset);
+            const size_t size = whole ? PAGE_STRIDE : PIECE_SIZE;
+
+            write_iov[i].iov_base = write_buf + skip;
+            write_iov[i].iov_len  = size;
+            read_iov[i].iov_base  = read_buf + skip;
+            read_iov[i].iov_len   = size;
+
+            request_size += size;
+        }
+
+        for (off_t offset = 0; offset + (off_t)request_size <= DEVICE_SIZE;
+             offset += (off_t)request_size)
+        {
+            for (size_t i = 0; i < NUM_PIECES; ++i)
+            {
+                memset(
+                    write_iov[i].iov_base,
+                    (int)(piece_offset + (size_t)offset / PIECE_SIZE + i),
+                    write_iov[i].iov_len
+                    );
+            }
+
+            if (pwritev(fd, write_iov, NUM_PIECES, offset)
+                != (ssize_t)request_size)
+            {
+                return false;
+            }
+
+            if (preadv(fd, read_iov, NUM_PIECES, offset)
+                != (ssize_t)request_size)
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < NUM_PIECES; ++i)
+            {
+                if (memcmp(
+                        write_iov[i].iov_base, read_iov[i].iov_base,
+                        write_iov[i].iov_len
+                        ) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    int main(int argc, char **argv)
+    {
+        /* with O_DIRECT, request data lives in the buffers given to
+           pwritev() and preadv(), and whole pages of shared mappings can be
+           mapped into the driver memory, here between copies of the pieces
+           that only fill part of a page, as several segments */
+
+        const int fd = open(argv[1], O_RDWR | O_DIRECT);
+
+        if (fd < 0)
+            return 1;
+
+        const size_t bufs_size = 2 * NUM_PIECES * PAGE_STRIDE;
+
+        char *const bufs = mmap(
+            NULL, bufs_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0
+            );
+
+        if (bufs == MAP_FAILED)
+            return 1;
+
+        const bool success = write_and_read_back(fd, bufs, 0, false)
+            && write_and_read_back(fd, bufs, 512, false)
+            && write_and_read_back(fd, bufs, PAGE_STRIDE - PIECE_SIZE, false)
+            && write_and_read_back(fd, bufs, 512, true)
+            && write_and_read_back(fd, bufs, PAGE_STRIDE - PIECE_SIZE, true);
+
+        return success ? 0 : 1;
+    }
+    '
+
+# skip test if kbdus doesn't support zero-copy on this kernel
+
+kernel_is_at_least 4.18 || exit 0
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+# create device
+
+device_path="$( "${driver_binary}" "${report_path}" )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# write and read back data split into pieces, some filling whole pages
+
+run_c submit_pieces "${device_path}"
+
+# ensure that request data was mapped, if debugfs is mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+if [[ -e "${stats_path}" ]]; then
+    for type in read write; do
+        mapped="$( grep "^${type} mapped " "${stats_path}" | cut -d ' ' -f3 )"
+        (( mapped > 0 ))
+    done
+fi
+
+# destroy device and wait for the driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ensure that some request was given to the driver in several segments, and
+# that no pages holding segments exposed other data
+
+read -r max_iovcnt num_exposed < "${report_path}"
+
+(( max_iovcnt > 1 ))
+(( num_exposed == 0 ))
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,115 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that bdus_splice() fails outside of callbacks and that
+# read and write requests are correctly served when callbacks use it, with
+# kbdus transferring their data to and from the given file.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _GNU_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <stdio.h>
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int *const backing_fd = ctx->private_data;
+        return bdus_splice(*backing_fd, offset) ? 0 : bdus_abort;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        const int *const backing_fd = ctx->private_data;
+        return bdus_splice(*backing_fd, offset) ? 0 : bdus_abort;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .read  = device_read,
+        .write = device_write,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                     = 1 << 26,
+        .logical_block_size       = 512,
+        .max_concurrent_callbacks = 4,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 2)
+            return 2;
+
+        /* bdus_splice() may only be called from callbacks */
+
+        if (bdus_splice(0, 0) || errno != EINVAL)
+            return 1;
+
+        int backing_fd = open(argv[1], O_RDWR);
+
+        if (backing_fd < 0)
+            return 1;
+
+        return bdus_run(&device_ops, &device_attrs, &backing_fd) ? 0 : 1;
+    }
+    '
+
+# create backing file
+
+backing_path="$( mktemp )"
+trap '{ rm -f "${backing_path}"; }' EXIT
+
+truncate --size=64M "${backing_path}"
+
+# create device
+
+device_path="$( run_c driver "${backing_path}" )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+
+# write and verify data (O_DIRECT ensures that every request reaches the
+# driver)
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=64k
+ioengine=psync
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+# ensure that the data ended up in the backing file
+
+cmp "${device_path}" "${backing_path}"
+
+# ensure that the data of read and write requests was spliced, if debugfs is
+# mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+if [[ -e "${stats_path}" ]]; then
+    for type in read write; do
+        spliced="$( grep "^${type} spliced " "${stats_path}" | cut -d ' ' -f3 )"
+        (( spliced > 0 ))
+    done
+fi
+
+# ---------------------------------------------------------------------------- #
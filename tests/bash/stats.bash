@@ -0,0 +1,92 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that `bdus stats` and `bdus top` report the requests served
+# by a device's driver over the given interval, and that statistics are no
+# longer available once the device is destroyed.
+
+# ---------------------------------------------------------------------------- #
+
+# compile driver
+
+driver_binary="$( compile_driver_ram )"
+stats_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${stats_path}"; }' EXIT
+
+# create device
+
+device_path="$(
+    "${driver_binary}" max_concurrent_callbacks=2 disable_partition_scanning=1
+    )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# read 16 blocks and write 8 blocks while statistics are being collected
+
+bdus stats --json --interval 3 "${device_path}" > "${stats_path}" &
+stats_pid="$!"
+
+sleep 0.5
+
+for (( i = 0; i < 16; ++i )); do
+    dd if="${device_path}" of=/dev/null bs=4096 count=1 skip="${i}" \
+        iflag=direct status=none
+done
+
+for (( i = 0; i < 8; ++i )); do
+    dd if=/dev/zero of="${device_path}" bs=4096 count=1 seek="${i}" \
+        oflag=direct status=none
+done
+
+wait "${stats_pid}"
+
+# ensure that all requests above were counted (other requests, e.g. from udev,
+# may also have been), that they did not fail, and that their service times
+# were recorded
+
+function type_requests()
+{
+    grep -o "\"$1\": {\"requests\": [0-9]*" "${stats_path}" |
+        grep -o '[0-9]*$'
+}
+
+(( "$( type_requests read )" >= 16 ))
+(( "$( type_requests write )" >= 8 ))
+
+grep -q "^{\"id\": ${device_id}, " "${stats_path}"
+grep -q '"p50_us": [0-9]' "${stats_path}"
+
+if grep -q '"\(errors\|timeouts\)": [1-9]' "${stats_path}"; then
+    exit 1
+fi
+
+# ensure that the table lists requests types and the total, with no errors or
+# timeouts (the last two columns)
+
+bdus stats --interval 0.5 "${device_id}" | awk '
+    $1 == "read" || $1 == "write" { ++num_types }
+    $1 == "total" { total_seen = 1; ok = $(NF - 1) == 0 && $NF == 0 }
+    END { exit num_types != 2 || !total_seen || !ok }
+    '
+
+# ensure that `bdus top` lists the device while it is in use
+
+dd if="${device_path}" of=/dev/null bs=4096 count=256 iflag=direct \
+    status=none &
+dd_pid="$!"
+
+top_json="$( bdus top --json --interval 0.5 --iterations 1 )"
+[[ "${top_json}" == *"{\"id\": ${device_id}, "* ]]
+
+wait "${dd_pid}"
+
+# ensure that statistics are no longer available once the device is destroyed
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+if bdus stats --interval 0.1 "${device_id}" > /dev/null 2>&1; then
+    exit 1
+fi
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,80 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that, when attribute trace_size is positive, the requests
+# served by the driver are recorded in the device's trace and can be obtained
+# with `bdus trace` while the driver runs or after it is killed, and that the
+# trace is removed once the driver terminates successfully.
+
+# ---------------------------------------------------------------------------- #
+
+# compile driver
+
+driver_binary="$( compile_driver_ram )"
+trap '{ rm -f "${driver_binary}"; }' EXIT
+
+# create device
+
+function create_device()
+{
+    "${driver_binary}" trace_size=1024 max_concurrent_callbacks=2 \
+        disable_partition_scanning=1
+}
+
+device_path="$( create_device )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# read 16 blocks starting at 64 KiB and write one block at 256 KiB
+
+for (( i = 0; i < 16; ++i )); do
+    dd if="${device_path}" of=/dev/null bs=4096 count=1 skip=$(( 16 + i )) \
+        iflag=direct status=none
+done
+
+dd if=/dev/zero of="${device_path}" bs=4096 count=1 seek=64 oflag=direct \
+    status=none
+
+# ensure that the trace is ordered by time, that requests were served by the
+# driver's two threads without errors, and that all requests above appear in
+# it (columns are TIME_US THREAD TYPE OFFSET SIZE DURATION_US ERROR)
+
+bdus trace "${device_path}" | awk '
+    NR == 1 { next }
+    $1 + 0 < last_time || $2 >= 2 || $7 != 0 { invalid = 1 }
+    { last_time = $1 + 0 }
+    $3 == "read" && $5 == 4096 && $4 >= 65536 && $4 < 131072 && !($4 in r) {
+        r[$4] = 1
+        ++num_reads
+    }
+    $3 == "write" && $5 == 4096 && $4 == 262144 { write_seen = 1 }
+    END { exit invalid || num_reads != 16 || !write_seen }
+    '
+
+# ensure that the trace is removed once the driver terminates successfully
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+if bdus trace "${device_id}" > /dev/null 2>&1; then
+    exit 1
+fi
+
+# ensure that the trace is left behind if the driver is killed (which also
+# destroys the device, as the driver is not recoverable)
+
+device_path="$( create_device )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+dd if="${device_path}" of=/dev/null bs=4096 count=1 iflag=direct status=none
+
+kill -SIGKILL "${driver_pid}"
+tail --pid="${driver_pid}" -f /dev/null
+
+num_reads="$(
+    bdus trace "${device_id}" | awk '$3 == "read"' | wc -l
+    )"
+(( num_reads > 0 ))
+
+# ---------------------------------------------------------------------------- #
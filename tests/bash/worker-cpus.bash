@@ -0,0 +1,170 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that attributes worker_cpus and worker_numa_nodes restrict
+# the CPUs on which the driver's threads run, that invalid values for them are
+# rejected, and that the CPU affinity of the thread running bdus_run() is
+# restored.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _GNU_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <sched.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = malloc((size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memcpy(buffer, (char *)ctx->private_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memcpy((char *)ctx->private_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize = device_initialize,
+        .terminate  = device_terminate,
+        .read       = device_read,
+        .write      = device_write,
+    };
+
+    /* Usage: driver <report_path> <worker_cpus|-> <worker_numa_nodes|-> */
+    int main(int argc, char **argv)
+    {
+        if (argc != 4)
+            return 2;
+
+        const struct bdus_attrs device_attrs = {
+            .size                       = 1 << 26,
+            .logical_block_size         = 512,
+            .max_concurrent_callbacks   = 4,
+            .num_queues                 = 2,
+            .disable_partition_scanning = true,
+            .worker_cpus       = strcmp(argv[2], "-") ? argv[2] : NULL,
+            .worker_numa_nodes = strcmp(argv[3], "-") ? argv[3] : NULL,
+        };
+
+        cpu_set_t original_cpus;
+        cpu_set_t cpus;
+
+        if (sched_getaffinity(0, sizeof(original_cpus), &original_cpus) != 0)
+            return 1;
+
+        if (!bdus_run(&device_ops, &device_attrs, NULL))
+            return errno == EINVAL ? 3 : 1;
+
+        /* report whether the original affinity was restored once the device
+           is destroyed */
+
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0)
+            return 1;
+
+        FILE *const report = fopen(argv[1], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(report, "%d\n", CPU_EQUAL(&cpus, &original_cpus) ? 1 : 0);
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+# restrict to the first CPU (which is assumed to belong to NUMA node 0)
+
+numa_nodes=( - )
+[[ ! -e /sys/devices/system/node/node0 ]] || numa_nodes+=( 0 )
+
+for worker_numa_nodes in "${numa_nodes[@]}"; do
+
+    # create device
+
+    device_path="$(
+        "${driver_binary}" "${report_path}" 0 "${worker_numa_nodes}"
+        )"
+    driver_pid="$( pgrep --full "${driver_binary}" )"
+
+    # write and verify data
+
+    fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=64k
+ioengine=libaio
+iodepth=8
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+    # ensure that all of the driver's threads may only run on the first CPU
+
+    for status in /proc/"${driver_pid}"/task/*/status; do
+        grep -Fx $'Cpus_allowed_list:\t0' "${status}"
+    done
+
+    # destroy device and wait for the driver to terminate
+
+    bdus destroy "${device_path}"
+    tail --pid="${driver_pid}" -f /dev/null
+
+    # ensure that the original affinity was restored
+
+    (( $( < "${report_path}" ) == 1 ))
+
+done
+
+# reject invalid values (the driver exits with code 3 if bdus_run() fails with
+# EINVAL)
+
+invalid_cpus=(  ''  0-  1-0  0,,1  cpu0  -  )
+invalid_nodes=( -   -   -    -     -     x  )
+
+for i in "${!invalid_cpus[@]}"; do
+    exit_code=0
+    "${driver_binary}" "${report_path}" \
+        "${invalid_cpus[i]}" "${invalid_nodes[i]}" || exit_code="$?"
+    (( exit_code == 3 ))
+done
+
+# ---------------------------------------------------------------------------- #
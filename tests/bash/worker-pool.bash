@@ -0,0 +1,80 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served when attribute
+# min_concurrent_callbacks is less than max_concurrent_callbacks, that worker
+# threads are spawned as requests accumulate, and that they exit once idle.
+
+# ---------------------------------------------------------------------------- #
+
+function count_threads()
+{
+    find "/proc/${driver_pid}/task" -mindepth 1 -maxdepth 1 | wc -l
+}
+
+# compile driver
+
+driver_binary="$( compile_driver_ram )"
+trap '{ rm -f "${driver_binary}"; }' EXIT
+
+# create device
+
+device_path="$(
+    "${driver_binary}" \
+        min_concurrent_callbacks=1 max_concurrent_callbacks=8 \
+        idle_worker_timeout_ms=100 disable_partition_scanning=1
+    )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# count threads while idle
+
+sleep 1
+idle_threads="$( count_threads )"
+
+# write and verify data, counting threads in the meantime
+
+fio - <<EOF &
+[global]
+filename=${device_path}
+size=256m
+blocksize=64k
+ioengine=libaio
+iodepth=32
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+fio_pid="$!"
+
+max_threads="${idle_threads}"
+
+set +o xtrace  # too verbose
+
+while kill -0 "${fio_pid}" 2> /dev/null; do
+    threads="$( count_threads )"
+    (( threads <= max_threads )) || max_threads="${threads}"
+    sleep 0.1
+done
+
+set -o xtrace
+
+wait "${fio_pid}"
+
+# ensure that threads were spawned under load
+
+(( max_threads > idle_threads ))
+
+# ensure that the extra threads exit once idle
+
+for (( i = 0; i < 50; ++i )); do
+    (( $( count_threads ) > idle_threads )) || break
+    sleep 0.1
+done
+
+(( $( count_threads ) == idle_threads ))
+
+# ---------------------------------------------------------------------------- #
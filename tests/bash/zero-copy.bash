@@ -0,0 +1,56 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that requests are correctly served when attribute zero_copy
+# is set, both when request data can be mapped into the driver's memory and
+# when it must be copied, and that the former actually happens.
+
+# ---------------------------------------------------------------------------- #
+
+# skip test if kbdus doesn't support zero-copy on this kernel
+
+kernel_is_at_least 4.18 || exit 0
+
+# create device
+
+device_path="$( run_driver_ram zero_copy=1 )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+
+# skip test if debugfs is not mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+[[ -e "${stats_path}" ]] || exit 0
+
+# write and verify data (with O_DIRECT, request data lives in fio's buffers, and
+# pages of shared mappings can be mapped into the driver's memory while those of
+# private anonymous memory cannot)
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=64m
+blocksize=64k
+ioengine=psync
+direct=1
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+
+[private]
+mem=malloc
+
+[shared]
+stonewall
+mem=mmapshared
+EOF
+
+# ensure that the data of both read and write requests was mapped
+
+for type in read write; do
+    mapped="$( grep "^${type} mapped " "${stats_path}" | cut -d ' ' -f3 )"
+    (( mapped > 0 ))
+done
+
+# ---------------------------------------------------------------------------- #
@@ -0,0 +1,170 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that, when attribute zero_extent_size is positive, reads of
+# regions marked with bdus_set_zero_range() as containing only zeros are
+# served without invoking the driver, and that writes to those regions make
+# subsequent reads of them reach the driver again.
+
+# ---------------------------------------------------------------------------- #
+
+driver='
+    #define _DEFAULT_SOURCE
+
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    /* the workload only writes to the first WRITTEN_SIZE bytes */
+    #define WRITTEN_SIZE (UINT64_C(1) << 24)
+
+    static unsigned long num_unwritten_reads;
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        ctx->private_data = calloc(1, (size_t)ctx->attrs->size);
+        return ctx->private_data ? 0 : ENOMEM;
+    }
+
+    static int device_terminate(struct bdus_ctx *ctx)
+    {
+        free(ctx->private_data);
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        if (offset + size > WRITTEN_SIZE)
+        {
+            __atomic_add_fetch(
+                &num_unwritten_reads, 1, __ATOMIC_RELAXED
+                );
+        }
+
+        memcpy(buffer, (char *)ctx->private_data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memcpy((char *)ctx->private_data + offset, buffer, (size_t)size);
+        return 0;
+    }
+
+    static int device_on_device_available(struct bdus_ctx *ctx)
+    {
+        /* the whole device initially contains only zeros */
+
+        if (!bdus_set_zero_range(ctx, 0, ctx->attrs->size, true))
+            return 1;
+
+        printf("%s\n", ctx->path);
+        return fflush(stdout) == 0 ? 0 : 1;
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize          = device_initialize,
+        .terminate           = device_terminate,
+        .read                = device_read,
+        .write               = device_write,
+        .on_device_available = device_on_device_available,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = 1 << 26,
+        .logical_block_size         = 512,
+        .max_concurrent_callbacks   = 4,
+        .zero_extent_size           = 1 << 12,
+        .disable_partition_scanning = true,
+    };
+
+    int main(int argc, char **argv)
+    {
+        if (argc != 2 || !bdus_run(&device_ops, &device_attrs, NULL))
+            return 1;
+
+        /* report unwritten reads once the device is destroyed */
+
+        FILE *const report = fopen(argv[1], "w");
+
+        if (!report)
+            return 1;
+
+        fprintf(report, "%lu\n", num_unwritten_reads);
+
+        return fclose(report) == 0 ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+report_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${report_path}"; }' EXIT
+
+# create device
+
+device_path="$( "${driver_binary}" "${report_path}" )"
+device_id="$( basename "${device_path}" | cut -d '-' -f2 )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+# ensure that the whole device reads as zeros
+
+cmp --bytes=$(( 1 << 26 )) <( dd if="${device_path}" bs=1M iflag=direct ) \
+    /dev/zero
+
+# write and verify data in the first 16 MiB (verification only succeeds if
+# reads of written regions reach the driver)
+
+fio - <<EOF
+[global]
+filename=${device_path}
+size=16m
+blocksize=4k
+ioengine=libaio
+iodepth=16
+direct=1
+
+[write-verify]
+readwrite=randwrite
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+# ensure that the rest of the device still reads as zeros
+
+cmp --bytes=$(( 48 << 20 )) \
+    <( dd if="${device_path}" bs=1M skip=16 iflag=direct ) /dev/zero
+
+# ensure that reads were served from the zero map, if debugfs is mounted
+
+stats_path="/sys/kernel/debug/kbdus/bdus-${device_id}/stats"
+
+if [[ -e "${stats_path}" ]]; then
+    hits="$( grep '^zero_extents hits ' "${stats_path}" | cut -d ' ' -f3 )"
+    (( hits > 0 ))
+fi
+
+# destroy device and wait for the driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ensure that no read of an unwritten region reached the driver
+
+read -r num_unwritten_reads < "${report_path}"
+
+(( num_unwritten_reads == 0 ))
+
+# ---------------------------------------------------------------------------- #
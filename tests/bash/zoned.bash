@@ -0,0 +1,333 @@
+# SPDX-License-Identifier: MIT
+# ---------------------------------------------------------------------------- #
+
+# This test ensures that drivers implementing callback report_zones export a
+# host-managed zoned device whose zones are reported, written sequentially,
+# opened, closed, finished, and reset through the driver's callbacks, and that
+# data written to it with fio's zoned mode is correctly read back.
+
+# ---------------------------------------------------------------------------- #
+
+# skip test if kbdus can't export zoned devices on this kernel
+
+kernel_is_at_least 5.10 || exit 0
+
+driver='
+    #include <bdus.h>
+
+    #include <errno.h>
+    #include <pthread.h>
+    #include <stdbool.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <string.h>
+
+    #define ZONE_SIZE (UINT64_C(1) << 22)
+    #define NUM_ZONES 8
+
+    static char data[NUM_ZONES * ZONE_SIZE];
+    static uint64_t write_pointers[NUM_ZONES];
+    static uint8_t conditions[NUM_ZONES];
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    /* writes at the write pointer of the zone containing offset, which must
+     * be that write pointer unless appending */
+    static int write_to_zone(
+        const char *buffer, uint64_t offset, uint32_t size, bool append,
+        uint64_t *out_offset
+        )
+    {
+        const size_t zone = (size_t)(offset / ZONE_SIZE);
+        int ret = 0;
+
+        pthread_mutex_lock(&mutex);
+
+        const uint64_t wp = write_pointers[zone];
+
+        if ((!append && offset != wp) || wp + size > (zone + 1) * ZONE_SIZE)
+        {
+            ret = 5; /* EIO */
+        }
+        else
+        {
+            memcpy(data + wp, buffer, (size_t)size);
+
+            write_pointers[zone] = wp + size;
+
+            if (wp + size == (zone + 1) * ZONE_SIZE)
+                conditions[zone] = bdus_zone_full;
+            else if (conditions[zone] != bdus_zone_explicit_open)
+                conditions[zone] = bdus_zone_implicit_open;
+
+            *out_offset = wp;
+        }
+
+        pthread_mutex_unlock(&mutex);
+
+        return ret;
+    }
+
+    static int device_initialize(struct bdus_ctx *ctx)
+    {
+        /* zoned devices can keep track of neither zeros nor cached data */
+
+        if (ctx->attrs->zone_size != ZONE_SIZE
+            || ctx->attrs->max_zone_append_size == 0
+            || ctx->attrs->zero_extent_size != 0
+            || ctx->attrs->read_cache_size != 0)
+        {
+            return EINVAL;
+        }
+
+        for (size_t i = 0; i < NUM_ZONES; ++i)
+        {
+            write_pointers[i] = i * ZONE_SIZE;
+            conditions[i]     = bdus_zone_empty;
+        }
+
+        return 0;
+    }
+
+    static int device_read(
+        char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        memcpy(buffer, data + offset, (size_t)size);
+        return 0;
+    }
+
+    static int device_write(
+        const char *buffer, uint64_t offset, uint32_t size,
+        struct bdus_ctx *ctx
+        )
+    {
+        uint64_t written_offset;
+        return write_to_zone(buffer, offset, size, false, &written_offset);
+    }
+
+    static int device_report_zones(
+        struct bdus_zone *zones, uint64_t offset, uint32_t num_zones,
+        struct bdus_ctx *ctx
+        )
+    {
+        pthread_mutex_lock(&mutex);
+
+        for (uint32_t i = 0; i < num_zones; ++i)
+        {
+            const size_t zone = (size_t)(offset / ZONE_SIZE) + i;
+
+            zones[i].offset        = zone * ZONE_SIZE;
+            zones[i].size          = ZONE_SIZE;
+            zones[i].capacity      = ZONE_SIZE;
+            zones[i].write_pointer = write_pointers[zone];
+            zones[i].type          = bdus_zone_sequential;
+            zones[i].condition     = conditions[zone];
+        }
+
+        pthread_mutex_unlock(&mutex);
+
+        return 0;
+    }
+
+    /* sets the write pointer of the zone at offset to its start (reset) or
+     * end (finish), and otherwise sets its condition as if opened or closed */
+    static int set_zone(uint64_t offset, uint8_t condition)
+    {
+        const size_t zone = (size_t)(offset / ZONE_SIZE);
+
+        pthread_mutex_lock(&mutex);
+
+        if (condition == bdus_zone_empty)
+            write_pointers[zone] = offset;
+        else if (condition == bdus_zone_full)
+            write_pointers[zone] = offset + ZONE_SIZE;
+
+        /* closing a zone that was not written leaves it empty */
+        if (condition == bdus_zone_closed && write_pointers[zone] == offset)
+            condition = bdus_zone_empty;
+
+        if (conditions[zone] != bdus_zone_full
+            || condition == bdus_zone_empty)
+        {
+            conditions[zone] = condition;
+        }
+
+        pthread_mutex_unlock(&mutex);
+
+        return 0;
+    }
+
+    static int device_reset_zone(uint64_t offset, struct bdus_ctx *ctx)
+    {
+        return set_zone(offset, bdus_zone_empty);
+    }
+
+    static int device_open_zone(uint64_t offset, struct bdus_ctx *ctx)
+    {
+        return set_zone(offset, bdus_zone_explicit_open);
+    }
+
+    static int device_close_zone(uint64_t offset, struct bdus_ctx *ctx)
+    {
+        return set_zone(offset, bdus_zone_closed);
+    }
+
+    static int device_finish_zone(uint64_t offset, struct bdus_ctx *ctx)
+    {
+        return set_zone(offset, bdus_zone_full);
+    }
+
+    static int device_append_to_zone(
+        const char *buffer, uint64_t zone_offset, uint32_t size,
+        uint64_t *out_offset, struct bdus_ctx *ctx
+        )
+    {
+        return write_to_zone(buffer, zone_offset, size, true, out_offset);
+    }
+
+    static const struct bdus_ops device_ops = {
+        .initialize     = device_initialize,
+        .read           = device_read,
+        .write          = device_write,
+        .report_zones   = device_report_zones,
+        .reset_zone     = device_reset_zone,
+        .open_zone      = device_open_zone,
+        .close_zone     = device_close_zone,
+        .finish_zone    = device_finish_zone,
+        .append_to_zone = device_append_to_zone,
+    };
+
+    static const struct bdus_attrs device_attrs = {
+        .size                       = NUM_ZONES * ZONE_SIZE,
+        .logical_block_size         = 512,
+        .max_concurrent_callbacks   = 4,
+        .zone_size                  = ZONE_SIZE,
+        .zero_extent_size           = 1 << 12,
+        .read_cache_size            = 1 << 20,
+        .disable_partition_scanning = true,
+    };
+
+    int main(void)
+    {
+        return bdus_run(&device_ops, &device_attrs, NULL) ? 0 : 1;
+    }
+    '
+
+# compile driver
+
+driver_binary="$( compile_c driver )"
+data_path="$( mktemp )"
+trap '{ rm -f "${driver_binary}" "${data_path}"; }' EXIT
+
+# create device
+
+device_path="$( "${driver_binary}" )"
+driver_pid="$( pgrep --full "${driver_binary}" )"
+
+queue_path="/sys/block/$( basename "${device_path}" )/queue"
+zone_sectors=8192
+
+# ensures that zone $1 has its write pointer $2 sectors into it and condition $3
+# (as abbreviated by blkzone)
+
+function check_zone()
+{
+    local report regex
+
+    report="$(
+        blkzone report --offset "$(( $1 * zone_sectors ))" --count 1 \
+            "${device_path}"
+        )"
+
+    regex='wptr (0x[0-9a-f]+).*zcond: *[0-9]+\(([a-z]+)\)'
+
+    [[ "${report}" =~ ${regex} ]]
+    (( BASH_REMATCH[1] == $2 )) && [[ "${BASH_REMATCH[2]}" == "$3" ]]
+}
+
+# ensure that the device is a host-managed zoned device with 8 empty sequential
+# write required zones of 4 MiB that supports zone append requests
+
+[[ "$( cat "${queue_path}/zoned" )" == host-managed ]]
+(( "$( cat "${queue_path}/chunk_sectors" )" == zone_sectors ))
+(( "$( cat "${queue_path}/nr_zones" )" == 8 ))
+(( "$( cat "${queue_path}/zone_append_max_bytes" )" > 0 ))
+
+(( "$(
+    blkzone report "${device_path}" | grep -c 'SEQ_WRITE_REQUIRED'
+    )" == 8 ))
+
+for (( i = 0; i < 8; ++i )); do
+    check_zone "${i}" 0 em
+done
+
+# write two blocks sequentially to the second zone and read them back
+
+head -c 131072 /dev/urandom > "${data_path}"
+
+dd if="${data_path}" of="${device_path}" bs=65536 count=1 \
+    seek="$(( zone_sectors / 128 ))" oflag=direct status=none
+dd if="${data_path}" of="${device_path}" bs=65536 count=1 skip=1 \
+    seek="$(( zone_sectors / 128 + 1 ))" oflag=direct status=none
+
+check_zone 1 256 oi
+
+cmp "${data_path}" <(
+    dd if="${device_path}" bs=65536 count=2 skip="$(( zone_sectors / 128 ))" \
+        iflag=direct status=none
+    )
+
+# ensure that writing anywhere other than the write pointer fails
+
+if dd if="${data_path}" of="${device_path}" bs=65536 count=1 \
+    seek="$(( zone_sectors / 128 ))" oflag=direct status=none; then
+    exit 1
+fi
+
+check_zone 1 256 oi
+
+# finish the third zone, reset the second one, and open and close the fourth
+
+blkzone finish --offset "$(( 2 * zone_sectors ))" --count 1 "${device_path}"
+blkzone reset --offset "${zone_sectors}" --count 1 "${device_path}"
+
+check_zone 1 0 em
+check_zone 2 "${zone_sectors}" fu
+
+blkzone open --offset "$(( 3 * zone_sectors ))" --count 1 "${device_path}"
+check_zone 3 0 oe
+
+blkzone close --offset "$(( 3 * zone_sectors ))" --count 1 "${device_path}"
+check_zone 3 0 em
+
+# write and verify data with fio in zoned mode in the last four zones
+
+fio - <<EOF
+[global]
+filename=${device_path}
+offset=16m
+size=16m
+blocksize=64k
+ioengine=libaio
+iodepth=4
+direct=1
+zonemode=zbd
+
+[write-verify]
+readwrite=write
+verify=crc32c
+verify_fatal=1
+verify_state_save=0
+EOF
+
+for (( i = 4; i < 8; ++i )); do
+    check_zone "${i}" "${zone_sectors}" fu
+done
+
+# destroy device and wait for the driver to terminate
+
+bdus destroy "${device_path}"
+tail --pid="${driver_pid}" -f /dev/null
+
+# ---------------------------------------------------------------------------- #
@@ -102,6 +102,7 @@ static const struct bdus_attrs good_attrs[] = {
         .max_concurrent_callbacks   = UINT32_MAX,
         .disable_partition_scanning = true,
         .log                        = true,
+        .num_queues                 = UINT32_MAX,
     },
 };
 
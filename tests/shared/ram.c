@@ -166,16 +166,125 @@ static const struct bdus_ops device_ops = {
     .ioctl        = device_ioctl,
 };
 
-static const struct bdus_attrs device_attrs = {
-    .size                     = 1 << 30, // 1 GiB
-    .logical_block_size       = 512,
-    .max_concurrent_callbacks = 8,
-};
+/* -------------------------------------------------------------------------- */
+
+#define device_parse_attr_bool_(attrs, arg, value, attr)                       \
+    do                                                                         \
+    {                                                                          \
+        if (strcmp((arg), #attr) == 0)                                         \
+        {                                                                      \
+            (attrs)->attr = (value) != 0;                                      \
+            return (value) <= 1;                                               \
+        }                                                                      \
+    } while (0)
+
+#define device_parse_attr_u32_(attrs, arg, value, attr)                        \
+    do                                                                         \
+    {                                                                          \
+        if (strcmp((arg), #attr) == 0)                                         \
+        {                                                                      \
+            (attrs)->attr = (uint32_t)(value);                                 \
+            return (value) <= UINT32_MAX;                                      \
+        }                                                                      \
+    } while (0)
+
+// Sets the attribute given by an argument of the form <name>=<value>. Returns
+// false if the argument is invalid.
+static bool device_parse_attr(struct bdus_attrs *attrs, char *arg)
+{
+    char *const value_str = strchr(arg, '=');
+
+    if (!value_str)
+        return false;
+
+    *value_str = '\0';
+
+    // string attributes
+
+    if (strcmp(arg, "worker_cpus") == 0)
+    {
+        attrs->worker_cpus = value_str + 1;
+        return true;
+    }
+
+    if (strcmp(arg, "worker_numa_nodes") == 0)
+    {
+        attrs->worker_numa_nodes = value_str + 1;
+        return true;
+    }
+
+    // numeric attributes
+
+    char *end;
+
+    errno = 0;
+    const unsigned long long value = strtoull(value_str + 1, &end, 0);
+
+    if (errno != 0 || end == value_str + 1 || *end != '\0')
+        return false;
+
+    if (strcmp(arg, "size") == 0)
+    {
+        attrs->size = (uint64_t)value;
+        return true;
+    }
+
+    if (strcmp(arg, "dispatch_policy") == 0)
+    {
+        attrs->dispatch_policy = (enum bdus_dispatch_policy)value;
+        return value <= UINT32_MAX;
+    }
+
+    device_parse_attr_u32_(attrs, arg, value, logical_block_size);
+    device_parse_attr_u32_(attrs, arg, value, physical_block_size);
+    device_parse_attr_u32_(attrs, arg, value, max_concurrent_callbacks);
+    device_parse_attr_u32_(attrs, arg, value, max_read_write_size);
+    device_parse_attr_u32_(attrs, arg, value, max_write_same_size);
+    device_parse_attr_u32_(attrs, arg, value, max_write_zeros_size);
+    device_parse_attr_u32_(attrs, arg, value, max_discard_erase_size);
+    device_parse_attr_u32_(attrs, arg, value, num_queues);
+    device_parse_attr_u32_(attrs, arg, value, min_concurrent_callbacks);
+    device_parse_attr_u32_(attrs, arg, value, idle_worker_timeout_ms);
+    device_parse_attr_u32_(attrs, arg, value, num_poll_queues);
+    device_parse_attr_u32_(attrs, arg, value, busy_poll_us);
+    device_parse_attr_u32_(attrs, arg, value, max_discard_ranges);
+    device_parse_attr_u32_(attrs, arg, value, zero_extent_size);
+    device_parse_attr_u32_(attrs, arg, value, read_cache_size);
+    device_parse_attr_u32_(attrs, arg, value, trace_size);
+    device_parse_attr_u32_(attrs, arg, value, chunk_size);
+
+    device_parse_attr_bool_(attrs, arg, value, disable_partition_scanning);
+    device_parse_attr_bool_(attrs, arg, value, use_io_uring);
+    device_parse_attr_bool_(attrs, arg, value, io_uring_polling);
+    device_parse_attr_bool_(attrs, arg, value, zero_copy);
+
+    return false;
+}
+
+#undef device_parse_attr_u32_
+#undef device_parse_attr_bool_
 
 /* -------------------------------------------------------------------------- */
 
-int main(void)
+// Usage: ram [<attr>=<value>...]
+
+int main(int argc, char **argv)
 {
+    struct bdus_attrs device_attrs = {
+        .size                     = 1 << 30, // 1 GiB
+        .logical_block_size       = 512,
+        .max_concurrent_callbacks = 8,
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!device_parse_attr(&device_attrs, argv[i]))
+        {
+            fprintf(stderr, "Usage: %s [<attr>=<value>...]\n", argv[0]);
+            return 2;
+        }
+    }
+
     const bool success = bdus_run(&device_ops, &device_attrs, NULL);
 
     if (!success)